@@ -1,5 +1,7 @@
 // SPDX-License-Identifier: GPL-2.0+
 
+#include <cmath>
+
 #include "DsoConfigAnalysisPage.h"
 
 DsoConfigAnalysisPage::DsoConfigAnalysisPage(DsoSettings *settings, QWidget *parent)
@@ -39,6 +41,37 @@ DsoConfigAnalysisPage::DsoConfigAnalysisPage(DsoSettings *settings, QWidget *par
     minimumMagnitudeLayout->addWidget(minimumMagnitudeSpinBox);
     minimumMagnitudeLayout->addWidget(minimumMagnitudeUnitLabel);
 
+    averagingLabel = new QLabel(tr("Averaging"));
+    averagingComboBox = new QComboBox();
+    for (Dso::SpectrumAveraging averaging : Dso::SpectrumAveragingEnum)
+        averagingComboBox->addItem(Dso::spectrumAveragingString(averaging));
+    averagingComboBox->setCurrentIndex((int)settings->post.spectrumAveraging);
+
+    averageCountLabel = new QLabel(tr("Frames / segments"));
+    averageCountSpinBox = new QSpinBox();
+    averageCountSpinBox->setMinimum(2);
+    averageCountSpinBox->setMaximum(1024);
+    averageCountSpinBox->setValue((int)settings->post.spectrumAverageCount);
+
+    stftLengthLabel = new QLabel(tr("Roll mode STFT length"));
+    stftLengthSpinBox = new QSpinBox();
+    stftLengthSpinBox->setMinimum(64);
+    stftLengthSpinBox->setMaximum(65536);
+    stftLengthSpinBox->setValue((int)settings->post.spectrogramLength);
+
+    stftOverlapLabel = new QLabel(tr("Roll mode STFT overlap"));
+    stftOverlapSpinBox = new QSpinBox();
+    stftOverlapSpinBox->setMinimum(0);
+    stftOverlapSpinBox->setMaximum(95);
+    stftOverlapSpinBox->setSuffix(tr(" %"));
+    stftOverlapSpinBox->setValue((int)std::round(settings->post.spectrogramOverlap * 100));
+
+    waterfallDepthLabel = new QLabel(tr("Waterfall rows"));
+    waterfallDepthSpinBox = new QSpinBox();
+    waterfallDepthSpinBox->setMinimum(16);
+    waterfallDepthSpinBox->setMaximum(4096);
+    waterfallDepthSpinBox->setValue((int)settings->view.waterfallDepth);
+
     spectrumLayout = new QGridLayout();
     spectrumLayout->addWidget(windowFunctionLabel, 0, 0);
     spectrumLayout->addWidget(windowFunctionComboBox, 0, 1);
@@ -46,12 +79,81 @@ DsoConfigAnalysisPage::DsoConfigAnalysisPage(DsoSettings *settings, QWidget *par
     spectrumLayout->addLayout(referenceLevelLayout, 1, 1);
     spectrumLayout->addWidget(minimumMagnitudeLabel, 2, 0);
     spectrumLayout->addLayout(minimumMagnitudeLayout, 2, 1);
+    spectrumLayout->addWidget(averagingLabel, 3, 0);
+    spectrumLayout->addWidget(averagingComboBox, 3, 1);
+    spectrumLayout->addWidget(averageCountLabel, 4, 0);
+    spectrumLayout->addWidget(averageCountSpinBox, 4, 1);
+    spectrumLayout->addWidget(stftLengthLabel, 5, 0);
+    spectrumLayout->addWidget(stftLengthSpinBox, 5, 1);
+    spectrumLayout->addWidget(stftOverlapLabel, 6, 0);
+    spectrumLayout->addWidget(stftOverlapSpinBox, 6, 1);
+    spectrumLayout->addWidget(waterfallDepthLabel, 7, 0);
+    spectrumLayout->addWidget(waterfallDepthSpinBox, 7, 1);
 
     spectrumGroup = new QGroupBox(tr("Spectrum"));
     spectrumGroup->setLayout(spectrumLayout);
 
+    filterTypeLabel = new QLabel(tr("Filter"));
+    filterTypeComboBox = new QComboBox();
+    for (Dso::FilterType type : Dso::FilterTypeEnum) filterTypeComboBox->addItem(Dso::filterTypeString(type));
+    filterTypeComboBox->setCurrentIndex((int)settings->post.filterType);
+
+    filterDesignLabel = new QLabel(tr("Design"));
+    filterDesignComboBox = new QComboBox();
+    for (Dso::FilterDesign design : Dso::FilterDesignEnum)
+        filterDesignComboBox->addItem(Dso::filterDesignString(design));
+    filterDesignComboBox->setCurrentIndex((int)settings->post.filterDesign);
+
+    filterFrequencyLabel = new QLabel(tr("Corner / center frequency"));
+    filterFrequencySpinBox = new QDoubleSpinBox();
+    filterFrequencySpinBox->setDecimals(2);
+    filterFrequencySpinBox->setMinimum(0.01);
+    filterFrequencySpinBox->setMaximum(100e6);
+    filterFrequencySpinBox->setSuffix(tr(" Hz"));
+    filterFrequencySpinBox->setValue(settings->post.filterFrequency);
+
+    filterBandwidthLabel = new QLabel(tr("Bandwidth"));
+    filterBandwidthSpinBox = new QDoubleSpinBox();
+    filterBandwidthSpinBox->setDecimals(2);
+    filterBandwidthSpinBox->setMinimum(0.01);
+    filterBandwidthSpinBox->setMaximum(100e6);
+    filterBandwidthSpinBox->setSuffix(tr(" Hz"));
+    filterBandwidthSpinBox->setValue(settings->post.filterBandwidth);
+
+    filterOrderLabel = new QLabel(tr("IIR order"));
+    filterOrderSpinBox = new QSpinBox();
+    filterOrderSpinBox->setMinimum(2);
+    filterOrderSpinBox->setMaximum(16);
+    filterOrderSpinBox->setSingleStep(2);
+    filterOrderSpinBox->setValue((int)settings->post.filterOrder);
+
+    filterTapsLabel = new QLabel(tr("FIR taps"));
+    filterTapsSpinBox = new QSpinBox();
+    filterTapsSpinBox->setMinimum(3);
+    filterTapsSpinBox->setMaximum(65535);
+    filterTapsSpinBox->setSingleStep(2);
+    filterTapsSpinBox->setValue((int)settings->post.filterTaps);
+
+    filterLayout = new QGridLayout();
+    filterLayout->addWidget(filterTypeLabel, 0, 0);
+    filterLayout->addWidget(filterTypeComboBox, 0, 1);
+    filterLayout->addWidget(filterDesignLabel, 1, 0);
+    filterLayout->addWidget(filterDesignComboBox, 1, 1);
+    filterLayout->addWidget(filterFrequencyLabel, 2, 0);
+    filterLayout->addWidget(filterFrequencySpinBox, 2, 1);
+    filterLayout->addWidget(filterBandwidthLabel, 3, 0);
+    filterLayout->addWidget(filterBandwidthSpinBox, 3, 1);
+    filterLayout->addWidget(filterOrderLabel, 4, 0);
+    filterLayout->addWidget(filterOrderSpinBox, 4, 1);
+    filterLayout->addWidget(filterTapsLabel, 5, 0);
+    filterLayout->addWidget(filterTapsSpinBox, 5, 1);
+
+    filterGroup = new QGroupBox(tr("Channel filter"));
+    filterGroup->setLayout(filterLayout);
+
     mainLayout = new QVBoxLayout();
     mainLayout->addWidget(spectrumGroup);
+    mainLayout->addWidget(filterGroup);
     mainLayout->addStretch(1);
 
     setLayout(mainLayout);
@@ -62,4 +164,15 @@ void DsoConfigAnalysisPage::saveSettings() {
     settings->post.spectrumWindow = (Dso::WindowFunction)windowFunctionComboBox->currentIndex();
     settings->post.spectrumReference = referenceLevelSpinBox->value();
     settings->post.spectrumLimit = minimumMagnitudeSpinBox->value();
+    settings->post.spectrumAveraging = (Dso::SpectrumAveraging)averagingComboBox->currentIndex();
+    settings->post.spectrumAverageCount = (unsigned)averageCountSpinBox->value();
+    settings->post.spectrogramLength = (unsigned)stftLengthSpinBox->value();
+    settings->post.spectrogramOverlap = stftOverlapSpinBox->value() / 100.0;
+    settings->view.waterfallDepth = (unsigned)waterfallDepthSpinBox->value();
+    settings->post.filterType = (Dso::FilterType)filterTypeComboBox->currentIndex();
+    settings->post.filterDesign = (Dso::FilterDesign)filterDesignComboBox->currentIndex();
+    settings->post.filterFrequency = filterFrequencySpinBox->value();
+    settings->post.filterBandwidth = filterBandwidthSpinBox->value();
+    settings->post.filterOrder = (unsigned)filterOrderSpinBox->value();
+    settings->post.filterTaps = (unsigned)filterTapsSpinBox->value() | 1u;
 }
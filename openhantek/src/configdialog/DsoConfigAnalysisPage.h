@@ -45,4 +45,31 @@ class DsoConfigAnalysisPage : public QWidget {
     QDoubleSpinBox *minimumMagnitudeSpinBox;
     QLabel *minimumMagnitudeUnitLabel;
     QHBoxLayout *minimumMagnitudeLayout;
+
+    QLabel *averagingLabel;
+    QComboBox *averagingComboBox;
+    QLabel *averageCountLabel;
+    QSpinBox *averageCountSpinBox;
+
+    QLabel *stftLengthLabel;
+    QSpinBox *stftLengthSpinBox;
+    QLabel *stftOverlapLabel;
+    QSpinBox *stftOverlapSpinBox;
+    QLabel *waterfallDepthLabel;
+    QSpinBox *waterfallDepthSpinBox;
+
+    QGroupBox *filterGroup;
+    QGridLayout *filterLayout;
+    QLabel *filterTypeLabel;
+    QComboBox *filterTypeComboBox;
+    QLabel *filterDesignLabel;
+    QComboBox *filterDesignComboBox;
+    QLabel *filterFrequencyLabel;
+    QDoubleSpinBox *filterFrequencySpinBox;
+    QLabel *filterBandwidthLabel;
+    QDoubleSpinBox *filterBandwidthSpinBox;
+    QLabel *filterOrderLabel;
+    QSpinBox *filterOrderSpinBox;
+    QLabel *filterTapsLabel;
+    QSpinBox *filterTapsSpinBox;
 };
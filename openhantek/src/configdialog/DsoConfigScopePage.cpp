@@ -1,11 +1,13 @@
 // SPDX-License-Identifier: GPL-2.0+
 
+#include <cmath>
+
 #include "DsoConfigScopePage.h"
 
 DsoConfigScopePage::DsoConfigScopePage(DsoSettings *settings, QWidget *parent) : QWidget(parent), settings(settings) {
     // Initialize lists for comboboxes
     QStringList interpolationStrings;
-    interpolationStrings << tr("Off") << tr("Linear");
+    interpolationStrings << tr("Off") << tr("Linear") << tr("Sin(x)/x");
 
     // Initialize elements
     interpolationLabel = new QLabel(tr("Interpolation"));
@@ -17,12 +19,20 @@ DsoConfigScopePage::DsoConfigScopePage(DsoSettings *settings, QWidget *parent) :
     digitalPhosphorDepthSpinBox->setMinimum(2);
     digitalPhosphorDepthSpinBox->setMaximum(99);
     digitalPhosphorDepthSpinBox->setValue(settings->view.digitalPhosphorDepth);
+    xyPersistenceLabel = new QLabel(tr("XY density persistence"));
+    xyPersistenceSpinBox = new QSpinBox();
+    xyPersistenceSpinBox->setMinimum(0);
+    xyPersistenceSpinBox->setMaximum(99);
+    xyPersistenceSpinBox->setSuffix(tr(" %"));
+    xyPersistenceSpinBox->setValue((int)std::round(settings->view.xyPersistence * 100));
 
     graphLayout = new QGridLayout();
     graphLayout->addWidget(interpolationLabel, 1, 0);
     graphLayout->addWidget(interpolationComboBox, 1, 1);
     graphLayout->addWidget(digitalPhosphorDepthLabel, 2, 0);
     graphLayout->addWidget(digitalPhosphorDepthSpinBox, 2, 1);
+    graphLayout->addWidget(xyPersistenceLabel, 3, 0);
+    graphLayout->addWidget(xyPersistenceSpinBox, 3, 1);
 
     graphGroup = new QGroupBox(tr("Graph"));
     graphGroup->setLayout(graphLayout);
@@ -38,4 +48,5 @@ DsoConfigScopePage::DsoConfigScopePage(DsoSettings *settings, QWidget *parent) :
 void DsoConfigScopePage::saveSettings() {
     settings->view.interpolation = (Dso::InterpolationMode)interpolationComboBox->currentIndex();
     settings->view.digitalPhosphorDepth = digitalPhosphorDepthSpinBox->value();
+    settings->view.xyPersistence = xyPersistenceSpinBox->value() / 100.0;
 }
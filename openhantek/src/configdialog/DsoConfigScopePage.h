@@ -35,6 +35,8 @@ class DsoConfigScopePage : public QWidget {
     QGridLayout *graphLayout;
     QLabel *digitalPhosphorDepthLabel;
     QSpinBox *digitalPhosphorDepthSpinBox;
+    QLabel *xyPersistenceLabel;
+    QSpinBox *xyPersistenceSpinBox;
     QLabel *interpolationLabel;
     QComboBox *interpolationComboBox;
 };
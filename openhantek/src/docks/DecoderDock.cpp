@@ -0,0 +1,143 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QCheckBox>
+#include <QCloseEvent>
+#include <QComboBox>
+#include <QDockWidget>
+#include <QDoubleSpinBox>
+#include <QLabel>
+#include <QSpinBox>
+
+#include <algorithm>
+
+#include "DecoderDock.h"
+#include "dockwindows.h"
+
+#include "scopesettings.h"
+
+typedef DsoSettingsScopeDecoder::Protocol Protocol;
+typedef DsoSettingsScopeDecoder::Parity Parity;
+
+DecoderDock::DecoderDock(DsoSettingsScope *scope, QWidget *parent, Qt::WindowFlags flags)
+    : QDockWidget(tr("Protocol decoder"), parent, flags), scope(scope) {
+
+    protocolComboBox = new QComboBox();
+    protocolComboBox->addItems({tr("Off"), tr("UART"), tr("SPI"), tr("I2C")});
+
+    dataLabel = new QLabel();
+    dataComboBox = new QComboBox();
+    clockLabel = new QLabel();
+    clockComboBox = new QComboBox();
+    for (const DsoSettingsScopeVoltage &voltage : scope->voltage) {
+        dataComboBox->addItem(voltage.name);
+        clockComboBox->addItem(voltage.name);
+    }
+
+    thresholdSpinBox = new QDoubleSpinBox();
+    thresholdSpinBox->setRange(-100.0, 100.0);
+    thresholdSpinBox->setDecimals(2);
+    thresholdSpinBox->setSingleStep(0.1);
+    thresholdSpinBox->setSuffix(tr(" V"));
+
+    baudrateSpinBox = new QSpinBox();
+    baudrateSpinBox->setRange(1, 100000000);
+    baudrateSpinBox->setSuffix(tr(" Bd"));
+
+    dataBitsSpinBox = new QSpinBox();
+    dataBitsSpinBox->setRange(4, 16);
+
+    parityComboBox = new QComboBox();
+    parityComboBox->addItems({tr("None"), tr("Even"), tr("Odd")});
+
+    spiModeComboBox = new QComboBox();
+    for (unsigned mode = 0; mode < 4; ++mode)
+        spiModeComboBox->addItem(tr("Mode %1 (CPOL %2, CPHA %3)").arg(mode).arg(mode >> 1).arg(mode & 1));
+
+    lsbFirstCheckBox = new QCheckBox(tr("LSB first"));
+
+    dockLayout = new QGridLayout();
+    dockLayout->setColumnMinimumWidth(0, 64);
+    dockLayout->setColumnStretch(1, 1);
+    dockLayout->addWidget(new QLabel(tr("Protocol")), 0, 0);
+    dockLayout->addWidget(protocolComboBox, 0, 1);
+    dockLayout->addWidget(dataLabel, 1, 0);
+    dockLayout->addWidget(dataComboBox, 1, 1);
+    dockLayout->addWidget(clockLabel, 2, 0);
+    dockLayout->addWidget(clockComboBox, 2, 1);
+    dockLayout->addWidget(new QLabel(tr("Threshold")), 3, 0);
+    dockLayout->addWidget(thresholdSpinBox, 3, 1);
+    dockLayout->addWidget(new QLabel(tr("Baudrate")), 4, 0);
+    dockLayout->addWidget(baudrateSpinBox, 4, 1);
+    dockLayout->addWidget(new QLabel(tr("Data bits")), 5, 0);
+    dockLayout->addWidget(dataBitsSpinBox, 5, 1);
+    dockLayout->addWidget(new QLabel(tr("Parity")), 6, 0);
+    dockLayout->addWidget(parityComboBox, 6, 1);
+    dockLayout->addWidget(new QLabel(tr("SPI mode")), 7, 0);
+    dockLayout->addWidget(spiModeComboBox, 7, 1);
+    dockLayout->addWidget(lsbFirstCheckBox, 8, 1);
+
+    dockWidget = new QWidget();
+    SetupDockWidget(this, dockWidget, dockLayout);
+
+    // Set values, fix settings of channels that don't exist
+    if (scope->decoder.dataChannel >= scope->voltage.size()) scope->decoder.dataChannel = 0;
+    if (scope->decoder.clockChannel >= scope->voltage.size()) scope->decoder.clockChannel = 0;
+    scope->decoder.dataBits = std::min(std::max(scope->decoder.dataBits, 4u), 16u);
+    scope->decoder.spiMode &= 3;
+    protocolComboBox->setCurrentIndex((int)scope->decoder.protocol);
+    dataComboBox->setCurrentIndex((int)scope->decoder.dataChannel);
+    clockComboBox->setCurrentIndex((int)scope->decoder.clockChannel);
+    thresholdSpinBox->setValue(scope->decoder.threshold);
+    baudrateSpinBox->setValue((int)scope->decoder.baudrate);
+    dataBitsSpinBox->setValue((int)scope->decoder.dataBits);
+    parityComboBox->setCurrentIndex((int)scope->decoder.parity);
+    spiModeComboBox->setCurrentIndex((int)scope->decoder.spiMode);
+    lsbFirstCheckBox->setChecked(scope->decoder.lsbFirst);
+    updateProtocol();
+
+    // Connect signals and slots
+    connect(protocolComboBox, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+            [this](int index) {
+                this->scope->decoder.protocol = (Protocol)index;
+                updateProtocol();
+            });
+    connect(dataComboBox, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+            [this](int index) { this->scope->decoder.dataChannel = (ChannelID)index; });
+    connect(clockComboBox, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+            [this](int index) { this->scope->decoder.clockChannel = (ChannelID)index; });
+    connect(thresholdSpinBox, static_cast<void (QDoubleSpinBox::*)(double)>(&QDoubleSpinBox::valueChanged),
+            [this](double value) { this->scope->decoder.threshold = value; });
+    connect(baudrateSpinBox, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged),
+            [this](int value) { this->scope->decoder.baudrate = value; });
+    connect(dataBitsSpinBox, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged),
+            [this](int value) { this->scope->decoder.dataBits = (unsigned)value; });
+    connect(parityComboBox, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+            [this](int index) { this->scope->decoder.parity = (Parity)index; });
+    connect(spiModeComboBox, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+            [this](int index) { this->scope->decoder.spiMode = (unsigned)index; });
+    connect(lsbFirstCheckBox, &QCheckBox::toggled, [this](bool checked) { this->scope->decoder.lsbFirst = checked; });
+}
+
+/// \brief Don't close the dock, just hide it
+/// \param event The close event that should be handled.
+void DecoderDock::closeEvent(QCloseEvent *event) {
+    hide();
+    event->accept();
+}
+
+void DecoderDock::updateProtocol() {
+    const Protocol protocol = scope->decoder.protocol;
+    switch (protocol) {
+    case Protocol::UART: dataLabel->setText(tr("RX")); break;
+    case Protocol::I2C: dataLabel->setText(tr("SDA")); break;
+    default: dataLabel->setText(tr("Data")); break;
+    }
+    clockLabel->setText(protocol == Protocol::I2C ? tr("SCL") : tr("Clock"));
+
+    clockComboBox->setEnabled(protocol == Protocol::SPI || protocol == Protocol::I2C);
+    baudrateSpinBox->setEnabled(protocol == Protocol::UART);
+    dataBitsSpinBox->setEnabled(protocol == Protocol::UART || protocol == Protocol::SPI);
+    parityComboBox->setEnabled(protocol == Protocol::UART);
+    spiModeComboBox->setEnabled(protocol == Protocol::SPI);
+    lsbFirstCheckBox->setEnabled(protocol == Protocol::SPI);
+}
@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QDockWidget>
+#include <QGridLayout>
+
+class QCheckBox;
+class QComboBox;
+class QDoubleSpinBox;
+class QLabel;
+class QSpinBox;
+struct DsoSettingsScope;
+
+/// \brief Dock window for the serial protocol decoder.
+/// It selects the protocol, the channels, the logic threshold and the protocol parameters. The decoded words are
+/// shown at the bottom of the scope screen.
+class DecoderDock : public QDockWidget {
+    Q_OBJECT
+
+  public:
+    /// \brief Initializes the protocol decoder docking window.
+    /// \param scope The target settings object.
+    /// \param parent The parent widget.
+    /// \param flags Flags for the window manager.
+    DecoderDock(DsoSettingsScope *scope, QWidget *parent, Qt::WindowFlags flags = 0);
+
+  protected:
+    void closeEvent(QCloseEvent *event);
+    /// \brief Enable the widgets used by the selected protocol.
+    void updateProtocol();
+
+    QGridLayout *dockLayout; ///< The main layout for the dock window
+    QWidget *dockWidget;     ///< The main widget for the dock window
+
+    QComboBox *protocolComboBox;        ///< Off, UART, SPI or I2C
+    QLabel *dataLabel;                  ///< RX, data or SDA
+    QComboBox *dataComboBox;            ///< The data channel
+    QLabel *clockLabel;                 ///< Clock or SCL
+    QComboBox *clockComboBox;           ///< The clock channel
+    QDoubleSpinBox *thresholdSpinBox;   ///< Logic level threshold
+    QSpinBox *baudrateSpinBox;          ///< UART bit rate
+    QSpinBox *dataBitsSpinBox;          ///< UART and SPI word size
+    QComboBox *parityComboBox;          ///< UART parity
+    QComboBox *spiModeComboBox;         ///< SPI clock polarity and phase
+    QCheckBox *lsbFirstCheckBox;        ///< SPI bit order
+
+    DsoSettingsScope *scope; ///< The settings provided by the parent class
+};
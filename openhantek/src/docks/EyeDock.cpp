@@ -0,0 +1,105 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QCheckBox>
+#include <QCloseEvent>
+#include <QComboBox>
+#include <QDockWidget>
+#include <QLabel>
+#include <QPushButton>
+#include <QSpinBox>
+
+#include <cmath>
+
+#include "EyeDock.h"
+#include "dockwindows.h"
+
+#include "post/eyediagramgenerator.h"
+#include "scopesettings.h"
+#include "utils/printutils.h"
+
+/// Refresh interval of the measurements in ms
+static const int REFRESH_INTERVAL = 500;
+
+EyeDock::EyeDock(DsoSettingsScope *scope, EyeDiagramGenerator *eyeDiagramGenerator, QWidget *parent,
+                 Qt::WindowFlags flags)
+    : QDockWidget(tr("Eye diagram"), parent, flags), scope(scope), eyeDiagramGenerator(eyeDiagramGenerator) {
+
+    enabledCheckBox = new QCheckBox(tr("Show eye diagram"));
+
+    channelComboBox = new QComboBox();
+    for (const DsoSettingsScopeVoltage &voltage : scope->voltage) channelComboBox->addItem(voltage.name);
+
+    bitrateSpinBox = new QSpinBox();
+    bitrateSpinBox->setRange(0, 100000000);
+    bitrateSpinBox->setSuffix(tr(" bit/s"));
+    bitrateSpinBox->setSpecialValueText(tr("Auto"));
+
+    bitrateLabel = new QLabel();
+    unitIntervalsLabel = new QLabel();
+    heightLabel = new QLabel();
+    widthLabel = new QLabel();
+    resetButton = new QPushButton(tr("Reset"));
+
+    dockLayout = new QGridLayout();
+    dockLayout->setColumnMinimumWidth(0, 64);
+    dockLayout->setColumnStretch(1, 1);
+    dockLayout->addWidget(enabledCheckBox, 0, 0, 1, 2);
+    dockLayout->addWidget(new QLabel(tr("Channel")), 1, 0);
+    dockLayout->addWidget(channelComboBox, 1, 1);
+    dockLayout->addWidget(new QLabel(tr("Bit rate")), 2, 0);
+    dockLayout->addWidget(bitrateSpinBox, 2, 1);
+    dockLayout->addWidget(new QLabel(tr("Recovered")), 3, 0);
+    dockLayout->addWidget(bitrateLabel, 3, 1);
+    dockLayout->addWidget(new QLabel(tr("Unit intervals")), 4, 0);
+    dockLayout->addWidget(unitIntervalsLabel, 4, 1);
+    dockLayout->addWidget(new QLabel(tr("Eye height")), 5, 0);
+    dockLayout->addWidget(heightLabel, 5, 1);
+    dockLayout->addWidget(new QLabel(tr("Eye width")), 6, 0);
+    dockLayout->addWidget(widthLabel, 6, 1);
+    dockLayout->addWidget(resetButton, 7, 1);
+
+    dockWidget = new QWidget();
+    SetupDockWidget(this, dockWidget, dockLayout);
+
+    // Set values, fix settings of channels that don't exist
+    if (scope->eye.channel >= scope->voltage.size()) scope->eye.channel = 0;
+    enabledCheckBox->setChecked(scope->eye.enabled);
+    channelComboBox->setCurrentIndex((int)scope->eye.channel);
+    bitrateSpinBox->setValue((int)scope->eye.bitrate);
+
+    // Connect signals and slots
+    connect(enabledCheckBox, &QCheckBox::toggled, [this](bool checked) { this->scope->eye.enabled = checked; });
+    connect(channelComboBox, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+            [this](int index) { this->scope->eye.channel = (ChannelID)index; });
+    connect(bitrateSpinBox, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged),
+            [this](int value) { this->scope->eye.bitrate = value; });
+    connect(resetButton, &QPushButton::clicked, [this]() { this->eyeDiagramGenerator->reset(); });
+    connect(&refreshTimer, &QTimer::timeout, this, &EyeDock::refresh);
+    refreshTimer.start(REFRESH_INTERVAL);
+}
+
+/// \brief Don't close the dock, just hide it
+/// \param event The close event that should be handled.
+void EyeDock::closeEvent(QCloseEvent *event) {
+    hide();
+    event->accept();
+}
+
+void EyeDock::refresh() {
+    if (!isVisible()) return;
+
+    const EyeDiagramGenerator::Measurement eye = eyeDiagramGenerator->measurement();
+    auto format = [](double value, Unit unit) {
+        return std::isnan(value) ? QString("-") : valueToString(value, unit, 4);
+    };
+    bitrateLabel->setText(std::isnan(eye.unitInterval) ? QString("-")
+                                                       : valueToString(1.0 / eye.unitInterval, UNIT_HERTZ, 4));
+    unitIntervalsLabel->setText(QString::number(eye.unitIntervals));
+    heightLabel->setText(format(eye.height, UNIT_VOLTS));
+    if (std::isnan(eye.width))
+        widthLabel->setText("-");
+    else
+        widthLabel->setText(tr("%1 (%2 UI)")
+                                .arg(format(eye.width, UNIT_SECONDS))
+                                .arg(eye.width / eye.unitInterval, 0, 'f', 2));
+}
@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QDockWidget>
+#include <QGridLayout>
+#include <QTimer>
+
+class QCheckBox;
+class QComboBox;
+class QLabel;
+class QPushButton;
+class QSpinBox;
+struct DsoSettingsScope;
+class EyeDiagramGenerator;
+
+/// \brief Dock window for the eye diagram.
+/// It selects the channel and the bit rate and shows the recovered clock and the eye opening. The eye itself is
+/// drawn on the scope screen.
+class EyeDock : public QDockWidget {
+    Q_OBJECT
+
+  public:
+    /// \brief Initializes the eye diagram docking window.
+    /// \param scope The target settings object.
+    /// \param eyeDiagramGenerator The eye diagram that is controlled.
+    /// \param parent The parent widget.
+    /// \param flags Flags for the window manager.
+    EyeDock(DsoSettingsScope *scope, EyeDiagramGenerator *eyeDiagramGenerator, QWidget *parent,
+            Qt::WindowFlags flags = 0);
+
+  protected:
+    void closeEvent(QCloseEvent *event);
+    /// \brief Update the measurements.
+    void refresh();
+
+    QGridLayout *dockLayout; ///< The main layout for the dock window
+    QWidget *dockWidget;     ///< The main widget for the dock window
+    QTimer refreshTimer;     ///< Periodically updates the measurements
+
+    QCheckBox *enabledCheckBox;  ///< Show the eye diagram instead of the graphs
+    QComboBox *channelComboBox;  ///< The analyzed channel
+    QSpinBox *bitrateSpinBox;    ///< The nominal bit rate, 0 to estimate it
+    QLabel *bitrateLabel;        ///< The recovered bit rate
+    QLabel *unitIntervalsLabel;  ///< Number of accumulated unit intervals
+    QLabel *heightLabel;         ///< Vertical eye opening
+    QLabel *widthLabel;          ///< Horizontal eye opening
+    QPushButton *resetButton;    ///< Discard the accumulated eye
+
+    DsoSettingsScope *scope; ///< The settings provided by the parent class
+    EyeDiagramGenerator *eyeDiagramGenerator;
+};
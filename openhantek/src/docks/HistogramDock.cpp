@@ -0,0 +1,106 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QCheckBox>
+#include <QCloseEvent>
+#include <QComboBox>
+#include <QDockWidget>
+#include <QLabel>
+#include <QPushButton>
+
+#include <cmath>
+
+#include "HistogramDock.h"
+#include "dockwindows.h"
+
+#include "post/histogramgenerator.h"
+#include "scopesettings.h"
+#include "utils/printutils.h"
+
+/// Refresh interval of the statistics in ms
+static const int REFRESH_INTERVAL = 500;
+
+typedef DsoSettingsScopeHistogram::Mode Mode;
+
+HistogramDock::HistogramDock(DsoSettingsScope *scope, HistogramGenerator *histogramGenerator, QWidget *parent,
+                             Qt::WindowFlags flags)
+    : QDockWidget(tr("Histogram"), parent, flags), scope(scope), histogramGenerator(histogramGenerator) {
+
+    modeComboBox = new QComboBox();
+    modeComboBox->addItems({tr("Off"), tr("Amplitude"), tr("Period"), tr("Pulse width"), tr("Edge position")});
+
+    channelComboBox = new QComboBox();
+    for (const DsoSettingsScopeVoltage &voltage : scope->voltage) channelComboBox->addItem(voltage.name);
+
+    markersCheckBox = new QCheckBox(tr("Between markers"));
+
+    waveformsLabel = new QLabel();
+    countLabel = new QLabel();
+    meanLabel = new QLabel();
+    deviationLabel = new QLabel();
+    minimumLabel = new QLabel();
+    maximumLabel = new QLabel();
+    resetButton = new QPushButton(tr("Reset"));
+
+    dockLayout = new QGridLayout();
+    dockLayout->setColumnMinimumWidth(0, 64);
+    dockLayout->setColumnStretch(1, 1);
+    dockLayout->addWidget(new QLabel(tr("Mode")), 0, 0);
+    dockLayout->addWidget(modeComboBox, 0, 1);
+    dockLayout->addWidget(new QLabel(tr("Channel")), 1, 0);
+    dockLayout->addWidget(channelComboBox, 1, 1);
+    dockLayout->addWidget(markersCheckBox, 2, 0, 1, 2);
+    dockLayout->addWidget(new QLabel(tr("Waveforms")), 3, 0);
+    dockLayout->addWidget(waveformsLabel, 3, 1);
+    dockLayout->addWidget(new QLabel(tr("Values")), 4, 0);
+    dockLayout->addWidget(countLabel, 4, 1);
+    dockLayout->addWidget(new QLabel(tr("Mean")), 5, 0);
+    dockLayout->addWidget(meanLabel, 5, 1);
+    dockLayout->addWidget(new QLabel(tr("Std. dev.")), 6, 0);
+    dockLayout->addWidget(deviationLabel, 6, 1);
+    dockLayout->addWidget(new QLabel(tr("Minimum")), 7, 0);
+    dockLayout->addWidget(minimumLabel, 7, 1);
+    dockLayout->addWidget(new QLabel(tr("Maximum")), 8, 0);
+    dockLayout->addWidget(maximumLabel, 8, 1);
+    dockLayout->addWidget(resetButton, 9, 1);
+
+    dockWidget = new QWidget();
+    SetupDockWidget(this, dockWidget, dockLayout);
+
+    // Set values, fix settings of channels that don't exist
+    if (scope->histogram.channel >= scope->voltage.size()) scope->histogram.channel = 0;
+    modeComboBox->setCurrentIndex((int)scope->histogram.mode);
+    channelComboBox->setCurrentIndex((int)scope->histogram.channel);
+    markersCheckBox->setChecked(scope->histogram.betweenMarkers);
+
+    // Connect signals and slots
+    connect(modeComboBox, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+            [this](int index) { this->scope->histogram.mode = (Mode)index; });
+    connect(channelComboBox, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+            [this](int index) { this->scope->histogram.channel = (ChannelID)index; });
+    connect(markersCheckBox, &QCheckBox::toggled,
+            [this](bool checked) { this->scope->histogram.betweenMarkers = checked; });
+    connect(resetButton, &QPushButton::clicked, [this]() { this->histogramGenerator->reset(); });
+    connect(&refreshTimer, &QTimer::timeout, this, &HistogramDock::refresh);
+    refreshTimer.start(REFRESH_INTERVAL);
+}
+
+/// \brief Don't close the dock, just hide it
+/// \param event The close event that should be handled.
+void HistogramDock::closeEvent(QCloseEvent *event) {
+    hide();
+    event->accept();
+}
+
+void HistogramDock::refresh() {
+    if (!isVisible()) return;
+
+    const ValueHistogram histogram = histogramGenerator->histogram();
+    const Unit unit = histogram.amplitude ? UNIT_VOLTS : UNIT_SECONDS;
+    auto format = [unit](double value) { return std::isnan(value) ? QString("-") : valueToString(value, unit, 4); };
+    waveformsLabel->setText(QString::number(histogram.waveforms));
+    countLabel->setText(QString::number(histogram.count));
+    meanLabel->setText(format(histogram.mean));
+    deviationLabel->setText(format(histogram.deviation));
+    minimumLabel->setText(format(histogram.minimum));
+    maximumLabel->setText(format(histogram.maximum));
+}
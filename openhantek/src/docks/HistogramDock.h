@@ -0,0 +1,53 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QDockWidget>
+#include <QGridLayout>
+#include <QTimer>
+
+class QCheckBox;
+class QComboBox;
+class QLabel;
+class QPushButton;
+struct DsoSettingsScope;
+class HistogramGenerator;
+
+/// \brief Dock window for the histogram analysis.
+/// It selects the quantity, the channel and the time window and shows the statistics of the accumulated values.
+/// The histogram itself is drawn on the scope screen.
+class HistogramDock : public QDockWidget {
+    Q_OBJECT
+
+  public:
+    /// \brief Initializes the histogram docking window.
+    /// \param scope The target settings object.
+    /// \param histogramGenerator The histogram analysis that is controlled.
+    /// \param parent The parent widget.
+    /// \param flags Flags for the window manager.
+    HistogramDock(DsoSettingsScope *scope, HistogramGenerator *histogramGenerator, QWidget *parent,
+                  Qt::WindowFlags flags = 0);
+
+  protected:
+    void closeEvent(QCloseEvent *event);
+    /// \brief Update the statistics.
+    void refresh();
+
+    QGridLayout *dockLayout; ///< The main layout for the dock window
+    QWidget *dockWidget;     ///< The main widget for the dock window
+    QTimer refreshTimer;     ///< Periodically updates the statistics
+
+    QComboBox *modeComboBox;       ///< Off, amplitude, period, pulse width or edge position
+    QComboBox *channelComboBox;    ///< The analyzed channel
+    QCheckBox *markersCheckBox;    ///< Window between the markers or the whole screen
+    QLabel *waveformsLabel;        ///< Number of accumulated waveforms
+    QLabel *countLabel;            ///< Number of values
+    QLabel *meanLabel;             ///< Average value
+    QLabel *deviationLabel;        ///< Standard deviation
+    QLabel *minimumLabel;          ///< Lowest value
+    QLabel *maximumLabel;          ///< Highest value
+    QPushButton *resetButton;      ///< Discard the accumulated values
+
+    DsoSettingsScope *scope; ///< The settings provided by the parent class
+    HistogramGenerator *histogramGenerator;
+};
@@ -6,6 +6,7 @@
 #include <QDockWidget>
 #include <QLabel>
 #include <QSignalBlocker>
+#include <QSpinBox>
 #include <QCoreApplication>
 
 #include <cmath>
@@ -55,6 +56,22 @@ HorizontalDock::HorizontalDock(DsoSettingsScope *scope, QWidget *parent, Qt::Win
     for (Dso::GraphFormat format: Dso::GraphFormatEnum)
         this->formatComboBox->addItem(Dso::graphFormatString(format));
 
+    this->rollHistoryLabel = new QLabel(tr("Roll history"));
+    this->rollHistorySiSpinBox = new SiSpinBox(UNIT_SECONDS);
+    this->rollHistorySiSpinBox->setSteps(QList<double>() << 1.0 << 2.0 << 5.0 << 10.0);
+    this->rollHistorySiSpinBox->setMinimum(1.0);
+    this->rollHistorySiSpinBox->setMaximum(36e3);
+
+    this->averagingLabel = new QLabel(tr("Averaging"));
+    this->averagingComboBox = new QComboBox();
+    this->averagingComboBox->addItem(tr("Off"));
+    this->averagingComboBox->addItem(tr("Running"));
+    this->averagingComboBox->addItem(tr("Exponential"));
+    this->averagingComboBox->addItem(tr("High resolution"));
+    this->averagingCountLabel = new QLabel(tr("Average of"));
+    this->averagingCountSpinBox = new QSpinBox();
+    this->averagingCountSpinBox->setRange(2, 256);
+
     this->dockLayout = new QGridLayout();
     this->dockLayout->setColumnMinimumWidth(0, 64);
     this->dockLayout->setColumnStretch(1, 1);
@@ -68,6 +85,12 @@ HorizontalDock::HorizontalDock(DsoSettingsScope *scope, QWidget *parent, Qt::Win
     this->dockLayout->addWidget(this->recordLengthComboBox, 3, 1);
     this->dockLayout->addWidget(this->formatLabel, 4, 0);
     this->dockLayout->addWidget(this->formatComboBox, 4, 1);
+    this->dockLayout->addWidget(this->rollHistoryLabel, 5, 0);
+    this->dockLayout->addWidget(this->rollHistorySiSpinBox, 5, 1);
+    this->dockLayout->addWidget(this->averagingLabel, 6, 0);
+    this->dockLayout->addWidget(this->averagingComboBox, 6, 1);
+    this->dockLayout->addWidget(this->averagingCountLabel, 7, 0);
+    this->dockLayout->addWidget(this->averagingCountSpinBox, 7, 1);
 
     this->dockWidget = new QWidget();
     SetupDockWidget(this, dockWidget, dockLayout);
@@ -78,6 +101,12 @@ HorizontalDock::HorizontalDock(DsoSettingsScope *scope, QWidget *parent, Qt::Win
     connect(this->frequencybaseSiSpinBox, SELECT<double>::OVERLOAD_OF(&QDoubleSpinBox::valueChanged), this, &HorizontalDock::frequencybaseSelected);
     connect(this->recordLengthComboBox, SELECT<int>::OVERLOAD_OF(&QComboBox::currentIndexChanged), this, &HorizontalDock::recordLengthSelected);
     connect(this->formatComboBox, SELECT<int>::OVERLOAD_OF(&QComboBox::currentIndexChanged), this, &HorizontalDock::formatSelected);
+    connect(this->rollHistorySiSpinBox, SELECT<double>::OVERLOAD_OF(&QDoubleSpinBox::valueChanged),
+            [this](double duration) { this->scope->horizontal.rollHistory = duration; });
+    connect(this->averagingComboBox, SELECT<int>::OVERLOAD_OF(&QComboBox::currentIndexChanged),
+            [this](int index) { this->scope->averaging.mode = (DsoSettingsScopeAveraging::Mode)index; });
+    connect(this->averagingCountSpinBox, SELECT<int>::OVERLOAD_OF(&QSpinBox::valueChanged),
+            [this](int count) { this->scope->averaging.count = (unsigned)count; });
 
     // Set values
     this->setSamplerate(scope->horizontal.samplerate);
@@ -85,6 +114,9 @@ HorizontalDock::HorizontalDock(DsoSettingsScope *scope, QWidget *parent, Qt::Win
     this->setFrequencybase(scope->horizontal.frequencybase);
     // this->setRecordLength(scope->horizontal.recordLength);
     this->setFormat(scope->horizontal.format);
+    this->rollHistorySiSpinBox->setValue(scope->horizontal.rollHistory);
+    this->averagingComboBox->setCurrentIndex((int)scope->averaging.mode);
+    this->averagingCountSpinBox->setValue((int)scope->averaging.count);
 }
 
 /// \brief Don't close the dock, just hide it.
@@ -12,6 +12,7 @@
 class QLabel;
 class QCheckBox;
 class QComboBox;
+class QSpinBox;
 
 class SiSpinBox;
 
@@ -70,12 +71,18 @@ class HorizontalDock : public QDockWidget {
     QLabel *frequencybaseLabel;        ///< The label for the frequencybase spinbox
     QLabel *recordLengthLabel;         ///< The label for the record length combobox
     QLabel *formatLabel;               ///< The label for the format combobox
+    QLabel *rollHistoryLabel;          ///< The label for the roll history spinbox
+    QLabel *averagingLabel;            ///< The label for the averaging mode combobox
+    QLabel *averagingCountLabel;       ///< The label for the averaging count spinbox
     SiSpinBox *samplerateSiSpinBox;    ///< Selects the samplerate for aquisitions
     SiSpinBox *timebaseSiSpinBox;      ///< Selects the timebase for voltage graphs
     SiSpinBox *frequencybaseSiSpinBox; ///< Selects the frequencybase for spectrum graphs
     QComboBox *recordLengthComboBox;   ///< Selects the record length for aquisitions
     QComboBox *formatComboBox;         ///< Selects the way the sampled data is
                                        /// interpreted and shown
+    SiSpinBox *rollHistorySiSpinBox;   ///< Selects the duration kept in roll mode
+    QComboBox *averagingComboBox;      ///< Selects the waveform averaging mode
+    QSpinBox *averagingCountSpinBox;   ///< Selects the number of averaged records or samples
 
     DsoSettingsScope *scope; ///< The settings provided by the parent class
     QList<double> timebaseSteps;     ///< Steps for the timebase spinbox
@@ -0,0 +1,139 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QCheckBox>
+#include <QCloseEvent>
+#include <QDockWidget>
+#include <QDoubleSpinBox>
+#include <QLabel>
+#include <QPushButton>
+
+#include <algorithm>
+
+#include "MaskDock.h"
+#include "dockwindows.h"
+
+#include "post/masktest.h"
+#include "scopesettings.h"
+#include "utils/metrics.h"
+
+/// Refresh interval of the status in ms
+static const int REFRESH_INTERVAL = 500;
+
+/// \return The number of sample sets the post processing dropped so far
+static unsigned long long droppedSets() { return Metrics::Registry::get()->counter("post.dropped")->get(); }
+
+MaskDock::MaskDock(DsoSettingsScope *scope, MaskTest *maskTest, QWidget *parent, Qt::WindowFlags flags)
+    : QDockWidget(tr("Mask test"), parent, flags), scope(scope), maskTest(maskTest) {
+
+    enabledCheckBox = new QCheckBox(tr("Test waveforms"));
+
+    toleranceXSpinBox = new QDoubleSpinBox();
+    toleranceXSpinBox->setRange(0.0, 5.0);
+    toleranceXSpinBox->setSingleStep(0.05);
+    toleranceXSpinBox->setSuffix(tr(" div"));
+    toleranceYSpinBox = new QDoubleSpinBox();
+    toleranceYSpinBox->setRange(0.0, 5.0);
+    toleranceYSpinBox->setSingleStep(0.05);
+    toleranceYSpinBox->setSuffix(tr(" div"));
+
+    createButton = new QPushButton(tr("Create from waveform"));
+    clearMaskButton = new QPushButton(tr("Remove mask"));
+    stopCheckBox = new QCheckBox(tr("Stop on failure"));
+    saveCheckBox = new QCheckBox(tr("Keep failures for export"));
+
+    testedLabel = new QLabel();
+    passedLabel = new QLabel();
+    failedLabel = new QLabel();
+    missedLabel = new QLabel();
+    resetButton = new QPushButton(tr("Reset"));
+
+    dockLayout = new QGridLayout();
+    dockLayout->setColumnMinimumWidth(0, 64);
+    dockLayout->setColumnStretch(1, 1);
+    dockLayout->addWidget(enabledCheckBox, 0, 0, 1, 2);
+    dockLayout->addWidget(new QLabel(tr("Tolerance X")), 1, 0);
+    dockLayout->addWidget(toleranceXSpinBox, 1, 1);
+    dockLayout->addWidget(new QLabel(tr("Tolerance Y")), 2, 0);
+    dockLayout->addWidget(toleranceYSpinBox, 2, 1);
+    dockLayout->addWidget(createButton, 3, 1);
+    dockLayout->addWidget(clearMaskButton, 4, 1);
+    dockLayout->addWidget(stopCheckBox, 5, 0, 1, 2);
+    dockLayout->addWidget(saveCheckBox, 6, 0, 1, 2);
+    dockLayout->addWidget(new QLabel(tr("Tested")), 7, 0);
+    dockLayout->addWidget(testedLabel, 7, 1);
+    dockLayout->addWidget(new QLabel(tr("Passed")), 8, 0);
+    dockLayout->addWidget(passedLabel, 8, 1);
+    dockLayout->addWidget(new QLabel(tr("Failed")), 9, 0);
+    dockLayout->addWidget(failedLabel, 9, 1);
+    dockLayout->addWidget(new QLabel(tr("Missed")), 10, 0);
+    dockLayout->addWidget(missedLabel, 10, 1);
+    dockLayout->addWidget(resetButton, 11, 1);
+
+    dockWidget = new QWidget();
+    SetupDockWidget(this, dockWidget, dockLayout);
+
+    // Set values
+    enabledCheckBox->setChecked(scope->mask.enabled);
+    toleranceXSpinBox->setValue(scope->mask.toleranceX);
+    toleranceYSpinBox->setValue(scope->mask.toleranceY);
+    stopCheckBox->setChecked(scope->mask.stopOnFailure);
+    saveCheckBox->setChecked(scope->mask.saveFailures);
+    maskVersion = maskTest->version();
+    droppedAtReset = droppedSets();
+
+    // Connect signals and slots
+    connect(enabledCheckBox, &QCheckBox::toggled, [this](bool checked) { this->scope->mask.enabled = checked; });
+    connect(toleranceXSpinBox, static_cast<void (QDoubleSpinBox::*)(double)>(&QDoubleSpinBox::valueChanged),
+            [this](double value) { this->scope->mask.toleranceX = value; });
+    connect(toleranceYSpinBox, static_cast<void (QDoubleSpinBox::*)(double)>(&QDoubleSpinBox::valueChanged),
+            [this](double value) { this->scope->mask.toleranceY = value; });
+    connect(createButton, &QPushButton::clicked, [this]() { this->maskTest->createMasks(); });
+    connect(clearMaskButton, &QPushButton::clicked, [this]() {
+        this->maskTest->clearMasks();
+        refresh();
+    });
+    connect(stopCheckBox, &QCheckBox::toggled, [this](bool checked) { this->scope->mask.stopOnFailure = checked; });
+    connect(saveCheckBox, &QCheckBox::toggled, [this](bool checked) { this->scope->mask.saveFailures = checked; });
+    connect(resetButton, &QPushButton::clicked, [this]() {
+        this->maskTest->reset();
+        previousTested = 0;
+        droppedAtReset = droppedSets();
+        refresh();
+    });
+    connect(&refreshTimer, &QTimer::timeout, this, &MaskDock::refresh);
+    refreshTimer.start(REFRESH_INTERVAL);
+    rateTimer.start();
+}
+
+/// \brief Don't close the dock, just hide it
+/// \param event The close event that should be handled.
+void MaskDock::closeEvent(QCloseEvent *event) {
+    hide();
+    event->accept();
+}
+
+void MaskDock::refresh() {
+    // The settings keep a copy of the masks, they are saved and drawn from there
+    const unsigned version = maskTest->version();
+    if (version != maskVersion) {
+        maskVersion = version;
+        const std::vector<std::pair<QPolygonF, QPolygonF>> masks = maskTest->masks();
+        for (ChannelID channel = 0; channel < scope->voltage.size() && channel < masks.size(); ++channel) {
+            scope->voltage[channel].maskUpper = masks[channel].first;
+            scope->voltage[channel].maskLower = masks[channel].second;
+        }
+    }
+
+    const unsigned long long tested = maskTest->tested();
+    const unsigned long long failed = maskTest->failed();
+    const qint64 elapsed = std::max(rateTimer.restart(), (qint64)1);
+    const double rate = (tested >= previousTested ? tested - previousTested : tested) * 1000.0 / elapsed;
+    previousTested = tested;
+
+    if (!isVisible()) return;
+
+    testedLabel->setText(tr("%1 (%2/s)").arg(tested).arg(rate, 0, 'f', 1));
+    passedLabel->setText(QString::number(tested - std::min(failed, tested)));
+    failedLabel->setText(tr("%1 (%2 %)").arg(failed).arg(tested ? 100.0 * failed / tested : 0.0, 0, 'f', 2));
+    missedLabel->setText(QString::number(droppedSets() - droppedAtReset));
+}
@@ -0,0 +1,60 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QDockWidget>
+#include <QElapsedTimer>
+#include <QGridLayout>
+#include <QTimer>
+
+class QCheckBox;
+class QDoubleSpinBox;
+class QLabel;
+class QPushButton;
+struct DsoSettingsScope;
+class MaskTest;
+
+/// \brief Dock window for the mask test.
+/// It creates the masks from the current waveforms, enables the test and shows the pass/fail counters. Missed
+/// waveforms are sample sets the post processing dropped since the last reset, they were not tested.
+class MaskDock : public QDockWidget {
+    Q_OBJECT
+
+  public:
+    /// \brief Initializes the mask test docking window.
+    /// \param scope The target settings object.
+    /// \param maskTest The mask test that is controlled.
+    /// \param parent The parent widget.
+    /// \param flags Flags for the window manager.
+    MaskDock(DsoSettingsScope *scope, MaskTest *maskTest, QWidget *parent, Qt::WindowFlags flags = 0);
+
+  protected:
+    void closeEvent(QCloseEvent *event);
+    /// \brief Update the counters and copy changed masks into the settings.
+    void refresh();
+
+    QGridLayout *dockLayout; ///< The main layout for the dock window
+    QWidget *dockWidget;     ///< The main widget for the dock window
+    QTimer refreshTimer;     ///< Periodically updates the status
+    QElapsedTimer rateTimer; ///< Time since the last refresh
+
+    QCheckBox *enabledCheckBox;        ///< Start/stop testing
+    QDoubleSpinBox *toleranceXSpinBox; ///< Horizontal tolerance of created masks
+    QDoubleSpinBox *toleranceYSpinBox; ///< Vertical tolerance of created masks
+    QPushButton *createButton;         ///< Create the masks from the next waveform
+    QPushButton *clearMaskButton;      ///< Remove the masks
+    QCheckBox *stopCheckBox;           ///< Stop on failure
+    QCheckBox *saveCheckBox;           ///< Keep failing waveforms for the export
+    QLabel *testedLabel;               ///< Number of tested waveforms and the test rate
+    QLabel *passedLabel;               ///< Number of passed waveforms
+    QLabel *failedLabel;               ///< Number of failed waveforms
+    QLabel *missedLabel;               ///< Number of untested waveforms
+    QPushButton *resetButton;          ///< Reset the counters
+
+    DsoSettingsScope *scope; ///< The settings provided by the parent class
+    MaskTest *maskTest;
+
+    unsigned maskVersion;                  ///< Version of the masks in the settings
+    unsigned long long previousTested = 0; ///< Tested waveforms at the last refresh, used to compute the rate
+    unsigned long long droppedAtReset;     ///< Dropped sample sets of the post processing at the last reset
+};
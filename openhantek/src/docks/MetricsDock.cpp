@@ -0,0 +1,77 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QCloseEvent>
+#include <QDockWidget>
+#include <QLabel>
+
+#include "MetricsDock.h"
+#include "dockwindows.h"
+
+#include "utils/printutils.h"
+
+MetricsDock::MetricsDock(QWidget *parent, Qt::WindowFlags flags) : QDockWidget(tr("Metrics"), parent, flags) {
+    // Counters and histograms are created lazily, each kind gets its own grid so that new rows don't overlap
+    counterLayout = new QGridLayout();
+    histogramLayout = new QGridLayout();
+    for (QGridLayout *layout : {counterLayout, histogramLayout}) {
+        layout->setColumnMinimumWidth(0, 64);
+        layout->setColumnStretch(1, 1);
+    }
+    dockLayout = new QVBoxLayout();
+    dockLayout->addLayout(counterLayout);
+    dockLayout->addLayout(histogramLayout);
+
+    dockWidget = new QWidget();
+    SetupDockWidget(this, dockWidget, dockLayout);
+
+    previous = Metrics::Registry::get()->snapshot();
+    connect(&refreshTimer, &QTimer::timeout, this, &MetricsDock::refresh);
+    refreshTimer.start(1000);
+}
+
+/// \brief Don't close the dock, just hide it
+/// \param event The close event that should be handled.
+void MetricsDock::closeEvent(QCloseEvent *event) {
+    hide();
+    event->accept();
+}
+
+void MetricsDock::refresh() {
+    Metrics::Snapshot now = Metrics::Registry::get()->snapshot();
+
+    // Metrics are created lazily, add rows for new ones. Counters come first, histograms below.
+    while (counterLabels.size() < now.counters.size()) {
+        QLabel *value = new QLabel();
+        const int row = (int)counterLabels.size();
+        counterLayout->addWidget(new QLabel(now.counters[counterLabels.size()].name), row, 0);
+        counterLayout->addWidget(value, row, 1);
+        counterLabels.push_back(value);
+    }
+    while (histogramLabels.size() < now.histograms.size()) {
+        QLabel *value = new QLabel();
+        const int row = (int)histogramLabels.size();
+        histogramLayout->addWidget(new QLabel(now.histograms[histogramLabels.size()].name), row, 0);
+        histogramLayout->addWidget(value, row, 1);
+        histogramLabels.push_back(value);
+    }
+
+    if (isVisible()) {
+        for (size_t i = 0; i < now.counters.size(); ++i) {
+            const double rate = now.counterRate(i, previous);
+            if (now.counters[i].unit == Metrics::Counter::Unit::BYTES)
+                counterLabels[i]->setText(tr("%1 MB/s").arg(rate / 1e6, 0, 'f', 2));
+            else
+                counterLabels[i]->setText(tr("%1 (%2/s)").arg(now.counters[i].value).arg(rate, 0, 'f', 1));
+        }
+        for (size_t i = 0; i < now.histograms.size(); ++i) {
+            const Metrics::Histogram::Snapshot &h = now.histograms[i].value;
+            histogramLabels[i]->setText(tr("%1/s, avg %2, p95 %3, max %4")
+                                            .arg(now.histogramRate(i, previous), 0, 'f', 1)
+                                            .arg(valueToString(h.mean() / 1e3, UNIT_SECONDS, 3))
+                                            .arg(valueToString(h.percentile(0.95) / 1e3, UNIT_SECONDS, 3))
+                                            .arg(valueToString(h.max() / 1e3, UNIT_SECONDS, 3)));
+        }
+    }
+
+    previous = std::move(now);
+}
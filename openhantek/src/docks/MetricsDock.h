@@ -0,0 +1,43 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QDockWidget>
+#include <QGridLayout>
+#include <QTimer>
+#include <QVBoxLayout>
+
+#include <vector>
+
+#include "utils/metrics.h"
+
+class QLabel;
+
+/// \brief Dock window for the pipeline statistics.
+/// It shows throughput, error counters and per-stage latencies of the acquisition, post processing and
+/// rendering pipeline. The values are refreshed once per second while the dock is visible.
+class MetricsDock : public QDockWidget {
+    Q_OBJECT
+
+  public:
+    /// \brief Initializes the metrics docking window.
+    /// \param parent The parent widget.
+    /// \param flags Flags for the window manager.
+    MetricsDock(QWidget *parent, Qt::WindowFlags flags = 0);
+
+  protected:
+    void closeEvent(QCloseEvent *event);
+    /// \brief Update all labels with a new snapshot of the metrics registry.
+    void refresh();
+
+    QVBoxLayout *dockLayout;      ///< The main layout for the dock window
+    QGridLayout *counterLayout;   ///< One row per counter
+    QGridLayout *histogramLayout; ///< One row per histogram, below the counters
+    QWidget *dockWidget;          ///< The main widget for the dock window
+    QTimer refreshTimer;          ///< Periodically updates the values
+
+    std::vector<QLabel *> counterLabels;   ///< One value label per counter
+    std::vector<QLabel *> histogramLabels; ///< One value label per histogram
+
+    Metrics::Snapshot previous; ///< The last snapshot, used to compute rates
+};
@@ -0,0 +1,117 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QCheckBox>
+#include <QCloseEvent>
+#include <QDockWidget>
+#include <QLabel>
+#include <QPushButton>
+#include <QSignalBlocker>
+#include <QSpinBox>
+
+#include <algorithm>
+
+#include "SegmentDock.h"
+#include "dockwindows.h"
+
+#include "post/segmentbuffer.h"
+#include "scopesettings.h"
+#include "utils/printutils.h"
+
+/// Refresh interval of the status in ms
+static const int REFRESH_INTERVAL = 500;
+
+SegmentDock::SegmentDock(DsoSettingsScope *scope, SegmentBuffer *buffer, QWidget *parent, Qt::WindowFlags flags)
+    : QDockWidget(tr("Segments"), parent, flags), scope(scope), buffer(buffer) {
+
+    enabledCheckBox = new QCheckBox(tr("Capture all trigger events"));
+    statusLabel = new QLabel();
+
+    capacitySpinBox = new QSpinBox();
+    capacitySpinBox->setRange(1, 100000);
+
+    overlaySpinBox = new QSpinBox();
+    overlaySpinBox->setRange(0, 1000);
+    overlaySpinBox->setSpecialValueText(tr("Off"));
+
+    reviewSpinBox = new QSpinBox();
+    reviewSpinBox->setRange(-1, -1);
+    reviewSpinBox->setSpecialValueText(tr("Live"));
+    timestampLabel = new QLabel();
+
+    clearButton = new QPushButton(tr("Clear"));
+
+    dockLayout = new QGridLayout();
+    dockLayout->setColumnMinimumWidth(0, 64);
+    dockLayout->setColumnStretch(1, 1);
+    dockLayout->addWidget(enabledCheckBox, 0, 0, 1, 2);
+    dockLayout->addWidget(new QLabel(tr("Stored")), 1, 0);
+    dockLayout->addWidget(statusLabel, 1, 1);
+    dockLayout->addWidget(new QLabel(tr("Capacity")), 2, 0);
+    dockLayout->addWidget(capacitySpinBox, 2, 1);
+    dockLayout->addWidget(new QLabel(tr("Overlay")), 3, 0);
+    dockLayout->addWidget(overlaySpinBox, 3, 1);
+    dockLayout->addWidget(new QLabel(tr("Review")), 4, 0);
+    dockLayout->addWidget(reviewSpinBox, 4, 1);
+    dockLayout->addWidget(timestampLabel, 5, 1);
+    dockLayout->addWidget(clearButton, 6, 1);
+
+    dockWidget = new QWidget();
+    SetupDockWidget(this, dockWidget, dockLayout);
+
+    // Set values
+    enabledCheckBox->setChecked(scope->segments.enabled);
+    capacitySpinBox->setValue((int)scope->segments.capacity);
+    overlaySpinBox->setValue((int)scope->segments.overlay);
+    scope->segments.review = -1;
+
+    // Connect signals and slots
+    connect(enabledCheckBox, &QCheckBox::toggled, [this](bool checked) { this->scope->segments.enabled = checked; });
+    connect(capacitySpinBox, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged),
+            [this](int value) { this->scope->segments.capacity = (unsigned)value; });
+    connect(overlaySpinBox, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged),
+            [this](int value) { this->scope->segments.overlay = (unsigned)value; });
+    connect(reviewSpinBox, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), [this](int value) {
+        this->scope->segments.review = value;
+        refresh();
+    });
+    connect(clearButton, &QPushButton::clicked, [this]() {
+        this->buffer->clear();
+        previousTotal = 0;
+        refresh();
+    });
+    connect(&refreshTimer, &QTimer::timeout, this, &SegmentDock::refresh);
+    refreshTimer.start(REFRESH_INTERVAL);
+    rateTimer.start();
+}
+
+/// \brief Don't close the dock, just hide it
+/// \param event The close event that should be handled.
+void SegmentDock::closeEvent(QCloseEvent *event) {
+    hide();
+    event->accept();
+}
+
+void SegmentDock::refresh() {
+    const unsigned count = buffer->count();
+    const unsigned long long total = buffer->total();
+    const qint64 elapsed = std::max(rateTimer.restart(), (qint64)1);
+    const double rate = (total >= previousTotal ? total - previousTotal : total) * 1000.0 / elapsed;
+    previousTotal = total;
+
+    if (!isVisible()) return;
+
+    // The buffer may hold fewer segments than configured, if they are long
+    statusLabel->setText(tr("%1 of %2 (%3/s)").arg(count).arg(buffer->capacity()).arg(rate, 0, 'f', 1));
+    {
+        QSignalBlocker blocker(reviewSpinBox);
+        reviewSpinBox->setMaximum((int)count - 1);
+    }
+    scope->segments.review = reviewSpinBox->value();
+
+    SegmentBuffer::Segment segment;
+    if (scope->segments.review >= 0 && buffer->get((unsigned)scope->segments.review, segment))
+        timestampLabel->setText(
+            tr("#%1 at %2").arg(segment.number).arg(valueToString(segment.timestamp, UNIT_SECONDS, 6)));
+    else
+        timestampLabel->clear();
+}
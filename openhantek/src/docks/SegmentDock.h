@@ -0,0 +1,54 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QDockWidget>
+#include <QElapsedTimer>
+#include <QGridLayout>
+#include <QTimer>
+
+class QCheckBox;
+class QLabel;
+class QPushButton;
+class QSpinBox;
+struct DsoSettingsScope;
+class SegmentBuffer;
+
+/// \brief Dock window for the segmented acquisition.
+/// It enables the capture of all trigger events into the segment buffer and allows to review single
+/// segments or overlay the latest ones. Segment 0 is the oldest stored one, stop capturing to review a
+/// full buffer without the segments moving on.
+class SegmentDock : public QDockWidget {
+    Q_OBJECT
+
+  public:
+    /// \brief Initializes the segmented acquisition docking window.
+    /// \param scope The target settings object.
+    /// \param buffer The segment buffer that is shown.
+    /// \param parent The parent widget.
+    /// \param flags Flags for the window manager.
+    SegmentDock(DsoSettingsScope *scope, SegmentBuffer *buffer, QWidget *parent, Qt::WindowFlags flags = 0);
+
+  protected:
+    void closeEvent(QCloseEvent *event);
+    /// \brief Update the segment count, rate and the review range.
+    void refresh();
+
+    QGridLayout *dockLayout; ///< The main layout for the dock window
+    QWidget *dockWidget;     ///< The main widget for the dock window
+    QTimer refreshTimer;     ///< Periodically updates the status
+    QElapsedTimer rateTimer; ///< Time since the last refresh
+
+    QCheckBox *enabledCheckBox; ///< Start/stop collecting segments
+    QLabel *statusLabel;        ///< Number of stored segments and capture rate
+    QSpinBox *capacitySpinBox;  ///< Size of the segment buffer
+    QSpinBox *overlaySpinBox;   ///< Number of overlaid segments
+    QSpinBox *reviewSpinBox;    ///< The reviewed segment
+    QLabel *timestampLabel;     ///< Timestamp of the reviewed segment
+    QPushButton *clearButton;   ///< Discard all segments
+
+    DsoSettingsScope *scope; ///< The settings provided by the parent class
+    SegmentBuffer *buffer;
+
+    unsigned long long previousTotal = 0; ///< Captured segments at the last refresh, used to compute the rate
+};
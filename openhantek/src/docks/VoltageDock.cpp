@@ -12,6 +12,7 @@
 #include "VoltageDock.h"
 #include "dockwindows.h"
 
+#include "post/mathexpression.h"
 #include "settings.h"
 #include "sispinbox.h"
 #include "utils/printutils.h"
@@ -31,7 +32,7 @@ VoltageDock::VoltageDock(DsoSettingsScope *scope, const Dso::ControlSpecificatio
         couplingStrings.append(Dso::couplingString(c));
 
     for( auto e: Dso::MathModeEnum ) {
-        modeStrings.append(Dso::mathModeString(e));
+        expressionStrings.append(Dso::mathModeExpression(e, scope->voltage[0].name, scope->voltage[1].name));
     }
 
     for (double gainStep: scope->gainSteps)
@@ -54,8 +55,11 @@ VoltageDock::VoltageDock(DsoSettingsScope *scope, const Dso::ControlSpecificatio
 
         if (channel < spec->channels)
             b.miscComboBox->addItems(couplingStrings);
-        else
-            b.miscComboBox->addItems(modeStrings);
+        else {
+            b.miscComboBox->setEditable(true);
+            b.miscComboBox->setInsertPolicy(QComboBox::NoInsert);
+            b.miscComboBox->addItems(expressionStrings);
+        }
 
         b.gainComboBox->addItems(gainStrings);
 
@@ -67,7 +71,7 @@ VoltageDock::VoltageDock(DsoSettingsScope *scope, const Dso::ControlSpecificatio
         if (channel < spec->channels)
             setCoupling(channel, scope->voltage[channel].couplingOrMathIndex);
         else
-            setMode(scope->voltage[channel].couplingOrMathIndex);
+            setExpression(channel, scope->voltage[channel].mathExpression);
         setGain(channel, scope->voltage[channel].gainStepIndex);
         setUsed(channel, scope->voltage[channel].used);
 
@@ -78,14 +82,18 @@ VoltageDock::VoltageDock(DsoSettingsScope *scope, const Dso::ControlSpecificatio
         connect(b.invertCheckBox, &QAbstractButton::toggled, [this,channel](bool checked) {
             this->scope->voltage[channel].inverted = checked;
         });
-        connect(b.miscComboBox, SELECT<int>::OVERLOAD_OF(&QComboBox::currentIndexChanged), [this,channel,spec,scope](int index){
-            this->scope->voltage[channel].couplingOrMathIndex = (unsigned)index;
-            if (channel < spec->channels) {
+        if (channel < spec->channels) {
+            connect(b.miscComboBox, SELECT<int>::OVERLOAD_OF(&QComboBox::currentIndexChanged), [this,channel,spec,scope](int index){
+                this->scope->voltage[channel].couplingOrMathIndex = (unsigned)index;
                 emit couplingChanged(channel, scope->coupling(channel, spec));
-            } else {
-                emit modeChanged(Dso::getMathMode(this->scope->voltage[channel]));
-            }
-        });
+            });
+        } else {
+            connect(b.miscComboBox, &QComboBox::currentTextChanged, [this,channel](const QString &expression) {
+                this->scope->voltage[channel].mathExpression = expression;
+                checkExpression(channel);
+                emit expressionChanged(channel);
+            });
+        }
         connect(b.usedCheckBox, &QAbstractButton::toggled, [this,channel](bool checked) {
             this->scope->voltage[channel].used = checked;
             emit usedChanged(channel, checked);
@@ -117,9 +125,22 @@ void VoltageDock::setGain(ChannelID channel, unsigned gainStepIndex) {
     channelBlocks[channel].gainComboBox->setCurrentIndex((unsigned)gainStepIndex);
 }
 
-void VoltageDock::setMode(unsigned mathModeIndex) {
-    QSignalBlocker blocker(channelBlocks[spec->channels].miscComboBox);
-    channelBlocks[spec->channels].miscComboBox->setCurrentIndex((int)mathModeIndex);
+void VoltageDock::setExpression(ChannelID channel, const QString &expression) {
+    if (channel < spec->channels || channel >= scope->voltage.size()) return;
+    QSignalBlocker blocker(channelBlocks[channel].miscComboBox);
+    channelBlocks[channel].miscComboBox->setCurrentText(expression);
+    checkExpression(channel);
+}
+
+void VoltageDock::checkExpression(ChannelID channel) {
+    QStringList names;
+    for (ChannelID input = 0; input < channel; ++input) names << scope->voltage[input].name;
+    MathExpression expression;
+    if (expression.compile(scope->voltage[channel].mathExpression, names))
+        channelBlocks[channel].miscComboBox->setToolTip(
+            tr("Channels: %1\nFunctions: abs, sqrt, integrate, diff").arg(names.join(", ")));
+    else
+        channelBlocks[channel].miscComboBox->setToolTip(expression.error());
 }
 
 void VoltageDock::setUsed(ChannelID channel, bool used) {
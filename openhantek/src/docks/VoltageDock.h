@@ -37,9 +37,10 @@ class VoltageDock : public QDockWidget {
     /// \param gain The gain in volts.
     void setGain(ChannelID channel, unsigned gainStepIndex);
 
-    /// \brief Sets the mode for the math channel.
-    /// \param mathModeIndex The math-mode index.
-    void setMode(unsigned mathModeIndex);
+    /// \brief Sets the expression of a math channel.
+    /// \param channel The math channel, whose expression should be set.
+    /// \param expression The expression, see MathExpression.
+    void setExpression(ChannelID channel, const QString &expression);
 
     /// \brief Enables/disables a channel.
     /// \param channel The channel, that should be enabled/disabled.
@@ -48,6 +49,8 @@ class VoltageDock : public QDockWidget {
 
   protected:
     void closeEvent(QCloseEvent *event);
+    /// \brief Show the syntax error or the available inputs of a math channel expression as tooltip.
+    void checkExpression(ChannelID channel);
 
     QGridLayout *dockLayout;           ///< The main layout for the dock window
     QWidget *dockWidget;               ///< The main widget for the dock window
@@ -55,7 +58,7 @@ class VoltageDock : public QDockWidget {
     struct ChannelBlock {
         QCheckBox * usedCheckBox;   ///< Enable/disable a specific channel
         QComboBox * gainComboBox;   ///< Select the vertical gain for the channels
-        QComboBox * miscComboBox;   ///< Select coupling for real and mode for math channels
+        QComboBox * miscComboBox;   ///< Select coupling for real and enter the expression for math channels
         QCheckBox * invertCheckBox; ///< Select if the channels should be displayed inverted
     };
 
@@ -65,12 +68,12 @@ class VoltageDock : public QDockWidget {
     const Dso::ControlSpecification *spec;
 
     QStringList couplingStrings; ///< The strings for the couplings
-    QStringList modeStrings;     ///< The strings for the math mode
+    QStringList expressionStrings; ///< The predefined math expressions
     QStringList gainStrings;     ///< String representations for the gain steps
 
   signals:
     void couplingChanged(ChannelID channel, Dso::Coupling coupling); ///< A coupling has been selected
     void gainChanged(ChannelID channel, double gain);                ///< A gain has been selected
-    void modeChanged(Dso::MathMode mode);              ///< The mode for the math channels has been changed
+    void expressionChanged(ChannelID channel);                       ///< The expression of a math channel has been changed
     void usedChanged(ChannelID channel, bool used); ///< A channel has been enabled/disabled
 };
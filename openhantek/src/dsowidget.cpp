@@ -136,7 +136,7 @@ DsoWidget::DsoWidget(DsoSettingsScope *scope, DsoSettingsView *view, const Dso::
         if ((unsigned)channel < spec->channels)
             updateVoltageCoupling((unsigned)channel);
         else
-            updateMathMode();
+            updateMathExpression((unsigned)channel);
         updateVoltageDetails((unsigned)channel);
         updateSpectrumDetails((unsigned)channel);
     }
@@ -416,10 +416,10 @@ void DsoWidget::updateVoltageCoupling(ChannelID channel) {
     measurementMiscLabel[channel]->setText(Dso::couplingString(scope->coupling(channel, spec)));
 }
 
-/// \brief Handles modeChanged signal from the voltage dock.
-void DsoWidget::updateMathMode() {
-    measurementMiscLabel[spec->channels]->setText(
-        Dso::mathModeString(Dso::getMathMode(scope->voltage[spec->channels])));
+/// \brief Handles expressionChanged signal from the voltage dock.
+/// \param channel The math channel whose expression was changed.
+void DsoWidget::updateMathExpression(ChannelID channel) {
+    measurementMiscLabel[channel]->setText(scope->voltage[channel].mathExpression);
 }
 
 /// \brief Handles gainChanged signal from the voltage dock.
@@ -481,6 +481,27 @@ void DsoWidget::updateZoom(bool enabled) {
     repaint();
 }
 
+/// \brief Formats a measured value, NaN values are shown as "-".
+static QString measurementToString(double value, Unit unit, int precision) {
+    return std::isnan(value) ? QString("-") : valueToString(value, unit, precision);
+}
+
+/// \brief Lists all measured values of a channel.
+QString DsoWidget::measurementDetails(const Measurements &measurements) {
+    return tr("Minimum: %1\nMaximum: %2\nMean: %3\nRMS: %4\nAC RMS: %5\nPeriod: %6\nDuty cycle: %7\n"
+              "Rise time: %8\nFall time: %9")
+        .arg(measurementToString(measurements.minimum, UNIT_VOLTS, 4))
+        .arg(measurementToString(measurements.maximum, UNIT_VOLTS, 4))
+        .arg(measurementToString(measurements.mean, UNIT_VOLTS, 4))
+        .arg(measurementToString(measurements.rms, UNIT_VOLTS, 4))
+        .arg(measurementToString(measurements.acRms, UNIT_VOLTS, 4))
+        .arg(measurementToString(measurements.period, UNIT_SECONDS, 4))
+        .arg(std::isnan(measurements.dutyCycle) ? QString("-")
+                                                 : QString("%1 %").arg(measurements.dutyCycle * 100.0, 0, 'f', 1))
+        .arg(measurementToString(measurements.riseTime, UNIT_SECONDS, 4))
+        .arg(measurementToString(measurements.fallTime, UNIT_SECONDS, 4));
+}
+
 /// \brief Prints analyzed data.
 void DsoWidget::showNew(std::shared_ptr<PPresult> data) {
     mainScope->showData(data);
@@ -498,12 +519,15 @@ void DsoWidget::showNew(std::shared_ptr<PPresult> data) {
 
     for (ChannelID channel = 0; channel < scope->voltage.size(); ++channel) {
         if (scope->voltage[channel].used && data.get()->data(channel)) {
+            const Measurements &measurements = data.get()->data(channel)->measurements;
             // Amplitude string representation (4 significant digits)
-            measurementAmplitudeLabel[channel]->setText(
-                valueToString(data.get()->data(channel)->computeAmplitude(), UNIT_VOLTS, 4));
+            measurementAmplitudeLabel[channel]->setText(measurementToString(measurements.amplitude, UNIT_VOLTS, 4));
             // Frequency string representation (5 significant digits)
-            measurementFrequencyLabel[channel]->setText(
-                valueToString(data.get()->data(channel)->frequency, UNIT_HERTZ, 5));
+            measurementFrequencyLabel[channel]->setText(measurementToString(measurements.frequency, UNIT_HERTZ, 5));
+            // All other measurements are shown as tooltip
+            const QString details = measurementDetails(measurements);
+            measurementAmplitudeLabel[channel]->setToolTip(details);
+            measurementFrequencyLabel[channel]->setToolTip(details);
         }
     }
 }
@@ -13,6 +13,7 @@
 #include "hantekdso/controlspecification.h"
 
 class SpectrumGenerator;
+struct Measurements;
 struct DsoSettingsScope;
 struct DsoSettingsView;
 
@@ -49,6 +50,7 @@ class DsoWidget : public QWidget {
     void updateSpectrumDetails(ChannelID channel);
     void updateTriggerDetails();
     void updateVoltageDetails(ChannelID channel);
+    static QString measurementDetails(const Measurements &measurements);
 
     Sliders mainSliders;
     Sliders zoomSliders;
@@ -104,7 +106,7 @@ class DsoWidget : public QWidget {
 
     // Vertical axis
     void updateVoltageCoupling(ChannelID channel);
-    void updateMathMode();
+    void updateMathExpression(ChannelID channel);
     void updateVoltageGain(ChannelID channel);
     void updateVoltageUsed(ChannelID channel, bool used);
 
@@ -0,0 +1,59 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include "exporthistogramcsv.h"
+#include "exporterregistry.h"
+#include "post/histogramgenerator.h"
+#include "iconfont/QtAwesome.h"
+
+#include <QCoreApplication>
+#include <QTextStream>
+#include <QFile>
+#include <QFileDialog>
+
+ExporterHistogramCSV::ExporterHistogramCSV(const HistogramGenerator *histogramGenerator)
+    : histogramGenerator(histogramGenerator) {}
+
+void ExporterHistogramCSV::create(ExporterRegistry *registry) { this->registry = registry; requested = false; }
+
+QIcon ExporterHistogramCSV::icon() { return iconFont->icon(fa::barchart); }
+
+QString ExporterHistogramCSV::name() { return QCoreApplication::tr("Export histogram CSV"); }
+
+ExporterInterface::Type ExporterHistogramCSV::type() { return Type::SnapshotExport; }
+
+bool ExporterHistogramCSV::samples(const std::shared_ptr<PPresult>) {
+    // The values are accumulated by the histogram analysis, the current sample set only triggers the export
+    requested = true;
+    return false;
+}
+
+bool ExporterHistogramCSV::save() {
+    const ValueHistogram histogram = histogramGenerator->histogram();
+    if (histogram.bins.empty() || !histogram.count) return false;
+
+    QStringList filters;
+    filters << QCoreApplication::tr("Comma-Separated Values (*.csv)");
+
+    QFileDialog fileDialog(nullptr, QCoreApplication::tr("Export file..."), QString(), filters.join(";;"));
+    fileDialog.setFileMode(QFileDialog::AnyFile);
+    fileDialog.setAcceptMode(QFileDialog::AcceptSave);
+    if (fileDialog.exec() != QDialog::Accepted) return false;
+
+    QFile csvFile(fileDialog.selectedFiles().first());
+    if (!csvFile.open(QIODevice::WriteOnly | QIODevice::Text)) return false;
+
+    QTextStream csvStream(&csvFile);
+    csvStream.setRealNumberNotation(QTextStream::ScientificNotation);
+    csvStream.setRealNumberPrecision(10);
+
+    csvStream << (histogram.amplitude ? "\"V\"" : "\"s\"") << ",\"count\"\n";
+    const double binSize = (histogram.valueLast - histogram.valueFirst) / histogram.bins.size();
+    for (size_t bin = 0; bin < histogram.bins.size(); ++bin)
+        csvStream << histogram.valueFirst + (bin + 0.5) * binSize << "," << histogram.bins[bin] << "\n";
+
+    csvFile.close();
+
+    return true;
+}
+
+float ExporterHistogramCSV::progress() { return requested ? 1.0f : 0; }
@@ -0,0 +1,24 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+#include "exporterinterface.h"
+
+class HistogramGenerator;
+
+/// \brief Exports the accumulated histogram of the histogram analysis to a CSV file.
+/// Every row contains the center value of a bin and the number of values in that bin.
+class ExporterHistogramCSV : public ExporterInterface
+{
+public:
+    ExporterHistogramCSV(const HistogramGenerator *histogramGenerator);
+    virtual void create(ExporterRegistry *registry) override;
+    virtual QIcon icon() override;
+    virtual QString name() override;
+    virtual Type type() override;
+    virtual bool samples(const std::shared_ptr<PPresult>data) override;
+    virtual bool save() override;
+    virtual float progress() override;
+private:
+    const HistogramGenerator *histogramGenerator;
+    bool requested = false;
+};
@@ -0,0 +1,82 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include "exportmaskfailurescsv.h"
+#include "exporterregistry.h"
+#include "post/masktest.h"
+#include "settings.h"
+#include "iconfont/QtAwesome.h"
+
+#include <QCoreApplication>
+#include <QTextStream>
+#include <QFile>
+#include <QFileDialog>
+
+#include <algorithm>
+
+ExporterMaskFailuresCSV::ExporterMaskFailuresCSV(const MaskTest *maskTest) : maskTest(maskTest) {}
+
+void ExporterMaskFailuresCSV::create(ExporterRegistry *registry) { this->registry = registry; requested = false; }
+
+QIcon ExporterMaskFailuresCSV::icon() { return iconFont->icon(fa::exclamationtriangle); }
+
+QString ExporterMaskFailuresCSV::name() { return QCoreApplication::tr("Export mask failures CSV"); }
+
+ExporterInterface::Type ExporterMaskFailuresCSV::type() { return Type::SnapshotExport; }
+
+bool ExporterMaskFailuresCSV::samples(const std::shared_ptr<PPresult>) {
+    // The waveforms are kept by the mask test, the current sample set only triggers the export
+    requested = true;
+    return false;
+}
+
+bool ExporterMaskFailuresCSV::save() {
+    const unsigned count = maskTest->failureCount();
+    if (!count) return false;
+
+    QStringList filters;
+    filters << QCoreApplication::tr("Comma-Separated Values (*.csv)");
+
+    QFileDialog fileDialog(nullptr, QCoreApplication::tr("Export file..."), QString(), filters.join(";;"));
+    fileDialog.setFileMode(QFileDialog::AnyFile);
+    fileDialog.setAcceptMode(QFileDialog::AcceptSave);
+    if (fileDialog.exec() != QDialog::Accepted) return false;
+
+    QFile csvFile(fileDialog.selectedFiles().first());
+    if (!csvFile.open(QIODevice::WriteOnly | QIODevice::Text)) return false;
+
+    QTextStream csvStream(&csvFile);
+    csvStream.setRealNumberNotation(QTextStream::FixedNotation);
+    csvStream.setRealNumberPrecision(10);
+
+    const DsoSettingsScope &scope = registry->settings->scope;
+
+    // Start with channel names
+    csvStream << "\"waveform\",\"t\"";
+    for (ChannelID channel = 0; channel < scope.voltage.size(); ++channel) {
+        if (scope.voltage[channel].used) csvStream << ",\"" << scope.voltage[channel].name << "\"";
+    }
+    csvStream << "\n";
+
+    MaskTest::Failure failure;
+    for (unsigned index = 0; index < count; ++index) {
+        if (!maskTest->failure(index, failure)) break;
+        size_t rows = 0;
+        for (const std::vector<double> &samples : failure.samples) rows = std::max(rows, samples.size());
+        for (size_t row = 0; row < rows; ++row) {
+            csvStream << failure.number << "," << row * failure.interval;
+            for (ChannelID channel = 0; channel < scope.voltage.size(); ++channel) {
+                if (!scope.voltage[channel].used) continue;
+                csvStream << ",";
+                if (channel < failure.samples.size() && row < failure.samples[channel].size())
+                    csvStream << failure.samples[channel][row];
+            }
+            csvStream << "\n";
+        }
+    }
+
+    csvFile.close();
+
+    return true;
+}
+
+float ExporterMaskFailuresCSV::progress() { return requested ? 1.0f : 0; }
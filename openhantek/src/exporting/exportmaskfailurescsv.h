@@ -0,0 +1,24 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+#include "exporterinterface.h"
+
+class MaskTest;
+
+/// \brief Exports the failing waveforms of the mask test to a CSV file.
+/// Every row contains the waveform number, the time and the voltage of each enabled channel.
+class ExporterMaskFailuresCSV : public ExporterInterface
+{
+public:
+    ExporterMaskFailuresCSV(const MaskTest *maskTest);
+    virtual void create(ExporterRegistry *registry) override;
+    virtual QIcon icon() override;
+    virtual QString name() override;
+    virtual Type type() override;
+    virtual bool samples(const std::shared_ptr<PPresult>data) override;
+    virtual bool save() override;
+    virtual float progress() override;
+private:
+    const MaskTest *maskTest;
+    bool requested = false;
+};
@@ -0,0 +1,81 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include "exportsegmentscsv.h"
+#include "exporterregistry.h"
+#include "post/segmentbuffer.h"
+#include "settings.h"
+#include "iconfont/QtAwesome.h"
+
+#include <QCoreApplication>
+#include <QTextStream>
+#include <QFile>
+#include <QFileDialog>
+
+ExporterSegmentsCSV::ExporterSegmentsCSV(const SegmentBuffer *buffer) : buffer(buffer) {}
+
+void ExporterSegmentsCSV::create(ExporterRegistry *registry) { this->registry = registry; requested = false; }
+
+QIcon ExporterSegmentsCSV::icon() { return iconFont->icon(fa::th); }
+
+QString ExporterSegmentsCSV::name() { return QCoreApplication::tr("Export segments CSV"); }
+
+ExporterInterface::Type ExporterSegmentsCSV::type() { return Type::SnapshotExport; }
+
+bool ExporterSegmentsCSV::samples(const std::shared_ptr<PPresult>) {
+    // The segments are taken from the segment buffer, the current sample set only triggers the export
+    requested = true;
+    return false;
+}
+
+bool ExporterSegmentsCSV::save() {
+    const unsigned count = buffer->count();
+    if (!count) return false;
+
+    QStringList filters;
+    filters << QCoreApplication::tr("Comma-Separated Values (*.csv)");
+
+    QFileDialog fileDialog(nullptr, QCoreApplication::tr("Export file..."), QString(), filters.join(";;"));
+    fileDialog.setFileMode(QFileDialog::AnyFile);
+    fileDialog.setAcceptMode(QFileDialog::AcceptSave);
+    if (fileDialog.exec() != QDialog::Accepted) return false;
+
+    QFile csvFile(fileDialog.selectedFiles().first());
+    if (!csvFile.open(QIODevice::WriteOnly | QIODevice::Text)) return false;
+
+    QTextStream csvStream(&csvFile);
+    csvStream.setRealNumberNotation(QTextStream::FixedNotation);
+    csvStream.setRealNumberPrecision(10);
+
+    const DsoSettingsScope &scope = registry->settings->scope;
+    const double interval = buffer->interval();
+    const double pretrigger = buffer->pretrigger();
+
+    // Start with channel names
+    csvStream << "\"segment\",\"timestamp\",\"t\"";
+    for (ChannelID channel = 0; channel < scope.voltage.size(); ++channel) {
+        if (scope.voltage[channel].used) csvStream << ",\"" << scope.voltage[channel].name << "\"";
+    }
+    csvStream << "\n";
+
+    SegmentBuffer::Segment segment;
+    std::vector<std::vector<double>> samples;
+    for (unsigned index = 0; index < count; ++index) {
+        if (!buffer->get(index, segment, samples)) break;
+        for (size_t row = 0; row < samples.front().size(); ++row) {
+            csvStream << segment.number << "," << segment.timestamp << ","
+                      << (row - pretrigger + segment.triggerFraction) * interval;
+            for (ChannelID channel = 0; channel < scope.voltage.size(); ++channel) {
+                if (!scope.voltage[channel].used) continue;
+                csvStream << ",";
+                if (channel < samples.size()) csvStream << samples[channel][row];
+            }
+            csvStream << "\n";
+        }
+    }
+
+    csvFile.close();
+
+    return true;
+}
+
+float ExporterSegmentsCSV::progress() { return requested ? 1.0f : 0; }
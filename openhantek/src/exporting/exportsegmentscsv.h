@@ -0,0 +1,25 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+#include "exporterinterface.h"
+
+class SegmentBuffer;
+
+/// \brief Exports all segments of the segmented acquisition to a CSV file.
+/// Every row contains the segment number, its timestamp, the time relative to the trigger point
+/// and the voltage of each enabled channel.
+class ExporterSegmentsCSV : public ExporterInterface
+{
+public:
+    ExporterSegmentsCSV(const SegmentBuffer *buffer);
+    virtual void create(ExporterRegistry *registry) override;
+    virtual QIcon icon() override;
+    virtual QString name() override;
+    virtual Type type() override;
+    virtual bool samples(const std::shared_ptr<PPresult>data) override;
+    virtual bool save() override;
+    virtual float progress() override;
+private:
+    const SegmentBuffer *buffer;
+    bool requested = false;
+};
@@ -76,14 +76,13 @@ bool LegacyExportDrawer::exportSamples(const PPresult *result, QPaintDevice* pai
                 // Print label
                 painter.setPen(colorValues->voltage[channel]);
                 painter.drawText(QRectF(0, top, lineHeight * 4, lineHeight), settings->scope.voltage[channel].name);
-                // Print coupling/math mode
+                // Print coupling/math expression
                 if ((unsigned int)channel < deviceSpecification->channels)
                     painter.drawText(QRectF(lineHeight * 4, top, lineHeight * 2, lineHeight),
                                      Dso::couplingString(settings->scope.coupling(channel, deviceSpecification)));
                 else
-                    painter.drawText(
-                        QRectF(lineHeight * 4, top, lineHeight * 2, lineHeight),
-                        Dso::mathModeString(Dso::getMathMode(settings->scope.voltage[channel])));
+                    painter.drawText(QRectF(lineHeight * 4, top, lineHeight * 2, lineHeight),
+                                     settings->scope.voltage[channel].mathExpression);
 
                 // Print voltage gain
                 painter.drawText(QRectF(lineHeight * 6, top, stretchBase * 2, lineHeight),
@@ -101,11 +100,11 @@ bool LegacyExportDrawer::exportSamples(const PPresult *result, QPaintDevice* pai
                 // Amplitude string representation (4 significant digits)
                 painter.setPen(colorValues->text);
                 painter.drawText(QRectF(lineHeight * 6 + stretchBase * 4, top, stretchBase * 3, lineHeight),
-                                 valueToString(result->data(channel)->computeAmplitude(), UNIT_VOLTS, 4),
+                                 valueToString(result->data(channel)->measurements.amplitude, UNIT_VOLTS, 4),
                                  QTextOption(Qt::AlignRight));
                 // Frequency string representation (5 significant digits)
                 painter.drawText(QRectF(lineHeight * 6 + stretchBase * 7, top, stretchBase * 3, lineHeight),
-                                 valueToString(result->data(channel)->frequency, UNIT_HERTZ, 5),
+                                 valueToString(result->data(channel)->measurements.frequency, UNIT_HERTZ, 5),
                                  QTextOption(Qt::AlignRight));
             }
         }
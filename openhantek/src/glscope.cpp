@@ -1,5 +1,6 @@
 // SPDX-License-Identifier: GPL-2.0+
 
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 
@@ -19,9 +20,42 @@
 #include "post/graphgenerator.h"
 #include "post/ppresult.h"
 #include "scopesettings.h"
+#include "utils/metrics.h"
 #include "viewconstants.h"
 #include "viewsettings.h"
 
+/// Single channel texture formats of desktop OpenGL, missing in the OpenGL ES 2 headers
+static const GLenum TEXTURE_RED = 0x1903;
+static const GLint TEXTURE_R8 = 0x8229;
+/// Minimal number of rows of the waterfall
+static const unsigned MIN_WATERFALL_DEPTH = 16;
+
+/// Vertex shaders of the textured quads of the waterfall and the XY density, the quad covers `area` in divs
+static const char *QUAD_VSHADER_ES = R"(
+          #version 100
+          attribute highp vec2 vertex;
+          uniform mat4 matrix;
+          uniform highp vec4 area;
+          varying highp vec2 position;
+          void main()
+          {
+              gl_Position = matrix * vec4(mix(area.xy, area.zw, vertex), 0.0, 1.0);
+              position = vertex;
+          }
+    )";
+static const char *QUAD_VSHADER_DESKTOP = R"(
+          #version 150
+          in highp vec2 vertex;
+          uniform mat4 matrix;
+          uniform highp vec4 area;
+          out highp vec2 position;
+          void main()
+          {
+              gl_Position = matrix * vec4(mix(area.xy, area.zw, vertex), 0.0, 1.0);
+              position = vertex;
+          }
+    )";
+
 GlScope *GlScope::createNormal(DsoSettingsScope *scope, DsoSettingsView *view, QWidget *parent) {
     GlScope *s = new GlScope(scope, view, parent);
     s->zoomed = false;
@@ -55,9 +89,19 @@ void GlScope::fixOpenGLversion(QSurfaceFormat::RenderableType t) {
 GlScope::GlScope(DsoSettingsScope *scope, DsoSettingsView *view, QWidget *parent)
     : QOpenGLWidget(parent), scope(scope), view(view) {
     vaMarker.resize(MARKER_COUNT);
+    uploadTime = Metrics::Registry::get()->histogram("gl.upload");
+    paintTime = Metrics::Registry::get()->histogram("gl.paint");
 }
 
-GlScope::~GlScope() {/* virtual destructor necessary */}
+GlScope::~GlScope() {
+    if ((waterfalls.empty() && densityTextures.empty()) || !context()) return;
+    makeCurrent();
+    for (Waterfall &waterfall : waterfalls)
+        if (waterfall.texture) context()->functions()->glDeleteTextures(1, &waterfall.texture);
+    for (GLuint &texture : densityTextures)
+        if (texture) context()->functions()->glDeleteTextures(1, &texture);
+    doneCurrent();
+}
 
 void GlScope::mousePressEvent(QMouseEvent *event) {
     if (!zoomed && event->button() == Qt::LeftButton) {
@@ -218,6 +262,138 @@ void GlScope::initializeGL() {
 
     m_program = std::move(program);
     shaderCompileSuccess = true;
+
+    initializeWaterfall();
+    initializeDensity();
+}
+
+void GlScope::initializeWaterfall() {
+    auto program = std::unique_ptr<QOpenGLShaderProgram>(new QOpenGLShaderProgram(context()));
+
+    // The rows are a ring starting at `offset`, the levels are mapped to a blue-cyan-yellow-red colour scale
+    const char *fshaderES = R"(
+          #version 100
+          uniform sampler2D rows;
+          uniform highp float offset;
+          varying highp vec2 position;
+          void main()
+          {
+              highp float level = texture2D(rows, vec2(position.x, fract(offset + position.y))).r;
+              gl_FragColor = vec4(clamp(vec3(1.5) - abs(4.0 * level - vec3(3.0, 2.0, 1.0)), 0.0, 1.0), 1.0);
+          }
+    )";
+
+    const char *fshaderDesktop = R"(
+          #version 150
+          uniform sampler2D rows;
+          uniform highp float offset;
+          in highp vec2 position;
+          out vec4 flatColor;
+          void main()
+          {
+              highp float level = texture(rows, vec2(position.x, fract(offset + position.y))).r;
+              flatColor = vec4(clamp(vec3(1.5) - abs(4.0 * level - vec3(3.0, 2.0, 1.0)), 0.0, 1.0), 1.0);
+          }
+    )";
+
+    bool usesOpenGL = QSurfaceFormat::defaultFormat().renderableType() == QSurfaceFormat::OpenGL;
+    if (!program->addShaderFromSourceCode(QOpenGLShader::Vertex, usesOpenGL ? QUAD_VSHADER_DESKTOP : QUAD_VSHADER_ES) ||
+        !program->addShaderFromSourceCode(QOpenGLShader::Fragment, usesOpenGL ? fshaderDesktop : fshaderES) ||
+        !program->link()) {
+        qWarning() << "Waterfall not available:" << program->log();
+        return;
+    }
+
+    int vertexLocation = program->attributeLocation("vertex");
+    waterfallAreaLocation = program->uniformLocation("area");
+    waterfallMatrixLocation = program->uniformLocation("matrix");
+    waterfallOffsetLocation = program->uniformLocation("offset");
+    waterfallRowsLocation = program->uniformLocation("rows");
+    if (vertexLocation == -1 || waterfallAreaLocation == -1 || waterfallMatrixLocation == -1 ||
+        waterfallOffsetLocation == -1 || waterfallRowsLocation == -1) {
+        qWarning() << "Failed to locate waterfall shader variable";
+        return;
+    }
+
+    const GLfloat quad[] = {0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f};
+    program->bind();
+    {
+        m_vaoWaterfall.create();
+        QOpenGLVertexArrayObject::Binder b(&m_vaoWaterfall);
+        m_waterfallQuad.create();
+        m_waterfallQuad.bind();
+        m_waterfallQuad.setUsagePattern(QOpenGLBuffer::StaticDraw);
+        m_waterfallQuad.allocate(quad, int(sizeof(quad)));
+        program->enableAttributeArray(vertexLocation);
+        program->setAttributeBuffer(vertexLocation, GL_FLOAT, 0, 2, 0);
+    }
+    program->release();
+    m_program->bind();
+
+    m_waterfallProgram = std::move(program);
+}
+
+void GlScope::initializeDensity() {
+    auto program = std::unique_ptr<QOpenGLShaderProgram>(new QOpenGLShaderProgram(context()));
+
+    // The levels are the opacity of the channel colour
+    const char *fshaderES = R"(
+          #version 100
+          uniform sampler2D map;
+          uniform highp vec4 colour;
+          varying highp vec2 position;
+          void main()
+          {
+              gl_FragColor = vec4(colour.rgb, texture2D(map, position).r);
+          }
+    )";
+    const char *fshaderDesktop = R"(
+          #version 150
+          uniform sampler2D map;
+          uniform highp vec4 colour;
+          in highp vec2 position;
+          out vec4 flatColor;
+          void main()
+          {
+              flatColor = vec4(colour.rgb, texture(map, position).r);
+          }
+    )";
+
+    bool usesOpenGL = QSurfaceFormat::defaultFormat().renderableType() == QSurfaceFormat::OpenGL;
+    if (!program->addShaderFromSourceCode(QOpenGLShader::Vertex, usesOpenGL ? QUAD_VSHADER_DESKTOP : QUAD_VSHADER_ES) ||
+        !program->addShaderFromSourceCode(QOpenGLShader::Fragment, usesOpenGL ? fshaderDesktop : fshaderES) ||
+        !program->link()) {
+        qWarning() << "XY density not available:" << program->log();
+        return;
+    }
+
+    int vertexLocation = program->attributeLocation("vertex");
+    densityAreaLocation = program->uniformLocation("area");
+    densityMatrixLocation = program->uniformLocation("matrix");
+    densityColourLocation = program->uniformLocation("colour");
+    densityMapLocation = program->uniformLocation("map");
+    if (vertexLocation == -1 || densityAreaLocation == -1 || densityMatrixLocation == -1 ||
+        densityColourLocation == -1 || densityMapLocation == -1) {
+        qWarning() << "Failed to locate XY density shader variable";
+        return;
+    }
+
+    const GLfloat quad[] = {0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f};
+    program->bind();
+    {
+        m_vaoDensity.create();
+        QOpenGLVertexArrayObject::Binder b(&m_vaoDensity);
+        m_densityQuad.create();
+        m_densityQuad.bind();
+        m_densityQuad.setUsagePattern(QOpenGLBuffer::StaticDraw);
+        m_densityQuad.allocate(quad, int(sizeof(quad)));
+        program->enableAttributeArray(vertexLocation);
+        program->setAttributeBuffer(vertexLocation, GL_FLOAT, 0, 2, 0);
+    }
+    program->release();
+    m_program->bind();
+
+    m_densityProgram = std::move(program);
 }
 
 void GlScope::showData(std::shared_ptr<PPresult> data) {
@@ -233,7 +409,18 @@ void GlScope::showData(std::shared_ptr<PPresult> data) {
     m_GraphHistory.splice(m_GraphHistory.begin(), m_GraphHistory, std::prev(m_GraphHistory.end()));
 
     // Add new entry
-    m_GraphHistory.front().writeData(data.get(), m_program.get(), vertexLocation);
+    {
+        Metrics::ScopedTimer timer(uploadTime);
+        m_GraphHistory.front().writeData(data.get(), m_program.get(), vertexLocation);
+        if (view->waterfall) uploadWaterfall(data.get());
+        if (view->xyDensity && scope->horizontal.format == Dso::GraphFormat::XY) uploadDensity(data.get());
+        if (scope->eye.enabled && scope->horizontal.format == Dso::GraphFormat::TY) uploadDensity(data.get());
+    }
+    decodedWords = data->decodedWords;
+    decoderUndersampled = data->decoderUndersampled;
+    graphOrigin = data->graphOrigin;
+    graphScale = data->graphScale;
+    histogram = data->histogram;
     // doneCurrent();
 
     update();
@@ -255,9 +442,16 @@ void GlScope::markerUpdated() {
 
 void GlScope::paintGL() {
     if (!shaderCompileSuccess) return;
+    Metrics::ScopedTimer timer(paintTime);
 
     auto *gl = context()->functions();
 
+    // The QPainter of the overlays resets the state when it ends, restore what initializeGL() configured
+    gl->glEnable(GL_BLEND);
+    gl->glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    gl->glEnable(GL_DEPTH_TEST);
+    gl->glEnable(GL_CULL_FACE);
+
     // Clear OpenGL buffer and configure settings
     // TODO Don't clear if view->digitalPhosphorDraws()>1
     gl->glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -266,31 +460,194 @@ void GlScope::paintGL() {
     m_program->bind();
 
     // Apply zoom settings via matrix transformation
+    QMatrix4x4 matrix = pmvMatrix;
     if (zoomed) {
         QMatrix4x4 m;
         m.scale(QVector3D(DIVS_TIME / (GLfloat)fabs(scope->horizontal.marker[1] - scope->horizontal.marker[0]), 1.0f,
                           1.0f));
         m.translate((GLfloat) - (scope->horizontal.marker[0] + scope->horizontal.marker[1]) / 2, 0.0f, 0.0f);
-        m_program->setUniformValue(matrixLocation, pmvMatrix * m);
+        matrix = pmvMatrix * m;
+        m_program->setUniformValue(matrixLocation, matrix);
+    }
+
+    // The waterfall replaces the spectrum graphs
+    const bool waterfall = view->waterfall && scope->horizontal.format == Dso::GraphFormat::TY;
+    if (waterfall) {
+        drawWaterfalls(matrix);
+        m_program->bind();
+    }
+    // The intensity maps replace the XY graphs
+    if (view->xyDensity && scope->horizontal.format == Dso::GraphFormat::XY) {
+        drawDensities(matrix);
+        m_program->bind();
+    }
+    // The eye diagram replaces the voltage graphs, its time axis are unit intervals and not affected by the zoom
+    const bool eye = scope->eye.enabled && scope->horizontal.format == Dso::GraphFormat::TY;
+    if (eye) {
+        drawDensities(pmvMatrix);
+        m_program->bind();
     }
 
     unsigned historyIndex = 0;
     for (Graph &graph : m_GraphHistory) {
         for (ChannelID channel = 0; channel < scope->voltage.size(); ++channel) {
-            if (scope->horizontal.format == Dso::GraphFormat::TY) {
+            if (scope->horizontal.format == Dso::GraphFormat::TY && !waterfall) {
                 drawSpectrumChannelGraph(channel, graph, (int)historyIndex);
             }
-            drawVoltageChannelGraph(channel, graph, (int)historyIndex);
+            // The reviewed segment replaces the live graph
+            if (scope->segments.review < 0 && !eye) drawVoltageChannelGraph(channel, graph, (int)historyIndex);
         }
         ++historyIndex;
     }
 
+    if (!m_GraphHistory.empty() && scope->horizontal.format == Dso::GraphFormat::TY && !eye) {
+        for (ChannelID channel = 0; channel < scope->voltage.size(); ++channel)
+            drawSegmentsChannelGraph(channel, m_GraphHistory.front());
+    }
+
     if (zoomed) { m_program->setUniformValue(matrixLocation, pmvMatrix); }
 
     if (!this->zoomed) drawMarkers();
 
     drawGrid();
     m_program->release();
+
+    drawMasks(matrix);
+    drawHistogram(matrix);
+    drawDecodedWords(matrix);
+}
+
+void GlScope::drawMasks(const QMatrix4x4 &matrix) {
+    if (!scope->mask.enabled || scope->horizontal.format != Dso::GraphFormat::TY) return;
+
+    // Divs to normalized device coordinates to pixels
+    auto toPixel = [this, &matrix](double x, double y) {
+        const QVector3D position = matrix.map(QVector3D((float)x, (float)y, 0.0f));
+        return QPointF((position.x() + 1.0) * width() / 2, (1.0 - position.y()) * height() / 2);
+    };
+
+    QPainter painter(this);
+    painter.setRenderHint(QPainter::Antialiasing, true);
+    painter.setPen(Qt::NoPen);
+    painter.setBrush(QColor(0xff, 0x00, 0x00, 0x3f));
+    for (const DsoSettingsScopeVoltage &voltage : scope->voltage) {
+        if (!voltage.used) continue;
+        // The area between each limit line and the screen border
+        for (const QPolygonF *line : {&voltage.maskUpper, &voltage.maskLower}) {
+            if (line->isEmpty()) continue;
+            const double border = line == &voltage.maskUpper ? DIVS_VOLTAGE / 2 : -DIVS_VOLTAGE / 2;
+            QPolygonF area;
+            area.reserve(line->size() + 2);
+            for (const QPointF &point : *line) area << toPixel(point.x(), point.y());
+            area << toPixel(line->last().x(), border) << toPixel(line->first().x(), border);
+            painter.drawPolygon(area);
+        }
+    }
+}
+
+void GlScope::drawHistogram(const QMatrix4x4 &matrix) {
+    if (histogram.bins.empty() || scope->horizontal.format != Dso::GraphFormat::TY) return;
+    const unsigned long long highest = *std::max_element(histogram.bins.begin(), histogram.bins.end());
+    if (!highest) return;
+
+    // The highest bin reaches a fifth of the screen width or a quarter of the screen height
+    const size_t count = histogram.bins.size();
+    const double binSize = (histogram.last - histogram.first) / count;
+    QPolygonF outline;
+    outline.reserve((int)(2 * count + 2));
+    if (histogram.amplitude) {
+        auto toPixel = [this, &matrix](double length, double y) {
+            const QVector3D position = matrix.map(QVector3D(0.0f, (float)y, 0.0f));
+            return QPointF(length * width() / 5, (1.0 - position.y()) * height() / 2);
+        };
+        outline << toPixel(0.0, histogram.first);
+        for (size_t bin = 0; bin < count; ++bin) {
+            const double length = (double)histogram.bins[bin] / highest;
+            outline << toPixel(length, histogram.first + bin * binSize)
+                    << toPixel(length, histogram.first + (bin + 1) * binSize);
+        }
+        outline << toPixel(0.0, histogram.last);
+    } else {
+        auto toPixel = [this, &matrix](double x, double length) {
+            const QVector3D position = matrix.map(QVector3D((float)x, 0.0f, 0.0f));
+            return QPointF((position.x() + 1.0) * width() / 2, height() * (1.0 - length / 4));
+        };
+        outline << toPixel(histogram.first, 0.0);
+        for (size_t bin = 0; bin < count; ++bin) {
+            const double length = (double)histogram.bins[bin] / highest;
+            outline << toPixel(histogram.first + bin * binSize, length)
+                    << toPixel(histogram.first + (bin + 1) * binSize, length);
+        }
+        outline << toPixel(histogram.last, 0.0);
+    }
+
+    const QColor color = histogram.channel < view->screen.voltage.size() ? view->screen.voltage[histogram.channel]
+                                                                          : view->screen.text;
+    QColor fill = color;
+    fill.setAlpha(0x5f);
+    QPainter painter(this);
+    painter.setRenderHint(QPainter::Antialiasing, true);
+    painter.setPen(color);
+    painter.setBrush(fill);
+    painter.drawPolygon(outline);
+}
+
+void GlScope::drawDecodedWords(const QMatrix4x4 &matrix) {
+    if ((decodedWords.empty() && !decoderUndersampled) || scope->horizontal.format != Dso::GraphFormat::TY) return;
+
+    const ChannelID channel = scope->decoder.dataChannel;
+    const QColor color = channel < view->screen.voltage.size() ? view->screen.voltage[channel] : view->screen.text;
+    QColor fill = color;
+    fill.setAlpha(0x3f);
+    const QColor errorColor(0xff, 0x3f, 0x3f);
+
+    QPainter painter(this);
+    painter.setRenderHint(QPainter::Antialiasing, true);
+    const QFontMetrics metrics = painter.fontMetrics();
+    const double rowHeight = metrics.height() + 4;
+    const double top = height() - rowHeight - 2;
+    const int digits = scope->decoder.dataBits > 8 ? 4 : 2;
+
+    if (decoderUndersampled) {
+        painter.setPen(errorColor);
+        painter.drawText(QRectF(0, top, width(), rowHeight), Qt::AlignCenter, tr("Sample rate too low to decode"));
+        return;
+    }
+
+    for (const DecodedWord &word : decodedWords) {
+        // Divs to normalized device coordinates to pixels
+        const double left =
+            (matrix.map(QVector3D((float)(graphOrigin + word.start * graphScale), 0.0f, 0.0f)).x() + 1.0) * width() / 2;
+        const double right =
+            (matrix.map(QVector3D((float)(graphOrigin + word.end * graphScale), 0.0f, 0.0f)).x() + 1.0) * width() / 2;
+        if (right < 0.0 || left > width()) continue;
+
+        if (word.kind == DecodedWord::Kind::START || word.kind == DecodedWord::Kind::STOP) {
+            painter.setPen(color);
+            painter.drawLine(QPointF(left, top), QPointF(left, top + rowHeight));
+            painter.drawText(QRectF(left + 2, top, rowHeight, rowHeight), Qt::AlignLeft | Qt::AlignVCenter,
+                             word.kind == DecodedWord::Kind::START ? "S" : "P");
+            continue;
+        }
+
+        const QRectF box(left, top, std::max(right - left, 1.0), rowHeight);
+        const bool error = word.status == DecodedWord::Status::PARITY_ERROR ||
+                           word.status == DecodedWord::Status::FRAMING_ERROR;
+        painter.setPen(error ? errorColor : color);
+        painter.setBrush(fill);
+        painter.drawRoundedRect(box, 3, 3);
+
+        QString label;
+        if (word.kind == DecodedWord::Kind::ADDRESS)
+            label = QString("%1 %2").arg(word.value >> 1, 2, 16, QChar('0')).arg(word.value & 1 ? "R" : "W");
+        else
+            label = QString("%1").arg(word.value, digits, 16, QChar('0'));
+        label = label.toUpper();
+        if (word.status == DecodedWord::Status::NACK) label += " N";
+        if (error) label += " !";
+        // Skip the labels that don't fit into their box
+        if (metrics.size(0, label).width() + 4 < box.width()) painter.drawText(box, Qt::AlignCenter, label);
+    }
 }
 
 void GlScope::resizeGL(int width, int height) {
@@ -473,3 +830,161 @@ void GlScope::drawSpectrumChannelGraph(ChannelID channel, Graph &graph, int hist
     const GLenum dMode = (view->interpolation == Dso::INTERPOLATION_OFF) ? GL_POINTS : GL_LINE_STRIP;
     context()->functions()->glDrawArrays(dMode, 0, v.second);
 }
+
+void GlScope::drawSegmentsChannelGraph(ChannelID channel, Graph &graph) {
+    if (!scope->voltage[channel].used || channel >= graph.vaoSegments.size() || !graph.segmentVertexCount) return;
+
+    // A reviewed segment is drawn like the live graph, overlaid segments are dimmed
+    QColor color = view->screen.voltage[channel];
+    if (scope->segments.review < 0) color = color.darker(200);
+    m_program->setUniformValue(colorLocation, color);
+    Graph::VaoCount &v = graph.vaoSegments[channel];
+
+    QOpenGLVertexArrayObject::Binder b(v.first);
+    const GLenum dMode = (view->interpolation == Dso::INTERPOLATION_OFF) ? GL_POINTS : GL_LINE_STRIP;
+    for (GLsizei first = 0; first + graph.segmentVertexCount <= v.second; first += graph.segmentVertexCount)
+        context()->functions()->glDrawArrays(dMode, first, graph.segmentVertexCount);
+}
+
+void GlScope::uploadWaterfall(const PPresult *data) {
+    if (!m_waterfallProgram) return;
+    auto *gl = context()->functions();
+    const bool singleChannelFormat = !context()->isOpenGLES();
+    const GLsizei depth = (GLsizei)std::max(view->waterfallDepth, MIN_WATERFALL_DEPTH);
+
+    waterfalls.resize(data->channelCount());
+    gl->glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (ChannelID channel = 0; channel < data->channelCount(); ++channel) {
+        Waterfall &waterfall = waterfalls[channel];
+        const DataChannel *channelData = data->data(channel);
+        const GLsizei width = (GLsizei)channelData->spectrum.sample.size();
+        if (!width || channelData->spectrogram.empty()) continue;
+
+        if (!waterfall.texture) gl->glGenTextures(1, &waterfall.texture);
+        gl->glBindTexture(GL_TEXTURE_2D, waterfall.texture);
+        if (waterfall.width != width || waterfall.depth != depth) {
+            // The bins have changed, restart with an empty history
+            std::vector<uint8_t> empty((size_t)width * depth, 0);
+            gl->glTexImage2D(GL_TEXTURE_2D, 0, singleChannelFormat ? TEXTURE_R8 : GL_LUMINANCE, width, depth, 0,
+                             singleChannelFormat ? TEXTURE_RED : GL_LUMINANCE, GL_UNSIGNED_BYTE, empty.data());
+            gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            waterfall.width = width;
+            waterfall.depth = depth;
+            waterfall.next = 0;
+        }
+        waterfall.interval = channelData->spectrum.interval;
+
+        // Only the latest rows fit into the ring, they are written in at most two pieces
+        const uint8_t *rows = channelData->spectrogram.data();
+        GLsizei rowCount = (GLsizei)(channelData->spectrogram.size() / width);
+        if (rowCount > depth) {
+            rows += (size_t)(rowCount - depth) * width;
+            rowCount = depth;
+        }
+        while (rowCount > 0) {
+            const GLsizei count = std::min(rowCount, depth - waterfall.next);
+            gl->glTexSubImage2D(GL_TEXTURE_2D, 0, 0, waterfall.next, width, count,
+                                singleChannelFormat ? TEXTURE_RED : GL_LUMINANCE, GL_UNSIGNED_BYTE, rows);
+            rows += (size_t)count * width;
+            rowCount -= count;
+            waterfall.next = (waterfall.next + count) % depth;
+        }
+    }
+    gl->glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void GlScope::drawWaterfalls(const QMatrix4x4 &matrix) {
+    if (!m_waterfallProgram) return;
+
+    std::vector<ChannelID> shown;
+    for (ChannelID channel = 0; channel < waterfalls.size() && channel < scope->spectrum.size(); ++channel)
+        if (scope->spectrum[channel].used && waterfalls[channel].width) shown.push_back(channel);
+    if (shown.empty()) return;
+
+    auto *gl = context()->functions();
+    m_waterfallProgram->bind();
+    m_waterfallProgram->setUniformValue(waterfallMatrixLocation, matrix);
+    m_waterfallProgram->setUniformValue(waterfallRowsLocation, 0);
+    gl->glActiveTexture(GL_TEXTURE0);
+    // Don't hide the graphs and the grid that are drawn afterwards
+    gl->glDepthMask(GL_FALSE);
+    {
+        QOpenGLVertexArrayObject::Binder b(&m_vaoWaterfall);
+        for (size_t band = 0; band < shown.size(); ++band) {
+            const Waterfall &waterfall = waterfalls[shown[band]];
+            // The first channel is at the top, the newest row at the top of each band
+            const float top = DIVS_VOLTAGE / 2 - DIVS_VOLTAGE * band / shown.size();
+            const float bottom = top - DIVS_VOLTAGE / shown.size();
+            const float right =
+                -DIVS_TIME / 2 + (float)(waterfall.width * waterfall.interval / scope->horizontal.frequencybase);
+            m_waterfallProgram->setUniformValue(waterfallAreaLocation, QVector4D(-DIVS_TIME / 2, bottom, right, top));
+            m_waterfallProgram->setUniformValue(waterfallOffsetLocation, (GLfloat)waterfall.next / waterfall.depth);
+            gl->glBindTexture(GL_TEXTURE_2D, waterfall.texture);
+            gl->glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        }
+    }
+    gl->glBindTexture(GL_TEXTURE_2D, 0);
+    gl->glDepthMask(GL_TRUE);
+    m_waterfallProgram->release();
+}
+
+void GlScope::uploadDensity(const PPresult *data) {
+    if (!m_densityProgram) return;
+    auto *gl = context()->functions();
+    const bool singleChannelFormat = !context()->isOpenGLES();
+
+    densityTextures.resize(data->channelCount(), 0);
+    densityShown.assign(data->channelCount(), false);
+    gl->glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (ChannelID channel = 0; channel < data->channelCount(); ++channel) {
+        const std::vector<uint8_t> &density = data->data(channel)->density;
+        if (density.size() != (size_t)XY_DENSITY_WIDTH * XY_DENSITY_HEIGHT) continue;
+
+        GLuint &texture = densityTextures[channel];
+        if (!texture) {
+            gl->glGenTextures(1, &texture);
+            gl->glBindTexture(GL_TEXTURE_2D, texture);
+            gl->glTexImage2D(GL_TEXTURE_2D, 0, singleChannelFormat ? TEXTURE_R8 : GL_LUMINANCE, XY_DENSITY_WIDTH,
+                             XY_DENSITY_HEIGHT, 0, singleChannelFormat ? TEXTURE_RED : GL_LUMINANCE,
+                             GL_UNSIGNED_BYTE, density.data());
+            gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        } else {
+            gl->glBindTexture(GL_TEXTURE_2D, texture);
+            gl->glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, XY_DENSITY_WIDTH, XY_DENSITY_HEIGHT,
+                                singleChannelFormat ? TEXTURE_RED : GL_LUMINANCE, GL_UNSIGNED_BYTE, density.data());
+        }
+        densityShown[channel] = true;
+    }
+    gl->glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void GlScope::drawDensities(const QMatrix4x4 &matrix) {
+    if (!m_densityProgram) return;
+
+    auto *gl = context()->functions();
+    m_densityProgram->bind();
+    m_densityProgram->setUniformValue(densityMatrixLocation, matrix);
+    m_densityProgram->setUniformValue(densityMapLocation, 0);
+    m_densityProgram->setUniformValue(densityAreaLocation,
+                                      QVector4D(-DIVS_TIME / 2, -DIVS_VOLTAGE / 2, DIVS_TIME / 2, DIVS_VOLTAGE / 2));
+    gl->glActiveTexture(GL_TEXTURE0);
+    gl->glDepthMask(GL_FALSE);
+    {
+        QOpenGLVertexArrayObject::Binder b(&m_vaoDensity);
+        for (ChannelID channel = 0; channel < densityShown.size(); ++channel) {
+            if (!densityShown[channel] || channel >= view->screen.voltage.size()) continue;
+            m_densityProgram->setUniformValue(densityColourLocation, view->screen.voltage[channel]);
+            gl->glBindTexture(GL_TEXTURE_2D, densityTextures[channel]);
+            gl->glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        }
+    }
+    gl->glBindTexture(GL_TEXTURE_2D, 0);
+    gl->glDepthMask(GL_TRUE);
+    m_densityProgram->release();
+}
@@ -15,10 +15,14 @@
 #include "glscopegraph.h"
 #include "hantekdso/enums.h"
 #include "hantekprotocol/types.h"
+#include "post/ppresult.h"
 
 struct DsoSettingsView;
 struct DsoSettingsScope;
 class PPresult;
+namespace Metrics {
+class Histogram;
+}
 
 /// \brief OpenGL accelerated widget that displays the oscilloscope screen.
 class GlScope : public QOpenGLWidget {
@@ -73,6 +77,26 @@ class GlScope : public QOpenGLWidget {
 
     void drawVoltageChannelGraph(ChannelID channel, Graph &graph, int historyIndex);
     void drawSpectrumChannelGraph(ChannelID channel, Graph &graph, int historyIndex);
+    /// Draw the segments of the segmented acquisition
+    void drawSegmentsChannelGraph(ChannelID channel, Graph &graph);
+    /// \brief Compile the colour map shader of the waterfall.
+    void initializeWaterfall();
+    /// \brief Write the new spectrum rows into the waterfall textures.
+    void uploadWaterfall(const PPresult *data);
+    /// \brief Draw the waterfalls of all channels with enabled spectrum, each in its own horizontal band.
+    void drawWaterfalls(const QMatrix4x4 &matrix);
+    /// \brief Compile the shader of the XY intensity maps.
+    void initializeDensity();
+    /// \brief Write the new XY intensity maps into their textures.
+    void uploadDensity(const PPresult *data);
+    /// \brief Draw the XY intensity maps over the whole screen in the colour of their x channel.
+    void drawDensities(const QMatrix4x4 &matrix);
+    /// \brief Draw the areas outside of the mask test limits.
+    void drawMasks(const QMatrix4x4 &matrix);
+    /// \brief Draw the words of the protocol decoder as labeled boxes at the bottom of the screen.
+    void drawDecodedWords(const QMatrix4x4 &matrix);
+    /// \brief Draw the histogram of the HistogramGenerator, voltages from the left and times from the bottom border.
+    void drawHistogram(const QMatrix4x4 &matrix);
   signals:
     void markerMoved(unsigned marker, double position);
 
@@ -105,6 +129,44 @@ class GlScope : public QOpenGLWidget {
     std::list<Graph> m_GraphHistory;
     unsigned currentGraphInHistory = 0;
 
+    // Waterfall
+    /// \brief Ring of spectrum rows of one channel, stored as 8 bit texture.
+    struct Waterfall {
+        GLuint texture = 0;
+        GLsizei width = 0;     ///< Number of frequency bins
+        GLsizei depth = 0;     ///< Number of rows
+        GLsizei next = 0;      ///< Ring position of the next row, the oldest row
+        double interval = 0.0; ///< Frequency step between two bins
+    };
+    std::vector<Waterfall> waterfalls;
+    std::unique_ptr<QOpenGLShaderProgram> m_waterfallProgram;
+    QOpenGLBuffer m_waterfallQuad;
+    QOpenGLVertexArrayObject m_vaoWaterfall;
+    int waterfallAreaLocation;
+    int waterfallMatrixLocation;
+    int waterfallOffsetLocation;
+    int waterfallRowsLocation;
+
+    // XY density
+    std::vector<GLuint> densityTextures; ///< Intensity map of each x channel, 0 if not created yet
+    std::vector<bool> densityShown;      ///< true if the latest result contains the map of the channel
+    std::unique_ptr<QOpenGLShaderProgram> m_densityProgram;
+    QOpenGLBuffer m_densityQuad;
+    QOpenGLVertexArrayObject m_vaoDensity;
+    int densityAreaLocation;
+    int densityMatrixLocation;
+    int densityColourLocation;
+    int densityMapLocation;
+
+    // Protocol decoder
+    std::vector<DecodedWord> decodedWords;
+    bool decoderUndersampled = false; ///< Show that the samplerate is too low to decode
+    double graphOrigin = 0.0;         ///< Horizontal position of the time 0 of the decodedWords in divs
+    double graphScale = 0.0;          ///< Divs per second
+
+    // Histogram analysis
+    ValueHistogram histogram;
+
     // OpenGL shader, matrix, var-locations
     bool shaderCompileSuccess = false;
     QString errorMessage;
@@ -114,4 +176,8 @@ class GlScope : public QOpenGLWidget {
     int vertexLocation;
     int matrixLocation;
     int selectionLocation;
+
+    // Statistics
+    Metrics::Histogram *uploadTime; ///< Time to copy new vertices to the GPU
+    Metrics::Histogram *paintTime;  ///< Time to issue all draw calls
 };
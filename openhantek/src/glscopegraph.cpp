@@ -11,6 +11,7 @@ void Graph::writeData(PPresult *data, QOpenGLShaderProgram *program, int vertexL
     int neededMemory = 0;
     for (ChannelGraph &cg : data->vaChannelVoltage) neededMemory += cg.size() * sizeof(QVector3D);
     for (ChannelGraph &cg : data->vaChannelSpectrum) neededMemory += cg.size() * sizeof(QVector3D);
+    for (ChannelGraph &cg : data->vaChannelSegments) neededMemory += cg.size() * sizeof(QVector3D);
 
     buffer.bind();
     program->bind();
@@ -65,6 +66,26 @@ void Graph::writeData(PPresult *data, QOpenGLShaderProgram *program, int vertexL
         }
     }
 
+    // Segments of the segmented acquisition
+    vaoSegments.resize(data->vaChannelSegments.size());
+    segmentVertexCount = (GLsizei)data->segmentVertexCount;
+    for (ChannelID channel = 0; channel < vaoSegments.size(); ++channel) {
+        VaoCount &v = vaoSegments[channel];
+        if (!v.first) {
+            v.first = new QOpenGLVertexArrayObject;
+            if (!v.first->create()) throw new std::runtime_error("QOpenGLVertexArrayObject create failed");
+        }
+        ChannelGraph &gSegments = data->vaChannelSegments[channel];
+        v.first->bind();
+        int dataSize = int(gSegments.size() * sizeof(QVector3D));
+        buffer.write(offset, gSegments.data(), dataSize);
+        program->enableAttributeArray(vertexLocation);
+        program->setAttributeBuffer(vertexLocation, GL_FLOAT, offset, 3, 0);
+        v.first->release();
+        v.second = (int)gSegments.size();
+        offset += dataSize;
+    }
+
     buffer.release();
 }
 
@@ -77,5 +98,9 @@ Graph::~Graph() {
         vao.first->destroy();
         delete vao.first;
     }
+    for (auto &vao : vaoSegments) {
+        vao.first->destroy();
+        delete vao.first;
+    }
     if (buffer.isCreated()) { buffer.destroy(); }
 }
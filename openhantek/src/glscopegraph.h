@@ -24,4 +24,6 @@ struct Graph {
     QOpenGLBuffer buffer;
     std::vector<VaoCount> vaoVoltage;
     std::vector<VaoCount> vaoSpectrum;
+    std::vector<VaoCount> vaoSegments; ///< All segments of a channel, each segmentVertexCount vertices long
+    GLsizei segmentVertexCount = 0;
 };
@@ -89,6 +89,7 @@ struct ControlSpecification {
     bool supportsCaptureState = true;
     bool supportsOffset = true;
     bool supportsCouplingRelays = true;
+    bool supportsStreaming = false; ///< Roll mode can keep bulk reads queued while the device samples continuously
     int fixedUSBinLength = 0;
 };
 }
@@ -11,5 +11,7 @@ struct DSOsamples {
     std::vector<std::vector<double>> data; ///< Pointer to input data from device
     double samplerate = 0.0;               ///< The samplerate of the input data
     bool append = false;                   ///< true, if waiting data should be appended
+    unsigned long long sequence = 0;       ///< Incremented for every new sample set, used to detect dropped sets
+    long long timestamp = 0;               ///< Host time the samples were received in ns, steady clock
     mutable QReadWriteLock lock;
 };
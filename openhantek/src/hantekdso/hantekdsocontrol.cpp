@@ -1,6 +1,8 @@
 // SPDX-License-Identifier: GPL-2.0+
 
+#include <algorithm>
 #include <assert.h>
+#include <chrono>
 #include <cmath>
 #include <limits>
 #include <stdexcept>
@@ -17,12 +19,21 @@
 #include "hantekprotocol/controlStructs.h"
 #include "models/modelDSO6022.h"
 #include "usb/usbdevice.h"
+#include "utils/metrics.h"
 
 using namespace Hantek;
 using namespace Dso;
 
+/// Streaming mode: Raw data buffer, about 2 s of both channels at 8 MS/s
+static const size_t STREAM_RAW_SIZE = 1 << 25;
+/// Streaming mode: Number of bulk transfers that are queued
+static const unsigned STREAM_TRANSFERS = 8;
+/// Streaming mode: Restart the acquisition if no data was received for this time in ms
+static const qint64 STREAM_STALL_TIMEOUT = 1000;
+
 /// \brief Start sampling process.
 void HantekDsoControl::enableSampling(bool enabled) {
+    for (HantekDsoControl *follower : followers) follower->enableSampling(enabled);
     sampling = enabled;
 
     // Emit signals for initial settings
@@ -35,6 +46,8 @@ void HantekDsoControl::enableSampling(bool enabled) {
     emit samplingStatusChanged(enabled);
 }
 
+void HantekDsoControl::addFollower(HantekDsoControl *follower) { followers.push_back(follower); }
+
 const USBDevice *HantekDsoControl::getDevice() const { return device; }
 
 const DSOsamples &HantekDsoControl::getLastSamples() { return result; }
@@ -46,15 +59,29 @@ HantekDsoControl::HantekDsoControl(USBDevice *device)
 
     qRegisterMetaType<DSOsamples *>();
 
+    Metrics::Registry *metrics = Metrics::Registry::get();
+    metricCycle = metrics->histogram("control.cycle");
+    metricTriggerWait = metrics->histogram("control.triggerWait");
+    metricFetch = metrics->histogram("control.fetch");
+    metricCaptures = metrics->counter("control.captures");
+    metricOverruns = metrics->counter("control.streamOverruns", Metrics::Counter::Unit::BYTES);
+    metricCommandsSent = metrics->counter("control.commandsSent");
+    metricCommandsSkipped = metrics->counter("control.commandsSkipped");
+    metricCycleTransfers = metrics->counter("control.cycleTransfers");
+    metricFrameTransfers = metrics->counter("control.frameTransfers");
+
     if (specification->fixedUSBinLength) device->overwriteInPacketLength(specification->fixedUSBinLength);
 
     // Apply special requirements by the devices model
     device->getModel()->applyRequirements(this);
 
-    retrieveChannelLevelData();
+    // The application quits when the device is disconnected, a failed query is not repeated
+    retrieveCapabilities();
 }
 
 HantekDsoControl::~HantekDsoControl() {
+    // The stream writes into streamRaw
+    device->stopStream();
     while (firstBulkCommand) {
         BulkCommand *t = firstBulkCommand->next;
         delete firstBulkCommand;
@@ -99,6 +126,8 @@ double HantekDsoControl::getMaxSamplerate() const {
 
 bool HantekDsoControl::isSampling() const { return sampling; }
 
+unsigned HantekDsoControl::getFrameTransfers() const { return frameTransfers; }
+
 /// \brief Updates the interval of the periodic thread timer.
 void HantekDsoControl::updateInterval() {
     // Check the current oscilloscope state everytime 25% of the time the buffer
@@ -125,6 +154,19 @@ unsigned HantekDsoControl::getRecordLength() const {
     return controlsettings.samplerate.limits->recordLengths[controlsettings.recordLengthId];
 }
 
+Dso::ErrorCode HantekDsoControl::retrieveCapabilities() {
+    connectionSpeed = queryConnectionSpeed();
+    if (connectionSpeed < 0)
+        qWarning() << "Getting the connection speed failed: " << libUsbErrorString(connectionSpeed);
+
+    const Dso::ErrorCode errorCode = retrieveChannelLevelData();
+
+    // The queries are part of the connection, not of the next sample set
+    frameTransferStart = device->getTransferCount();
+    frameControlReadStart = device->getControlReadCount();
+    return errorCode;
+}
+
 Dso::ErrorCode HantekDsoControl::retrieveChannelLevelData() {
     // Get channel level data
     int errorCode = device->controlRead(&controlsettings.cmdGetLimits);
@@ -220,6 +262,10 @@ void HantekDsoControl::convertRawDataToSamples(const std::vector<unsigned char>
     QWriteLocker locker(&result.lock);
     result.samplerate = controlsettings.samplerate.current;
     result.append = isRollMode();
+    result.timestamp =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    ++result.sequence;
     // Prepare result buffers
     result.data.resize(specification->channels);
     for (ChannelID channelCounter = 0; channelCounter < specification->channels; ++channelCounter)
@@ -407,8 +453,8 @@ double HantekDsoControl::getBestSamplerate(double samplerate, bool fastRate, boo
 
 unsigned HantekDsoControl::getSampleCount() const {
     if (isRollMode()) {
-        // TODO handle libusb error
-        return getPacketSize();
+        // An unknown speed gives no samples, they're fetched after the speed was queried again
+        return (unsigned)std::max(getPacketSize(), 0);
     } else {
         if (isFastRate())
             return getRecordLength();
@@ -600,6 +646,7 @@ void HantekDsoControl::updateSamplerateLimits() {
 }
 
 Dso::ErrorCode HantekDsoControl::setRecordLength(unsigned index) {
+    for (HantekDsoControl *follower : followers) follower->setRecordLength(index);
     if (!device->isConnected()) return Dso::ErrorCode::CONNECTION;
 
     if (!updateRecordLength(index)) return Dso::ErrorCode::PARAMETER;
@@ -612,6 +659,7 @@ Dso::ErrorCode HantekDsoControl::setRecordLength(unsigned index) {
 }
 
 Dso::ErrorCode HantekDsoControl::setSamplerate(double samplerate) {
+    for (HantekDsoControl *follower : followers) follower->setSamplerate(samplerate);
     if (!device->isConnected()) return Dso::ErrorCode::CONNECTION;
 
     if (samplerate == 0.0) {
@@ -657,6 +705,7 @@ Dso::ErrorCode HantekDsoControl::setSamplerate(double samplerate) {
 }
 
 Dso::ErrorCode HantekDsoControl::setRecordTime(double duration) {
+    for (HantekDsoControl *follower : followers) follower->setRecordTime(duration);
     if (!device->isConnected()) return Dso::ErrorCode::CONNECTION;
 
     if (duration == 0.0) {
@@ -707,6 +756,7 @@ Dso::ErrorCode HantekDsoControl::setRecordTime(double duration) {
 }
 
 Dso::ErrorCode HantekDsoControl::setChannelUsed(ChannelID channel, bool used) {
+    for (HantekDsoControl *follower : followers) follower->setChannelUsed(channel, used);
     if (!device->isConnected()) return Dso::ErrorCode::CONNECTION;
 
     if (channel >= specification->channels) return Dso::ErrorCode::PARAMETER;
@@ -764,6 +814,7 @@ Dso::ErrorCode HantekDsoControl::setChannelUsed(ChannelID channel, bool used) {
 }
 
 Dso::ErrorCode HantekDsoControl::setCoupling(ChannelID channel, Dso::Coupling coupling) {
+    for (HantekDsoControl *follower : followers) follower->setCoupling(channel, coupling);
     if (!device->isConnected()) return Dso::ErrorCode::CONNECTION;
 
     if (channel >= specification->channels) return Dso::ErrorCode::PARAMETER;
@@ -778,6 +829,7 @@ Dso::ErrorCode HantekDsoControl::setCoupling(ChannelID channel, Dso::Coupling co
 }
 
 Dso::ErrorCode HantekDsoControl::setGain(ChannelID channel, double gain) {
+    for (HantekDsoControl *follower : followers) follower->setGain(channel, gain);
     if (!device->isConnected()) return Dso::ErrorCode::CONNECTION;
 
     if (channel >= specification->channels) return Dso::ErrorCode::PARAMETER;
@@ -814,6 +866,7 @@ Dso::ErrorCode HantekDsoControl::setGain(ChannelID channel, double gain) {
 }
 
 Dso::ErrorCode HantekDsoControl::setOffset(ChannelID channel, const double offset) {
+    for (HantekDsoControl *follower : followers) follower->setOffset(channel, offset);
     if (!device->isConnected()) return Dso::ErrorCode::CONNECTION;
 
     if (channel >= specification->channels) return Dso::ErrorCode::PARAMETER;
@@ -841,6 +894,7 @@ Dso::ErrorCode HantekDsoControl::setOffset(ChannelID channel, const double offse
 }
 
 Dso::ErrorCode HantekDsoControl::setTriggerMode(Dso::TriggerMode mode) {
+    for (HantekDsoControl *follower : followers) follower->setTriggerMode(mode);
     if (!device->isConnected()) return Dso::ErrorCode::CONNECTION;
 
     controlsettings.trigger.mode = mode;
@@ -848,6 +902,7 @@ Dso::ErrorCode HantekDsoControl::setTriggerMode(Dso::TriggerMode mode) {
 }
 
 Dso::ErrorCode HantekDsoControl::setTriggerSource(bool special, unsigned id) {
+    for (HantekDsoControl *follower : followers) follower->setTriggerSource(special, id);
     if (!device->isConnected()) return Dso::ErrorCode::CONNECTION;
     if (specification->isSoftwareTriggerDevice) return Dso::ErrorCode::UNSUPPORTED;
 
@@ -894,6 +949,7 @@ Dso::ErrorCode HantekDsoControl::setTriggerSource(bool special, unsigned id) {
 }
 
 Dso::ErrorCode HantekDsoControl::setTriggerLevel(ChannelID channel, double level) {
+    for (HantekDsoControl *follower : followers) follower->setTriggerLevel(channel, level);
     if (!device->isConnected()) return Dso::ErrorCode::CONNECTION;
 
     if (channel >= specification->channels) return Dso::ErrorCode::PARAMETER;
@@ -935,6 +991,7 @@ Dso::ErrorCode HantekDsoControl::setTriggerLevel(ChannelID channel, double level
 }
 
 Dso::ErrorCode HantekDsoControl::setTriggerSlope(Dso::Slope slope) {
+    for (HantekDsoControl *follower : followers) follower->setTriggerSlope(slope);
     if (!device->isConnected()) return Dso::ErrorCode::CONNECTION;
 
     switch (specification->cmdSetTrigger) {
@@ -961,9 +1018,13 @@ Dso::ErrorCode HantekDsoControl::setTriggerSlope(Dso::Slope slope) {
     return Dso::ErrorCode::NONE;
 }
 
-void HantekDsoControl::forceTrigger() { modifyCommand<BulkCommand>(BulkCode::FORCETRIGGER); }
+void HantekDsoControl::forceTrigger() {
+    for (HantekDsoControl *follower : followers) follower->forceTrigger();
+    modifyCommand<BulkCommand>(BulkCode::FORCETRIGGER);
+}
 
 Dso::ErrorCode HantekDsoControl::setPretriggerPosition(double position) {
+    for (HantekDsoControl *follower : followers) follower->setPretriggerPosition(position);
     if (!device->isConnected()) return Dso::ErrorCode::CONNECTION;
 
     // All trigger positions are measured in samples
@@ -1061,11 +1122,20 @@ const ControlCommand *HantekDsoControl::getCommand(ControlCode code) const { ret
 
 void HantekDsoControl::run() {
     int errorCode = 0;
+    Metrics::ScopedTimer cycleTimer(metricCycle);
 
-    // Send all pending bulk commands
+    const uint64_t transfers = device->getTransferCount();
+    metricCycleTransfers->add(transfers - cycleTransferStart);
+    cycleTransferStart = transfers;
+
+    // Send all pending bulk commands. A setting that was changed back and forth or set to its current value
+    // doesn't change the bytes, those commands are dropped without a round trip.
     BulkCommand *command = firstBulkCommand;
     while (command) {
-        if (command->pending) {
+        if (command->pending && !command->repeat && *command == command->sent) {
+            command->pending = false;
+            metricCommandsSkipped->add();
+        } else if (command->pending) {
             timestampDebug(QString("Sending bulk command:%1").arg(hexDump(command->data(), command->size())));
 
             errorCode = bulkCommand(command);
@@ -1073,8 +1143,11 @@ void HantekDsoControl::run() {
                 qWarning() << "Sending bulk command failed: " << libUsbErrorString(errorCode);
                 emit communicationError();
                 return;
-            } else
+            } else {
                 command->pending = false;
+                command->sent = *command;
+                metricCommandsSent->add();
+            }
         }
         command = command->next;
     }
@@ -1082,7 +1155,10 @@ void HantekDsoControl::run() {
     // Send all pending control commands
     ControlCommand *controlCommand = firstControlCommand;
     while (controlCommand) {
-        if (controlCommand->pending) {
+        if (controlCommand->pending && !controlCommand->repeat && *controlCommand == controlCommand->sent) {
+            controlCommand->pending = false;
+            metricCommandsSkipped->add();
+        } else if (controlCommand->pending) {
             timestampDebug(QString("Sending control command %1:%2")
                                .arg(QString::number(controlCommand->code, 16),
                                     hexDump(controlCommand->data(), controlCommand->size())));
@@ -1096,14 +1172,25 @@ void HantekDsoControl::run() {
                     emit communicationError();
                     return;
                 }
-            } else
+            } else {
                 controlCommand->pending = false;
+                controlCommand->sent = *controlCommand;
+                metricCommandsSent->add();
+            }
         }
         controlCommand = controlCommand->next;
     }
 
+    // The continuous read is only used in roll mode while sampling
+    const bool streaming = specification->supportsStreaming && isRollMode() && this->sampling;
+    if (!streaming) device->stopStream();
+
     // State machine for the device communication
-    if (isRollMode()) {
+    if (streaming) {
+        // Roll mode, the data is read continuously
+        this->captureState = CAPTURE_WAITING;
+        if (!runStreaming()) return;
+    } else if (isRollMode()) {
         // Roll mode
         this->captureState = CAPTURE_WAITING;
         bool toNextState = true;
@@ -1163,9 +1250,11 @@ void HantekDsoControl::run() {
             break;
 
         case RollState::GETDATA: {
+            Metrics::ScopedTimer fetchTimer(metricFetch);
             std::vector<unsigned char> rawData = this->getSamples(expectedSampleCount);
             if (this->_samplingStarted) {
                 convertRawDataToSamples(rawData);
+                countCapture();
                 emit samplesAvailable(&result);
             }
         }
@@ -1204,9 +1293,13 @@ void HantekDsoControl::run() {
         case CAPTURE_READY:
         case CAPTURE_READY2250:
         case CAPTURE_READY5200: {
+            if (this->_samplingStarted && triggerWaitTimer.isValid())
+                metricTriggerWait->record(triggerWaitTimer.nsecsElapsed());
+            Metrics::ScopedTimer fetchTimer(metricFetch);
             std::vector<unsigned char> rawData = this->getSamples(expectedSampleCount);
             if (this->_samplingStarted) {
                 convertRawDataToSamples(rawData);
+                countCapture();
                 emit samplesAvailable(&result);
             }
         }
@@ -1282,6 +1375,7 @@ void HantekDsoControl::run() {
             timestampDebug("Starting to capture");
 
             this->_samplingStarted = true;
+            this->triggerWaitTimer.start();
             this->cycleCounter = 0;
             this->startCycle = int(controlsettings.trigger.position * 1000.0 / cycleTime + 1.0);
             this->lastTriggerMode = controlsettings.trigger.mode;
@@ -1302,7 +1396,9 @@ void HantekDsoControl::run() {
 #endif
 }
 
-int HantekDsoControl::getConnectionSpeed() const {
+int HantekDsoControl::getConnectionSpeed() const { return connectionSpeed; }
+
+int HantekDsoControl::queryConnectionSpeed() const {
     int errorCode;
     ControlGetSpeed response;
     errorCode = device->controlRead(&response);
@@ -1311,6 +1407,110 @@ int HantekDsoControl::getConnectionSpeed() const {
     return response.getSpeed();
 }
 
+void HantekDsoControl::countCapture() {
+    metricCaptures->add();
+
+    const uint64_t transfers = device->getTransferCount();
+    const uint64_t controlReads = device->getControlReadCount();
+    frameTransfers = (unsigned)(transfers - frameTransferStart);
+    metricFrameTransfers->add(transfers - frameTransferStart);
+#ifdef DEBUG
+    // Everything the acquisition needs to read by control transfers is cached at connect
+    if (controlReads != frameControlReadStart)
+        qWarning() << "Unexpected control reads for one sample set:" << controlReads - frameControlReadStart;
+#endif
+    frameTransferStart = transfers;
+    frameControlReadStart = controlReads;
+}
+
+int HantekDsoControl::startStreaming() {
+    device->stopStream();
+
+    streamRaw.reset(STREAM_RAW_SIZE);
+    streamReadPosition = 0;
+    streamSamplerate = controlsettings.samplerate.current;
+    streamStallTimer.start();
+
+    // The device samples continuously after this command, as long as the data is read
+    int errorCode = device->controlWrite(getCommand(ControlCode::CONTROL_ACQUIIRE_HARD_DATA));
+    if (errorCode < 0) return errorCode;
+
+    timestampDebug("Starting to stream");
+    return device->startStream(
+        (unsigned)specification->fixedUSBinLength, STREAM_TRANSFERS,
+        [this](const unsigned char *data, int length) { streamRaw.write(data, (size_t)length); });
+}
+
+bool HantekDsoControl::runStreaming() {
+    // (Re)start the stream after a samplerate change or if a transfer failed
+    if (!device->isStreaming() || streamSamplerate != controlsettings.samplerate.current) {
+        if (device->streamError() == LIBUSB_ERROR_NO_DEVICE) {
+            emit communicationError();
+            return false;
+        }
+        int errorCode = startStreaming();
+        if (errorCode < 0) {
+            qWarning() << "Starting the stream failed: " << libUsbErrorString(errorCode);
+            if (errorCode == LIBUSB_ERROR_NO_DEVICE) {
+                emit communicationError();
+                return false;
+            }
+            return true;
+        }
+    }
+
+    const unsigned long long written = streamRaw.written();
+    if (written == streamReadPosition) {
+        // The device stopped sending, acquire again
+        if (streamStallTimer.elapsed() > STREAM_STALL_TIMEOUT) {
+            timestampDebug("Stream stalled");
+            device->controlWrite(getCommand(ControlCode::CONTROL_ACQUIIRE_HARD_DATA));
+            streamStallTimer.start();
+        }
+        return true;
+    }
+    streamStallTimer.start();
+
+    // Skip the data that has been overwritten, keep the channel interleave
+    const unsigned long long oldest = streamRaw.oldest();
+    bool gap = false;
+    if (streamReadPosition < oldest) {
+        const unsigned channels = specification->channels;
+        const unsigned long long lost = (oldest - streamReadPosition + channels - 1) / channels * channels;
+        metricOverruns->add(lost);
+        streamReadPosition += lost;
+        gap = true;
+    }
+
+    // Whole samples of all channels only
+    const size_t available = (size_t)(written - streamReadPosition);
+    streamChunk.resize(available - available % specification->channels);
+    if (streamChunk.empty()) return true;
+    const size_t read = streamRaw.read(streamReadPosition, streamChunk.data(), streamChunk.size());
+    if (read != streamChunk.size()) {
+        // Overwritten while copying, skip it with the next call
+        metricOverruns->add(streamChunk.size());
+        streamReadPosition += streamChunk.size();
+        return true;
+    }
+    streamReadPosition += read;
+
+    {
+        Metrics::ScopedTimer fetchTimer(metricFetch);
+        convertRawDataToSamples(streamChunk);
+
+        QWriteLocker locker(&result.lock);
+        // Don't connect the new samples to the old ones if data was lost, the rolling history starts again
+        if (gap) result.append = false;
+    }
+    countCapture();
+    emit samplesAvailable(&result);
+
+    // Check if we're in single trigger mode
+    if (controlsettings.trigger.mode == Dso::TriggerMode::SINGLE) this->enableSampling(false);
+    return true;
+}
+
 int HantekDsoControl::getPacketSize() const {
     const int s = getConnectionSpeed();
     if (s == CONNECTION_FULLSPEED)
@@ -3,6 +3,7 @@
 #pragma once
 
 #define NOMINMAX // disable windows.h min/max global methods
+#include <atomic>
 #include <limits>
 
 #include "controlsettings.h"
@@ -11,19 +12,26 @@
 #include "errorcodes.h"
 #include "states.h"
 #include "utils/printutils.h"
+#include "utils/ringbuffer.h"
 
 #include "hantekprotocol/bulkStructs.h"
 #include "hantekprotocol/controlStructs.h"
 #include "hantekprotocol/definitions.h"
 
+#include <memory>
 #include <vector>
 
+#include <QElapsedTimer>
 #include <QMutex>
 #include <QStringList>
 #include <QThread>
 #include <QTimer>
 
 class USBDevice;
+namespace Metrics {
+class Counter;
+class Histogram;
+}
 
 /// \brief The DsoControl abstraction layer for %Hantek USB DSOs.
 /// TODO Please anyone, refactor this class into smaller pieces (Separation of Concerns!).
@@ -72,11 +80,21 @@ class HantekDsoControl : public QObject {
 
     bool isSampling() const;
 
+    /// \brief Gets the USB round trips between the last two sample sets. Compare it with the `control.frameTransfers`
+    /// and `control.captures` metrics to see the average.
+    /// \return The number of synchronous USB transfers.
+    unsigned getFrameTransfers() const;
+
+    /// \brief Mirror all settings to another device of the same model, for synchronized acquisition with
+    /// several devices. The setters and enableSampling()/forceTrigger() are forwarded with the same arguments.
+    /// \param follower The other device control. This object does not take ownership.
+    void addFollower(HantekDsoControl *follower);
+
     /// Return the associated usb device.
     const USBDevice *getDevice() const;
 
-    /// \brief Gets the speed of the connection.
-    /// \return The ::ConnectionSpeed of the USB connection.
+    /// \brief Gets the speed of the connection, it is queried once when the device is connected.
+    /// \return The ::ConnectionSpeed of the USB connection, negative libusb error code if the query failed.
     int getConnectionSpeed() const;
 
     /// \brief Gets the maximum size of one packet transmitted via bulk transfer.
@@ -118,7 +136,14 @@ class HantekDsoControl : public QObject {
     bool isFastRate() const;
     unsigned getRecordLength() const;
 
+    /// \brief Query everything that doesn't change while the device is connected: The connection speed and the
+    /// channel level data. Called once by the constructor, the acquisition only uses the cached values.
+    Dso::ErrorCode retrieveCapabilities();
     Dso::ErrorCode retrieveChannelLevelData();
+    /// \return The ::ConnectionSpeed read from the device, negative libusb error code on error.
+    int queryConnectionSpeed() const;
+    /// \brief Count an emitted sample set and the USB transfers it needed.
+    void countCapture();
 
     /// \brief Calculated the nearest samplerate supported by the oscilloscope.
     /// \param samplerate The target samplerate, that should be met as good as
@@ -154,6 +179,15 @@ class HantekDsoControl : public QObject {
     /// \brief Converts raw oscilloscope data to sample data
     void convertRawDataToSamples(const std::vector<unsigned char> &rawData);
 
+    /// \brief Roll mode for devices that support streaming: Keep the device sampling and the bulk reads queued,
+    /// convert the data received since the last call and append it to the stream history.
+    /// \return false on a fatal communication error.
+    bool runStreaming();
+
+    /// \brief Start the acquisition and the continuous read, clear the stream buffers.
+    /// \return LIBUSB_SUCCESS or a libusb error code.
+    int startStreaming();
+
     /// \brief Sets the size of the sample buffer without updating dependencies.
     /// \param index The record length index that should be set.
     /// \return The record length that has been set, 0 on error.
@@ -180,8 +214,10 @@ class HantekDsoControl : public QObject {
     ControlCommand *firstControlCommand = nullptr;
 
     // Communication with device
-    USBDevice *device;     ///< The USB device for the oscilloscope
-    bool sampling = false; ///< true, if the oscilloscope is taking samples
+    USBDevice *device;                          ///< The USB device for the oscilloscope
+    bool sampling = false;                      ///< true, if the oscilloscope is taking samples
+    int connectionSpeed = 0;                    ///< Cached ::ConnectionSpeed or libusb error code
+    std::vector<HantekDsoControl *> followers;  ///< Devices that get the same settings, see addFollower()
 
     // Device setup
     const Dso::ControlSpecification *specification; ///< The specifications of the device
@@ -201,6 +237,29 @@ class HantekDsoControl : public QObject {
     int startCycle = 0;
     int cycleTime = 0;
 
+    // Streaming mode
+    RingBuffer<unsigned char> streamRaw;       ///< Raw data, written by the usb event thread
+    unsigned long long streamReadPosition = 0; ///< Position of the next unconverted raw byte
+    std::vector<unsigned char> streamChunk;    ///< Raw data converted in this cycle
+    double streamSamplerate = 0.0;             ///< Samplerate the stream was started with
+    QElapsedTimer streamStallTimer;            ///< Time since data was received the last time
+
+    // Statistics
+    QElapsedTimer triggerWaitTimer;          ///< Started when a capture is started
+    Metrics::Histogram *metricCycle;         ///< Duration of one run() iteration
+    Metrics::Histogram *metricTriggerWait;   ///< Time from starting a capture until the data is ready
+    Metrics::Histogram *metricFetch;         ///< Time to fetch and convert one sample set
+    Metrics::Counter *metricCaptures;        ///< Number of sample sets emitted
+    Metrics::Counter *metricOverruns;        ///< Streaming mode: Raw bytes overwritten before they were converted
+    Metrics::Counter *metricCommandsSent;    ///< Pending commands that were sent
+    Metrics::Counter *metricCommandsSkipped; ///< Pending commands that weren't sent, their bytes didn't change
+    Metrics::Counter *metricCycleTransfers;  ///< USB transfers of the run() cycles, including the commands
+    uint64_t cycleTransferStart = 0;         ///< USB transfers of the device at the start of this cycle
+    Metrics::Counter *metricFrameTransfers;  ///< USB transfers for the emitted sample sets
+    uint64_t frameTransferStart = 0;         ///< USB transfers of the device after the last sample set
+    uint64_t frameControlReadStart = 0;      ///< Control reads of the device after the last sample set
+    std::atomic<unsigned> frameTransfers{0}; ///< USB transfers between the last two sample sets
+
     /// \brief Send a bulk command to the oscilloscope.
     /// \param command The command, that should be sent.
     /// \param attempts The number of attempts, that are done on timeouts.
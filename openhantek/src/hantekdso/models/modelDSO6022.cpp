@@ -16,6 +16,8 @@ static void initSpecifications(Dso::ControlSpecification& specification) {
     specification.supportsCaptureState = false;
     specification.supportsOffset = false;
     specification.supportsCouplingRelays = false;
+    // The device keeps sampling after CONTROL_ACQUIIRE_HARD_DATA as long as the IN endpoint is read
+    specification.supportsStreaming = true;
 
     specification.samplerate.single.base = 1e6;
     specification.samplerate.single.max = 48e6;
@@ -0,0 +1,127 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QMutexLocker>
+
+#include <climits>
+#include <cstdlib>
+
+#include "samplemerger.h"
+#include "utils/metrics.h"
+
+/// Sample sets received further apart in ns are counted as stale
+static const long long MERGE_TOLERANCE = 20000000;
+/// Upper limit of the sample sets waiting per device
+static const size_t MERGE_PENDING = 16;
+
+SampleMerger::SampleMerger(unsigned devices, unsigned channelsPerDevice, ChannelID firstSecondaryChannel)
+    : channelsPerDevice(channelsPerDevice), firstSecondaryChannel(firstSecondaryChannel), devices(devices) {
+    Metrics::Registry *metrics = Metrics::Registry::get();
+    for (unsigned device = 0; device < devices; ++device) {
+        this->devices[device].frames = metrics->counter(QString("merge.dev%1.frames").arg(device));
+        this->devices[device].samples = metrics->counter(QString("merge.dev%1.samples").arg(device));
+    }
+    staleFrames = metrics->counter("merge.stale");
+    mismatchedFrames = metrics->counter("merge.mismatched");
+    skew = metrics->histogram("merge.skew");
+}
+
+void SampleMerger::input(unsigned device, const DSOsamples *samples) {
+    if (device >= devices.size()) return;
+
+    // Copy outside of the lock, every device has its own thread
+    Frame frame;
+    {
+        QReadLocker locker(&samples->lock);
+        frame.data = samples->data;
+        frame.samplerate = samples->samplerate;
+        frame.append = samples->append;
+        frame.timestamp = samples->timestamp;
+    }
+    size_t count = 0;
+    for (const std::vector<double> &channel : frame.data) count += channel.size();
+    devices[device].frames->add();
+    devices[device].samples->add(count);
+
+    QMutexLocker locker(&mutex);
+    Device &source = devices[device];
+    source.pending.push_back(std::move(frame));
+    if (source.pending.size() > MERGE_PENDING) {
+        source.pending.pop_front();
+        staleFrames->add();
+    }
+
+    Device &primary = devices.front();
+    while (!primary.pending.empty()) {
+        const Frame &current = primary.pending.front();
+        // Wait until the other devices delivered the sample set captured at the same time, but not longer than
+        // until the next sample set of the primary device. Roll mode blocks just continue the stream.
+        if (!current.append && primary.pending.size() < 2) {
+            for (size_t other = 1; other < devices.size(); ++other)
+                if (devices[other].pending.empty() || devices[other].pending.back().timestamp < current.timestamp)
+                    return;
+        }
+
+        {
+            QWriteLocker resultLocker(&result.lock);
+            result.data.resize(firstSecondaryChannel + (devices.size() - 1) * channelsPerDevice);
+            for (std::vector<double> &channel : result.data) channel.clear();
+            result.samplerate = current.samplerate;
+            result.append = current.append;
+            result.timestamp = current.timestamp;
+            ++result.sequence;
+            for (ChannelID channel = 0; channel < current.data.size() && channel < channelsPerDevice; ++channel)
+                result.data[channel] = current.data[channel];
+
+            for (unsigned other = 1; other < devices.size(); ++other) {
+                std::deque<Frame> &pending = devices[other].pending;
+                // Sample sets with another samplerate or mode don't share the time axis
+                for (auto frame = pending.begin(); frame != pending.end();) {
+                    if (frame->samplerate == current.samplerate && frame->append == current.append) {
+                        ++frame;
+                    } else {
+                        frame = pending.erase(frame);
+                        mismatchedFrames->add();
+                    }
+                }
+
+                if (current.append) {
+                    // All blocks up to this one, the next primary block takes the later ones
+                    while (!pending.empty() && pending.front().timestamp <= current.timestamp + MERGE_TOLERANCE) {
+                        skew->record(std::llabs(pending.front().timestamp - current.timestamp));
+                        devices[other].last = std::move(pending.front());
+                        pending.pop_front();
+                        place(other, devices[other].last);
+                    }
+                    continue;
+                }
+
+                // The closest sample set, older ones are outdated
+                auto closest = pending.end();
+                long long distance = LLONG_MAX;
+                for (auto frame = pending.begin(); frame != pending.end(); ++frame) {
+                    if (std::llabs(frame->timestamp - current.timestamp) >= distance) continue;
+                    distance = std::llabs(frame->timestamp - current.timestamp);
+                    closest = frame;
+                }
+                if (closest != pending.end()) {
+                    devices[other].last = std::move(*closest);
+                    pending.erase(pending.begin(), closest + 1);
+                    skew->record(distance);
+                }
+                if (distance > MERGE_TOLERANCE) staleFrames->add();
+                if (devices[other].last.samplerate == current.samplerate && !devices[other].last.append)
+                    place(other, devices[other].last);
+            }
+        }
+        primary.pending.pop_front();
+        emit samplesAvailable(&result);
+    }
+}
+
+void SampleMerger::place(unsigned device, const Frame &frame) {
+    const ChannelID first = firstSecondaryChannel + (device - 1) * channelsPerDevice;
+    for (ChannelID channel = 0; channel < frame.data.size() && channel < channelsPerDevice; ++channel) {
+        std::vector<double> &target = result.data[first + channel];
+        target.insert(target.end(), frame.data[channel].begin(), frame.data[channel].end());
+    }
+}
@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QMutex>
+#include <QObject>
+
+#include <deque>
+#include <vector>
+
+#include "dsosamples.h"
+#include "hantekprotocol/types.h"
+
+namespace Metrics {
+class Counter;
+class Histogram;
+}
+
+/// \brief Combines the sample sets of several devices into one sample set by their host timestamps.
+/// Device 0 is the primary device, every sample set of it is combined with the sample set of each other device
+/// that was received closest to it. In roll mode all blocks received since the previous combination are appended
+/// instead. The channels of the primary device keep their index, the channels of the other devices follow from
+/// `firstSecondaryChannel` on, so that the math channels in between keep their index too.
+///
+/// The devices aren't triggered together, the combination is only as close as the host timestamps.
+class SampleMerger : public QObject {
+    Q_OBJECT
+
+  public:
+    /// \param devices Number of devices, including the primary one.
+    /// \param channelsPerDevice Physical channels of each device.
+    /// \param firstSecondaryChannel Index of the first channel of device 1 in the combined sample set.
+    SampleMerger(unsigned devices, unsigned channelsPerDevice, ChannelID firstSecondaryChannel);
+
+    /// \brief Add the sample set of a device. A sample set of the primary device emits samplesAvailable() with
+    /// the combined sample set. Thread safe, call it directly from the acquisition threads.
+    void input(unsigned device, const DSOsamples *samples);
+
+  signals:
+    void samplesAvailable(const DSOsamples *samples); ///< A combined sample set is available
+
+  private:
+    struct Frame {
+        std::vector<std::vector<double>> data;
+        double samplerate = 0.0;
+        bool append = false;
+        long long timestamp = 0;
+    };
+    struct Device {
+        std::deque<Frame> pending; ///< Sample sets that weren't combined yet, oldest first
+        Frame last;                ///< The last combined sample set, reused if no newer one arrives in time
+        Metrics::Counter *frames;  ///< Sample sets received from this device
+        Metrics::Counter *samples; ///< Samples received from this device
+    };
+
+    /// \brief Append the channels of a sample set of another device to the result.
+    void place(unsigned device, const Frame &frame);
+
+    const unsigned channelsPerDevice;
+    const ChannelID firstSecondaryChannel;
+
+    QMutex mutex;
+    std::vector<Device> devices;
+    DSOsamples result;
+
+    Metrics::Counter *staleFrames;      ///< A sample set of another device was reused or is missing
+    Metrics::Counter *mismatchedFrames; ///< A sample set of another device was skipped, the samplerate differs
+    Metrics::Histogram *skew;           ///< Time between the combined sample sets of the primary and another device
+};
@@ -201,27 +201,42 @@ void BulkSetTriggerAndSamplerate::init() { data()[0] = (uint8_t) BulkCode::SETTR
 //////////////////////////////////////////////////////////////////////////////
 // class BulkForceTrigger
 /// \brief Sets the data array to needed values.
-BulkForceTrigger::BulkForceTrigger() : BulkCommand(BulkCode::FORCETRIGGER, 2) { data()[0] = (uint8_t) BulkCode::FORCETRIGGER; }
+BulkForceTrigger::BulkForceTrigger() : BulkCommand(BulkCode::FORCETRIGGER, 2) {
+    data()[0] = (uint8_t)BulkCode::FORCETRIGGER;
+    repeat = true;
+}
 
 //////////////////////////////////////////////////////////////////////////////
 // class BulkCaptureStart
 /// \brief Sets the data array to needed values.
-BulkCaptureStart::BulkCaptureStart() : BulkCommand(BulkCode::STARTSAMPLING, 2) { data()[0] = (uint8_t) BulkCode::STARTSAMPLING; }
+BulkCaptureStart::BulkCaptureStart() : BulkCommand(BulkCode::STARTSAMPLING, 2) {
+    data()[0] = (uint8_t)BulkCode::STARTSAMPLING;
+    repeat = true;
+}
 
 //////////////////////////////////////////////////////////////////////////////
 // class BulkTriggerEnabled
 /// \brief Sets the data array to needed values.
-BulkTriggerEnabled::BulkTriggerEnabled() : BulkCommand(BulkCode::ENABLETRIGGER, 2) { data()[0] = (uint8_t) BulkCode::ENABLETRIGGER; }
+BulkTriggerEnabled::BulkTriggerEnabled() : BulkCommand(BulkCode::ENABLETRIGGER, 2) {
+    data()[0] = (uint8_t)BulkCode::ENABLETRIGGER;
+    repeat = true;
+}
 
 //////////////////////////////////////////////////////////////////////////////
 // class BulkGetData
 /// \brief Sets the data array to needed values.
-BulkGetData::BulkGetData() : BulkCommand(BulkCode::GETDATA, 2) { data()[0] = (uint8_t) BulkCode::GETDATA; }
+BulkGetData::BulkGetData() : BulkCommand(BulkCode::GETDATA, 2) {
+    data()[0] = (uint8_t)BulkCode::GETDATA;
+    repeat = true;
+}
 
 //////////////////////////////////////////////////////////////////////////////
 // class BulkGetCaptureState
 /// \brief Sets the data array to needed values.
-BulkGetCaptureState::BulkGetCaptureState() : BulkCommand(BulkCode::GETCAPTURESTATE, 2) { data()[0] = (uint8_t) BulkCode::GETCAPTURESTATE; }
+BulkGetCaptureState::BulkGetCaptureState() : BulkCommand(BulkCode::GETCAPTURESTATE, 2) {
+    data()[0] = (uint8_t)BulkCode::GETCAPTURESTATE;
+    repeat = true;
+}
 
 //////////////////////////////////////////////////////////////////////////////
 // class BulkResponseGetCaptureState
@@ -15,5 +15,7 @@ protected:
 public:
     Hantek::BulkCode code;
     bool pending = false;
+    bool repeat = false;       ///< Sent every time it is pending, e.g. a trigger, not only when its bytes changed
+    std::vector<uint8_t> sent; ///< The bytes last sent to the device, empty if never sent
     BulkCommand* next = nullptr;
 };
@@ -127,6 +127,7 @@ void ControlSetTimeDIV::setDiv(uint8_t val) { data()[0] = val; }
 
 ControlAcquireHardData::ControlAcquireHardData() : ControlCommand(ControlCode::CONTROL_ACQUIIRE_HARD_DATA, 1) {
     data()[0] = 0x01;
+    repeat = true;
 }
 
 ControlGetLimits::ControlGetLimits(size_t channels)
@@ -16,5 +16,7 @@ public:
     bool pending = false;
     uint8_t code;
     uint8_t value = 0;
+    bool repeat = false;       ///< Sent every time it is pending, not only when its bytes changed
+    std::vector<uint8_t> sent; ///< The bytes last sent to the device, empty if never sent
     ControlCommand* next = nullptr;
 };
@@ -8,6 +8,8 @@
 #include <QSurfaceFormat>
 #include <QTranslator>
 
+#include <algorithm>
+#include <climits>
 #include <iostream>
 #include <libusb-1.0/libusb.h>
 #include <memory>
@@ -19,26 +21,48 @@
 // DSO core logic
 #include "dsomodel.h"
 #include "hantekdsocontrol.h"
+#include "samplemerger.h"
+#include "usb/finddevices.h"
 #include "usb/usbdevice.h"
 
 // Post processing
+#include "post/channelfilter.h"
+#include "post/eyediagramgenerator.h"
 #include "post/graphgenerator.h"
+#include "post/histogramgenerator.h"
+#include "post/masktest.h"
 #include "post/mathchannelgenerator.h"
+#include "post/measurementgenerator.h"
 #include "post/postprocessing.h"
+#include "post/protocoldecoder.h"
+#include "post/rollinghistory.h"
+#include "post/segmentbuffer.h"
+#include "post/segmentedacquisition.h"
 #include "post/spectrumgenerator.h"
+#include "post/waveformaverager.h"
 
 // Exporter
 #include "exporting/exportcsv.h"
 #include "exporting/exporterprocessor.h"
 #include "exporting/exporterregistry.h"
+#include "exporting/exporthistogramcsv.h"
 #include "exporting/exportimage.h"
+#include "exporting/exportmaskfailurescsv.h"
 #include "exporting/exportprint.h"
+#include "exporting/exportsegmentscsv.h"
 
 // GUI
 #include "iconfont/QtAwesome.h"
 #include "mainwindow.h"
 #include "selectdevice/selectsupporteddevice.h"
 
+// Statistics
+#include "utils/metrics.h"
+
+// Remote control
+#include "remote/scpiserver.h"
+#include "remote/sharedmemorypublisher.h"
+
 // OpenGL setup
 #include "glscope.h"
 
@@ -51,7 +75,7 @@ using namespace Hantek;
 /// \brief Initialize the device with the current settings.
 void applySettingsToDevice(HantekDsoControl *dsoControl, DsoSettingsScope *scope,
                            const Dso::ControlSpecification *spec) {
-    bool mathUsed = scope->anyUsed(spec->channels);
+    bool mathUsed = scope->anyMathUsed(spec);
     for (ChannelID channel = 0; channel < spec->channels; ++channel) {
         dsoControl->setCoupling(channel, scope->coupling(channel, spec));
         dsoControl->setGain(channel, scope->gain(channel) * DIVS_VOLTAGE);
@@ -79,6 +103,40 @@ void applySettingsToDevice(HantekDsoControl *dsoControl, DsoSettingsScope *scope
     dsoControl->setTriggerSource(scope->trigger.special, scope->trigger.source);
 }
 
+/// \brief Connect further ready devices of the same model for the synchronized acquisition.
+/// \param count The number of devices that should be connected.
+std::vector<std::unique_ptr<USBDevice>> connectSecondaryDevices(libusb_context *context, const USBDevice *primary,
+                                                                unsigned count) {
+    std::vector<std::unique_ptr<USBDevice>> devices;
+    FindDevices findDevices(context);
+    if (findDevices.updateDeviceList() < 0) return devices;
+
+    std::vector<UniqueUSBid> candidates;
+    for (const auto &entry : *findDevices.getDevices()) {
+        if (entry.first == primary->getUniqueUSBDeviceID() || entry.second->getModel() != primary->getModel())
+            continue;
+        if (entry.second->needsFirmware()) {
+            qWarning() << "Skipping" << QString::fromStdString(entry.second->getModel()->name)
+                       << "without firmware, select it once to upload the firmware";
+            continue;
+        }
+        candidates.push_back(entry.first);
+    }
+    for (UniqueUSBid id : candidates) {
+        if (devices.size() >= count) break;
+        std::unique_ptr<USBDevice> device = findDevices.takeDevice(id);
+        QString errorMessage;
+        if (!device->connectDevice(errorMessage)) {
+            qWarning() << errorMessage;
+            continue;
+        }
+        devices.push_back(std::move(device));
+    }
+    if (devices.size() < count)
+        qWarning() << "Found" << devices.size() << "of" << count << "further devices of the same model";
+    return devices;
+}
+
 /// \brief Initialize resources and translations and show the main window.
 int main(int argc, char *argv[]) {
     //////// Set application information ////////
@@ -92,6 +150,11 @@ int main(int argc, char *argv[]) {
 #endif
 
     bool useGles = false;
+    QString metricsLogFile;
+    QString scpiPort;
+    QString scpiSocket;
+    QString sharedMemoryName;
+    unsigned deviceCount = 1;
     {
         QCoreApplication parserApp(argc, argv);
         QCommandLineParser p;
@@ -99,8 +162,34 @@ int main(int argc, char *argv[]) {
         p.addVersionOption();
         QCommandLineOption useGlesOption("useGLES", QCoreApplication::tr("Use OpenGL ES instead of OpenGL"));
         p.addOption(useGlesOption);
+        QCommandLineOption metricsLogOption(
+            "metricsLog",
+            QCoreApplication::tr("Append pipeline statistics to <file> every second (JSON lines for *.json)"),
+            "file");
+        p.addOption(metricsLogOption);
+        QCommandLineOption scpiPortOption(
+            "scpiPort", QCoreApplication::tr("Accept SCPI commands on the TCP <port> of localhost"), "port");
+        p.addOption(scpiPortOption);
+        QCommandLineOption scpiSocketOption(
+            "scpiSocket", QCoreApplication::tr("Accept SCPI commands on the local socket <name>"), "name");
+        p.addOption(scpiSocketOption);
+        QCommandLineOption sharedMemoryOption(
+            "sharedMemory", QCoreApplication::tr("Publish the processed samples to the shared memory ring <name>"),
+            "name");
+        p.addOption(sharedMemoryOption);
+        QCommandLineOption devicesOption(
+            "devices",
+            QCoreApplication::tr("Acquire with <count> devices of the selected model together, the selected one "
+                                 "is shown"),
+            "count");
+        p.addOption(devicesOption);
         p.process(parserApp);
         useGles = p.isSet(useGlesOption);
+        metricsLogFile = p.value(metricsLogOption);
+        scpiPort = p.value(scpiPortOption);
+        scpiSocket = p.value(scpiSocketOption);
+        sharedMemoryName = p.value(sharedMemoryOption);
+        if (p.isSet(devicesOption)) deviceCount = std::max(p.value(devicesOption).toUInt(), 1u);
     }
 
     GlScope::fixOpenGLversion(useGles ? QSurfaceFormat::OpenGLES : QSurfaceFormat::OpenGL);
@@ -144,44 +233,142 @@ int main(int argc, char *argv[]) {
     QObject::connect(device.get(), &USBDevice::deviceDisconnected, QCoreApplication::instance(),
                      &QCoreApplication::quit);
 
+    //////// Further devices for the synchronized acquisition, each one with its own thread ////////
+    // They follow the settings of the selected device, their channels are placed after the math channels
+    std::vector<std::unique_ptr<USBDevice>> secondaryDevices;
+    std::vector<std::unique_ptr<HantekDsoControl>> secondaryControls;
+    std::vector<std::unique_ptr<QThread>> secondaryThreads;
+    if (deviceCount > 1) {
+        secondaryDevices = connectSecondaryDevices(context, device.get(), deviceCount - 1);
+        if (!secondaryDevices.empty()) device->setMetricsName("dev0");
+    }
+    for (size_t index = 0; index < secondaryDevices.size(); ++index) {
+        USBDevice *secondaryDevice = secondaryDevices[index].get();
+        secondaryDevice->setMetricsName(QString("dev%1").arg(index + 1));
+        HantekDsoControl *control = new HantekDsoControl(secondaryDevice);
+        QThread *thread = new QThread();
+        thread->setObjectName(QString("dsoControlThread%1").arg(index + 1));
+        secondaryControls.emplace_back(control);
+        secondaryThreads.emplace_back(thread);
+        control->moveToThread(thread);
+        dsoControl.addFollower(control);
+        QObject::connect(thread, &QThread::started, control, &HantekDsoControl::run);
+        QObject::connect(control, &HantekDsoControl::communicationError, QCoreApplication::instance(),
+                         &QCoreApplication::quit);
+        QObject::connect(secondaryDevice, &USBDevice::deviceDisconnected, QCoreApplication::instance(),
+                         &QCoreApplication::quit);
+    }
+
     //////// Create settings object ////////
     DsoSettings settings(device->getModel()->spec());
 
+    //////// Create segment buffer for the segmented acquisition ////////
+    SegmentBuffer segmentBuffer;
+
+    //////// Create mask test, its failures can be exported ////////
+    MaskTest maskTest(&settings.scope);
+    QObject::connect(&maskTest, &MaskTest::stopRequested, &dsoControl,
+                     [&dsoControl]() { dsoControl.enableSampling(false); });
+
+    //////// Create histogram analysis, its histogram can be exported ////////
+    HistogramGenerator histogramGenerator(&settings.scope);
+
+    //////// Create eye diagram ////////
+    EyeDiagramGenerator eyeDiagramGenerator(&settings.scope);
+
     //////// Create exporters ////////
     ExporterRegistry exportRegistry(device->getModel()->spec(), &settings);
 
     ExporterCSV exporterCSV;
+    ExporterSegmentsCSV exporterSegmentsCSV(&segmentBuffer);
+    ExporterMaskFailuresCSV exporterMaskFailuresCSV(&maskTest);
+    ExporterHistogramCSV exporterHistogramCSV(&histogramGenerator);
     ExporterImage exportImage;
     ExporterPrint exportPrint;
 
     ExporterProcessor samplesToExportRaw(&exportRegistry);
 
     exportRegistry.registerExporter(&exporterCSV);
+    exportRegistry.registerExporter(&exporterSegmentsCSV);
+    exportRegistry.registerExporter(&exporterMaskFailuresCSV);
+    exportRegistry.registerExporter(&exporterHistogramCSV);
     exportRegistry.registerExporter(&exportImage);
     exportRegistry.registerExporter(&exportPrint);
 
     //////// Create post processing objects ////////
     QThread postProcessingThread;
     postProcessingThread.setObjectName("postProcessingThread");
-    PostProcessing postProcessing(settings.scope.countChannels());
+    const unsigned channelsPerDevice = device->getModel()->spec()->channels;
+    const unsigned channelCount =
+        settings.scope.countChannels() + (unsigned)secondaryDevices.size() * channelsPerDevice;
+    PostProcessing postProcessing(channelCount);
 
     SpectrumGenerator spectrumGenerator(&settings.scope, &settings.post);
+    ChannelFilter channelFilter(&settings.post, device->getModel()->spec()->channels);
     MathChannelGenerator mathchannelGenerator(&settings.scope, device->getModel()->spec()->channels);
-    GraphGenerator graphGenerator(&settings.scope, device->getModel()->spec()->isSoftwareTriggerDevice);
-
-    postProcessing.registerProcessor(&samplesToExportRaw);
-    postProcessing.registerProcessor(&mathchannelGenerator);
-    postProcessing.registerProcessor(&spectrumGenerator);
-    postProcessing.registerProcessor(&graphGenerator);
+    WaveformAverager waveformAverager(&settings.scope, &mathchannelGenerator,
+                                      device->getModel()->spec()->isSoftwareTriggerDevice);
+    RollingHistory rollingHistory(&settings.scope);
+    MeasurementGenerator measurementGenerator(&settings.scope);
+    ProtocolDecoder protocolDecoder(&settings.scope);
+    GraphGenerator graphGenerator(&settings.scope, &settings.view, device->getModel()->spec()->isSoftwareTriggerDevice,
+                                  &rollingHistory);
+    SegmentedAcquisition segmentedAcquisition(&settings.scope, &segmentBuffer);
+
+    postProcessing.registerProcessor(&samplesToExportRaw, "exportRaw");
+    postProcessing.registerProcessor(&channelFilter, "filter");
+    postProcessing.registerProcessor(&mathchannelGenerator, "math");
+    postProcessing.registerProcessor(&waveformAverager, "averaging");
+    postProcessing.registerProcessor(&rollingHistory, "rollHistory");
+    postProcessing.registerProcessor(&spectrumGenerator, "spectrum");
+    postProcessing.registerProcessor(&measurementGenerator, "measurements");
+    postProcessing.registerProcessor(&protocolDecoder, "decoder");
+    postProcessing.registerProcessor(&graphGenerator, "graph");
+    postProcessing.registerProcessor(&maskTest, "mask");
+    postProcessing.registerProcessor(&histogramGenerator, "histogram");
+    postProcessing.registerProcessor(&eyeDiagramGenerator, "eye");
+    postProcessing.registerProcessor(&segmentedAcquisition, "segments");
+
+    // Other processes read the results from the shared memory, a slot holds the longest record of every channel
+    std::unique_ptr<SharedMemoryPublisher> sharedMemoryPublisher;
+    if (!sharedMemoryName.isEmpty()) {
+        size_t capacity = 1 << 20;
+        const Dso::ControlSpecification *spec = device->getModel()->spec();
+        for (unsigned length : spec->samplerate.single.recordLengths)
+            if (length != UINT_MAX) capacity = std::max(capacity, (size_t)length);
+        for (unsigned length : spec->samplerate.multi.recordLengths)
+            if (length != UINT_MAX) capacity = std::max(capacity, (size_t)length);
+        sharedMemoryPublisher.reset(
+            new SharedMemoryPublisher(&settings.scope, sharedMemoryName, capacity, channelCount));
+        postProcessing.registerProcessor(sharedMemoryPublisher.get(), "sharedMemory");
+    }
 
     postProcessing.moveToThread(&postProcessingThread);
-    QObject::connect(&dsoControl, &HantekDsoControl::samplesAvailable, &postProcessing, &PostProcessing::input);
+    std::unique_ptr<SampleMerger> sampleMerger;
+    if (secondaryDevices.empty()) {
+        QObject::connect(&dsoControl, &HantekDsoControl::samplesAvailable, &postProcessing, &PostProcessing::input);
+    } else {
+        // Combined in the acquisition threads, the post processing gets one sample set for all devices
+        sampleMerger.reset(new SampleMerger((unsigned)secondaryDevices.size() + 1, channelsPerDevice,
+                                            settings.scope.countChannels()));
+        SampleMerger *merger = sampleMerger.get();
+        QObject::connect(
+            &dsoControl, &HantekDsoControl::samplesAvailable, merger,
+            [merger](const DSOsamples *samples) { merger->input(0, samples); }, Qt::DirectConnection);
+        for (size_t index = 0; index < secondaryControls.size(); ++index)
+            QObject::connect(
+                secondaryControls[index].get(), &HantekDsoControl::samplesAvailable, merger,
+                [merger, index](const DSOsamples *samples) { merger->input((unsigned)index + 1, samples); },
+                Qt::DirectConnection);
+        QObject::connect(merger, &SampleMerger::samplesAvailable, &postProcessing, &PostProcessing::input);
+    }
     QObject::connect(&postProcessing, &PostProcessing::processingFinished, &exportRegistry, &ExporterRegistry::input,
                      Qt::DirectConnection);
 
     //////// Create main window ////////
     iconFont->initFontAwesome();
-    MainWindow openHantekMainWindow(&dsoControl, &settings, &exportRegistry);
+    MainWindow openHantekMainWindow(&dsoControl, &settings, &exportRegistry, &segmentBuffer, &maskTest,
+                                    &histogramGenerator, &eyeDiagramGenerator, &mathchannelGenerator);
     QObject::connect(&postProcessing, &PostProcessing::processingFinished, &openHantekMainWindow,
                      &MainWindow::showNewData);
     QObject::connect(&exportRegistry, &ExporterRegistry::exporterProgressChanged, &openHantekMainWindow,
@@ -192,19 +379,40 @@ int main(int argc, char *argv[]) {
 
     applySettingsToDevice(&dsoControl, &settings.scope, device->getModel()->spec());
 
+    std::unique_ptr<Metrics::Logger> metricsLogger;
+    if (!metricsLogFile.isEmpty()) metricsLogger.reset(new Metrics::Logger(metricsLogFile));
+
+    //////// Create the remote control server if requested ////////
+    std::unique_ptr<ScpiServer> scpiServer;
+    if (!scpiPort.isEmpty() || !scpiSocket.isEmpty()) {
+        scpiServer.reset(new ScpiServer(&dsoControl, &settings.scope, device->getModel()->spec(),
+                                        QString::fromStdString(device->getModel()->name)));
+        if (!scpiPort.isEmpty()) scpiServer->listenTcp((quint16)scpiPort.toUInt());
+        if (!scpiSocket.isEmpty()) scpiServer->listenLocal(scpiSocket);
+        QObject::connect(&postProcessing, &PostProcessing::processingFinished, scpiServer.get(),
+                         &ScpiServer::input);
+    }
+
     //////// Start DSO thread and go into GUI main loop
     dsoControl.enableSampling(true);
     postProcessingThread.start();
     dsoControlThread.start();
+    for (std::unique_ptr<QThread> &thread : secondaryThreads) thread->start();
     int res = openHantekApplication.exec();
 
     //////// Clean up ////////
     dsoControlThread.quit();
     dsoControlThread.wait(10000);
+    for (std::unique_ptr<QThread> &thread : secondaryThreads) {
+        thread->quit();
+        thread->wait(10000);
+    }
 
     postProcessingThread.quit();
     postProcessingThread.wait(10000);
 
+    secondaryControls.clear();
+    secondaryDevices.clear();
     if (context && device != nullptr) { libusb_exit(context); }
 
     return res;
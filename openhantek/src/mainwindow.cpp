@@ -2,7 +2,13 @@
 #include "iconfont/QtAwesome.h"
 #include "ui_mainwindow.h"
 
+#include "DecoderDock.h"
+#include "EyeDock.h"
+#include "HistogramDock.h"
 #include "HorizontalDock.h"
+#include "MaskDock.h"
+#include "MetricsDock.h"
+#include "SegmentDock.h"
 #include "SpectrumDock.h"
 #include "TriggerDock.h"
 #include "VoltageDock.h"
@@ -15,6 +21,7 @@
 #include "exporting/exporterinterface.h"
 #include "exporting/exporterregistry.h"
 #include "hantekdsocontrol.h"
+#include "post/mathchannelgenerator.h"
 #include "usb/usbdevice.h"
 #include "viewconstants.h"
 
@@ -25,6 +32,8 @@
 #include <QMessageBox>
 
 MainWindow::MainWindow(HantekDsoControl *dsoControl, DsoSettings *settings, ExporterRegistry *exporterRegistry,
+                       SegmentBuffer *segmentBuffer, MaskTest *maskTest, HistogramGenerator *histogramGenerator,
+                       EyeDiagramGenerator *eyeDiagramGenerator, MathChannelGenerator *mathChannelGenerator,
                        QWidget *parent)
     : QMainWindow(parent), ui(new Ui::MainWindow), mSettings(settings), exporterRegistry(exporterRegistry) {
     ui->setupUi(this);
@@ -82,6 +91,42 @@ MainWindow::MainWindow(HantekDsoControl *dsoControl, DsoSettings *settings, Expo
     addDockWidget(Qt::RightDockWidgetArea, voltageDock);
     addDockWidget(Qt::RightDockWidgetArea, spectrumDock);
 
+    // The segmented acquisition is hidden by default and can be enabled in the view menu
+    SegmentDock *segmentDock = new SegmentDock(scope, segmentBuffer, this);
+    addDockWidget(Qt::RightDockWidgetArea, segmentDock);
+    segmentDock->hide();
+    ui->menuView->addAction(segmentDock->toggleViewAction());
+
+    // The protocol decoder is hidden by default and can be enabled in the view menu
+    DecoderDock *decoderDock = new DecoderDock(scope, this);
+    addDockWidget(Qt::RightDockWidgetArea, decoderDock);
+    decoderDock->hide();
+    ui->menuView->addAction(decoderDock->toggleViewAction());
+
+    // The mask test is hidden by default and can be enabled in the view menu
+    MaskDock *maskDock = new MaskDock(scope, maskTest, this);
+    addDockWidget(Qt::RightDockWidgetArea, maskDock);
+    maskDock->hide();
+    ui->menuView->addAction(maskDock->toggleViewAction());
+
+    // The histogram analysis is hidden by default and can be enabled in the view menu
+    HistogramDock *histogramDock = new HistogramDock(scope, histogramGenerator, this);
+    addDockWidget(Qt::RightDockWidgetArea, histogramDock);
+    histogramDock->hide();
+    ui->menuView->addAction(histogramDock->toggleViewAction());
+
+    // The eye diagram is hidden by default and can be enabled in the view menu
+    EyeDock *eyeDock = new EyeDock(scope, eyeDiagramGenerator, this);
+    addDockWidget(Qt::RightDockWidgetArea, eyeDock);
+    eyeDock->hide();
+    ui->menuView->addAction(eyeDock->toggleViewAction());
+
+    // The pipeline statistics are hidden by default and can be enabled in the view menu
+    MetricsDock *metricsDock = new MetricsDock(this);
+    addDockWidget(Qt::RightDockWidgetArea, metricsDock);
+    metricsDock->hide();
+    ui->menuView->addAction(metricsDock->toggleViewAction());
+
     restoreGeometry(mSettings->mainWindowGeometry);
     restoreState(mSettings->mainWindowState);
 
@@ -160,12 +205,12 @@ MainWindow::MainWindow(HantekDsoControl *dsoControl, DsoSettings *settings, Expo
     auto usedChanged = [this, dsoControl, spec](ChannelID channel, bool used) {
         if (channel >= (unsigned int)mSettings->scope.voltage.size()) return;
 
-        bool mathUsed = mSettings->scope.anyUsed(spec->channels);
+        bool mathUsed = mSettings->scope.anyMathUsed(spec);
 
         // Normal channel, check if voltage/spectrum or math channel is used
         if (channel < spec->channels) dsoControl->setChannelUsed(channel, mathUsed | mSettings->scope.anyUsed(channel));
         // Math channel, update all channels
-        else if (channel == spec->channels) {
+        else {
             for (ChannelID c = 0; c < spec->channels; ++c)
                 dsoControl->setChannelUsed(c, mathUsed | mSettings->scope.anyUsed(c));
         }
@@ -175,7 +220,10 @@ MainWindow::MainWindow(HantekDsoControl *dsoControl, DsoSettings *settings, Expo
 
     connect(voltageDock, &VoltageDock::couplingChanged, dsoControl, &HantekDsoControl::setCoupling);
     connect(voltageDock, &VoltageDock::couplingChanged, dsoWidget, &DsoWidget::updateVoltageCoupling);
-    connect(voltageDock, &VoltageDock::modeChanged, dsoWidget, &DsoWidget::updateMathMode);
+    connect(voltageDock, &VoltageDock::expressionChanged, dsoWidget, &DsoWidget::updateMathExpression);
+    connect(voltageDock, &VoltageDock::expressionChanged, [this, mathChannelGenerator](ChannelID channel) {
+        mathChannelGenerator->setExpression(channel, mSettings->scope.voltage[channel].mathExpression);
+    });
     connect(voltageDock, &VoltageDock::gainChanged, [this, dsoControl, spec](ChannelID channel, double gain) {
         if (channel >= spec->channels) return;
 
@@ -212,10 +260,14 @@ MainWindow::MainWindow(HantekDsoControl *dsoControl, DsoSettings *settings, Expo
             &HorizontalDock::setSamplerateLimits);
     connect(dsoControl, &HantekDsoControl::samplerateSet, horizontalDock, &HorizontalDock::setSamplerateSteps);
 
-    connect(ui->actionOpen, &QAction::triggered, [this]() {
+    connect(ui->actionOpen, &QAction::triggered, [this, mathChannelGenerator]() {
         QString fileName = QFileDialog::getOpenFileName(this, tr("Open file"), "", tr("Settings (*.ini)"));
         if (!fileName.isEmpty()) {
-            if (mSettings->setFilename(fileName)) { mSettings->load(); }
+            if (mSettings->setFilename(fileName)) {
+                mSettings->load();
+                for (ChannelID channel = 0; channel < mSettings->scope.voltage.size(); ++channel)
+                    mathChannelGenerator->setExpression(channel, mSettings->scope.voltage[channel].mathExpression);
+            }
         }
     });
 
@@ -267,6 +319,26 @@ MainWindow::MainWindow(HantekDsoControl *dsoControl, DsoSettings *settings, Expo
     });
     ui->actionZoom->setChecked(mSettings->view.zoom);
 
+    connect(ui->actionWaterfall, &QAction::toggled, [this](bool enabled) {
+        mSettings->view.waterfall = enabled;
+
+        if (mSettings->view.waterfall)
+            this->ui->actionWaterfall->setStatusTip(tr("Show the spectrum graphs"));
+        else
+            this->ui->actionWaterfall->setStatusTip(tr("Show the spectrum history as waterfall"));
+    });
+    ui->actionWaterfall->setChecked(mSettings->view.waterfall);
+
+    connect(ui->actionXyDensity, &QAction::toggled, [this](bool enabled) {
+        mSettings->view.xyDensity = enabled;
+
+        if (mSettings->view.xyDensity)
+            this->ui->actionXyDensity->setStatusTip(tr("Draw the XY graphs as lines"));
+        else
+            this->ui->actionXyDensity->setStatusTip(tr("Draw the XY graphs as intensity map"));
+    });
+    ui->actionXyDensity->setChecked(mSettings->view.xyDensity);
+
     connect(ui->actionAbout, &QAction::triggered, [this]() {
         QMessageBox::about(
             this, tr("About OpenHantek %1").arg(VERSION),
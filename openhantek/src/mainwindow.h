@@ -12,6 +12,11 @@ class HorizontalDock;
 class TriggerDock;
 class SpectrumDock;
 class VoltageDock;
+class SegmentBuffer;
+class MaskTest;
+class HistogramGenerator;
+class EyeDiagramGenerator;
+class MathChannelGenerator;
 
 namespace Ui {
 class MainWindow;
@@ -25,6 +30,8 @@ class MainWindow : public QMainWindow {
 
   public:
     explicit MainWindow(HantekDsoControl *dsoControl, DsoSettings *mSettings, ExporterRegistry *exporterRegistry,
+                        SegmentBuffer *segmentBuffer, MaskTest *maskTest, HistogramGenerator *histogramGenerator,
+                        EyeDiagramGenerator *eyeDiagramGenerator, MathChannelGenerator *mathChannelGenerator,
                         QWidget *parent = 0);
     ~MainWindow();
   public slots:
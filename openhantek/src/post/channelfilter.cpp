@@ -0,0 +1,329 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#define _USE_MATH_DEFINES
+#include <algorithm>
+#include <cmath>
+
+#include <fftw3.h>
+
+#include "channelfilter.h"
+
+#include "post/ppresult.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FILTER_SSE2
+#endif
+
+/// Longer FIR kernels are convolved by overlap-save FFT instead of directly
+static const size_t FFT_TAPS = 64;
+/// Shortest overlap-save transform
+static const size_t MIN_FFT_LENGTH = 1024;
+/// Plans up to this length are measured, longer ones estimated because measuring takes too long
+static const size_t MEASURE_LIMIT = 1 << 14;
+/// Highest number of IIR sections, order 16
+static const unsigned MAX_SECTIONS = 8;
+/// Highest corner frequency relative to the samplerate
+static const double MAX_FREQUENCY = 0.49;
+
+ChannelFilter::ChannelFilter(const DsoSettingsPostProcessing *postprocessing, unsigned physicalChannels)
+    : postprocessing(postprocessing), physicalChannels(physicalChannels) {}
+
+ChannelFilter::~ChannelFilter() { releaseConvolution(); }
+
+void ChannelFilter::releaseConvolution() {
+    if (forward) fftw_destroy_plan(forward);
+    if (backward) fftw_destroy_plan(backward);
+    forward = backward = nullptr;
+    if (fftTime) fftw_free(fftTime);
+    if (fftSpectrum) fftw_free(fftSpectrum);
+    fftTime = fftSpectrum = nullptr;
+    fftLength = 0;
+}
+
+/// \brief Windowed sinc low pass with the given corner frequency relative to the samplerate.
+static void lowpassKernel(std::vector<double> &kernel, double frequency) {
+    const size_t taps = kernel.size();
+    const double center = (taps - 1) / 2.0;
+    double sum = 0.0;
+    for (size_t position = 0; position < taps; ++position) {
+        const double x = position - center;
+        const double sinc = x == 0.0 ? 2.0 * frequency : std::sin(2.0 * M_PI * frequency * x) / (M_PI * x);
+        // Blackman window
+        const double window = 0.42 - 0.5 * std::cos(2.0 * M_PI * position / (taps - 1)) +
+                              0.08 * std::cos(4.0 * M_PI * position / (taps - 1));
+        kernel[position] = sinc * window;
+        sum += kernel[position];
+    }
+    for (double &value : kernel) value /= sum;
+}
+
+void ChannelFilter::design(double samplerate) {
+    const Dso::FilterType type = postprocessing->filterType;
+    const double nyquist = MAX_FREQUENCY * samplerate;
+    const double frequency = std::max(std::min(postprocessing->filterFrequency, nyquist), 1e-6 * samplerate);
+    const double bandwidth = std::max(postprocessing->filterBandwidth, 1e-6 * samplerate);
+    designType = postprocessing->filterDesign;
+    sections.clear();
+    kernel.clear();
+    releaseConvolution();
+
+    if (designType == Dso::FilterDesign::IIR) {
+        const unsigned count = std::max(std::min(postprocessing->filterOrder / 2, MAX_SECTIONS), 1u);
+        const double w0 = 2.0 * M_PI * frequency / samplerate;
+        const double cosW0 = std::cos(w0);
+        const double sinW0 = std::sin(w0);
+        for (unsigned section = 0; section < count; ++section) {
+            // Butterworth pole pairs for low/high pass, the band filters use the band Q in every section
+            const double q = (type == Dso::FilterType::LOWPASS || type == Dso::FilterType::HIGHPASS)
+                                 ? 1.0 / (2.0 * std::cos(M_PI * (2 * section + 1) / (4.0 * count)))
+                                 : frequency / bandwidth;
+            const double alpha = sinW0 / (2.0 * q);
+            double b0, b1, b2;
+            switch (type) {
+            case Dso::FilterType::HIGHPASS:
+                b0 = b2 = (1.0 + cosW0) / 2.0;
+                b1 = -(1.0 + cosW0);
+                break;
+            case Dso::FilterType::BANDPASS:
+                b0 = alpha;
+                b1 = 0.0;
+                b2 = -alpha;
+                break;
+            case Dso::FilterType::NOTCH:
+                b0 = b2 = 1.0;
+                b1 = -2.0 * cosW0;
+                break;
+            default:
+                b0 = b2 = (1.0 - cosW0) / 2.0;
+                b1 = 1.0 - cosW0;
+                break;
+            }
+            const double a0 = 1.0 + alpha;
+            sections.push_back({b0 / a0, b1 / a0, b2 / a0, -2.0 * cosW0 / a0, (1.0 - alpha) / a0});
+        }
+        return;
+    }
+
+    // Odd length, the kernel is symmetric around its center sample
+    kernel.resize(std::max(postprocessing->filterTaps, 3u) | 1u);
+    std::vector<double> upper(kernel.size());
+    switch (type) {
+    case Dso::FilterType::LOWPASS:
+        lowpassKernel(kernel, frequency / samplerate);
+        break;
+    case Dso::FilterType::HIGHPASS:
+        lowpassKernel(kernel, frequency / samplerate);
+        for (double &value : kernel) value = -value;
+        kernel[kernel.size() / 2] += 1.0;
+        break;
+    case Dso::FilterType::BANDPASS:
+    case Dso::FilterType::NOTCH: {
+        const double low = std::max(frequency - bandwidth / 2, 1e-6 * samplerate) / samplerate;
+        const double high = std::min(frequency + bandwidth / 2, nyquist) / samplerate;
+        lowpassKernel(kernel, low);
+        lowpassKernel(upper, high);
+        for (size_t position = 0; position < kernel.size(); ++position)
+            kernel[position] = upper[position] - kernel[position];
+        if (type == Dso::FilterType::NOTCH) {
+            for (double &value : kernel) value = -value;
+            kernel[kernel.size() / 2] += 1.0;
+        }
+        break;
+    }
+    default:
+        break;
+    }
+    if (kernel.size() > FFT_TAPS) prepareConvolution();
+}
+
+void ChannelFilter::prepareConvolution() {
+    size_t length = MIN_FFT_LENGTH;
+    while (length < 4 * kernel.size()) length *= 2;
+    fftLength = length;
+    fftTime = fftw_alloc_real(length);
+    fftSpectrum = (double *)fftw_alloc_complex(length / 2 + 1);
+    // Measuring overwrites the buffers, they are filled before every transform anyway
+    const unsigned flags = length <= MEASURE_LIMIT ? FFTW_MEASURE : FFTW_ESTIMATE;
+    forward = fftw_plan_dft_r2c_1d((int)length, fftTime, (fftw_complex *)fftSpectrum, flags);
+    backward = fftw_plan_dft_c2r_1d((int)length, (fftw_complex *)fftSpectrum, fftTime, flags);
+
+    // Kernel spectrum, including the 1/N scaling of the inverse transform
+    std::fill(fftTime, fftTime + length, 0.0);
+    for (size_t position = 0; position < kernel.size(); ++position) fftTime[position] = kernel[position] / length;
+    fftw_execute(forward);
+    kernelSpectrum.assign(fftSpectrum, fftSpectrum + 2 * (length / 2 + 1));
+}
+
+void ChannelFilter::convolve(const double *extended, double *out, size_t count) {
+    const size_t taps = kernel.size();
+    if (!fftLength) {
+        std::fill(out, out + count, 0.0);
+        for (size_t tap = 0; tap < taps; ++tap) {
+            const double weight = kernel[tap];
+            const double *input = extended + tap;
+            for (size_t position = 0; position < count; ++position) out[position] += weight * input[position];
+        }
+        return;
+    }
+
+    // Overlap-save: Each transform yields fftLength - taps + 1 valid outputs
+    const size_t step = fftLength - taps + 1;
+    const size_t bins = fftLength / 2 + 1;
+    const size_t available = count + taps - 1;
+    for (size_t first = 0; first < count; first += step) {
+        const size_t length = std::min(fftLength, available - first);
+        std::copy(extended + first, extended + first + length, fftTime);
+        std::fill(fftTime + length, fftTime + fftLength, 0.0);
+        fftw_execute(forward);
+        for (size_t bin = 0; bin < bins; ++bin) {
+            const double re = fftSpectrum[2 * bin];
+            const double im = fftSpectrum[2 * bin + 1];
+            fftSpectrum[2 * bin] = re * kernelSpectrum[2 * bin] - im * kernelSpectrum[2 * bin + 1];
+            fftSpectrum[2 * bin + 1] = re * kernelSpectrum[2 * bin + 1] + im * kernelSpectrum[2 * bin];
+        }
+        fftw_execute(backward);
+        // The symmetric kernel makes the convolution equal to the correlation of out[]
+        const size_t valid = std::min(step, count - first);
+        std::copy(fftTime + taps - 1, fftTime + taps - 1 + valid, out + first);
+    }
+}
+
+void ChannelFilter::filterFir(std::vector<double> &samples, ChannelState &state, bool continued) {
+    const size_t taps = kernel.size();
+    const size_t count = samples.size();
+    extended.resize(count + taps - 1);
+    if (continued) {
+        // Causal: The history of the previous blocks precedes the samples
+        if (!state.valid) state.history.assign(taps - 1, samples.front());
+        std::copy(state.history.begin(), state.history.end(), extended.begin());
+        std::copy(samples.begin(), samples.end(), extended.begin() + (taps - 1));
+        std::copy(extended.end() - (taps - 1), extended.end(), state.history.begin());
+    } else {
+        // Centered: The record is extended by its first and last sample
+        const size_t half = (taps - 1) / 2;
+        std::fill(extended.begin(), extended.begin() + half, samples.front());
+        std::copy(samples.begin(), samples.end(), extended.begin() + half);
+        std::fill(extended.begin() + half + count, extended.end(), samples.back());
+    }
+    state.valid = true;
+    convolve(extended.data(), samples.data(), count);
+}
+
+void ChannelFilter::settle(ChannelState &state, double input) const {
+    state.z.resize(2 * sections.size());
+    for (size_t section = 0; section < sections.size(); ++section) {
+        const Biquad &s = sections[section];
+        const double output = input * (s.b0 + s.b1 + s.b2) / (1.0 + s.a1 + s.a2);
+        state.z[2 * section] = output - s.b0 * input;
+        state.z[2 * section + 1] = s.b2 * input - s.a2 * output;
+        input = output;
+    }
+    state.valid = true;
+}
+
+void ChannelFilter::filterIir(std::vector<double> &samples, ChannelState &state) const {
+    double *z = state.z.data();
+    for (double &sample : samples) {
+        double x = sample;
+        for (size_t section = 0; section < sections.size(); ++section) {
+            const Biquad &s = sections[section];
+            const double y = s.b0 * x + z[2 * section];
+            z[2 * section] = s.b1 * x - s.a1 * y + z[2 * section + 1];
+            z[2 * section + 1] = s.b2 * x - s.a2 * y;
+            x = y;
+        }
+        sample = x;
+    }
+}
+
+void ChannelFilter::filterIirPair(std::vector<double> &first, ChannelState &firstState, std::vector<double> &second,
+                                  ChannelState &secondState) const {
+#ifdef FILTER_SSE2
+    // Both channels share the coefficients, each lane holds the state of one channel
+    const size_t count = sections.size();
+    __m128d z[2 * MAX_SECTIONS];
+    for (size_t index = 0; index < 2 * count; ++index)
+        z[index] = _mm_set_pd(secondState.z[index], firstState.z[index]);
+
+    double *a = first.data();
+    double *b = second.data();
+    for (size_t position = 0; position < first.size(); ++position) {
+        __m128d x = _mm_set_pd(b[position], a[position]);
+        for (size_t section = 0; section < count; ++section) {
+            const Biquad &s = sections[section];
+            const __m128d y = _mm_add_pd(_mm_mul_pd(_mm_set1_pd(s.b0), x), z[2 * section]);
+            z[2 * section] = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(_mm_set1_pd(s.b1), x), _mm_mul_pd(_mm_set1_pd(s.a1), y)),
+                                        z[2 * section + 1]);
+            z[2 * section + 1] = _mm_sub_pd(_mm_mul_pd(_mm_set1_pd(s.b2), x), _mm_mul_pd(_mm_set1_pd(s.a2), y));
+            x = y;
+        }
+        _mm_storel_pd(a + position, x);
+        _mm_storeh_pd(b + position, x);
+    }
+
+    for (size_t index = 0; index < 2 * count; ++index) {
+        _mm_storel_pd(&firstState.z[index], z[index]);
+        _mm_storeh_pd(&secondState.z[index], z[index]);
+    }
+#else
+    filterIir(first, firstState);
+    filterIir(second, secondState);
+#endif
+}
+
+void ChannelFilter::process(PPresult *result) {
+    if (postprocessing->filterType == Dso::FilterType::OFF || result->channelCount() == 0) {
+        signature.clear();
+        return;
+    }
+
+    const double interval = result->data(0)->voltage.interval;
+    if (interval <= 0.0) return;
+
+    const std::vector<double> current = {(double)postprocessing->filterType,
+                                         (double)postprocessing->filterDesign,
+                                         postprocessing->filterFrequency,
+                                         postprocessing->filterBandwidth,
+                                         (double)postprocessing->filterOrder,
+                                         (double)postprocessing->filterTaps,
+                                         interval};
+    if (current != signature) {
+        signature = current;
+        design(1.0 / interval);
+        states.assign(physicalChannels, ChannelState());
+    }
+
+    const unsigned channels = std::min(physicalChannels, result->channelCount());
+    const bool continued = result->append;
+
+    if (designType == Dso::FilterDesign::FIR) {
+        for (ChannelID channel = 0; channel < channels; ++channel) {
+            std::vector<double> &samples = result->modifyData(channel)->voltage.sample;
+            if (!samples.empty()) filterFir(samples, states[channel], continued);
+        }
+        return;
+    }
+
+    // Every record of the normal mode starts settled, roll mode blocks continue the previous state
+    std::vector<ChannelID> pending;
+    for (ChannelID channel = 0; channel < channels; ++channel) {
+        std::vector<double> &samples = result->modifyData(channel)->voltage.sample;
+        if (samples.empty()) continue;
+        if (!continued || !states[channel].valid) settle(states[channel], samples.front());
+        pending.push_back(channel);
+    }
+    size_t index = 0;
+    for (; index + 1 < pending.size(); index += 2) {
+        std::vector<double> &first = result->modifyData(pending[index])->voltage.sample;
+        std::vector<double> &second = result->modifyData(pending[index + 1])->voltage.sample;
+        if (first.size() == second.size())
+            filterIirPair(first, states[pending[index]], second, states[pending[index + 1]]);
+        else {
+            filterIir(first, states[pending[index]]);
+            filterIir(second, states[pending[index + 1]]);
+        }
+    }
+    if (index < pending.size())
+        filterIir(result->modifyData(pending[index])->voltage.sample, states[pending[index]]);
+}
@@ -0,0 +1,68 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+#include "postprocessingsettings.h"
+#include "processor.h"
+
+struct fftw_plan_s;
+
+/// \brief Digital filter of the physical channels, runs before all other processors.
+/// IIR filters are cascades of biquad sections (Butterworth low/high pass, band pass and notch), two channels are
+/// filtered at once with SSE2. FIR filters are linear phase windowed sinc kernels, convolved directly or, for long
+/// kernels, by FFT overlap-save convolution. In roll mode the filter state carries over from one block to the next.
+/// Records of the normal mode are not continuous, they start in the steady state of their first sample and FIR
+/// filters are centered on each sample, so the trigger point does not move.
+class ChannelFilter : public Processor {
+  public:
+    ChannelFilter(const DsoSettingsPostProcessing *postprocessing, unsigned physicalChannels);
+    virtual ~ChannelFilter();
+    virtual void process(PPresult *result) override;
+
+  private:
+    /// \brief Normalized transposed direct form II section.
+    struct Biquad {
+        double b0, b1, b2, a1, a2;
+    };
+    struct ChannelState {
+        std::vector<double> z;       ///< IIR: z1 and z2 of every section
+        std::vector<double> history; ///< FIR: The last taps-1 input samples
+        bool valid = false;          ///< false until the first samples were filtered
+    };
+
+    /// \brief Compute the biquads or the kernel for the current settings.
+    void design(double samplerate);
+    /// \brief Create the overlap-save plans and the kernel spectrum.
+    void prepareConvolution();
+    void releaseConvolution();
+
+    /// \brief Start the IIR state in the steady state for a constant input.
+    void settle(ChannelState &state, double input) const;
+    void filterIir(std::vector<double> &samples, ChannelState &state) const;
+    void filterIirPair(std::vector<double> &first, ChannelState &firstState, std::vector<double> &second,
+                       ChannelState &secondState) const;
+    void filterFir(std::vector<double> &samples, ChannelState &state, bool continued);
+    /// \brief out[n] = sum(kernel[k] * extended[n + k]) for all outputs.
+    void convolve(const double *extended, double *out, size_t count);
+
+    const DsoSettingsPostProcessing *postprocessing;
+    const unsigned physicalChannels;
+
+    std::vector<double> signature; ///< The settings and samplerate of the current design
+    Dso::FilterDesign designType = Dso::FilterDesign::IIR;
+    std::vector<Biquad> sections;
+    std::vector<double> kernel;    ///< Symmetric FIR kernel
+    std::vector<ChannelState> states;
+    std::vector<double> extended;  ///< FIR: Padded input of one channel
+
+    // Overlap-save convolution
+    size_t fftLength = 0;
+    fftw_plan_s *forward = nullptr;
+    fftw_plan_s *backward = nullptr;
+    double *fftTime = nullptr;     ///< fftLength samples
+    double *fftSpectrum = nullptr; ///< fftLength/2+1 interleaved complex bins
+    std::vector<double> kernelSpectrum;
+};
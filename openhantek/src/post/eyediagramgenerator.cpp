@@ -0,0 +1,220 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QMutexLocker>
+
+#include <algorithm>
+#include <thread>
+
+#include "eyediagramgenerator.h"
+#include "ppresult.h"
+#include "scopesettings.h"
+#include "viewconstants.h"
+
+/// Upper limit of the counting threads
+static const unsigned EYE_THREADS = 4;
+/// Records with more samples are counted by several threads
+static const size_t EYE_PARALLEL_SAMPLES = 1 << 16;
+/// Columns per unit interval, the screen shows two unit intervals
+static const double COLUMNS_PER_UI = XY_DENSITY_WIDTH / 2.0;
+/// Rows per div
+static const double ROWS_PER_DIV = XY_DENSITY_HEIGHT / DIVS_VOLTAGE;
+/// Upper limit of the points drawn between two samples
+static const unsigned MAX_POINTS = 32;
+/// A new record restarts the eye if its unit interval differs by more than this ratio
+static const double UI_TOLERANCE = 0.01;
+
+EyeDiagramGenerator::EyeDiagramGenerator(const DsoSettingsScope *scope) : scope(scope) {}
+
+void EyeDiagramGenerator::reset() { resetRequested = true; }
+
+bool EyeDiagramGenerator::recoverClock(const double *samples, size_t count, double interval, double level,
+                                       double hysteresis, double &phase, double &unitInterval) {
+    // The signal has to pass the hysteresis band to make an edge, the edge time is the last level crossing
+    edges.clear();
+    enum class State { UNKNOWN, LOW, HIGH } state = State::UNKNOWN;
+    double crossing = NAN;
+    for (size_t index = 1; index < count; ++index) {
+        const double previous = samples[index - 1];
+        const double value = samples[index];
+        if ((previous < level) != (value < level))
+            crossing = ((index - 1) + (level - previous) / (value - previous)) * interval;
+        if (value >= level + hysteresis) {
+            if (state == State::LOW) edges.push_back(crossing);
+            state = State::HIGH;
+        } else if (value <= level - hysteresis) {
+            if (state == State::HIGH) edges.push_back(crossing);
+            state = State::LOW;
+        }
+    }
+    if (edges.size() < 3) return false;
+
+    // Estimate the unit interval from the shortest pulses
+    if (!(unitInterval > 0.0)) {
+        double shortest = INFINITY;
+        for (size_t edge = 1; edge < edges.size(); ++edge) shortest = std::min(shortest, edges[edge] - edges[edge - 1]);
+        double sum = 0.0;
+        unsigned pulses = 0;
+        for (size_t edge = 1; edge < edges.size(); ++edge) {
+            const double pulse = edges[edge] - edges[edge - 1];
+            if (pulse >= 1.5 * shortest) continue;
+            sum += pulse;
+            ++pulses;
+        }
+        unitInterval = sum / pulses;
+    }
+
+    // Number the edges by the unit intervals between them and fit a line through their times, the second pass
+    // numbers the edges with the fitted unit interval
+    for (unsigned pass = 0; pass < 2; ++pass) {
+        double number = 0.0;
+        double sumNumbers = 0.0, sumTimes = 0.0, sumSquares = 0.0, sumProducts = 0.0;
+        for (size_t edge = 0; edge < edges.size(); ++edge) {
+            if (edge) number += std::max(std::round((edges[edge] - edges[edge - 1]) / unitInterval), 1.0);
+            sumNumbers += number;
+            sumTimes += edges[edge];
+            sumSquares += number * number;
+            sumProducts += number * edges[edge];
+        }
+        const double n = (double)edges.size();
+        const double variance = sumSquares - sumNumbers * sumNumbers / n;
+        if (!(variance > 0.0)) return false;
+        unitInterval = (sumProducts - sumNumbers * sumTimes / n) / variance;
+        phase = (sumTimes - unitInterval * sumNumbers) / n;
+    }
+    return unitInterval >= 2.0 * interval;
+}
+
+void EyeDiagramGenerator::accumulate(const double *samples, size_t count, double interval, double phase,
+                                     double unitInterval, double rowScale, double rowShift) {
+    const size_t cells = (size_t)XY_DENSITY_WIDTH * XY_DENSITY_HEIGHT;
+    size_t threads = 1;
+    if (count >= EYE_PARALLEL_SAMPLES)
+        threads = std::max(std::min(std::thread::hardware_concurrency(), EYE_THREADS), 1u);
+    if (threadCounts.size() < threads) threadCounts.resize(threads);
+
+    // Points between two samples, so that sparse samples still draw connected lines
+    const double step = interval / unitInterval;
+    const unsigned points = (unsigned)std::min(std::max(std::ceil(step * COLUMNS_PER_UI), 1.0), (double)MAX_POINTS);
+
+    auto countCells = [=](uint32_t *grid, size_t first, size_t last) {
+        for (size_t index = first; index < last; ++index) {
+            const double position = (index * interval - phase) / unitInterval;
+            const double row = samples[index] * rowScale + rowShift;
+            const double rowStep = index + 1 < count ? (samples[index + 1] * rowScale + rowShift - row) / points : 0;
+            const unsigned pointCount = index + 1 < count ? points : 1;
+            for (unsigned point = 0; point < pointCount; ++point) {
+                // Fold into two unit intervals from -1/2 to 3/2, the edges are at 0 and 1
+                const double ui = position + step * point / points;
+                const double folded = ui - 2.0 * std::floor((ui + 0.5) / 2.0);
+                const double x = (folded + 0.5) * COLUMNS_PER_UI;
+                const double y = row + rowStep * point;
+                if (x >= 0.0 && x < XY_DENSITY_WIDTH && y >= 0.0 && y < XY_DENSITY_HEIGHT)
+                    ++grid[(size_t)y * XY_DENSITY_WIDTH + (size_t)x];
+            }
+        }
+    };
+    for (size_t thread = 0; thread < threads; ++thread) threadCounts[thread].assign(cells, 0);
+    std::vector<std::thread> pool;
+    for (size_t thread = 1; thread < threads; ++thread)
+        pool.emplace_back(countCells, threadCounts[thread].data(), count * thread / threads,
+                          count * (thread + 1) / threads);
+    countCells(threadCounts.front().data(), 0, count / threads);
+    for (std::thread &thread : pool) thread.join();
+
+    for (size_t thread = 0; thread < threads; ++thread) {
+        const uint32_t *grid = threadCounts[thread].data();
+        for (size_t cell = 0; cell < cells; ++cell) counts[cell] += grid[cell];
+    }
+}
+
+void EyeDiagramGenerator::process(PPresult *result) {
+    const DsoSettingsScopeEye &settings = scope->eye;
+    const bool resetting = resetRequested.exchange(false);
+    if (!settings.enabled || scope->horizontal.format != Dso::GraphFormat::TY) return;
+
+    const ChannelID channel = settings.channel;
+    if (result->append || channel >= result->channelCount() || channel >= scope->voltage.size() ||
+        !scope->voltage[channel].used)
+        return;
+    const SampleValues &voltage = result->data(channel)->voltage;
+    if (voltage.sample.size() < 2 || voltage.interval <= 0.0) return;
+
+    const double gain = scope->gain(channel);
+    const double offset = scope->voltage[channel].offset;
+    const double invert = scope->voltage[channel].inverted ? -1.0 : 1.0;
+    const double rowScale = ROWS_PER_DIV * invert / gain;
+    const double rowShift = (offset + DIVS_VOLTAGE / 2) * ROWS_PER_DIV;
+
+    QMutexLocker locker(&mutex);
+    const std::vector<double> newSignature = {(double)channel, gain, offset, invert, settings.bitrate};
+    if (resetting || newSignature != signature || counts.empty()) {
+        signature = newSignature;
+        counts.assign((size_t)XY_DENSITY_WIDTH * XY_DENSITY_HEIGHT, 0);
+        unitIntervals = 0;
+        unitInterval = 0.0;
+    }
+
+    // The threshold is the middle of the levels
+    const double *samples = voltage.sample.data();
+    const size_t count = voltage.sample.size();
+    const auto range = std::minmax_element(samples, samples + count);
+    const double amplitude = *range.second - *range.first;
+    const double level = *range.first + amplitude / 2;
+    double phase = 0.0;
+    double recovered = settings.bitrate > 0.0 ? 1.0 / settings.bitrate : 0.0;
+    if (amplitude > 0.0 && recoverClock(samples, count, voltage.interval, level, 0.2 * amplitude, phase, recovered)) {
+        // Another signal, start over
+        if (unitInterval > 0.0 && std::abs(recovered - unitInterval) > UI_TOLERANCE * unitInterval) {
+            counts.assign(counts.size(), 0);
+            unitIntervals = 0;
+        }
+        unitInterval = recovered;
+        levelRow = level * rowScale + rowShift;
+        voltsPerRow = gain / ROWS_PER_DIV;
+        accumulate(samples, count, voltage.interval, phase, unitInterval, rowScale, rowShift);
+        unitIntervals += (unsigned long long)((count - 1) * voltage.interval / unitInterval);
+    }
+
+    // Logarithmic levels, so that rare transitions stay visible next to the busiest cells
+    const unsigned long long highest = *std::max_element(counts.begin(), counts.end());
+    std::vector<uint8_t> &target = result->modifyData(channel)->density;
+    target.assign(counts.size(), 0);
+    if (!highest) return;
+    const double scale = 255.0 / std::log1p((double)highest);
+    for (size_t cell = 0; cell < counts.size(); ++cell)
+        if (counts[cell]) target[cell] = (uint8_t)std::lround(std::log1p((double)counts[cell]) * scale);
+}
+
+EyeDiagramGenerator::Measurement EyeDiagramGenerator::measurement() const {
+    QMutexLocker locker(&mutex);
+    Measurement eye;
+    eye.unitIntervals = unitIntervals;
+    if (!unitIntervals || !(unitInterval > 0.0)) return eye;
+    eye.unitInterval = unitInterval;
+
+    const long long row = (long long)levelRow;
+    const long long center = XY_DENSITY_WIDTH / 2;
+    if (row < 0 || row >= XY_DENSITY_HEIGHT) return eye;
+    auto empty = [this](long long x, long long y) { return !counts[(size_t)y * XY_DENSITY_WIDTH + (size_t)x]; };
+
+    // Width: The empty columns around the center at the threshold level
+    long long left = center, right = center;
+    if (empty(center, row)) {
+        while (left > 0 && empty(left - 1, row)) --left;
+        while (right + 1 < XY_DENSITY_WIDTH && empty(right + 1, row)) ++right;
+        eye.width = (right - left + 1) / COLUMNS_PER_UI * unitInterval;
+    } else {
+        eye.width = 0.0;
+    }
+
+    // Height: The empty rows around the threshold level in the center column
+    long long bottom = row, top = row;
+    if (empty(center, row)) {
+        while (bottom > 0 && empty(center, bottom - 1)) --bottom;
+        while (top + 1 < XY_DENSITY_HEIGHT && empty(center, top + 1)) ++top;
+        eye.height = (top - bottom + 1) * voltsPerRow;
+    } else {
+        eye.height = 0.0;
+    }
+    return eye;
+}
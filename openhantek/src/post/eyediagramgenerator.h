@@ -0,0 +1,68 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QMutex>
+
+#include <atomic>
+#include <cmath>
+#include <vector>
+
+#include "processor.h"
+
+struct DsoSettingsScope;
+
+/// \brief Accumulates the eye diagram of a serial signal over many records.
+/// The bit clock is recovered from the edges of each record: The middle level crossings are numbered by the unit
+/// intervals between them and a straight line is fitted through their times, its slope is the unit interval and
+/// its offset the clock phase. The samples are then folded into two unit intervals, with the edges at 1/4 and 3/4
+/// of the screen width, and counted into a grid of XY_DENSITY_WIDTH x XY_DENSITY_HEIGHT cells. Sparse samples are
+/// connected by interpolated points. Long records are counted by several threads with their own grids that are
+/// added to the accumulated eye afterwards, so the eye of 10^6 unit intervals is complete after a few records.
+///
+/// The eye height and width are the openings at the eye center and at the threshold level, where no sample was
+/// counted so far. Roll mode blocks are not analyzed.
+class EyeDiagramGenerator : public Processor {
+  public:
+    /// \brief The measured eye, NaN if unknown.
+    struct Measurement {
+        unsigned long long unitIntervals = 0; ///< Number of accumulated unit intervals
+        double unitInterval = NAN;            ///< Recovered duration of a bit (s)
+        double height = NAN;                  ///< Vertical eye opening (V)
+        double width = NAN;                   ///< Horizontal eye opening (s)
+    };
+
+    EyeDiagramGenerator(const DsoSettingsScope *scope);
+    virtual void process(PPresult *result) override;
+
+    /// \brief Discard the accumulated eye, takes effect with the next record.
+    void reset();
+    /// \return The eye height and width of the accumulated eye
+    Measurement measurement() const;
+
+  private:
+    /// \brief Find the edges and fit the clock through them.
+    /// \param phase Time of an edge relative to the first sample (s).
+    /// \param unitInterval The nominal unit interval or 0 to estimate it, returns the fitted one.
+    /// \return false if there are not enough edges.
+    bool recoverClock(const double *samples, size_t count, double interval, double level, double hysteresis,
+                      double &phase, double &unitInterval);
+    /// \brief Count the samples into the accumulated eye.
+    /// \param rowScale, rowShift Convert volts to rows.
+    void accumulate(const double *samples, size_t count, double interval, double phase, double unitInterval,
+                    double rowScale, double rowShift);
+
+    const DsoSettingsScope *scope;
+
+    mutable QMutex mutex;                            ///< Guards the accumulated eye
+    std::vector<unsigned long long> counts;          ///< The accumulated eye, the first row is at the bottom
+    std::vector<std::vector<uint32_t>> threadCounts; ///< Cell counts of the current record of each thread
+    std::vector<double> edges;                       ///< Middle level crossings of the current record (s)
+    std::vector<double> signature;                   ///< The settings the eye was accumulated with
+    std::atomic<bool> resetRequested{false};
+
+    unsigned long long unitIntervals = 0; ///< Number of accumulated unit intervals
+    double unitInterval = 0.0;            ///< The unit interval of the last record (s)
+    double levelRow = 0.0;                ///< Row of the threshold level
+    double voltsPerRow = 0.0;             ///< Height of a row (V)
+};
@@ -0,0 +1,13 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include "frequencycounter.h"
+
+FrequencyCounter::Result FrequencyCounter::measure(double interval) const {
+    Result result;
+    result.edges = edges;
+    if (edges < 2) return result;
+
+    result.period = (last - first) / (edges - 1) * interval;
+    result.frequency = 1.0 / result.period;
+    return result;
+}
@@ -0,0 +1,36 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <cmath>
+
+/// \brief Reciprocal frequency counter on the rising edges of a record.
+/// The edges are found by the caller, e.g. the 50 % crossings of the MeasurementGenerator state machine, and
+/// added in order with sub-sample positions. The period is the time between the first and the last edge divided
+/// by the number of whole periods in between, so every edge of the record contributes and the resolution grows
+/// with the record length instead of being limited to one sample.
+class FrequencyCounter {
+  public:
+    struct Result {
+        double period = NAN;    ///< Average period (s)
+        double frequency = NAN; ///< 1 / period (Hz)
+        unsigned edges = 0;     ///< Number of counted edges
+    };
+
+    /// \brief Forget the edges of the previous record.
+    inline void reset() { edges = 0; }
+    /// \brief Count a rising edge.
+    /// \param position The interpolated position of the edge in samples, later than the previous one.
+    inline void addEdge(double position) {
+        if (!edges++) first = position;
+        last = position;
+    }
+    /// \brief Compute the frequency of the counted edges.
+    /// \param interval The time between two samples in s.
+    Result measure(double interval) const;
+
+  private:
+    double first = 0.0;
+    double last = 0.0;
+    unsigned edges = 0;
+};
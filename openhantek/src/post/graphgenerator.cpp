@@ -1,8 +1,11 @@
 // SPDX-License-Identifier: GPL-2.0+
 
+#define _USE_MATH_DEFINES
 #include <QDebug>
 #include <QMutex>
+#include <cmath>
 #include <exception>
+#include <thread>
 
 #include "post/graphgenerator.h"
 #include "post/ppresult.h"
@@ -11,6 +14,22 @@
 #include "scopesettings.h"
 #include "utils/printutils.h"
 #include "viewconstants.h"
+#include "viewsettings.h"
+
+/// Roll mode: Number of envelope columns a screen width is reduced to
+static const size_t ROLL_COLUMNS = 1024;
+/// Sin(x)/x interpolation: Vertices per screen width, about the width of the graph in pixels
+static const size_t SINC_POINTS = 2048;
+/// Sin(x)/x interpolation: Highest upsampling factor
+static const unsigned SINC_MAX_FACTOR = 64;
+/// Sin(x)/x interpolation: Samples each interpolated point depends on, the Lanczos kernel has SINC_TAPS/2 lobes
+static const int SINC_TAPS = 16;
+/// XY density: Upper limit of the counting threads
+static const unsigned DENSITY_THREADS = 4;
+/// XY density: Records with more sample pairs are counted by several threads
+static const size_t DENSITY_PARALLEL_SAMPLES = 1 << 17;
+/// XY density: Cells per div, the same in both directions
+static const double DENSITY_CELLS_PER_DIV = XY_DENSITY_WIDTH / DIVS_TIME;
 
 static const SampleValues &useSpecSamplesOf(ChannelID channel, const PPresult *result,
                                             const DsoSettingsScope *scope) {
@@ -26,20 +45,28 @@ static const SampleValues &useVoltSamplesOf(ChannelID channel, const PPresult *r
     return result->data(channel)->voltage;
 }
 
-GraphGenerator::GraphGenerator(const DsoSettingsScope *scope, bool isSoftwareTriggerDevice)
-    : scope(scope), isSoftwareTriggerDevice(isSoftwareTriggerDevice) {}
+GraphGenerator::GraphGenerator(const DsoSettingsScope *scope, const DsoSettingsView *view,
+                               bool isSoftwareTriggerDevice, const RollingHistory *history)
+    : scope(scope), view(view), isSoftwareTriggerDevice(isSoftwareTriggerDevice), history(history) {}
 
 bool GraphGenerator::isReady() const { return ready; }
 
 void GraphGenerator::generateGraphsTYvoltage(PPresult *result) {
+    if (result->append && history && history->isValid()) {
+        generateGraphsTYroll(result);
+        return;
+    }
+
     unsigned preTrigSamples = 0;
     unsigned postTrigSamples = 0;
     unsigned swTriggerStart = 0;
+    double swTriggerFraction = 0.0;
 
     // check trigger point for software trigger
-    if (isSoftwareTriggerDevice && scope->trigger.source < result->channelCount())
-        std::tie(preTrigSamples, postTrigSamples, swTriggerStart) = SoftwareTrigger::compute(result, scope);
-    result->softwareTriggerTriggered = postTrigSamples > preTrigSamples;
+    if (isSoftwareTriggerDevice && scope->trigger.source < result->channelCount() && !result->triggerAligned)
+        std::tie(preTrigSamples, postTrigSamples, swTriggerStart, swTriggerFraction) =
+            SoftwareTrigger::compute(result, scope);
+    result->softwareTriggerTriggered = result->triggerAligned || postTrigSamples > preTrigSamples;
 
     result->vaChannelVoltage.resize(scope->voltage.size());
     for (ChannelID channel = 0; channel < scope->voltage.size(); ++channel) {
@@ -66,6 +93,10 @@ void GraphGenerator::generateGraphsTYvoltage(PPresult *result) {
 
         // What's the horizontal distance between sampling points?
         float horizontalFactor = (float)(samples.interval / scope->horizontal.timebase);
+        // The exact trigger point lies between two samples, move the graph to keep it steady
+        const float horizontalShift = (float)swTriggerFraction * horizontalFactor - DIVS_TIME / 2;
+        result->graphOrigin = horizontalShift - (double)(swTriggerStart - preTrigSamples) * horizontalFactor;
+        result->graphScale = 1.0 / scope->horizontal.timebase;
 
         // Fill vector array
         std::vector<double>::const_iterator dataIterator = samples.sample.begin();
@@ -75,13 +106,126 @@ void GraphGenerator::generateGraphsTYvoltage(PPresult *result) {
 
         std::advance(dataIterator, swTriggerStart - preTrigSamples);
 
+        if (view->interpolation == Dso::INTERPOLATION_SINC &&
+            generateSinc(target, &*dataIterator, sampleCount, horizontalFactor, horizontalShift, gain, invert, offset))
+            continue;
+
         for (unsigned int position = 0; position < sampleCount; ++position) {
-            target.push_back(QVector3D(position * horizontalFactor - DIVS_TIME / 2,
+            target.push_back(QVector3D(position * horizontalFactor + horizontalShift,
                                        (float)*(dataIterator++) / gain * invert + offset, 0.0));
         }
     }
 }
 
+void GraphGenerator::prepareSinc(unsigned factor) {
+    if (factor == sincFactor) return;
+    sincFactor = factor;
+    sincTable.resize(factor * SINC_TAPS);
+    const double lobes = SINC_TAPS / 2;
+    for (unsigned phase = 0; phase < factor; ++phase) {
+        double *taps = &sincTable[phase * SINC_TAPS];
+        double sum = 0.0;
+        // Tap k weights the sample k - SINC_TAPS/2 + 1 positions away from the one left of the point
+        for (int k = 0; k < SINC_TAPS; ++k) {
+            const double t = (double)phase / factor - (k - SINC_TAPS / 2 + 1);
+            double weight = 1.0;
+            if (std::fabs(t) >= lobes)
+                weight = 0.0;
+            else if (t != 0.0)
+                weight = lobes * std::sin(M_PI * t) * std::sin(M_PI * t / lobes) / (M_PI * M_PI * t * t);
+            taps[k] = weight;
+            sum += weight;
+        }
+        // Unity gain for every phase, avoids ripple on flat signals
+        for (int k = 0; k < SINC_TAPS; ++k) taps[k] /= sum;
+    }
+}
+
+bool GraphGenerator::generateSinc(ChannelGraph &target, const double *samples, size_t count, float horizontalFactor,
+                                  float horizontalShift, float gain, float invert, float offset) {
+    // Visible samples and one more on each side, so the graph reaches the borders of the screen
+    const double left = (-DIVS_TIME / 2 - horizontalShift) / horizontalFactor;
+    const double right = (DIVS_TIME / 2 - horizontalShift) / horizontalFactor;
+    const long long first = std::max((long long)std::floor(left) - 1, 0ll);
+    const long long last = std::min((long long)std::ceil(right) + 1, (long long)count - 1);
+    if (last <= first) return false;
+    const size_t visible = (size_t)(last - first + 1);
+    const unsigned factor = (unsigned)std::min(SINC_POINTS / visible, (size_t)SINC_MAX_FACTOR);
+    if (factor < 2) return false;
+    prepareSinc(factor);
+
+    target.clear();
+    target.reserve((visible - 1) * factor + 1);
+    double window[SINC_TAPS];
+    for (long long position = first; position <= last; ++position) {
+        // The edges of the record are repeated
+        for (int k = 0; k < SINC_TAPS; ++k) {
+            const long long index = position + k - SINC_TAPS / 2 + 1;
+            window[k] = samples[std::max(std::min(index, (long long)count - 1), 0ll)];
+        }
+        const unsigned phases = position == last ? 1 : factor;
+        for (unsigned phase = 0; phase < phases; ++phase) {
+            const double *taps = &sincTable[phase * SINC_TAPS];
+            double value = 0.0;
+            for (int k = 0; k < SINC_TAPS; ++k) value += taps[k] * window[k];
+            target.push_back(QVector3D(((float)position + (float)phase / factor) * horizontalFactor + horizontalShift,
+                                       (float)value / gain * invert + offset, 0.0));
+        }
+    }
+    return true;
+}
+
+void GraphGenerator::generateGraphsTYroll(PPresult *result) {
+    result->softwareTriggerTriggered = false;
+    result->vaChannelVoltage.resize(scope->voltage.size());
+
+    // The window always has the same number of vertices, no matter how many samples it covers
+    const unsigned long long windowSamples =
+        (unsigned long long)std::max(scope->horizontal.timebase * DIVS_TIME / history->interval(), 1.0);
+    for (ChannelID channel = 0; channel < scope->voltage.size(); ++channel) {
+        ChannelGraph &target = result->vaChannelVoltage[channel];
+        target.clear();
+        const unsigned long long written = history->written(channel);
+        if (!scope->voltage[channel].used || !written) continue;
+
+        const float gain = (float)scope->gain(channel);
+        const float offset = (float)scope->voltage[channel].offset;
+        const float invert = scope->voltage[channel].inverted ? -1.0f : 1.0f;
+        const long long first = (long long)written - (long long)windowSamples;
+        // Sample 0 of the new block is the history sample `written - size`
+        result->graphScale = DIVS_TIME / (windowSamples * history->interval());
+        result->graphOrigin =
+            (double)((long long)written - (long long)result->data(channel)->voltage.sample.size() - first) * DIVS_TIME /
+                windowSamples -
+            DIVS_TIME / 2;
+
+        if (windowSamples <= ROLL_COLUMNS) {
+            // Few samples, draw each of them
+            const unsigned long long from = (unsigned long long)std::max(first, 0ll);
+            rollSamples.resize((size_t)(written - from));
+            const size_t count = history->read(channel, from, rollSamples.size(), rollSamples.data());
+            const float horizontalFactor = (float)DIVS_TIME / windowSamples;
+            target.reserve(count);
+            for (size_t index = 0; index < count; ++index)
+                target.push_back(QVector3D((float)((long long)(from + index) - first) * horizontalFactor - DIVS_TIME / 2,
+                                           (float)rollSamples[index] / gain * invert + offset, 0.0));
+        } else {
+            // Draw the min/max envelope of each column
+            rollColumns.resize(ROLL_COLUMNS);
+            history->envelope(channel, first, windowSamples, rollColumns);
+            const float horizontalFactor = (float)DIVS_TIME / ROLL_COLUMNS;
+            target.reserve(ROLL_COLUMNS * 2);
+            for (size_t column = 0; column < ROLL_COLUMNS; ++column) {
+                const RollingHistory::Envelope &envelope = rollColumns[column];
+                if (std::isnan(envelope.min)) continue;
+                const float x = ((float)column + 0.5f) * horizontalFactor - DIVS_TIME / 2;
+                target.push_back(QVector3D(x, (float)envelope.min / gain * invert + offset, 0.0));
+                target.push_back(QVector3D(x, (float)envelope.max / gain * invert + offset, 0.0));
+            }
+        }
+    }
+}
+
 void GraphGenerator::generateGraphsTYspectrum(PPresult *result) {
     ready = true;
     result->vaChannelSpectrum.resize(scope->spectrum.size());
@@ -135,6 +279,7 @@ void GraphGenerator::generateGraphsXY(PPresult *result, const DsoSettingsScope *
 
     // Delete all spectrum graphs
     for (ChannelGraph &data : result->vaChannelSpectrum) data.clear();
+    if (!view->xyDensity) densities.clear();
 
     // Generate voltage graphs for pairs of channels
     for (ChannelID channel = 0; channel < scope->voltage.size(); channel += 2) {
@@ -159,12 +304,6 @@ void GraphGenerator::generateGraphsXY(PPresult *result, const DsoSettingsScope *
 
         // Check if the sample count has changed
         const size_t sampleCount = std::min(xSamples.sample.size(), ySamples.sample.size());
-        ChannelGraph &drawLines = result->vaChannelVoltage[channel];
-        drawLines.reserve(sampleCount * 2);
-
-        // Fill vector array
-        std::vector<double>::const_iterator xIterator = xSamples.sample.begin();
-        std::vector<double>::const_iterator yIterator = ySamples.sample.begin();
         const double xGain = scope->gain(xChannel);
         const double yGain = scope->gain(yChannel);
         const double xOffset = scope->voltage[xChannel].offset;
@@ -172,9 +311,77 @@ void GraphGenerator::generateGraphsXY(PPresult *result, const DsoSettingsScope *
         const double xInvert = scope->voltage[xChannel].inverted ? -1.0 : 1.0;
         const double yInvert = scope->voltage[yChannel].inverted ? -1.0 : 1.0;
 
+        // The intensity map replaces the graph, its cost doesn't depend on the record length when drawing
+        if (view->xyDensity) {
+            result->vaChannelVoltage[channel].clear();
+            result->vaChannelVoltage[channel + 1].clear();
+            generateDensityXY(channel / 2, xSamples.sample.data(), ySamples.sample.data(), sampleCount,
+                              DENSITY_CELLS_PER_DIV * xInvert / xGain,
+                              (xOffset + DIVS_TIME / 2) * DENSITY_CELLS_PER_DIV, DENSITY_CELLS_PER_DIV * yInvert / yGain,
+                              (yOffset + DIVS_VOLTAGE / 2) * DENSITY_CELLS_PER_DIV,
+                              result->modifyData(xChannel)->density);
+            continue;
+        }
+
+        ChannelGraph &drawLines = result->vaChannelVoltage[channel];
+        drawLines.reserve(sampleCount * 2);
+
+        // Fill vector array
+        std::vector<double>::const_iterator xIterator = xSamples.sample.begin();
+        std::vector<double>::const_iterator yIterator = ySamples.sample.begin();
         for (unsigned int position = 0; position < sampleCount; ++position) {
             drawLines.push_back(QVector3D((float)(*(xIterator++) / xGain * xInvert + xOffset),
                                           (float)(*(yIterator++) / yGain * yInvert + yOffset), 0.0));
         }
     }
 }
+
+void GraphGenerator::generateDensityXY(size_t pair, const double *xSamples, const double *ySamples, size_t count,
+                                       double xScale, double xShift, double yScale, double yShift,
+                                       std::vector<uint8_t> &target) {
+    const size_t cells = (size_t)XY_DENSITY_WIDTH * XY_DENSITY_HEIGHT;
+    if (densities.size() <= pair) densities.resize(pair + 1);
+    std::vector<float> &density = densities[pair];
+    if (density.size() != cells) density.assign(cells, 0.0f);
+
+    size_t threads = 1;
+    if (count >= DENSITY_PARALLEL_SAMPLES)
+        threads = std::max(std::min(std::thread::hardware_concurrency(), DENSITY_THREADS), 1u);
+    if (densityCounts.size() < threads) densityCounts.resize(threads);
+
+    // Every thread counts into its own grid, so no increments collide
+    auto countCells = [xSamples, ySamples, xScale, xShift, yScale, yShift](uint32_t *grid, size_t first, size_t last) {
+        for (size_t index = first; index < last; ++index) {
+            const double x = xSamples[index] * xScale + xShift;
+            const double y = ySamples[index] * yScale + yShift;
+            if (x >= 0.0 && x < XY_DENSITY_WIDTH && y >= 0.0 && y < XY_DENSITY_HEIGHT)
+                ++grid[(size_t)y * XY_DENSITY_WIDTH + (size_t)x];
+        }
+    };
+    for (size_t thread = 0; thread < threads; ++thread) densityCounts[thread].assign(cells, 0);
+    std::vector<std::thread> pool;
+    for (size_t thread = 1; thread < threads; ++thread)
+        pool.emplace_back(countCells, densityCounts[thread].data(), count * thread / threads,
+                          count * (thread + 1) / threads);
+    countCells(densityCounts.front().data(), 0, count / threads);
+    for (std::thread &thread : pool) thread.join();
+
+    // Merge the grids into the decaying map
+    const float persistence = (float)std::min(std::max(view->xyPersistence, 0.0), 0.99);
+    float highest = 0.0f;
+    for (size_t cell = 0; cell < cells; ++cell) {
+        uint32_t hits = densityCounts.front()[cell];
+        for (size_t thread = 1; thread < threads; ++thread) hits += densityCounts[thread][cell];
+        // Drop faded cells before they become slow denormals
+        const float value = density[cell] * persistence + (float)hits;
+        density[cell] = value >= 1e-3f ? value : 0.0f;
+        highest = std::max(highest, density[cell]);
+    }
+
+    // Logarithmic levels, so that rarely visited cells stay visible next to the busiest one
+    target.assign(cells, 0);
+    if (!(highest > 0.0f)) return;
+    const float scale = 255.0f / std::log1p(highest);
+    for (size_t cell = 0; cell < cells; ++cell)
+        if (density[cell] > 0.0f) target[cell] = (uint8_t)std::lround(std::log1p(density[cell]) * scale);
+}
@@ -3,6 +3,7 @@
 #pragma once
 
 #include <deque>
+#include <vector>
 
 #include <QObject>
 #include <QVector3D>
@@ -10,19 +11,25 @@
 #include "hantekdso/enums.h"
 #include "hantekprotocol/types.h"
 #include "processor.h"
+#include "rollinghistory.h"
 
 struct DsoSettingsScope;
+struct DsoSettingsView;
 class PPresult;
 namespace Dso {
 struct ControlSpecification;
 }
 
 /// \brief Generates ready to be used vertex arrays
+/// The sin(x)/x interpolation upsamples the visible part of sparse records with a precomputed polyphase Lanczos
+/// filter, the number of vertices is limited to about one per screen pixel no matter how long the record is.
 class GraphGenerator : public QObject, public Processor {
     Q_OBJECT
 
   public:
-    GraphGenerator(const DsoSettingsScope *scope, bool isSoftwareTriggerDevice);
+    /// \param history The roll mode history that is drawn instead of the latest sample set, if available
+    GraphGenerator(const DsoSettingsScope *scope, const DsoSettingsView *view, bool isSoftwareTriggerDevice,
+                   const RollingHistory *history = nullptr);
     void generateGraphsXY(PPresult *result, const DsoSettingsScope *scope);
 
     bool isReady() const;
@@ -30,11 +37,33 @@ class GraphGenerator : public QObject, public Processor {
   private:
     void generateGraphsTYvoltage(PPresult *result);
     void generateGraphsTYspectrum(PPresult *result);
+    /// \brief Roll mode: Draw the latest screen width of the rolling history, newest samples on the right.
+    void generateGraphsTYroll(PPresult *result);
+    /// \brief Create the sin(x)/x interpolated graph of the visible samples.
+    /// \return false if there are enough samples on the screen to draw them directly.
+    bool generateSinc(ChannelGraph &target, const double *samples, size_t count, float horizontalFactor,
+                      float horizontalShift, float gain, float invert, float offset);
+    /// \brief Compute the polyphase filter for the given upsampling factor, if it has changed.
+    void prepareSinc(unsigned factor);
+    /// \brief XY mode: Count the sample pairs in the cells of the decaying intensity map of a channel pair.
+    /// Long records are split over several threads, each counting into its own grid.
+    /// \param xScale, yScale Cells per volt, negative for inverted channels.
+    /// \param xShift, yShift Cell position of 0 V.
+    void generateDensityXY(size_t pair, const double *xSamples, const double *ySamples, size_t count, double xScale,
+                           double xShift, double yScale, double yShift, std::vector<uint8_t> &target);
 
   private:
     bool ready = false;
     const DsoSettingsScope *scope;
+    const DsoSettingsView *view;
     const bool isSoftwareTriggerDevice;
+    const RollingHistory *history;
+    std::vector<double> rollSamples;
+    std::vector<RollingHistory::Envelope> rollColumns;
+    std::vector<double> sincTable; ///< Taps of each phase of the interpolation filter
+    unsigned sincFactor = 0;       ///< Upsampling factor of the sincTable
+    std::vector<std::vector<float>> densities;        ///< XY mode: Decaying intensity map of each channel pair
+    std::vector<std::vector<uint32_t>> densityCounts; ///< XY mode: Cell counts of the current frame of each thread
 
     // Processor interface
     private:
@@ -0,0 +1,273 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QMutexLocker>
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HISTOGRAM_SSE2
+#endif
+
+#include "histogramgenerator.h"
+#include "scopesettings.h"
+#include "viewconstants.h"
+
+/// Number of voltage bins over the screen height, about the resolution of the 8 bit ADCs
+static const size_t VOLTAGE_BINS = 256;
+/// Number of time bins over the window width
+static const size_t TIME_BINS = 1000;
+/// Number of interleaved partial histograms, sample i is counted in partial histogram i % PARTIALS
+static const size_t PARTIALS = 4;
+
+typedef DsoSettingsScopeHistogram::Mode Mode;
+
+HistogramGenerator::HistogramGenerator(const DsoSettingsScope *scope) : scope(scope) {}
+
+void HistogramGenerator::reset() { resetRequested = true; }
+
+ValueHistogram HistogramGenerator::histogram() const {
+    QMutexLocker locker(&mutex);
+    return accumulated;
+}
+
+void HistogramGenerator::clear(bool amplitude, double valueFirst, double valueLast, double first, double last) {
+    accumulated = ValueHistogram();
+    accumulated.amplitude = amplitude;
+    accumulated.channel = scope->histogram.channel;
+    accumulated.bins.assign(amplitude ? VOLTAGE_BINS : TIME_BINS, 0);
+    accumulated.valueFirst = valueFirst;
+    accumulated.valueLast = valueLast;
+    accumulated.first = first;
+    accumulated.last = last;
+    sum = 0.0;
+    sumSquares = 0.0;
+}
+
+void HistogramGenerator::addValue(double value) {
+    if (!accumulated.count) shift = value;
+    ++accumulated.count;
+    // The comparisons are false for the initial NaN
+    if (!(accumulated.minimum <= value)) accumulated.minimum = value;
+    if (!(accumulated.maximum >= value)) accumulated.maximum = value;
+    sum += value - shift;
+    sumSquares += (value - shift) * (value - shift);
+
+    const double bin = std::floor((value - accumulated.valueFirst) / (accumulated.valueLast - accumulated.valueFirst) *
+                                  accumulated.bins.size());
+    if (bin >= 0.0 && bin < accumulated.bins.size()) ++accumulated.bins[(size_t)bin];
+}
+
+void HistogramGenerator::addVoltages(const double *samples, size_t count) {
+    const size_t bins = accumulated.bins.size();
+    const size_t stride = bins + 2;
+    const double scale = bins / (accumulated.valueLast - accumulated.valueFirst);
+    partial.assign(PARTIALS * stride, 0);
+    uint32_t *const counts = partial.data();
+    if (!accumulated.count) shift = samples[0];
+
+    double minimum = samples[0];
+    double maximum = samples[0];
+    double total = 0.0;
+    double squares = 0.0;
+    size_t index = 0;
+#ifdef HISTOGRAM_SSE2
+    if (count >= 4) {
+        const __m128d valueFirst = _mm_set1_pd(accumulated.valueFirst);
+        const __m128d binScale = _mm_set1_pd(scale);
+        const __m128d underflow = _mm_set1_pd(-1.0);
+        const __m128d overflow = _mm_set1_pd((double)bins);
+        const __m128d one = _mm_set1_pd(1.0);
+        const __m128d offset = _mm_set1_pd(shift);
+        __m128d vMinimum = _mm_set1_pd(samples[0]);
+        __m128d vMaximum = vMinimum;
+        __m128d vSum = _mm_setzero_pd();
+        __m128d vSquares = _mm_setzero_pd();
+        int32_t positions[4];
+        for (; index + 4 <= count; index += 4) {
+            const __m128d a = _mm_loadu_pd(samples + index);
+            const __m128d b = _mm_loadu_pd(samples + index + 2);
+            vMinimum = _mm_min_pd(vMinimum, _mm_min_pd(a, b));
+            vMaximum = _mm_max_pd(vMaximum, _mm_max_pd(a, b));
+            const __m128d da = _mm_sub_pd(a, offset);
+            const __m128d db = _mm_sub_pd(b, offset);
+            vSum = _mm_add_pd(vSum, _mm_add_pd(da, db));
+            vSquares = _mm_add_pd(vSquares, _mm_add_pd(_mm_mul_pd(da, da), _mm_mul_pd(db, db)));
+
+            // Bin positions plus one, values outside of the bins go to the under- and overflow bin
+            const __m128i pa = _mm_cvttpd_epi32(_mm_add_pd(
+                _mm_min_pd(_mm_max_pd(_mm_mul_pd(_mm_sub_pd(a, valueFirst), binScale), underflow), overflow), one));
+            const __m128i pb = _mm_cvttpd_epi32(_mm_add_pd(
+                _mm_min_pd(_mm_max_pd(_mm_mul_pd(_mm_sub_pd(b, valueFirst), binScale), underflow), overflow), one));
+            _mm_storeu_si128((__m128i *)positions, _mm_unpacklo_epi64(pa, pb));
+            ++counts[positions[0]];
+            ++counts[stride + positions[1]];
+            ++counts[2 * stride + positions[2]];
+            ++counts[3 * stride + positions[3]];
+        }
+        double lanes[2];
+        _mm_storeu_pd(lanes, vMinimum);
+        minimum = std::min(lanes[0], lanes[1]);
+        _mm_storeu_pd(lanes, vMaximum);
+        maximum = std::max(lanes[0], lanes[1]);
+        _mm_storeu_pd(lanes, vSum);
+        total = lanes[0] + lanes[1];
+        _mm_storeu_pd(lanes, vSquares);
+        squares = lanes[0] + lanes[1];
+    }
+#endif
+    for (; index < count; ++index) {
+        const double value = samples[index];
+        minimum = std::min(minimum, value);
+        maximum = std::max(maximum, value);
+        total += value - shift;
+        squares += (value - shift) * (value - shift);
+        const double position = (value - accumulated.valueFirst) * scale;
+        const double limited = position >= -1.0 ? std::min(position, (double)bins) : -1.0;
+        ++counts[(index % PARTIALS) * stride + (size_t)(limited + 1.0)];
+    }
+
+    // Merge the partial histograms, the under- and overflow bins are dropped
+    for (size_t bin = 0; bin < bins; ++bin)
+        accumulated.bins[bin] += (unsigned long long)counts[bin + 1] + counts[stride + bin + 1] +
+                                 counts[2 * stride + bin + 1] + counts[3 * stride + bin + 1];
+    accumulated.count += count;
+    if (!(accumulated.minimum <= minimum)) accumulated.minimum = minimum;
+    if (!(accumulated.maximum >= maximum)) accumulated.maximum = maximum;
+    sum += total;
+    sumSquares += squares;
+}
+
+void HistogramGenerator::addTimes(const double *samples, size_t count, double position, double step, double scale,
+                                  double trigger) {
+    const double minimum = *std::min_element(samples, samples + count);
+    const double maximum = *std::max_element(samples, samples + count);
+    const double amplitude = maximum - minimum;
+    if (!(amplitude > 0.0)) return;
+
+    // The signal has to pass the low and the high level to make an edge, the edge time is the middle crossing
+    const double low = minimum + 0.1 * amplitude;
+    const double middle = minimum + 0.5 * amplitude;
+    const double high = minimum + 0.9 * amplitude;
+    const Mode mode = scope->histogram.mode;
+    const bool rising = scope->trigger.slope == Dso::Slope::Positive;
+
+    enum class State { UNKNOWN, LOW, HIGH } state = State::UNKNOWN;
+    double middleCrossing = NAN;
+    double lastEdge = NAN;
+    for (size_t index = 1; index < count; ++index) {
+        const double previous = samples[index - 1];
+        const double value = samples[index];
+        if ((previous < middle) != (value < middle))
+            middleCrossing = position + ((index - 1) + (middle - previous) / (value - previous)) * step;
+
+        bool edgeRising;
+        if (state == State::UNKNOWN) {
+            if (value <= low)
+                state = State::LOW;
+            else if (value >= high)
+                state = State::HIGH;
+            continue;
+        } else if (state == State::LOW && value >= high) {
+            state = State::HIGH;
+            edgeRising = true;
+        } else if (state == State::HIGH && value <= low) {
+            state = State::LOW;
+            edgeRising = false;
+        } else {
+            continue;
+        }
+
+        const double edge = middleCrossing;
+        switch (mode) {
+        case Mode::EDGE_POSITION:
+            if (edgeRising == rising) addValue((edge - trigger) / scale);
+            break;
+        case Mode::PERIOD:
+            if (edgeRising != rising) break;
+            if (!std::isnan(lastEdge)) addValue((edge - lastEdge) / scale);
+            lastEdge = edge;
+            break;
+        case Mode::PULSE_WIDTH:
+            if (edgeRising == rising) {
+                lastEdge = edge;
+            } else if (!std::isnan(lastEdge)) {
+                addValue((edge - lastEdge) / scale);
+                lastEdge = NAN;
+            }
+            break;
+        default: break;
+        }
+    }
+}
+
+void HistogramGenerator::process(PPresult *result) {
+    const DsoSettingsScopeHistogram &settings = scope->histogram;
+    const bool resetting = resetRequested.exchange(false);
+
+    QMutexLocker locker(&mutex);
+    if (settings.mode == Mode::OFF) {
+        signature.clear();
+        accumulated = ValueHistogram();
+        return;
+    }
+
+    const ChannelID channel = settings.channel;
+    if (result->append || result->graphScale <= 0.0 || channel >= result->channelCount() ||
+        channel >= scope->voltage.size() || !scope->voltage[channel].used) {
+        result->histogram = accumulated;
+        return;
+    }
+    const std::vector<double> &samples = result->data(channel)->voltage.sample;
+    const double step = result->data(channel)->voltage.interval * result->graphScale;
+    if (!(step > 0.0)) {
+        result->histogram = accumulated;
+        return;
+    }
+
+    // The time window in divs
+    double left = -DIVS_TIME / 2;
+    double right = DIVS_TIME / 2;
+    if (settings.betweenMarkers) {
+        left = std::max(std::min(scope->horizontal.marker[0], scope->horizontal.marker[1]), left);
+        right = std::min(std::max(scope->horizontal.marker[0], scope->horizontal.marker[1]), right);
+    }
+
+    const double gain = scope->gain(channel);
+    const double offset = scope->voltage[channel].offset;
+    const double invert = scope->voltage[channel].inverted ? -1.0 : 1.0;
+    const double trigger = (scope->trigger.position - 0.5) * DIVS_TIME;
+    const std::vector<double> newSignature = {(double)settings.mode, (double)channel, left, right, result->graphScale,
+                                              gain, offset, invert, (double)scope->trigger.slope,
+                                              scope->trigger.position};
+    if (resetting || newSignature != signature || accumulated.bins.empty()) {
+        signature = newSignature;
+        if (settings.mode == Mode::AMPLITUDE)
+            clear(true, (-DIVS_VOLTAGE / 2 - offset) * gain * invert, (DIVS_VOLTAGE / 2 - offset) * gain * invert,
+                  -DIVS_VOLTAGE / 2, DIVS_VOLTAGE / 2);
+        else if (settings.mode == Mode::EDGE_POSITION)
+            clear(false, (left - trigger) / result->graphScale, (right - trigger) / result->graphScale, left, right);
+        else
+            clear(false, 0.0, (right - left) / result->graphScale, left, right);
+    }
+
+    // The samples within the window
+    const double count = (double)samples.size();
+    const double begin = std::min(std::max(std::ceil((left - result->graphOrigin) / step), 0.0), count);
+    const double end = std::min(std::max(std::floor((right - result->graphOrigin) / step) + 1.0, 0.0), count);
+    if (end - begin >= 2) {
+        if (settings.mode == Mode::AMPLITUDE)
+            addVoltages(samples.data() + (size_t)begin, (size_t)(end - begin));
+        else
+            addTimes(samples.data() + (size_t)begin, (size_t)(end - begin), result->graphOrigin + begin * step, step,
+                     result->graphScale, trigger);
+        ++accumulated.waveforms;
+        if (accumulated.count) {
+            const double average = sum / accumulated.count;
+            accumulated.mean = shift + average;
+            accumulated.deviation = std::sqrt(std::max(sumSquares / accumulated.count - average * average, 0.0));
+        }
+    }
+    result->histogram = accumulated;
+}
@@ -0,0 +1,57 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QMutex>
+
+#include <atomic>
+#include <vector>
+
+#include "ppresult.h"
+#include "processor.h"
+
+struct DsoSettingsScope;
+
+/// \brief Accumulates a histogram of the voltages, periods, pulse widths or edge positions of one channel over
+/// many waveforms, so that noise and jitter can be characterized without exporting the waveforms.
+/// Only the samples within the time window are analyzed, the window is given in screen coordinates as drawn by
+/// the GraphGenerator. The bins cover the screen height for voltages and the window width for times. Roll mode
+/// blocks are not analyzed.
+///
+/// Voltages are counted with SSE2 into interleaved partial histograms, consecutive samples go to different partial
+/// histograms so that increments of the same bin don't wait for each other. The partial histograms are merged after
+/// each waveform. The histogram starts over whenever the settings, the timebase or the gain change.
+class HistogramGenerator : public Processor {
+  public:
+    HistogramGenerator(const DsoSettingsScope *scope);
+    virtual void process(PPresult *result) override;
+
+    /// \brief Discard the accumulated values, takes effect with the next waveform.
+    void reset();
+    /// \return A copy of the accumulated histogram
+    ValueHistogram histogram() const;
+
+  private:
+    /// \brief Count the voltages of the samples.
+    void addVoltages(const double *samples, size_t count);
+    /// \brief Find the edges and count their times.
+    /// \param position Screen position of the first sample in divs.
+    /// \param step Horizontal distance of two samples in divs.
+    void addTimes(const double *samples, size_t count, double position, double step, double scale, double trigger);
+    /// \brief Count a single value.
+    void addValue(double value);
+    /// \brief Start over with the given range.
+    void clear(bool amplitude, double valueFirst, double valueLast, double first, double last);
+
+    const DsoSettingsScope *scope;
+
+    mutable QMutex mutex; ///< Guards the accumulated histogram
+    ValueHistogram accumulated;
+    std::vector<double> signature; ///< The settings the histogram was accumulated with
+    std::atomic<bool> resetRequested{false};
+
+    std::vector<uint32_t> partial; ///< Partial histograms of one waveform, each with an under- and overflow bin
+    double shift = 0.0;            ///< The first value, subtracted before summing up to keep the precision
+    double sum = 0.0;              ///< Sum of the values minus shift
+    double sumSquares = 0.0;       ///< Sum of the squared values minus shift
+};
@@ -0,0 +1,234 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QMutexLocker>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MASK_SSE2
+#endif
+
+#include "masktest.h"
+#include "ppresult.h"
+#include "scopesettings.h"
+#include "viewconstants.h"
+
+/// Number of columns the masks are rasterized into
+static const size_t MASK_COLUMNS = 1000;
+/// Width of a column in divs
+static const double COLUMN_WIDTH = DIVS_TIME / MASK_COLUMNS;
+/// Number of failing waveforms that are kept for the export, the oldest ones are dropped
+static const size_t MAX_FAILURES = 100;
+
+static const double INF = std::numeric_limits<double>::infinity();
+
+/// \return true if any sample is above high or below low.
+static bool outside(const double *samples, size_t count, double low, double high) {
+    size_t index = 0;
+#ifdef MASK_SSE2
+    const __m128d lowLimit = _mm_set1_pd(low);
+    const __m128d highLimit = _mm_set1_pd(high);
+    __m128d any = _mm_setzero_pd();
+    for (; index + 4 <= count; index += 4) {
+        const __m128d a = _mm_loadu_pd(samples + index);
+        const __m128d b = _mm_loadu_pd(samples + index + 2);
+        any = _mm_or_pd(any, _mm_or_pd(_mm_cmpgt_pd(a, highLimit), _mm_cmplt_pd(a, lowLimit)));
+        any = _mm_or_pd(any, _mm_or_pd(_mm_cmpgt_pd(b, highLimit), _mm_cmplt_pd(b, lowLimit)));
+    }
+    if (_mm_movemask_pd(any)) return true;
+#endif
+    for (; index < count; ++index)
+        if (samples[index] > high || samples[index] < low) return true;
+    return false;
+}
+
+MaskTest::MaskTest(const DsoSettingsScope *scope) : scope(scope) {
+    channelMasks.resize(scope->voltage.size());
+    for (ChannelID channel = 0; channel < scope->voltage.size(); ++channel) {
+        Mask &mask = channelMasks[channel];
+        mask.upperLine = scope->voltage[channel].maskUpper;
+        mask.lowerLine = scope->voltage[channel].maskLower;
+        rasterize(mask.upperLine, INF, mask.upper);
+        rasterize(mask.lowerLine, -INF, mask.lower);
+    }
+}
+
+void MaskTest::rasterize(const QPolygonF &line, double unlimited, std::vector<double> &table) {
+    table.assign(MASK_COLUMNS, unlimited);
+    if (line.isEmpty()) return;
+
+    int point = 0;
+    for (size_t column = 0; column < MASK_COLUMNS; ++column) {
+        const double x = (column + 0.5) * COLUMN_WIDTH - DIVS_TIME / 2;
+        if (x < line.first().x() || x > line.last().x()) continue;
+        while (point + 1 < line.size() && line[point + 1].x() < x) ++point;
+        if (point + 1 >= line.size()) {
+            table[column] = line[point].y();
+            continue;
+        }
+        const QPointF &a = line[point];
+        const QPointF &b = line[point + 1];
+        table[column] = b.x() > a.x() ? a.y() + (b.y() - a.y()) * (x - a.x()) / (b.x() - a.x()) : a.y();
+    }
+}
+
+void MaskTest::createMasks() { createRequested = true; }
+
+void MaskTest::clearMasks() {
+    QMutexLocker locker(&mutex);
+    for (Mask &mask : channelMasks) {
+        mask.upperLine.clear();
+        mask.lowerLine.clear();
+        rasterize(mask.upperLine, INF, mask.upper);
+        rasterize(mask.lowerLine, -INF, mask.lower);
+    }
+    ++maskVersion;
+}
+
+unsigned MaskTest::version() const {
+    QMutexLocker locker(&mutex);
+    return maskVersion;
+}
+
+std::vector<std::pair<QPolygonF, QPolygonF>> MaskTest::masks() const {
+    QMutexLocker locker(&mutex);
+    std::vector<std::pair<QPolygonF, QPolygonF>> lines;
+    for (const Mask &mask : channelMasks) lines.push_back(std::make_pair(mask.upperLine, mask.lowerLine));
+    return lines;
+}
+
+void MaskTest::reset() {
+    QMutexLocker locker(&mutex);
+    testedCount = 0;
+    failedCount = 0;
+    failures.clear();
+}
+
+unsigned MaskTest::failureCount() const {
+    QMutexLocker locker(&mutex);
+    return (unsigned)failures.size();
+}
+
+bool MaskTest::failure(unsigned index, Failure &failure) const {
+    QMutexLocker locker(&mutex);
+    if (index >= failures.size()) return false;
+    failure = failures[index];
+    return true;
+}
+
+void MaskTest::create(Mask &mask, const std::vector<double> &samples, double origin, double step, double gain,
+                      double offset, double invert) {
+    // Range of the waveform within each column, the line between two samples counts for all columns it crosses
+    std::vector<double> minimum(MASK_COLUMNS, INF);
+    std::vector<double> maximum(MASK_COLUMNS, -INF);
+    auto columnOf = [](double x) { return (long long)std::floor((x + DIVS_TIME / 2) / COLUMN_WIDTH); };
+    for (size_t index = 0; index + 1 < samples.size(); ++index) {
+        const double y0 = samples[index] / gain * invert + offset;
+        const double y1 = samples[index + 1] / gain * invert + offset;
+        const long long first = std::max(columnOf(origin + index * step), 0ll);
+        const long long last = std::min(columnOf(origin + (index + 1) * step), (long long)MASK_COLUMNS - 1);
+        for (long long column = first; column <= last; ++column) {
+            minimum[(size_t)column] = std::min(minimum[(size_t)column], std::min(y0, y1));
+            maximum[(size_t)column] = std::max(maximum[(size_t)column], std::max(y0, y1));
+        }
+    }
+
+    // Widen by the tolerances
+    const long long reach = (long long)std::lround(scope->mask.toleranceX / COLUMN_WIDTH);
+    mask.upperLine.clear();
+    mask.lowerLine.clear();
+    for (long long column = 0; column < (long long)MASK_COLUMNS; ++column) {
+        double low = INF;
+        double high = -INF;
+        for (long long neighbour = std::max(column - reach, 0ll);
+             neighbour <= std::min(column + reach, (long long)MASK_COLUMNS - 1); ++neighbour) {
+            low = std::min(low, minimum[(size_t)neighbour]);
+            high = std::max(high, maximum[(size_t)neighbour]);
+        }
+        if (low > high) continue;
+        const double x = (column + 0.5) * COLUMN_WIDTH - DIVS_TIME / 2;
+        mask.upperLine << QPointF(x, high + scope->mask.toleranceY);
+        mask.lowerLine << QPointF(x, low - scope->mask.toleranceY);
+    }
+    rasterize(mask.upperLine, INF, mask.upper);
+    rasterize(mask.lowerLine, -INF, mask.lower);
+}
+
+bool MaskTest::test(const Mask &mask, const std::vector<double> &samples, double origin, double step, double gain,
+                    double offset, double invert) const {
+    const double count = (double)samples.size();
+    for (size_t column = 0; column < MASK_COLUMNS; ++column) {
+        const double upper = mask.upper[column];
+        const double lower = mask.lower[column];
+        if (std::isinf(upper) && std::isinf(lower) && upper > lower) continue;
+
+        // The samples drawn within this column
+        const double left = column * COLUMN_WIDTH - DIVS_TIME / 2;
+        const double first = std::min(std::max(std::ceil((left - origin) / step), 0.0), count);
+        const double end = std::min(std::max(std::ceil((left + COLUMN_WIDTH - origin) / step), 0.0), count);
+        if (end <= first) continue;
+
+        // Convert the limits to volts instead of converting the samples
+        const double a = (upper - offset) * gain * invert;
+        const double b = (lower - offset) * gain * invert;
+        if (outside(samples.data() + (size_t)first, (size_t)(end - first), std::min(a, b), std::max(a, b)))
+            return false;
+    }
+    return true;
+}
+
+void MaskTest::process(PPresult *result) {
+    const bool creating = createRequested.exchange(false);
+    if ((!scope->mask.enabled && !creating) || result->append || result->graphScale <= 0.0) return;
+
+    QMutexLocker locker(&mutex);
+    if (channelMasks.size() < result->channelCount()) channelMasks.resize(result->channelCount());
+
+    bool tested = false;
+    bool passed = true;
+    for (ChannelID channel = 0; channel < result->channelCount() && channel < scope->voltage.size(); ++channel) {
+        const SampleValues &voltage = result->data(channel)->voltage;
+        if (!scope->voltage[channel].used || voltage.sample.empty()) continue;
+
+        const double step = voltage.interval * result->graphScale;
+        const double gain = scope->gain(channel);
+        const double offset = scope->voltage[channel].offset;
+        const double invert = scope->voltage[channel].inverted ? -1.0 : 1.0;
+        Mask &mask = channelMasks[channel];
+        if (creating) {
+            create(mask, voltage.sample, result->graphOrigin, step, gain, offset, invert);
+            continue;
+        }
+        if (mask.upperLine.isEmpty() && mask.lowerLine.isEmpty()) continue;
+
+        tested = true;
+        if (!test(mask, voltage.sample, result->graphOrigin, step, gain, offset, invert)) passed = false;
+    }
+
+    if (creating) {
+        ++maskVersion;
+        return;
+    }
+    if (!tested) return;
+
+    const unsigned long long number = ++testedCount;
+    if (passed) return;
+    ++failedCount;
+
+    if (scope->mask.saveFailures) {
+        Failure failure;
+        failure.number = number;
+        failure.samples.resize(result->channelCount());
+        for (ChannelID channel = 0; channel < result->channelCount(); ++channel) {
+            if (channel >= scope->voltage.size() || !scope->voltage[channel].used) continue;
+            failure.samples[channel] = result->data(channel)->voltage.sample;
+            failure.interval = result->data(channel)->voltage.interval;
+        }
+        failures.push_back(std::move(failure));
+        if (failures.size() > MAX_FAILURES) failures.pop_front();
+    }
+    if (scope->mask.stopOnFailure) emit stopRequested();
+}
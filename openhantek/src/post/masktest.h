@@ -0,0 +1,90 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QMutex>
+#include <QObject>
+#include <QPolygonF>
+
+#include <atomic>
+#include <deque>
+#include <vector>
+
+#include "processor.h"
+
+struct DsoSettingsScope;
+
+/// \brief Tests every waveform against the masks of the channels and counts passed and failed waveforms.
+/// The upper and lower limit lines of a mask are rasterized into one limit pair per screen column. The test
+/// converts the limits of a column into volts and compares the samples of that column with SSE2, so the cost is
+/// one compare per sample no matter how detailed the mask is. Waveforms are tested in screen coordinates as drawn
+/// by the GraphGenerator, samples outside the screen are not tested. Roll mode blocks are not tested.
+///
+/// The masks are owned by this class and copied into the settings by the GUI, see version() and masks().
+class MaskTest : public QObject, public Processor {
+    Q_OBJECT
+
+  public:
+    /// \brief A failing waveform kept for the export.
+    struct Failure {
+        unsigned long long number = 0;            ///< Number of the waveform since the last reset, starting with 1
+        double interval = 0.0;                    ///< Time between two samples
+        std::vector<std::vector<double>> samples; ///< Voltages of the tested channels, empty for the others
+    };
+
+    /// \param scope The settings, the masks of the channels are loaded once.
+    MaskTest(const DsoSettingsScope *scope);
+    virtual void process(PPresult *result) override;
+
+    /// \brief Create the masks of all used channels from the next waveform, widened by the tolerances.
+    void createMasks();
+    /// \brief Remove the masks of all channels.
+    void clearMasks();
+    /// \return A number that changes whenever the masks change
+    unsigned version() const;
+    /// \return The upper and lower limit lines of each channel
+    std::vector<std::pair<QPolygonF, QPolygonF>> masks() const;
+
+    /// \brief Reset the counters and discard the kept failures.
+    void reset();
+    inline unsigned long long tested() const { return testedCount; }
+    inline unsigned long long failed() const { return failedCount; }
+    /// \return The number of kept failing waveforms
+    unsigned failureCount() const;
+    /// \brief Copy a kept failing waveform, index 0 is the oldest one.
+    /// \return false if the index is out of range.
+    bool failure(unsigned index, Failure &failure) const;
+
+  signals:
+    /// \brief A waveform failed and the acquisition should stop. Emitted in the post processing thread.
+    void stopRequested();
+
+  private:
+    /// \brief The limits of each column in divs, infinite if there is no limit.
+    struct Mask {
+        std::vector<double> upper;
+        std::vector<double> lower;
+        QPolygonF upperLine;
+        QPolygonF lowerLine;
+    };
+
+    /// \brief Compute the limit of each column by linear interpolation of the line.
+    static void rasterize(const QPolygonF &line, double unlimited, std::vector<double> &table);
+    /// \brief Create the mask of a channel from its waveform.
+    void create(Mask &mask, const std::vector<double> &samples, double origin, double step, double gain,
+                double offset, double invert);
+    /// \return true if all samples on the screen are within the mask.
+    bool test(const Mask &mask, const std::vector<double> &samples, double origin, double step, double gain,
+              double offset, double invert) const;
+
+    const DsoSettingsScope *scope;
+
+    mutable QMutex mutex;       ///< Guards the masks and the failures
+    std::vector<Mask> channelMasks;
+    unsigned maskVersion = 0;
+    std::deque<Failure> failures;
+
+    std::atomic<bool> createRequested{false};
+    std::atomic<unsigned long long> testedCount{0};
+    std::atomic<unsigned long long> failedCount{0};
+};
@@ -1,47 +1,72 @@
+#include <QDebug>
+#include <QMutexLocker>
+#include <algorithm>
+
 #include "mathchannelgenerator.h"
 #include "scopesettings.h"
-#include "post/postprocessingsettings.h"
-#include "enums.h"
+#include "post/ppresult.h"
 
 MathChannelGenerator::MathChannelGenerator(const DsoSettingsScope *scope, unsigned physicalChannels)
-    : physicalChannels(physicalChannels), scope(scope) {}
+    : physicalChannels(physicalChannels), scope(scope) {
+    for (ChannelID channel = physicalChannels; channel < scope->voltage.size(); ++channel)
+        expressions.push_back(scope->voltage[channel].mathExpression);
+}
 
 MathChannelGenerator::~MathChannelGenerator() {}
 
+void MathChannelGenerator::setExpression(ChannelID channel, const QString &expression) {
+    QMutexLocker locker(&mutex);
+    if (channel < physicalChannels || channel - physicalChannels >= expressions.size()) return;
+    expressions[channel - physicalChannels] = expression;
+}
+
+QString MathChannelGenerator::expression(ChannelID channel) const {
+    QMutexLocker locker(&mutex);
+    if (channel < physicalChannels || channel - physicalChannels >= expressions.size()) return QString();
+    return expressions[channel - physicalChannels];
+}
+
 void MathChannelGenerator::process(PPresult *result) {
-    bool channelsHaveData = !result->data(0)->voltage.sample.empty() && !result->data(1)->voltage.sample.empty();
-    if (!channelsHaveData) return;
+    if (result->channelCount() > physicalChannels) mathChannels.resize(result->channelCount() - physicalChannels);
+    inputs.resize(result->channelCount());
 
-    for (ChannelID channel = physicalChannels; channel < result->channelCount(); ++channel) {
+    // Channels of other devices follow the math channels, see SampleMerger
+    for (ChannelID channel = physicalChannels; channel < result->channelCount() && channel < scope->voltage.size();
+         ++channel) {
         DataChannel *const channelData = result->modifyData(channel);
+        MathChannel &math = mathChannels[channel - physicalChannels];
 
         // Math channel enabled?
         if (!scope->voltage[channel].used && !scope->spectrum[channel].used) continue;
 
-        // Set sampling interval
-        channelData->voltage.interval = result->data(0)->voltage.interval;
+        const QString text = expression(channel);
+        if (math.text != text) {
+            math.text = text;
+            QStringList names;
+            for (ChannelID input = 0; input < channel; ++input) names << scope->voltage[input].name;
+            if (!math.expression.compile(math.text, names))
+                qWarning() << scope->voltage[channel].name << ":" << math.expression.error();
+        }
 
-        // Resize the sample vector
         std::vector<double> &resultData = channelData->voltage.sample;
-        resultData.resize(std::min(result->data(0)->voltage.sample.size(), result->data(1)->voltage.sample.size()));
-
-        // Calculate values and write them into the sample buffer
-        std::vector<double>::const_iterator ch1Iterator = result->data(0)->voltage.sample.begin();
-        std::vector<double>::const_iterator ch2Iterator = result->data(1)->voltage.sample.begin();
-        for (std::vector<double>::iterator it = resultData.begin(); it != resultData.end(); ++it) {
-            switch (Dso::getMathMode(scope->voltage[physicalChannels])) {
-            case Dso::MathMode::ADD_CH1_CH2:
-                *it = *ch1Iterator + *ch2Iterator;
-                break;
-            case Dso::MathMode::SUB_CH2_FROM_CH1:
-                *it = *ch1Iterator - *ch2Iterator;
-                break;
-            case Dso::MathMode::SUB_CH1_FROM_CH2:
-                *it = *ch2Iterator - *ch1Iterator;
-                break;
-            }
-            ++ch1Iterator;
-            ++ch2Iterator;
+        if (!math.expression.isValid()) {
+            resultData.clear();
+            continue;
+        }
+
+        // The result is as long as the shortest input
+        const std::vector<ChannelID> &used = math.expression.inputs();
+        const ChannelID timebase = used.empty() ? 0 : used.front();
+        size_t count = result->data(timebase)->voltage.sample.size();
+        for (ChannelID input : used) {
+            count = std::min(count, result->data(input)->voltage.sample.size());
+            inputs[input] = result->data(input)->voltage.sample.data();
         }
+
+        // Set sampling interval
+        channelData->voltage.interval = result->data(timebase)->voltage.interval;
+
+        resultData.resize(count);
+        math.expression.evaluate(inputs, count, channelData->voltage.interval, result->append, resultData.data());
     }
 }
@@ -2,18 +2,42 @@
 
 #pragma once
 
+#include <QMutex>
+#include <QString>
+#include <vector>
+
+#include "mathexpression.h"
 #include "processor.h"
 
 struct DsoSettingsScope;
 class PPresult;
 
+/// \brief Computes the math channels from their expressions, see MathExpression.
+/// An expression is compiled again whenever its text changes. A math channel may read all physical channels and
+/// the math channels before it.
+///
+/// The expressions are copied from the settings once, the GUI hands over changed expressions with setExpression().
 class MathChannelGenerator : public Processor
 {
 public:
     MathChannelGenerator(const DsoSettingsScope *scope, unsigned physicalChannels);
     virtual ~MathChannelGenerator();
     virtual void process(PPresult *) override;
+
+    /// \brief Use a new expression for a math channel. Called by the GUI thread.
+    void setExpression(ChannelID channel, const QString &expression);
+    /// \return A copy of the expression of a math channel, empty for other channels
+    QString expression(ChannelID channel) const;
 private:
+    struct MathChannel {
+        QString text;              ///< The compiled expression text
+        MathExpression expression;
+    };
+
     const unsigned physicalChannels;
     const DsoSettingsScope *scope;
+    std::vector<MathChannel> mathChannels;  ///< Indexed by channel - physicalChannels
+    mutable QMutex mutex;                   ///< Guards the expressions
+    std::vector<QString> expressions;       ///< The expressions set by the GUI, indexed by channel - physicalChannels
+    std::vector<const double *> inputs;     ///< Sample pointers of all channels, reused for every result
 };
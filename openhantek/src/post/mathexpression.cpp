@@ -0,0 +1,341 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QCoreApplication>
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+#include "mathexpression.h"
+
+/// Samples per register block, 8 KiB per register keeps a handful of them in the L1 cache
+static const size_t BLOCK_SIZE = 1024;
+/// Target of the last instruction
+static const unsigned OUTPUT = UINT_MAX;
+
+/// \brief Recursive descent parser that emits the instructions while it parses.
+/// Every rule gets the first free register and returns the operand that holds its value. A binary operation
+/// evaluates its right side above the register of the left side and stores the result in the lower one, so the
+/// number of registers is the nesting depth of the expression.
+class MathExpression::Parser {
+  public:
+    Parser(MathExpression &expression, const QString &text, const QStringList &names)
+        : expression(expression), text(text), names(names) {}
+
+    bool run() {
+        expression.result = parseSum(0);
+        skipSpaces();
+        if (failed) return false;
+        if (position < text.size()) return fail(QCoreApplication::tr("Unexpected '%1'").arg(text[position]));
+        return true;
+    }
+
+  private:
+    MathExpression &expression;
+    const QString &text;
+    const QStringList &names;
+    int position = 0;
+    bool failed = false;
+
+    bool fail(const QString &message) {
+        if (!failed) expression.errorMessage = message;
+        failed = true;
+        return false;
+    }
+
+    void skipSpaces() {
+        while (position < text.size() && text[position].isSpace()) ++position;
+    }
+
+    bool accept(QChar c) {
+        skipSpaces();
+        if (position >= text.size() || text[position] != c) return false;
+        ++position;
+        return true;
+    }
+
+    Operand registerOperand(unsigned index) {
+        Operand operand;
+        operand.kind = Operand::REGISTER;
+        operand.index = index;
+        expression.registerCount = std::max(expression.registerCount, index + 1);
+        return operand;
+    }
+
+    Operand constant(double value) {
+        Operand operand;
+        operand.value = value;
+        return operand;
+    }
+
+    Operand instruction(Op op, const Operand &a, const Operand &b, unsigned target) {
+        Instruction instruction;
+        instruction.op = op;
+        instruction.a = a;
+        instruction.b = b;
+        instruction.target = target;
+        instruction.state = op == Op::DIFF ? NAN : 0.0;
+        expression.code.push_back(instruction);
+        return registerOperand(target);
+    }
+
+    Operand binary(Op op, const Operand &a, const Operand &b, unsigned target) {
+        if (a.kind == Operand::CONSTANT && b.kind == Operand::CONSTANT) {
+            switch (op) {
+            case Op::ADD: return constant(a.value + b.value);
+            case Op::SUB: return constant(a.value - b.value);
+            case Op::MUL: return constant(a.value * b.value);
+            case Op::DIV: return constant(a.value / b.value);
+            default: break;
+            }
+        }
+        return instruction(op, a, b, target);
+    }
+
+    Operand unary(Op op, const Operand &a, unsigned target) {
+        if (a.kind == Operand::CONSTANT) {
+            switch (op) {
+            case Op::NEG: return constant(-a.value);
+            case Op::ABS: return constant(std::fabs(a.value));
+            case Op::SQRT: return constant(std::sqrt(a.value));
+            default: break;
+            }
+        }
+        return instruction(op, a, Operand(), target);
+    }
+
+    /// sum = product { ("+" | "-") product }
+    Operand parseSum(unsigned target) {
+        Operand a = parseProduct(target);
+        while (!failed) {
+            Op op;
+            if (accept('+'))
+                op = Op::ADD;
+            else if (accept('-'))
+                op = Op::SUB;
+            else
+                break;
+            Operand b = parseProduct(target + (a.kind == Operand::REGISTER ? 1 : 0));
+            a = binary(op, a, b, target);
+        }
+        return a;
+    }
+
+    /// product = sign { ("*" | "/") sign }
+    Operand parseProduct(unsigned target) {
+        Operand a = parseSign(target);
+        while (!failed) {
+            Op op;
+            if (accept('*'))
+                op = Op::MUL;
+            else if (accept('/'))
+                op = Op::DIV;
+            else
+                break;
+            Operand b = parseSign(target + (a.kind == Operand::REGISTER ? 1 : 0));
+            a = binary(op, a, b, target);
+        }
+        return a;
+    }
+
+    /// sign = ("-" | "+") sign | primary
+    Operand parseSign(unsigned target) {
+        if (accept('-')) return unary(Op::NEG, parseSign(target), target);
+        if (accept('+')) return parseSign(target);
+        return parsePrimary(target);
+    }
+
+    /// primary = number | channel | function "(" sum ")" | "(" sum ")"
+    Operand parsePrimary(unsigned target) {
+        skipSpaces();
+        if (position >= text.size()) {
+            fail(QCoreApplication::tr("Incomplete expression"));
+            return Operand();
+        }
+
+        if (accept('(')) {
+            Operand a = parseSum(target);
+            if (!failed && !accept(')')) fail(QCoreApplication::tr("Missing ')'"));
+            return a;
+        }
+
+        const int start = position;
+        if (text[position].isDigit() || text[position] == '.') {
+            while (position < text.size() && (text[position].isDigit() || text[position] == '.')) ++position;
+            // Exponent
+            if (position < text.size() && (text[position] == 'e' || text[position] == 'E')) {
+                int end = position + 1;
+                if (end < text.size() && (text[end] == '+' || text[end] == '-')) ++end;
+                if (end < text.size() && text[end].isDigit()) {
+                    position = end;
+                    while (position < text.size() && text[position].isDigit()) ++position;
+                }
+            }
+            bool ok;
+            const double value = text.mid(start, position - start).toDouble(&ok);
+            if (!ok) fail(QCoreApplication::tr("Invalid number '%1'").arg(text.mid(start, position - start)));
+            return constant(value);
+        }
+
+        while (position < text.size() && (text[position].isLetterOrNumber() || text[position] == '_')) ++position;
+        const QString name = text.mid(start, position - start);
+        if (name.isEmpty()) {
+            fail(QCoreApplication::tr("Unexpected '%1'").arg(text[position]));
+            return Operand();
+        }
+
+        for (ChannelID channel = 0; channel < (ChannelID)names.size(); ++channel) {
+            if (name.compare(names[(int)channel], Qt::CaseInsensitive) != 0) continue;
+            if (std::find(expression.channels.begin(), expression.channels.end(), channel) ==
+                expression.channels.end())
+                expression.channels.push_back(channel);
+            Operand operand;
+            operand.kind = Operand::CHANNEL;
+            operand.index = channel;
+            return operand;
+        }
+
+        Op op;
+        const QString function = name.toLower();
+        if (function == "abs")
+            op = Op::ABS;
+        else if (function == "sqrt")
+            op = Op::SQRT;
+        else if (function == "integrate")
+            op = Op::INTEGRATE;
+        else if (function == "diff")
+            op = Op::DIFF;
+        else {
+            fail(QCoreApplication::tr("Unknown channel or function '%1'").arg(name));
+            return Operand();
+        }
+        if (!accept('(')) {
+            fail(QCoreApplication::tr("Missing '(' after '%1'").arg(name));
+            return Operand();
+        }
+        Operand a = parseSum(target);
+        if (!failed && !accept(')')) fail(QCoreApplication::tr("Missing ')'"));
+        return unary(op, a, target);
+    }
+};
+
+bool MathExpression::compile(const QString &text, const QStringList &names) {
+    channels.clear();
+    code.clear();
+    registerCount = 0;
+    errorMessage.clear();
+
+    if (text.trimmed().isEmpty()) {
+        errorMessage = QCoreApplication::tr("Empty expression");
+        valid = false;
+        return false;
+    }
+
+    valid = Parser(*this, text, names).run();
+    if (!valid) {
+        channels.clear();
+        code.clear();
+        return false;
+    }
+    if (!code.empty()) code.back().target = OUTPUT;
+    registers.resize(registerCount * BLOCK_SIZE);
+    return true;
+}
+
+/// \brief Apply a binary operation, one of the operands may be a constant (null pointer).
+template <class F>
+static inline void binaryOp(double *target, const double *a, double constantA, const double *b, double constantB,
+                            size_t count, F f) {
+    if (!a) {
+        for (size_t i = 0; i < count; ++i) target[i] = f(constantA, b[i]);
+    } else if (!b) {
+        for (size_t i = 0; i < count; ++i) target[i] = f(a[i], constantB);
+    } else {
+        for (size_t i = 0; i < count; ++i) target[i] = f(a[i], b[i]);
+    }
+}
+
+template <class F> static inline void unaryOp(double *target, const double *a, size_t count, F f) {
+    for (size_t i = 0; i < count; ++i) target[i] = f(a[i]);
+}
+
+void MathExpression::evaluate(const std::vector<const double *> &inputs, size_t count, double interval,
+                              bool continued, double *out) {
+    if (!valid) return;
+
+    if (code.empty()) {
+        if (result.kind == Operand::CHANNEL)
+            std::copy(inputs[result.index], inputs[result.index] + count, out);
+        else
+            std::fill(out, out + count, result.value);
+        return;
+    }
+
+    if (!continued) {
+        for (Instruction &instruction : code) instruction.state = instruction.op == Op::DIFF ? NAN : 0.0;
+    }
+
+    for (size_t offset = 0; offset < count; offset += BLOCK_SIZE) {
+        const size_t length = std::min(BLOCK_SIZE, count - offset);
+        auto source = [&](const Operand &operand) -> const double * {
+            switch (operand.kind) {
+            case Operand::REGISTER: return &registers[operand.index * BLOCK_SIZE];
+            case Operand::CHANNEL: return inputs[operand.index] + offset;
+            case Operand::CONSTANT: break;
+            }
+            return nullptr;
+        };
+
+        for (Instruction &instruction : code) {
+            double *target = instruction.target == OUTPUT ? out + offset : &registers[instruction.target * BLOCK_SIZE];
+            const double *a = source(instruction.a);
+            const double *b = source(instruction.b);
+            // Only integrate and diff of a constant are not folded by the compiler
+            if (!a && instruction.op != Op::ADD && instruction.op != Op::SUB && instruction.op != Op::MUL &&
+                instruction.op != Op::DIV) {
+                std::fill(target, target + length, instruction.a.value);
+                a = target;
+            }
+
+            switch (instruction.op) {
+            case Op::ADD:
+                binaryOp(target, a, instruction.a.value, b, instruction.b.value, length,
+                         [](double x, double y) { return x + y; });
+                break;
+            case Op::SUB:
+                binaryOp(target, a, instruction.a.value, b, instruction.b.value, length,
+                         [](double x, double y) { return x - y; });
+                break;
+            case Op::MUL:
+                binaryOp(target, a, instruction.a.value, b, instruction.b.value, length,
+                         [](double x, double y) { return x * y; });
+                break;
+            case Op::DIV:
+                binaryOp(target, a, instruction.a.value, b, instruction.b.value, length,
+                         [](double x, double y) { return x / y; });
+                break;
+            case Op::NEG: unaryOp(target, a, length, [](double x) { return -x; }); break;
+            case Op::ABS: unaryOp(target, a, length, [](double x) { return std::fabs(x); }); break;
+            case Op::SQRT: unaryOp(target, a, length, [](double x) { return std::sqrt(x); }); break;
+            case Op::INTEGRATE: {
+                double sum = instruction.state;
+                for (size_t i = 0; i < length; ++i) {
+                    sum += a[i] * interval;
+                    target[i] = sum;
+                }
+                instruction.state = sum;
+                break;
+            }
+            case Op::DIFF: {
+                double previous = std::isnan(instruction.state) ? a[0] : instruction.state;
+                for (size_t i = 0; i < length; ++i) {
+                    const double value = a[i];
+                    target[i] = (value - previous) / interval;
+                    previous = value;
+                }
+                instruction.state = previous;
+                break;
+            }
+            }
+        }
+    }
+}
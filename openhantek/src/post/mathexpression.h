@@ -0,0 +1,73 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <stddef.h>
+#include <vector>
+
+#include "hantekprotocol/types.h"
+
+/// \brief A math channel expression, compiled once and evaluated block by block.
+/// Expressions combine channels, numbers and functions with the usual precedence, e.g. `(CH1 - CH3) * CH2`,
+/// `abs(CH1)`, `integrate(CH2)` or `CH1 * CH1 / 50`. Channel and function names are case insensitive. Functions:
+/// abs, sqrt, integrate (running integral over time in Vs) and diff (derivative in V/s).
+///
+/// Compiling turns the expression into a short list of vector instructions. Constant subexpressions are folded,
+/// channels and constants are read in place and the last instruction writes to the output directly. Intermediate
+/// results live in a few register blocks that are small enough to stay in the cache, so no full length temporaries
+/// are needed no matter how complex the expression is.
+class MathExpression {
+  public:
+    /// \brief Compile an expression.
+    /// \param text The expression.
+    /// \param names The names of the channels the expression may read, the index is the ChannelID.
+    /// \return false on a syntax error, see error().
+    bool compile(const QString &text, const QStringList &names);
+
+    inline bool isValid() const { return valid; }
+    /// \return A description of the last syntax error
+    inline const QString &error() const { return errorMessage; }
+    /// \return The channels read by the expression, each listed once
+    inline const std::vector<ChannelID> &inputs() const { return channels; }
+
+    /// \brief Evaluate the compiled expression.
+    /// \param inputs The samples of the channels, indexed by ChannelID. Only the inputs() have to be valid and hold
+    /// at least `count` samples.
+    /// \param count The number of samples to compute.
+    /// \param interval The time between two samples in s, used by integrate and diff.
+    /// \param continued The samples continue the ones of the previous call (roll mode), integrate and diff keep
+    /// their state instead of starting over.
+    /// \param out Receives `count` results.
+    void evaluate(const std::vector<const double *> &inputs, size_t count, double interval, bool continued,
+                  double *out);
+
+  private:
+    enum class Op { ADD, SUB, MUL, DIV, NEG, ABS, SQRT, INTEGRATE, DIFF };
+
+    struct Operand {
+        enum Kind { REGISTER, CHANNEL, CONSTANT } kind = CONSTANT;
+        unsigned index = 0; ///< Register or channel
+        double value = 0.0; ///< Constant
+    };
+
+    struct Instruction {
+        Op op;
+        Operand a;
+        Operand b;          ///< Unused by functions and negation
+        unsigned target;    ///< Register that receives the result, OUTPUT for the last instruction
+        double state = 0.0; ///< Running sum of integrate, previous sample of diff
+    };
+
+    class Parser;
+    friend class Parser;
+
+    bool valid = false;
+    QString errorMessage;
+    std::vector<ChannelID> channels;
+    std::vector<Instruction> code;
+    Operand result;                ///< The value of the whole expression, if there are no instructions
+    unsigned registerCount = 0;
+    std::vector<double> registers; ///< registerCount blocks of samples
+};
@@ -0,0 +1,155 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <algorithm>
+#include <cmath>
+
+#include "measurementgenerator.h"
+
+#include "post/ppresult.h"
+#include "scopesettings.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MEASUREMENT_SSE2
+#endif
+
+/// \brief Gather minimum, maximum, sum and sum of squares in one pass.
+static void statistics(const double *samples, size_t count, double &minimum, double &maximum, double &sum,
+                       double &sumSquares) {
+    size_t position = 0;
+    minimum = maximum = samples[0];
+    sum = sumSquares = 0.0;
+#ifdef MEASUREMENT_SSE2
+    // Four samples per iteration in two independent accumulator chains
+    if (count >= 4) {
+        __m128d vMinimum = _mm_set1_pd(samples[0]);
+        __m128d vMaximum = vMinimum;
+        __m128d vSum0 = _mm_setzero_pd(), vSum1 = _mm_setzero_pd();
+        __m128d vSquares0 = _mm_setzero_pd(), vSquares1 = _mm_setzero_pd();
+        for (; position + 4 <= count; position += 4) {
+            const __m128d a = _mm_loadu_pd(samples + position);
+            const __m128d b = _mm_loadu_pd(samples + position + 2);
+            vMinimum = _mm_min_pd(vMinimum, _mm_min_pd(a, b));
+            vMaximum = _mm_max_pd(vMaximum, _mm_max_pd(a, b));
+            vSum0 = _mm_add_pd(vSum0, a);
+            vSum1 = _mm_add_pd(vSum1, b);
+            vSquares0 = _mm_add_pd(vSquares0, _mm_mul_pd(a, a));
+            vSquares1 = _mm_add_pd(vSquares1, _mm_mul_pd(b, b));
+        }
+        double lanes[2];
+        _mm_storeu_pd(lanes, vMinimum);
+        minimum = std::min(lanes[0], lanes[1]);
+        _mm_storeu_pd(lanes, vMaximum);
+        maximum = std::max(lanes[0], lanes[1]);
+        _mm_storeu_pd(lanes, _mm_add_pd(vSum0, vSum1));
+        sum = lanes[0] + lanes[1];
+        _mm_storeu_pd(lanes, _mm_add_pd(vSquares0, vSquares1));
+        sumSquares = lanes[0] + lanes[1];
+    }
+#endif
+    for (; position < count; ++position) {
+        const double value = samples[position];
+        minimum = std::min(minimum, value);
+        maximum = std::max(maximum, value);
+        sum += value;
+        sumSquares += value * value;
+    }
+}
+
+MeasurementGenerator::MeasurementGenerator(const DsoSettingsScope *scope) : scope(scope) {}
+
+void MeasurementGenerator::process(PPresult *result) {
+    for (ChannelID channel = 0; channel < result->channelCount(); ++channel) {
+        DataChannel *const channelData = result->modifyData(channel);
+        channelData->measurements = Measurements();
+        const std::vector<double> &samples = channelData->voltage.sample;
+        if (channel >= scope->voltage.size() || !scope->voltage[channel].used || samples.empty()) continue;
+        measure(samples.data(), samples.size(), channelData->voltage.interval, channelData->measurements);
+    }
+}
+
+void MeasurementGenerator::measure(const double *samples, size_t count, double interval, Measurements &result) {
+    result = Measurements();
+    if (!count) return;
+
+    double sum, sumSquares;
+    statistics(samples, count, result.minimum, result.maximum, sum, sumSquares);
+    result.amplitude = result.maximum - result.minimum;
+    result.mean = sum / count;
+    result.rms = std::sqrt(sumSquares / count);
+    result.acRms = std::sqrt(std::max(sumSquares / count - result.mean * result.mean, 0.0));
+    if (!(result.amplitude > 0.0)) return;
+
+    // The signal has to pass the low and the high level to make an edge, which also acts as hysteresis
+    const double low = result.minimum + 0.1 * result.amplitude;
+    const double middle = result.minimum + 0.5 * result.amplitude;
+    const double high = result.minimum + 0.9 * result.amplitude;
+
+    enum class State { UNKNOWN, LOW, HIGH } state = State::UNKNOWN;
+    double lowCrossing = NAN, middleCrossing = NAN, highCrossing = NAN;
+    double lastRising = NAN, highTime = NAN;
+    unsigned risingEdges = 0, rises = 0, falls = 0;
+    double riseSum = 0.0, fallSum = 0.0, highSum = 0.0, cycleSum = 0.0;
+    counter.reset();
+
+    for (size_t position = 1; position < count; ++position) {
+        const double previous = samples[position - 1];
+        const double value = samples[position];
+        // Interpolated position where the signal crosses the level
+        auto crossing = [&](double level) { return (position - 1) + (level - previous) / (value - previous); };
+
+        switch (state) {
+        case State::UNKNOWN:
+            if (value <= low)
+                state = State::LOW;
+            else if (value >= high)
+                state = State::HIGH;
+            break;
+        case State::LOW:
+            if (previous < low && value >= low) lowCrossing = crossing(low);
+            if (previous < middle && value >= middle) middleCrossing = crossing(middle);
+            if (value < high) break;
+
+            // Rising edge completed
+            highCrossing = crossing(high);
+            if (!std::isnan(lowCrossing)) {
+                riseSum += highCrossing - lowCrossing;
+                ++rises;
+            }
+            if (risingEdges && !std::isnan(highTime)) {
+                highSum += highTime;
+                cycleSum += middleCrossing - lastRising;
+            }
+            lastRising = middleCrossing;
+            if (!std::isnan(middleCrossing)) counter.addEdge(middleCrossing);
+            ++risingEdges;
+            highTime = NAN;
+            lowCrossing = middleCrossing = NAN;
+            state = State::HIGH;
+            break;
+        case State::HIGH:
+            if (previous > high && value <= high) highCrossing = crossing(high);
+            if (previous > middle && value <= middle) middleCrossing = crossing(middle);
+            if (value > low) break;
+
+            // Falling edge completed
+            lowCrossing = crossing(low);
+            if (!std::isnan(highCrossing)) {
+                fallSum += lowCrossing - highCrossing;
+                ++falls;
+            }
+            if (risingEdges) highTime = middleCrossing - lastRising;
+            highCrossing = middleCrossing = NAN;
+            state = State::LOW;
+            break;
+        }
+    }
+
+    // The 50 % crossings of the rising edges make the reciprocal frequency counter
+    const FrequencyCounter::Result frequency = counter.measure(interval);
+    result.period = frequency.period;
+    result.frequency = frequency.frequency;
+    if (cycleSum > 0.0) result.dutyCycle = highSum / cycleSum;
+    if (rises) result.riseTime = riseSum / rises * interval;
+    if (falls) result.fallTime = fallSum / falls * interval;
+}
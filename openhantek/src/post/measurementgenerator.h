@@ -0,0 +1,34 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <vector>
+
+#include "frequencycounter.h"
+#include "processor.h"
+
+struct DsoSettingsScope;
+class PPresult;
+struct Measurements;
+
+/// \brief Computes the Measurements of all used voltage channels.
+/// The sample statistics (min/max, mean, RMS) are gathered by one vectorized pass. A second pass runs a
+/// state machine over the 10 %, 50 % and 90 % levels and derives the duty cycle and rise/fall time from the
+/// same crossings. Its 50 % crossings of the rising edges feed the FrequencyCounter for period and frequency.
+/// Further measurements are added to these passes.
+class MeasurementGenerator : public Processor {
+  public:
+    MeasurementGenerator(const DsoSettingsScope *scope);
+    virtual void process(PPresult *result) override;
+
+    /// \brief Measure a record.
+    /// \param samples The voltage samples.
+    /// \param count The number of samples.
+    /// \param interval The time between two samples in s.
+    /// \param result Receives the measured values.
+    void measure(const double *samples, size_t count, double interval, Measurements &result);
+
+  private:
+    const DsoSettingsScope *scope;
+    FrequencyCounter counter;
+};
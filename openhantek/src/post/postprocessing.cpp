@@ -1,13 +1,21 @@
 #include "postprocessing.h"
+#include "utils/metrics.h"
 
 PostProcessing::PostProcessing(unsigned channelCount) : channelCount(channelCount) {
     qRegisterMetaType<std::shared_ptr<PPresult>>();
+    totalTime = Metrics::Registry::get()->histogram("post.total");
+    droppedSets = Metrics::Registry::get()->counter("post.dropped");
 }
 
-void PostProcessing::registerProcessor(Processor *processor) { processors.push_back(processor); }
+void PostProcessing::registerProcessor(Processor *processor, const QString &name) {
+    processors.push_back(processor);
+    processorTimes.push_back(Metrics::Registry::get()->histogram(
+        "post." + (name.isEmpty() ? QString("processor%1").arg(processors.size()) : name)));
+}
 
-void PostProcessing::convertData(const DSOsamples *source, PPresult *destination) {
+unsigned long long PostProcessing::convertData(const DSOsamples *source, PPresult *destination) {
     QReadLocker locker(&source->lock);
+    destination->append = source->append;
 
     for (ChannelID channel = 0; channel < source->data.size(); ++channel) {
         const std::vector<double> &rawChannelData = source->data.at(channel);
@@ -18,12 +26,20 @@ void PostProcessing::convertData(const DSOsamples *source, PPresult *destination
         channelData->voltage.interval = 1.0 / source->samplerate;
         channelData->voltage.sample = rawChannelData;
     }
+    return source->sequence;
 }
 
 void PostProcessing::input(const DSOsamples *data) {
+    Metrics::ScopedTimer timer(totalTime);
     currentData.reset(new PPresult(channelCount));
-    convertData(data, currentData.get());
-    for (Processor *p : processors) p->process(currentData.get());
+    const unsigned long long sequence = convertData(data, currentData.get());
+    if (lastSequence && sequence > lastSequence + 1) droppedSets->add(sequence - lastSequence - 1);
+    lastSequence = sequence;
+
+    for (size_t i = 0; i < processors.size(); ++i) {
+        Metrics::ScopedTimer processorTimer(processorTimes[i]);
+        processors[i]->process(currentData.get());
+    }
     std::shared_ptr<PPresult> res = std::move(currentData);
     emit processingFinished(res);
 }
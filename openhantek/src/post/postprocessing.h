@@ -11,6 +11,10 @@
 #include <QObject>
 
 struct DsoSettingsScope;
+namespace Metrics {
+class Counter;
+class Histogram;
+}
 
 /**
  * Manages all post processing processors. Register another processor with `registerProcessor(p)`.
@@ -26,8 +30,9 @@ class PostProcessing : public QObject {
      * imporant. The first added processor will be called first. This class does not take ownership
      * of the processors.
      * @param processor
+     * @param name A short name that is used for the processing time statistics of this processor
      */
-    void registerProcessor(Processor *processor);
+    void registerProcessor(Processor *processor, const QString &name = QString());
 
 
   private:
@@ -35,9 +40,15 @@ class PostProcessing : public QObject {
     const unsigned channelCount;
     /// The list of processors. Processors are not memory managed by this class.
     std::vector<Processor *> processors;
+    /// The processing time statistics, one for each processor
+    std::vector<Metrics::Histogram *> processorTimes;
+    Metrics::Histogram *totalTime;
+    Metrics::Counter *droppedSets; ///< Sample sets overwritten by the device thread before they were processed
+    unsigned long long lastSequence = 0;
     ///
     std::unique_ptr<PPresult> currentData;
-    static void convertData(const DSOsamples *source, PPresult *destination);
+    /// \return The sequence number of the converted sample set
+    static unsigned long long convertData(const DSOsamples *source, PPresult *destination);
   public slots:
     /**
      * Start processing new data. The actual data may be processed in another thread if you have moved
@@ -7,18 +7,23 @@ namespace Dso {
 
 Enum<Dso::MathMode, Dso::MathMode::ADD_CH1_CH2, Dso::MathMode::SUB_CH1_FROM_CH2> MathModeEnum;
 Enum<Dso::WindowFunction, Dso::WindowFunction::RECTANGULAR, Dso::WindowFunction::FLATTOP> WindowFunctionEnum;
+Enum<Dso::SpectrumAveraging, Dso::SpectrumAveraging::OFF, Dso::SpectrumAveraging::WELCH> SpectrumAveragingEnum;
+Enum<Dso::FilterType, Dso::FilterType::OFF, Dso::FilterType::NOTCH> FilterTypeEnum;
+Enum<Dso::FilterDesign, Dso::FilterDesign::IIR, Dso::FilterDesign::FIR> FilterDesignEnum;
 
-/// \brief Return string representation of the given math mode.
-/// \param mode The ::MathMode that should be returned as string.
-/// \return The string that should be used in labels etc.
-QString mathModeString(MathMode mode) {
+/// \brief Return the math channel expression of the given math mode.
+/// \param mode The ::MathMode that should be returned as expression.
+/// \param first The name of the first channel, MathExpression reads the channels by their translated names.
+/// \param second The name of the second channel.
+/// \return The expression.
+QString mathModeExpression(MathMode mode, const QString &first, const QString &second) {
     switch (mode) {
     case MathMode::ADD_CH1_CH2:
-        return QCoreApplication::tr("CH1 + CH2");
+        return QString("%1 + %2").arg(first, second);
     case MathMode::SUB_CH2_FROM_CH1:
-        return QCoreApplication::tr("CH1 - CH2");
+        return QString("%1 - %2").arg(first, second);
     case MathMode::SUB_CH1_FROM_CH2:
-        return QCoreApplication::tr("CH2 - CH1");
+        return QString("%2 - %1").arg(first, second);
     }
     return QString();
 }
@@ -60,4 +65,57 @@ QString windowFunctionString(WindowFunction window) {
     }
     return QString();
 }
+
+/// \brief Return string representation of the given spectrum averaging mode.
+/// \param averaging The ::SpectrumAveraging that should be returned as string.
+/// \return The string that should be used in labels etc.
+QString spectrumAveragingString(SpectrumAveraging averaging) {
+    switch (averaging) {
+    case SpectrumAveraging::OFF:
+        return QCoreApplication::tr("Off");
+    case SpectrumAveraging::LINEAR:
+        return QCoreApplication::tr("Linear");
+    case SpectrumAveraging::EXPONENTIAL:
+        return QCoreApplication::tr("Exponential");
+    case SpectrumAveraging::MAXHOLD:
+        return QCoreApplication::tr("Max hold");
+    case SpectrumAveraging::MINHOLD:
+        return QCoreApplication::tr("Min hold");
+    case SpectrumAveraging::WELCH:
+        return QCoreApplication::tr("Welch PSD");
+    }
+    return QString();
+}
+
+/// \brief Return string representation of the given filter type.
+/// \param type The ::FilterType that should be returned as string.
+/// \return The string that should be used in labels etc.
+QString filterTypeString(FilterType type) {
+    switch (type) {
+    case FilterType::OFF:
+        return QCoreApplication::tr("Off");
+    case FilterType::LOWPASS:
+        return QCoreApplication::tr("Low pass");
+    case FilterType::HIGHPASS:
+        return QCoreApplication::tr("High pass");
+    case FilterType::BANDPASS:
+        return QCoreApplication::tr("Band pass");
+    case FilterType::NOTCH:
+        return QCoreApplication::tr("Notch");
+    }
+    return QString();
+}
+
+/// \brief Return string representation of the given filter design.
+/// \param design The ::FilterDesign that should be returned as string.
+/// \return The string that should be used in labels etc.
+QString filterDesignString(FilterDesign design) {
+    switch (design) {
+    case FilterDesign::IIR:
+        return QCoreApplication::tr("IIR (biquads)");
+    case FilterDesign::FIR:
+        return QCoreApplication::tr("FIR (linear phase)");
+    }
+    return QString();
+}
 }
@@ -5,7 +5,7 @@
 namespace Dso {
 
 /// \enum MathMode
-/// \brief The different math modes for the math-channel.
+/// \brief The predefined expressions of the math channels, older versions only knew these.
 enum class MathMode : unsigned { ADD_CH1_CH2, SUB_CH2_FROM_CH1, SUB_CH1_FROM_CH2 };
 extern Enum<Dso::MathMode, Dso::MathMode::ADD_CH1_CH2, Dso::MathMode::SUB_CH1_FROM_CH2> MathModeEnum;
 
@@ -35,15 +35,62 @@ enum class WindowFunction : int {
 };
 extern Enum<Dso::WindowFunction, Dso::WindowFunction::RECTANGULAR, Dso::WindowFunction::FLATTOP> WindowFunctionEnum;
 
-QString mathModeString(MathMode mode);
+/// \enum SpectrumAveraging
+/// \brief How the power spectra of consecutive frames or of one record are combined.
+enum class SpectrumAveraging : int {
+    OFF,         ///< The spectrum of the latest frame
+    LINEAR,      ///< Mean power of the frames, the N latest frames once N frames are averaged
+    EXPONENTIAL, ///< Exponential power average, each new frame is weighted with 1/N
+    MAXHOLD,     ///< Maximum power of each frequency since the last change of the settings
+    MINHOLD,     ///< Minimum power of each frequency since the last change of the settings
+    WELCH        ///< Welch PSD, mean of N half overlapping segments of each record
+};
+extern Enum<Dso::SpectrumAveraging, Dso::SpectrumAveraging::OFF, Dso::SpectrumAveraging::WELCH> SpectrumAveragingEnum;
+
+/// \enum FilterType
+/// \brief The frequency response of the channel filter.
+enum class FilterType : int {
+    OFF,      ///< The channels are not filtered
+    LOWPASS,  ///< Passes the frequencies below the corner frequency
+    HIGHPASS, ///< Passes the frequencies above the corner frequency
+    BANDPASS, ///< Passes the band around the center frequency
+    NOTCH     ///< Blocks the band around the center frequency
+};
+extern Enum<Dso::FilterType, Dso::FilterType::OFF, Dso::FilterType::NOTCH> FilterTypeEnum;
+
+/// \enum FilterDesign
+/// \brief How the channel filter is realized.
+enum class FilterDesign : int {
+    IIR, ///< Cascade of biquad sections, Butterworth for low and high pass
+    FIR  ///< Linear phase windowed sinc kernel
+};
+extern Enum<Dso::FilterDesign, Dso::FilterDesign::IIR, Dso::FilterDesign::FIR> FilterDesignEnum;
+
+QString mathModeExpression(MathMode mode, const QString &first, const QString &second);
 QString windowFunctionString(WindowFunction window);
+QString spectrumAveragingString(SpectrumAveraging averaging);
+QString filterTypeString(FilterType type);
+QString filterDesignString(FilterDesign design);
 }
 
 Q_DECLARE_METATYPE(Dso::MathMode)
 Q_DECLARE_METATYPE(Dso::WindowFunction)
+Q_DECLARE_METATYPE(Dso::SpectrumAveraging)
+Q_DECLARE_METATYPE(Dso::FilterType)
+Q_DECLARE_METATYPE(Dso::FilterDesign)
 
 struct DsoSettingsPostProcessing {
     Dso::WindowFunction spectrumWindow = Dso::WindowFunction::HANN; ///< Window function for DFT
     double spectrumReference = 0.0;                                 ///< Reference level for spectrum in dBm
     double spectrumLimit = -20.0; ///< Minimum magnitude of the spectrum (Avoids peaks)
+    Dso::SpectrumAveraging spectrumAveraging = Dso::SpectrumAveraging::OFF; ///< Averaging of the power spectra
+    unsigned spectrumAverageCount = 8; ///< Number of averaged frames or Welch segments
+    unsigned spectrogramLength = 1024; ///< Roll mode: Length of the STFT segments
+    double spectrogramOverlap = 0.5;   ///< Roll mode: Overlap of consecutive STFT segments (0..0.95)
+    Dso::FilterType filterType = Dso::FilterType::OFF;       ///< Response of the filter of the physical channels
+    Dso::FilterDesign filterDesign = Dso::FilterDesign::IIR; ///< IIR or FIR filter
+    double filterFrequency = 50.0; ///< Corner frequency of low/high pass, center of band pass/notch in Hz
+    double filterBandwidth = 10.0; ///< Band pass/notch: Width of the band in Hz
+    unsigned filterOrder = 4;      ///< IIR: Filter order, order/2 biquad sections
+    unsigned filterTaps = 255;     ///< FIR: Length of the kernel, odd
 };
@@ -17,17 +17,3 @@ DataChannel *PPresult::modifyData(ChannelID channel) { return &this->analyzedDat
 unsigned int PPresult::sampleCount() const { return (unsigned)analyzedData[0].voltage.sample.size(); }
 
 unsigned int PPresult::channelCount() const { return (unsigned)analyzedData.size(); }
-
-double DataChannel::computeAmplitude() const {
-    double minimalVoltage, maximalVoltage;
-    minimalVoltage = maximalVoltage = voltage.sample[0];
-
-    for (unsigned int position = 1; position < voltage.sample.size(); ++position) {
-        if (voltage.sample[position] < minimalVoltage)
-            minimalVoltage = voltage.sample[position];
-        else if (voltage.sample[position] > maximalVoltage)
-            maximalVoltage = voltage.sample[position];
-    }
-
-    return maximalVoltage - minimalVoltage;
-}
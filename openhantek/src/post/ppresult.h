@@ -5,6 +5,7 @@
 #include <QVector3D>
 #include <QReadWriteLock>
 
+#include <cmath>
 #include <vector>
 #include "hantekprotocol/types.h"
 
@@ -14,14 +15,69 @@ struct SampleValues {
     double interval = 0.0;      ///< The interval between two sample values
 };
 
+/// \brief Measured values of the voltage samples, NaN if a value couldn't be determined.
+struct Measurements {
+    double minimum = NAN;   ///< Lowest sample (V)
+    double maximum = NAN;   ///< Highest sample (V)
+    double amplitude = NAN; ///< Peak-to-peak voltage (V)
+    double mean = NAN;      ///< Average voltage (V)
+    double rms = NAN;       ///< Root mean square (V)
+    double acRms = NAN;     ///< Root mean square without the mean (V)
+    double period = NAN;    ///< Average time between rising edges, see FrequencyCounter (s)
+    double frequency = NAN; ///< 1 / period (Hz)
+    double dutyCycle = NAN; ///< Ratio of the time above the middle level to the period
+    double riseTime = NAN;  ///< Average time from 10 % to 90 % of the amplitude (s)
+    double fallTime = NAN;  ///< Average time from 90 % to 10 % of the amplitude (s)
+};
+
 /// \brief Struct for the analyzed data.
 struct DataChannel {
-    SampleValues voltage;   ///< The time-domain voltage levels (V)
-    SampleValues spectrum;  ///< The frequency-domain power levels (dB)
+    SampleValues voltage;      ///< The time-domain voltage levels (V)
+    SampleValues spectrum;     ///< The frequency-domain power levels (dB)
+    Measurements measurements; ///< Computed by the MeasurementGenerator
+    /// New waterfall rows of `spectrum.sample.size()` levels each, 0..255 over the screen height
+    std::vector<uint8_t> spectrogram;
+    /// XY mode: Intensity map of this channel paired with the next one, eye diagram: Accumulated eye of this channel
+    /// over two unit intervals. XY_DENSITY_WIDTH x XY_DENSITY_HEIGHT levels 0..255, the first row is at the bottom
+    std::vector<uint8_t> density;
+};
 
-    double frequency = 0.0; ///< The frequency of the signal
-    // Calculate peak-to-peak voltage
-    double computeAmplitude() const;
+/// \brief A word of a serial protocol, see ProtocolDecoder.
+struct DecodedWord {
+    enum class Kind : uint8_t {
+        DATA,    ///< A data word
+        ADDRESS, ///< I2C address, the value includes the R/W bit
+        START,   ///< I2C start or repeated start condition
+        STOP     ///< I2C stop condition
+    };
+    enum class Status : uint8_t {
+        OK,            ///< Valid word, acknowledged for I2C
+        NACK,          ///< I2C word that was not acknowledged
+        PARITY_ERROR,  ///< UART parity bit mismatch
+        FRAMING_ERROR  ///< UART stop bit missing
+    };
+    Kind kind = Kind::DATA;
+    Status status = Status::OK;
+    unsigned value = 0; ///< The data bits
+    double start = 0.0; ///< Time of the first bit relative to the first sample of the result (s)
+    double end = 0.0;   ///< Time after the last bit relative to the first sample of the result (s)
+};
+
+/// \brief Histogram accumulated over many waveforms, see HistogramGenerator.
+struct ValueHistogram {
+    bool amplitude = true;                 ///< Voltages along the vertical axis, else times along the horizontal axis
+    ChannelID channel = 0;                 ///< The analyzed channel
+    std::vector<unsigned long long> bins;  ///< Number of values in each bin, empty if there is no histogram
+    double valueFirst = 0.0;               ///< Value at the start of the first bin (V or s)
+    double valueLast = 0.0;                ///< Value at the end of the last bin (V or s)
+    double first = 0.0;                    ///< Screen position of valueFirst in divs
+    double last = 0.0;                     ///< Screen position of valueLast in divs
+    unsigned long long waveforms = 0;      ///< Number of accumulated waveforms
+    unsigned long long count = 0;          ///< Number of values, including those outside of the bins
+    double mean = NAN;                     ///< Average value (V or s)
+    double deviation = NAN;                ///< Standard deviation (V or s)
+    double minimum = NAN;                  ///< Lowest value (V or s)
+    double maximum = NAN;                  ///< Highest value (V or s)
 };
 
 typedef std::vector<QVector3D> ChannelGraph;
@@ -43,9 +99,23 @@ class PPresult {
     unsigned int channelCount() const;
 
     bool softwareTriggerTriggered = false;
+    bool append = false; ///< true if the samples continue the previous result (roll mode)
+    /// The samples are already aligned to the software trigger, the trigger point is at the pretrigger position
+    bool triggerAligned = false;
 
     ChannelsGraphs vaChannelSpectrum;
     ChannelsGraphs vaChannelVoltage;
+    /// Segments of the segmented acquisition, each consists of `segmentVertexCount` vertices
+    ChannelsGraphs vaChannelSegments;
+    unsigned segmentVertexCount = 0;
+
+    /// Serial protocol words, in roll mode including the still visible words of the previous results
+    std::vector<DecodedWord> decodedWords;
+    bool decoderUndersampled = false; ///< The protocol decoder needs at least one sample per bit, nothing decoded
+    double graphOrigin = 0.0; ///< Horizontal graph position of the first sample in divs, set by the GraphGenerator
+    double graphScale = 0.0;  ///< Horizontal graph divs per second, set by the GraphGenerator
+    /// Copy of the accumulated histogram of the HistogramGenerator
+    ValueHistogram histogram;
   private:
     std::vector<DataChannel> analyzedData; ///< The analyzed data for each channel
 };
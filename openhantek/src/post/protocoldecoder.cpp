@@ -0,0 +1,312 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <algorithm>
+#include <bitset>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DECODER_SSE2
+#endif
+
+#include "protocoldecoder.h"
+#include "scopesettings.h"
+#include "utils/metrics.h"
+#include "viewconstants.h"
+
+/// Upper limit of the stored words, the oldest ones are dropped
+static const size_t MAX_WORDS = 65536;
+/// SPI: A clock pause of this many clock periods ends an incomplete word
+static const double SPI_PAUSE = 8.0;
+
+typedef DsoSettingsScopeDecoder::Protocol Protocol;
+typedef DsoSettingsScopeDecoder::Parity Parity;
+
+/// \return The index of the lowest set bit, x must not be 0.
+static inline unsigned lowestBit(uint64_t x) {
+#if defined(__GNUC__)
+    return (unsigned)__builtin_ctzll(x);
+#else
+    unsigned index = 0;
+    while (!(x & 1)) {
+        x >>= 1;
+        ++index;
+    }
+    return index;
+#endif
+}
+
+size_t ProtocolDecoder::LogicStream::nextEdge(size_t from) const {
+    if (from >= count) return count;
+    const size_t firstWord = from >> 6;
+    for (size_t word = firstWord; word < bits.size(); ++word) {
+        const uint64_t carry = word ? bits[word - 1] >> 63 : (uint64_t)previous;
+        // Bit i is set if sample i differs from the sample before
+        uint64_t changes = bits[word] ^ (bits[word] << 1 | carry);
+        if (word == firstWord) changes &= ~0ull << (from & 63);
+        if (changes) return std::min(word * 64 + lowestBit(changes), count);
+    }
+    return count;
+}
+
+ProtocolDecoder::ProtocolDecoder(const DsoSettingsScope *scope) : scope(scope) {
+    decodedWords = Metrics::Registry::get()->counter("decoder.words");
+}
+
+void ProtocolDecoder::threshold(const std::vector<double> &samples, double level, LogicStream &stream) {
+    const size_t count = samples.size();
+    const double *input = samples.data();
+    stream.count = count;
+    stream.bits.assign((count + 63) / 64, 0);
+
+    size_t index = 0;
+#ifdef DECODER_SSE2
+    // Compare two samples at once, movemask turns the comparison results into two bits
+    const __m128d threshold = _mm_set1_pd(level);
+    for (; index + 64 <= count; index += 64) {
+        uint64_t word = 0;
+        for (unsigned offset = 0; offset < 64; offset += 8) {
+            const double *block = input + index + offset;
+            const unsigned mask = (unsigned)_mm_movemask_pd(_mm_cmpgt_pd(_mm_loadu_pd(block), threshold)) |
+                                  (unsigned)_mm_movemask_pd(_mm_cmpgt_pd(_mm_loadu_pd(block + 2), threshold)) << 2 |
+                                  (unsigned)_mm_movemask_pd(_mm_cmpgt_pd(_mm_loadu_pd(block + 4), threshold)) << 4 |
+                                  (unsigned)_mm_movemask_pd(_mm_cmpgt_pd(_mm_loadu_pd(block + 6), threshold)) << 6;
+            word |= (uint64_t)mask << offset;
+        }
+        stream.bits[index >> 6] = word;
+    }
+#endif
+    for (; index < count; ++index)
+        if (input[index] > level) stream.bits[index >> 6] |= 1ull << (index & 63);
+}
+
+void ProtocolDecoder::reset() {
+    words.clear();
+    blockStart = 0;
+    busy = false;
+    bit = 0;
+    value = 0;
+    resume = 0;
+    lastEdge = -1.0;
+    clockPeriod = 0.0;
+    address = false;
+}
+
+void ProtocolDecoder::process(PPresult *result) {
+    result->decodedWords.clear();
+    result->decoderUndersampled = false;
+    const DsoSettingsScopeDecoder &settings = scope->decoder;
+    if (settings.protocol == Protocol::OFF) {
+        signature.clear();
+        reset();
+        return;
+    }
+
+    const bool clocked = settings.protocol != Protocol::UART;
+    if (settings.dataChannel >= result->channelCount() ||
+        (clocked && settings.clockChannel >= result->channelCount()))
+        return;
+    const SampleValues &dataSamples = result->data(settings.dataChannel)->voltage;
+    const double interval = dataSamples.interval;
+    if (dataSamples.sample.empty() || interval <= 0.0) return;
+
+    // A bit shorter than a sample can't be located, the search for the next start bit wouldn't advance
+    const double samplesPerBit = 1.0 / (settings.baudrate * interval);
+    if (settings.protocol == Protocol::UART && !(samplesPerBit >= 1.0)) {
+        result->decoderUndersampled = true;
+        signature.clear();
+        return;
+    }
+
+    // Start over for every record and whenever the settings change
+    const std::vector<double> newSignature = {(double)settings.protocol, (double)settings.dataChannel,
+                                              (double)settings.clockChannel, settings.threshold, settings.baudrate,
+                                              (double)settings.dataBits, (double)settings.parity,
+                                              (double)settings.spiMode, (double)settings.lsbFirst, interval};
+    const bool continued = result->append && newSignature == signature;
+    if (!continued) {
+        signature = newSignature;
+        reset();
+    }
+
+    threshold(dataSamples.sample, settings.threshold, data);
+    data.previous = continued ? dataLevel : data.level(0);
+    if (clocked) {
+        const std::vector<double> &clockSamples = result->data(settings.clockChannel)->voltage.sample;
+        if (clockSamples.empty()) return;
+        threshold(clockSamples, settings.threshold, clock);
+        clock.previous = continued ? clockLevel : clock.level(0);
+        data.count = clock.count = std::min(data.count, clock.count);
+    }
+
+    switch (settings.protocol) {
+    case Protocol::UART: decodeUart(samplesPerBit); break;
+    case Protocol::SPI: decodeSpi(); break;
+    case Protocol::I2C: decodeI2c(); break;
+    case Protocol::OFF: break;
+    }
+
+    dataLevel = data.level(data.count - 1);
+    if (clocked) clockLevel = clock.level(clock.count - 1);
+
+    // Roll mode: Drop the words that scrolled out of the screen
+    const double blockEnd = (double)(blockStart + data.count);
+    if (result->append) {
+        const double oldest = blockEnd - scope->horizontal.timebase * DIVS_TIME / interval;
+        while (!words.empty() && words.front().end < oldest) words.pop_front();
+    }
+
+    result->decodedWords.reserve(words.size());
+    for (const DecodedWord &word : words) {
+        result->decodedWords.push_back(word);
+        result->decodedWords.back().start = (word.start - (double)blockStart) * interval;
+        result->decodedWords.back().end = (word.end - (double)blockStart) * interval;
+    }
+    blockStart += data.count;
+}
+
+void ProtocolDecoder::addWord(DecodedWord::Kind kind, DecodedWord::Status status, unsigned value, double start,
+                              double end) {
+    DecodedWord word;
+    word.kind = kind;
+    word.status = status;
+    word.value = value;
+    word.start = start;
+    word.end = end;
+    words.push_back(word);
+    if (words.size() > MAX_WORDS) words.pop_front();
+    decodedWords->add();
+}
+
+void ProtocolDecoder::decodeUart(double samplesPerBit) {
+    const DsoSettingsScopeDecoder &settings = scope->decoder;
+    const unsigned parityBits = settings.parity == Parity::NONE ? 0 : 1;
+    const unsigned frameBits = 1 + settings.dataBits + parityBits + 1;
+
+    for (;;) {
+        if (!busy) {
+            // Wait for the falling edge of the start bit
+            size_t edge = data.nextEdge(resume > blockStart ? (size_t)(resume - blockStart) : 0);
+            while (edge < data.count && data.level(edge)) edge = data.nextEdge(edge + 1);
+            if (edge >= data.count) return;
+            busy = true;
+            bit = 0;
+            value = 0;
+            wordStart = (double)(blockStart + edge) - 0.5;
+        }
+
+        // Sample each bit in its center, the start bit is bit 0
+        for (; bit < frameBits; ++bit) {
+            const long long index =
+                (long long)std::floor(wordStart + (bit + 0.5) * samplesPerBit + 0.5) - (long long)blockStart;
+            if (index >= (long long)data.count) return; // Continue with the next block
+            const bool level = data.level((size_t)std::max(index, 0ll));
+            if (bit == 0 && level) break;
+            if (bit > 0 && level) value |= 1u << (bit - 1);
+        }
+        busy = false;
+        // wordStart lies half a sample before the start edge
+        const unsigned long long startEdge = (unsigned long long)std::max(wordStart + 0.5, 0.0);
+
+        if (bit == 0) {
+            // The start bit was a glitch
+            resume = (unsigned long long)std::max(std::floor(wordStart + 0.5 * samplesPerBit + 0.5), 0.0);
+            resume = std::max(resume, startEdge + 1);
+            continue;
+        }
+        // The search for the next start bit begins in the center of the stop bit, but always after the start edge
+        resume = (unsigned long long)std::floor(wordStart + (frameBits - 0.5) * samplesPerBit + 0.5);
+        resume = std::max(resume, startEdge + 1);
+
+        DecodedWord::Status status = DecodedWord::Status::OK;
+        if (!(value >> (frameBits - 2) & 1)) {
+            status = DecodedWord::Status::FRAMING_ERROR;
+        } else if (parityBits) {
+            // The number of ones including the parity bit is even for even parity
+            const size_t ones = std::bitset<32>(value & ((1u << (settings.dataBits + 1)) - 1)).count();
+            if ((ones & 1) != (settings.parity == Parity::ODD ? 1u : 0u)) status = DecodedWord::Status::PARITY_ERROR;
+        }
+        addWord(DecodedWord::Kind::DATA, status, value & ((1u << settings.dataBits) - 1), wordStart,
+                wordStart + frameBits * samplesPerBit);
+    }
+}
+
+void ProtocolDecoder::decodeSpi() {
+    const DsoSettingsScopeDecoder &settings = scope->decoder;
+    // Mode 0 and 3 sample on the rising edge, mode 1 and 2 on the falling edge
+    const bool samplingLevel = !(((settings.spiMode >> 1) ^ settings.spiMode) & 1);
+
+    for (size_t edge = clock.nextEdge(0); edge < clock.count; edge = clock.nextEdge(edge + 1)) {
+        if (clock.level(edge) != samplingLevel) continue;
+        const double position = (double)(blockStart + edge);
+        if (bit > 0 && lastEdge >= 0.0) {
+            const double gap = position - lastEdge;
+            if (clockPeriod > 0.0 && gap > SPI_PAUSE * clockPeriod)
+                bit = 0;
+            else
+                clockPeriod = gap;
+        }
+        lastEdge = position;
+
+        if (bit == 0) {
+            value = 0;
+            wordStart = position;
+        }
+        const unsigned level = data.level(edge) ? 1 : 0;
+        if (settings.lsbFirst)
+            value |= level << bit;
+        else
+            value = value << 1 | level;
+
+        if (++bit >= settings.dataBits) {
+            const double halfPeriod = clockPeriod > 0.0 ? clockPeriod / 2 : 0.5;
+            addWord(DecodedWord::Kind::DATA, DecodedWord::Status::OK, value, wordStart - halfPeriod,
+                    position + halfPeriod);
+            bit = 0;
+        }
+    }
+}
+
+void ProtocolDecoder::decodeI2c() {
+    // Walk through the edges of both lines in order
+    size_t nextSda = data.nextEdge(0);
+    size_t nextScl = clock.nextEdge(0);
+    while (nextSda < data.count || nextScl < clock.count) {
+        const size_t edge = std::min(nextSda, nextScl);
+        const double position = (double)(blockStart + edge);
+
+        if (edge == nextScl) {
+            // SDA is valid on the rising clock edge, the ninth bit is the acknowledge
+            if (busy && clock.level(edge)) {
+                const unsigned sda = data.level(edge) ? 1 : 0;
+                if (bit < 8) {
+                    if (bit == 0) {
+                        value = 0;
+                        wordStart = position;
+                    }
+                    value = value << 1 | sda;
+                    ++bit;
+                } else {
+                    addWord(address ? DecodedWord::Kind::ADDRESS : DecodedWord::Kind::DATA,
+                            sda ? DecodedWord::Status::NACK : DecodedWord::Status::OK, value, wordStart, position);
+                    address = false;
+                    bit = 0;
+                }
+            }
+        } else if (clock.level(edge)) {
+            // SDA changes while SCL is high: Start or stop condition
+            if (!data.level(edge)) {
+                addWord(DecodedWord::Kind::START, DecodedWord::Status::OK, 0, position, position);
+                busy = true;
+                address = true;
+                bit = 0;
+            } else if (busy) {
+                addWord(DecodedWord::Kind::STOP, DecodedWord::Status::OK, 0, position, position);
+                busy = false;
+            }
+        }
+
+        if (edge == nextSda) nextSda = data.nextEdge(edge + 1);
+        if (edge == nextScl) nextScl = clock.nextEdge(edge + 1);
+    }
+}
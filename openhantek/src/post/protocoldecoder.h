@@ -0,0 +1,73 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <deque>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "ppresult.h"
+#include "processor.h"
+
+struct DsoSettingsScope;
+namespace Metrics {
+class Counter;
+}
+
+/// \brief Decodes UART, SPI and I2C from the analog channels.
+/// The channels are compared against the threshold and packed into one bit per sample, two samples at a time with
+/// SSE2. The decoders are state machines that only look at the edges and the bit centers, the edge search skips 64
+/// samples without a level change at once. In roll mode the decoder state and the words of the previous blocks are
+/// kept, so words spanning two blocks are decoded as well. There is no chip select, an SPI word ends after the
+/// configured number of bits or when the clock pauses.
+class ProtocolDecoder : public Processor {
+  public:
+    ProtocolDecoder(const DsoSettingsScope *scope);
+    virtual void process(PPresult *result) override;
+
+  private:
+    /// \brief Logic levels of one channel, bit i % 64 of word i / 64 is the level of sample i.
+    struct LogicStream {
+        std::vector<uint64_t> bits;
+        size_t count = 0;
+        bool previous = false; ///< Level before the first sample, the last level of the previous block in roll mode
+
+        inline bool level(size_t index) const { return (bits[index >> 6] >> (index & 63)) & 1; }
+        inline bool before(size_t index) const { return index ? level(index - 1) : previous; }
+        /// \return The first sample at or after `from` with another level than the sample before it, or count.
+        size_t nextEdge(size_t from) const;
+    };
+
+    /// \brief Pack the samples into the stream, 1 if the sample is above the level.
+    static void threshold(const std::vector<double> &samples, double level, LogicStream &stream);
+
+    /// \brief Forget the decoder state and all words.
+    void reset();
+    void decodeUart(double samplesPerBit);
+    void decodeSpi();
+    void decodeI2c();
+    /// \brief Store a word, positions are absolute sample positions.
+    void addWord(DecodedWord::Kind kind, DecodedWord::Status status, unsigned value, double start, double end);
+
+    const DsoSettingsScope *scope;
+    Metrics::Counter *decodedWords;
+
+    std::vector<double> signature; ///< The settings of the current decoder state
+    LogicStream data;
+    LogicStream clock;
+    bool dataLevel = false;            ///< Roll mode: Last data level of the previous block
+    bool clockLevel = false;           ///< Roll mode: Last clock level of the previous block
+    unsigned long long blockStart = 0; ///< Absolute position of the first sample of the current block
+    std::deque<DecodedWord> words;     ///< Decoded words, start and end are absolute sample positions
+
+    // Decoder state, positions are absolute sample positions
+    bool busy = false;               ///< UART: Within a frame, I2C: Between start and stop condition
+    unsigned bit = 0;                ///< Index of the next bit of the word
+    unsigned value = 0;              ///< The bits of the current word
+    double wordStart = 0.0;          ///< Position of the start bit or the first clock edge of the current word
+    unsigned long long resume = 0;   ///< UART: The search for the next start bit continues here
+    double lastEdge = -1.0;          ///< SPI: Position of the previous sampling clock edge
+    double clockPeriod = 0.0;        ///< SPI: Time between two sampling clock edges
+    bool address = false;            ///< I2C: The next word is an address
+};
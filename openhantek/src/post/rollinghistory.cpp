@@ -0,0 +1,166 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "rollinghistory.h"
+
+#include "post/ppresult.h"
+#include "scopesettings.h"
+#include "viewconstants.h"
+
+/// Number of blocks of a level that are combined into one block of the next level
+static const unsigned long long LEVEL_FACTOR = 16;
+/// Number of envelope levels, the coarsest one has blocks of 16^5 samples
+static const int LEVEL_COUNT = 5;
+/// Upper limit of the samples per channel, older data is only available as envelope
+static const unsigned long long SAMPLES_LIMIT = 1 << 22;
+/// Upper limit of the blocks per level and channel
+static const unsigned long long BLOCKS_LIMIT = 1 << 18;
+
+struct RollingHistory::Channel {
+    RingBuffer<double> samples;
+    std::unique_ptr<RingBuffer<Envelope>> levels[LEVEL_COUNT]; ///< Level n has blocks of 16^(n+1) samples
+    Accumulator pending[LEVEL_COUNT];                          ///< The incomplete block of each level
+    unsigned long long written = 0;
+};
+
+/// \return The number of samples of a block of the level
+static inline unsigned long long blockSize(int level) {
+    unsigned long long size = LEVEL_FACTOR;
+    for (int i = 0; i < level; ++i) size *= LEVEL_FACTOR;
+    return size;
+}
+
+RollingHistory::RollingHistory(const DsoSettingsScope *scope) : scope(scope) {}
+
+unsigned long long RollingHistory::written(ChannelID channel) const {
+    return channel < channels.size() ? channels[channel]->written : 0;
+}
+
+size_t RollingHistory::read(ChannelID channel, unsigned long long first, size_t count, double *out) const {
+    if (channel >= channels.size()) return 0;
+    return channels[channel]->samples.read(first, out, count);
+}
+
+void RollingHistory::process(PPresult *result) {
+    // Only roll mode sample sets continue each other
+    if (!result->append) {
+        valid = false;
+        return;
+    }
+
+    const unsigned channelCount = result->channelCount();
+    double interval = 0.0;
+    for (ChannelID channel = 0; channel < channelCount; ++channel) {
+        if (!result->data(channel)->voltage.sample.empty()) {
+            interval = result->data(channel)->voltage.interval;
+            break;
+        }
+    }
+    if (interval <= 0.0) return;
+
+    // The graph shows the latest screen width, so at least that much is held. The sample ring stays limited to
+    // SAMPLES_LIMIT, the envelope levels cover the rest of the window.
+    const double window = scope->horizontal.timebase * DIVS_TIME / interval;
+    const unsigned long long requestedDepth =
+        (unsigned long long)std::max({scope->horizontal.rollHistory / interval, window, 1.0});
+    if (!valid || channelCount != channels.size() || interval != sampleInterval || requestedDepth != depth)
+        configure(channelCount, interval, requestedDepth);
+
+    for (ChannelID channel = 0; channel < channelCount; ++channel)
+        append(*channels[channel], result->data(channel)->voltage.sample);
+}
+
+void RollingHistory::configure(unsigned channelCount, double interval, unsigned long long depth) {
+    this->depth = depth;
+    sampleInterval = interval;
+    valid = true;
+
+    channels.resize(channelCount);
+    for (std::unique_ptr<Channel> &channel : channels) {
+        if (!channel) channel = std::unique_ptr<Channel>(new Channel());
+        channel->samples.reset((size_t)std::min(depth, SAMPLES_LIMIT));
+        for (int level = 0; level < LEVEL_COUNT; ++level) {
+            if (!channel->levels[level]) channel->levels[level].reset(new RingBuffer<Envelope>());
+            channel->levels[level]->reset((size_t)std::min(depth / blockSize(level) + 2, BLOCKS_LIMIT));
+            channel->pending[level] = Accumulator();
+        }
+        channel->written = 0;
+    }
+}
+
+void RollingHistory::append(Channel &channel, const std::vector<double> &samples) {
+    channel.samples.write(samples.data(), samples.size());
+    for (double value : samples) {
+        Envelope envelope = {value, value};
+        // Complete blocks are passed on to the next level
+        for (int level = 0; level < LEVEL_COUNT; ++level) {
+            Accumulator &pending = channel.pending[level];
+            pending.add(envelope);
+            if (pending.count < LEVEL_FACTOR) break;
+            envelope = pending.envelope;
+            pending = Accumulator();
+            channel.levels[level]->write(&envelope, 1);
+        }
+    }
+    channel.written += samples.size();
+}
+
+bool RollingHistory::column(const Channel &channel, int level, unsigned long long begin, unsigned long long end,
+                            Envelope &result) const {
+    Accumulator accumulator;
+    if (level < 0) {
+        double samples[LEVEL_FACTOR];
+        const size_t count = (size_t)(end - begin);
+        if (count > LEVEL_FACTOR || channel.samples.read(begin, samples, count) != count) return false;
+        for (size_t index = 0; index < count; ++index) accumulator.add({samples[index], samples[index]});
+    } else {
+        const unsigned long long size = blockSize(level);
+        const unsigned long long complete = channel.written / size;
+        const unsigned long long firstBlock = begin / size;
+        const unsigned long long lastBlock = (end - 1) / size;
+
+        Envelope blocks[LEVEL_FACTOR];
+        for (unsigned long long block = firstBlock; block <= lastBlock && block < complete;) {
+            const size_t count = (size_t)std::min<unsigned long long>(
+                {lastBlock + 1 - block, complete - block, (unsigned long long)LEVEL_FACTOR});
+            if (channel.levels[level]->read(block, blocks, count) != count) return false;
+            for (size_t index = 0; index < count; ++index) accumulator.add(blocks[index]);
+            block += count;
+        }
+        // The newest samples are still in the incomplete blocks of this and the finer levels
+        if (lastBlock >= complete)
+            for (int finer = 0; finer <= level; ++finer)
+                if (channel.pending[finer].count) accumulator.add(channel.pending[finer].envelope);
+    }
+    if (!accumulator.count) return false;
+    result = accumulator.envelope;
+    return true;
+}
+
+void RollingHistory::envelope(ChannelID channel, long long first, unsigned long long count,
+                              std::vector<Envelope> &out) const {
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    std::fill(out.begin(), out.end(), Envelope{nan, nan});
+    if (channel >= channels.size() || out.empty() || !count) return;
+    const Channel &history = *channels[channel];
+
+    // Choose the finest level that needs less than LEVEL_FACTOR blocks per column
+    const double samplesPerColumn = (double)count / out.size();
+    int level = -1;
+    while (level + 1 < LEVEL_COUNT && (double)blockSize(level + 1) <= samplesPerColumn) ++level;
+
+    for (size_t index = 0; index < out.size(); ++index) {
+        const long long begin = first + (long long)(index * samplesPerColumn);
+        const long long end = std::min(first + (long long)((index + 1) * samplesPerColumn),
+                                       (long long)history.written);
+        if (end <= 0 || end <= begin) continue;
+        const unsigned long long from = (unsigned long long)std::max(begin, 0ll);
+
+        // Older data is only held by the coarser levels
+        for (int tryLevel = level; tryLevel < LEVEL_COUNT; ++tryLevel)
+            if (column(history, tryLevel, from, (unsigned long long)end, out[index])) break;
+    }
+}
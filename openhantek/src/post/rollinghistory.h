@@ -0,0 +1,86 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "hantekprotocol/types.h"
+#include "processor.h"
+#include "utils/ringbuffer.h"
+
+struct DsoSettingsScope;
+class PPresult;
+
+/// \brief Rolling history of the roll mode sample sets.
+/// Roll mode delivers small blocks of samples that continue each other. They are appended to a fixed capacity
+/// ring per channel, holding `scope->horizontal.rollHistory` seconds but at least one screen width. Next to the
+/// samples, min/max envelopes of blocks of 16, 256, ... samples are maintained, so a window of any length is
+/// reduced to a fixed number of display columns with a constant amount of work per column.
+class RollingHistory : public Processor {
+  public:
+    /// Minimum and maximum of a block of samples
+    struct Envelope {
+        double min;
+        double max;
+    };
+
+    RollingHistory(const DsoSettingsScope *scope);
+    virtual void process(PPresult *result) override;
+
+    /// \return true if the history holds roll mode data
+    inline bool isValid() const { return valid; }
+    /// \return The time between two samples in s
+    inline double interval() const { return sampleInterval; }
+    inline unsigned channelCount() const { return (unsigned)channels.size(); }
+
+    /// \return The number of samples appended since the history was cleared, which is the position of the next one
+    unsigned long long written(ChannelID channel) const;
+
+    /// \brief Copy samples of the history.
+    /// \param channel The channel that should be read.
+    /// \param first The position of the first sample.
+    /// \param count The number of samples.
+    /// \param out Receives the samples.
+    /// \return The number of samples copied, 0 if the samples are not held (anymore).
+    size_t read(ChannelID channel, unsigned long long first, size_t count, double *out) const;
+
+    /// \brief Reduce a window of the history to min/max columns.
+    /// Columns before the first sample or beyond the held history get a NaN envelope.
+    /// \param channel The channel that should be read.
+    /// \param first The position of the first sample of the window, may be negative.
+    /// \param count The number of samples in the window.
+    /// \param out Receives one envelope per column, the number of columns is given by its size.
+    void envelope(ChannelID channel, long long first, unsigned long long count, std::vector<Envelope> &out) const;
+
+  private:
+    /// Builds the envelope of the next block of a level
+    struct Accumulator {
+        Envelope envelope;
+        unsigned count = 0;
+        inline void add(const Envelope &value) {
+            if (count++ == 0)
+                envelope = value;
+            else {
+                if (value.min < envelope.min) envelope.min = value.min;
+                if (value.max > envelope.max) envelope.max = value.max;
+            }
+        }
+    };
+
+    struct Channel;
+
+    /// \brief Allocate the rings for the given samplerate and depth and clear the history.
+    void configure(unsigned channelCount, double interval, unsigned long long depth);
+    void append(Channel &channel, const std::vector<double> &samples);
+    /// \brief Min/max of the samples [begin, end) taken from the given level, -1 for the samples themselves.
+    /// \return false if the level doesn't hold the complete range.
+    bool column(const Channel &channel, int level, unsigned long long begin, unsigned long long end,
+                Envelope &result) const;
+
+    const DsoSettingsScope *scope;
+    std::vector<std::unique_ptr<Channel>> channels;
+    bool valid = false;
+    double sampleInterval = 0.0;
+    unsigned long long depth = 0; ///< Samples per channel that should be held
+};
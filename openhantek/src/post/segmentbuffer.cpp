@@ -0,0 +1,122 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include "segmentbuffer.h"
+
+#include <QMutexLocker>
+
+#include <algorithm>
+#include <limits>
+
+bool SegmentBuffer::configure(unsigned channels, unsigned length, unsigned pretrigger, unsigned capacity,
+                              double interval) {
+    QMutexLocker locker(&mutex);
+    if (channels == slotChannels && length == slotLength && pretrigger == slotPretrigger &&
+        capacity == requestedCapacity && interval == sampleInterval)
+        return false;
+
+    slotChannels = channels;
+    slotLength = length;
+    slotPretrigger = pretrigger;
+    sampleInterval = interval;
+    requestedCapacity = capacity;
+    const size_t slotSize = std::max<size_t>((size_t)channels * length, 1);
+    const size_t slotCount = std::min<size_t>(capacity, SEGMENT_BUFFER_BYTES / sizeof(double) / slotSize);
+    storage.assign(slotCount * slotSize, 0.0);
+    segments.assign(slotCount, Segment());
+    head = 0;
+    stored = 0;
+    captured = 0;
+    epoch.start();
+    return true;
+}
+
+void SegmentBuffer::clear() {
+    QMutexLocker locker(&mutex);
+    head = 0;
+    stored = 0;
+    captured = 0;
+    epoch.start();
+}
+
+void SegmentBuffer::append(const std::vector<const std::vector<double> *> &samples, size_t start,
+                           const Segment &segment) {
+    QMutexLocker locker(&mutex);
+    if (segments.empty()) return;
+
+    double *slot = storage.data() + (size_t)head * slotChannels * slotLength;
+    for (unsigned channel = 0; channel < slotChannels; ++channel, slot += slotLength) {
+        const std::vector<double> *source = channel < samples.size() ? samples[channel] : nullptr;
+        if (!source || source->size() < start + slotLength)
+            std::fill(slot, slot + slotLength, std::numeric_limits<double>::quiet_NaN());
+        else
+            std::copy(source->begin() + start, source->begin() + start + slotLength, slot);
+    }
+    segments[head] = segment;
+    segments[head].number = captured++;
+
+    head = (head + 1) % (unsigned)segments.size();
+    stored = std::min(stored + 1, (unsigned)segments.size());
+}
+
+double SegmentBuffer::elapsed() const {
+    QMutexLocker locker(&mutex);
+    return epoch.isValid() ? epoch.nsecsElapsed() / 1e9 : 0.0;
+}
+
+unsigned SegmentBuffer::count() const {
+    QMutexLocker locker(&mutex);
+    return stored;
+}
+
+unsigned SegmentBuffer::capacity() const {
+    QMutexLocker locker(&mutex);
+    return (unsigned)segments.size();
+}
+
+unsigned long long SegmentBuffer::total() const {
+    QMutexLocker locker(&mutex);
+    return captured;
+}
+
+unsigned SegmentBuffer::length() const {
+    QMutexLocker locker(&mutex);
+    return slotLength;
+}
+
+unsigned SegmentBuffer::pretrigger() const {
+    QMutexLocker locker(&mutex);
+    return slotPretrigger;
+}
+
+unsigned SegmentBuffer::channels() const {
+    QMutexLocker locker(&mutex);
+    return slotChannels;
+}
+
+double SegmentBuffer::interval() const {
+    QMutexLocker locker(&mutex);
+    return sampleInterval;
+}
+
+bool SegmentBuffer::get(unsigned index, Segment &segment, std::vector<std::vector<double>> &samples) const {
+    QMutexLocker locker(&mutex);
+    if (index >= stored) return false;
+
+    const unsigned capacity = (unsigned)segments.size();
+    const unsigned slotIndex = (head + capacity - stored + index) % capacity;
+    const double *slot = storage.data() + (size_t)slotIndex * slotChannels * slotLength;
+    segment = segments[slotIndex];
+    samples.resize(slotChannels);
+    for (unsigned channel = 0; channel < slotChannels; ++channel, slot += slotLength)
+        samples[channel].assign(slot, slot + slotLength);
+    return true;
+}
+
+bool SegmentBuffer::get(unsigned index, Segment &segment) const {
+    QMutexLocker locker(&mutex);
+    if (index >= stored) return false;
+
+    const unsigned capacity = (unsigned)segments.size();
+    segment = segments[(head + capacity - stored + index) % capacity];
+    return true;
+}
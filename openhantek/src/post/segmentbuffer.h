@@ -0,0 +1,83 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QElapsedTimer>
+#include <QMutex>
+
+#include <vector>
+
+#include "hantekprotocol/types.h"
+
+/// Upper limit of the memory for the samples of all segments
+#define SEGMENT_BUFFER_BYTES (256u << 20)
+
+/// \brief Preallocated ring of trigger segments for the segmented acquisition.
+/// All segments have the same length and contain every channel. Memory is only allocated by `configure()`,
+/// storing a segment just copies the samples. When the buffer is full, the oldest segment is overwritten.
+/// The buffer is filled by the post processing thread and read by the GUI, all methods are thread safe.
+class SegmentBuffer {
+  public:
+    /// \brief Segment meta data
+    struct Segment {
+        unsigned long long number = 0; ///< Running number since the last `clear()`, starting with 0
+        double timestamp = 0.0;        ///< Time of the trigger event in s since the last `clear()`
+        double triggerFraction = 0.0;  ///< Sub-sample offset of the trigger point, see SoftwareTrigger::compute
+    };
+
+    /// \brief Resize the buffer. The content is discarded if any of the parameters changed.
+    /// The buffer holds fewer segments than requested if they would need more than SEGMENT_BUFFER_BYTES.
+    /// \param channels Number of channels per segment
+    /// \param length Number of samples per segment and channel
+    /// \param pretrigger Number of samples before the trigger point
+    /// \param capacity Maximum number of stored segments
+    /// \param interval Time between two samples in s
+    /// \return true if the buffer was reset
+    bool configure(unsigned channels, unsigned length, unsigned pretrigger, unsigned capacity, double interval);
+
+    /// \brief Remove all segments and reset the running number.
+    void clear();
+
+    /// \brief Store a new segment.
+    /// \param samples One sample vector per channel, an empty vector marks an unused channel
+    /// \param start Index of the first sample of the segment within the vectors
+    /// \param segment The meta data, the running number is assigned by the buffer
+    void append(const std::vector<const std::vector<double> *> &samples, size_t start, const Segment &segment);
+
+    /// \return Seconds since the last reset, the time base for the segment timestamps
+    double elapsed() const;
+
+    /// \return The number of stored segments
+    unsigned count() const;
+    /// \return The number of segments the buffer holds, limited by the memory they need
+    unsigned capacity() const;
+    /// \return The number of segments captured since the last `clear()`, including overwritten ones
+    unsigned long long total() const;
+    unsigned length() const;
+    unsigned pretrigger() const;
+    unsigned channels() const;
+    double interval() const;
+
+    /// \brief Copy a stored segment.
+    /// \param index 0 is the oldest stored segment, `count() - 1` the latest one
+    /// \param segment Receives the meta data
+    /// \param samples Receives one vector per channel, unused channels contain NaN
+    /// \return false if the index is out of range
+    bool get(unsigned index, Segment &segment, std::vector<std::vector<double>> &samples) const;
+    /// \brief Get the meta data of a stored segment only.
+    bool get(unsigned index, Segment &segment) const;
+
+  private:
+    mutable QMutex mutex;
+    QElapsedTimer epoch;             ///< Started by every reset
+    std::vector<double> storage;     ///< capacity * channels * length samples
+    std::vector<Segment> segments;   ///< Meta data for each slot of the ring
+    unsigned requestedCapacity = 0;  ///< The capacity given to `configure()`
+    unsigned slotChannels = 0;
+    unsigned slotLength = 0;
+    unsigned slotPretrigger = 0;
+    double sampleInterval = 0.0;
+    unsigned head = 0;               ///< The slot that is written next
+    unsigned stored = 0;             ///< Number of valid slots
+    unsigned long long captured = 0; ///< Running segment number
+};
@@ -0,0 +1,151 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <algorithm>
+#include <cmath>
+
+#include "segmentedacquisition.h"
+
+#include "post/ppresult.h"
+#include "post/segmentbuffer.h"
+#include "post/softwaretrigger.h"
+#include "scopesettings.h"
+#include "utils/metrics.h"
+#include "viewconstants.h"
+
+/// Upper limit of the samples per segment and channel in roll mode
+static const double MAX_ROLL_SEGMENT_LENGTH = 1 << 22;
+
+SegmentedAcquisition::SegmentedAcquisition(const DsoSettingsScope *scope, SegmentBuffer *buffer)
+    : scope(scope), buffer(buffer) {
+    capturedSegments = Metrics::Registry::get()->counter("segments.captured");
+}
+
+void SegmentedAcquisition::process(PPresult *result) {
+    if (scope->segments.enabled)
+        capture(result);
+    else
+        history.clear();
+    generateGraphs(result);
+}
+
+void SegmentedAcquisition::capture(PPresult *result) {
+    const ChannelID source = scope->trigger.source;
+    const unsigned channelCount = result->channelCount();
+    if (scope->trigger.special || source >= channelCount || !scope->voltage[source].used ||
+        result->data(source)->voltage.sample.empty())
+        return;
+
+    // A segment is one screen width, but not longer than the record. Roll mode blocks are continued, so the
+    // segments may span several of them.
+    const double interval = result->data(source)->voltage.interval;
+    const double maximum = result->append ? MAX_ROLL_SEGMENT_LENGTH : result->data(source)->voltage.sample.size();
+    const unsigned length = (unsigned)std::min(scope->horizontal.timebase * DIVS_TIME / interval, maximum);
+    const unsigned pretrigger = std::min((unsigned)(scope->trigger.position * length), length - 1);
+    if (length < 2) return;
+    if (buffer->configure(channelCount, length, pretrigger, scope->segments.capacity, interval)) history.clear();
+
+    // Collect the records. In roll mode the end of the previous block is prepended, so that trigger events
+    // close to the block boundary get a complete segment.
+    const bool continued = result->append && history.size() == channelCount;
+    size_t tail = 0;
+    std::vector<const std::vector<double> *> records(channelCount);
+    for (ChannelID channel = 0; channel < channelCount; ++channel) {
+        const std::vector<double> &samples = result->data(channel)->voltage.sample;
+        if (continued) {
+            if (channel == source) tail = history[channel].size();
+            history[channel].insert(history[channel].end(), samples.begin(), samples.end());
+            records[channel] = &history[channel];
+        } else
+            records[channel] = &samples;
+    }
+    if (!continued) holdoff = 0;
+
+    const std::vector<double> &trigger = *records[source];
+    const size_t recordLength = trigger.size();
+    const unsigned posttrigger = length - pretrigger;
+
+    // Trigger events within the tail have been stored already if their segment was complete
+    size_t reportFrom = pretrigger;
+    if (tail + pretrigger + 1 > length) reportFrom = std::max(reportFrom, tail + pretrigger + 1 - length);
+
+    edges.clear();
+    SoftwareTrigger::findEdges(trigger.data(), 0, recordLength, scope->voltage[source].trigger,
+                               scope->trigger.swTriggerHysteresis * scope->gain(source), scope->trigger.slope, edges,
+                               reportFrom);
+
+    const double now = buffer->elapsed();
+    for (double edge : edges) {
+        const size_t triggerSample = (size_t)std::floor(edge) + 1;
+        const size_t start = triggerSample - pretrigger;
+        if (triggerSample + posttrigger > recordLength) break;
+        if (start < holdoff) continue; // Segments don't overlap
+
+        SegmentBuffer::Segment segment;
+        segment.triggerFraction = triggerSample - edge;
+        // The record ends about now, the exact time of the trigger event is derived from its position
+        segment.timestamp = now - (recordLength - edge) * interval;
+        buffer->append(records, start, segment);
+        capturedSegments->add();
+        holdoff = start + length;
+    }
+
+    // Keep the end of a roll mode block for the next one
+    if (!result->append) {
+        history.clear();
+        return;
+    }
+    const size_t keep = std::min((size_t)length, recordLength);
+    holdoff = holdoff > recordLength - keep ? holdoff - (recordLength - keep) : 0;
+    history.resize(channelCount);
+    for (ChannelID channel = 0; channel < channelCount; ++channel) {
+        const std::vector<double> &record = *records[channel];
+        if (record.size() < keep) {
+            history[channel].clear();
+        } else if (&record == &history[channel]) {
+            history[channel].erase(history[channel].begin(), history[channel].end() - keep);
+        } else {
+            history[channel].assign(record.end() - keep, record.end());
+        }
+    }
+}
+
+void SegmentedAcquisition::generateGraphs(PPresult *result) {
+    const unsigned count = buffer->count();
+    unsigned first = 0;
+    unsigned shown = 0;
+    if (scope->segments.review >= 0 && (unsigned)scope->segments.review < count) {
+        first = (unsigned)scope->segments.review;
+        shown = 1;
+    } else {
+        shown = std::min(scope->segments.overlay, count);
+        first = count - shown;
+    }
+
+    result->vaChannelSegments.resize(scope->voltage.size());
+    for (ChannelGraph &graph : result->vaChannelSegments) graph.clear();
+    result->segmentVertexCount = shown ? buffer->length() : 0;
+    if (!shown) return;
+
+    // What's the horizontal distance between sampling points?
+    const float horizontalFactor = (float)(buffer->interval() / scope->horizontal.timebase);
+
+    for (unsigned index = first; index < first + shown; ++index) {
+        SegmentBuffer::Segment segment;
+        if (!buffer->get(index, segment, segmentSamples)) break;
+        const float shift = (float)segment.triggerFraction * horizontalFactor - DIVS_TIME / 2;
+
+        for (ChannelID channel = 0; channel < scope->voltage.size() && channel < segmentSamples.size(); ++channel) {
+            const std::vector<double> &samples = segmentSamples[channel];
+            if (!scope->voltage[channel].used || samples.empty() || std::isnan(samples.front())) continue;
+
+            ChannelGraph &target = result->vaChannelSegments[channel];
+            target.reserve(shown * samples.size());
+            const float gain = (float)scope->gain(channel);
+            const float offset = (float)scope->voltage[channel].offset;
+            const float invert = scope->voltage[channel].inverted ? -1.0f : 1.0f;
+            for (unsigned position = 0; position < samples.size(); ++position)
+                target.push_back(QVector3D(position * horizontalFactor + shift,
+                                           (float)samples[position] / gain * invert + offset, 0.0));
+        }
+    }
+}
@@ -0,0 +1,41 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <vector>
+
+#include "processor.h"
+
+struct DsoSettingsScope;
+class PPresult;
+class SegmentBuffer;
+namespace Metrics {
+class Counter;
+}
+
+/// \brief Segmented acquisition: Stores every trigger event of a record in a SegmentBuffer.
+/// The software trigger of the graph only shows the first trigger event of a record. This processor
+/// slices all trigger events of the record into segments of one screen width. Consecutive roll mode
+/// blocks are treated as one continuous stream, so segments spanning two blocks are not lost.
+/// It also creates the vertices for the segment overlay or the reviewed segment.
+class SegmentedAcquisition : public Processor {
+  public:
+    SegmentedAcquisition(const DsoSettingsScope *scope, SegmentBuffer *buffer);
+    virtual void process(PPresult *result) override;
+
+  private:
+    /// \brief Find all trigger events of the result and store them in the segment buffer.
+    void capture(PPresult *result);
+    /// \brief Create the vertices of the segments that should be displayed.
+    void generateGraphs(PPresult *result);
+
+    const DsoSettingsScope *scope;
+    SegmentBuffer *buffer;
+    Metrics::Counter *capturedSegments;
+
+    /// Roll mode: End of the previous block followed by the new block
+    std::vector<std::vector<double>> history;
+    size_t holdoff = 0;                              ///< Segments must not start before this sample of the record
+    std::vector<double> edges;                       ///< Trigger positions of the current record
+    std::vector<std::vector<double>> segmentSamples; ///< Copy of a stored segment for the vertex generation
+};
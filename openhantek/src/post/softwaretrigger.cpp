@@ -4,18 +4,104 @@
 #include "viewconstants.h"
 #include "utils/printutils.h"
 
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SOFTWARETRIGGER_SSE2
+#endif
+
+namespace {
+/// Number of samples that are compared at once. Bit k of a mask belongs to sample k of the block.
+const unsigned BLOCK = 8;
+
+/// \brief Compare a block of samples against the trigger and the arming level.
+/// For a rising edge a sample triggers if it is above the trigger level and arms if it is below the
+/// arming level. For a falling edge the comparisons are mirrored.
+template <bool rising>
+inline void blockMasks(const double *samples, double level, double armLevel, unsigned &triggerMask,
+                       unsigned &armMask) {
+#ifdef SOFTWARETRIGGER_SSE2
+    const __m128d vLevel = _mm_set1_pd(level);
+    const __m128d vArm = _mm_set1_pd(armLevel);
+    triggerMask = 0;
+    armMask = 0;
+    for (unsigned k = 0; k < BLOCK; k += 2) {
+        const __m128d v = _mm_loadu_pd(samples + k);
+        const __m128d t = rising ? _mm_cmpgt_pd(v, vLevel) : _mm_cmplt_pd(v, vLevel);
+        const __m128d a = rising ? _mm_cmplt_pd(v, vArm) : _mm_cmpgt_pd(v, vArm);
+        triggerMask |= (unsigned)_mm_movemask_pd(t) << k;
+        armMask |= (unsigned)_mm_movemask_pd(a) << k;
+    }
+#else
+    triggerMask = 0;
+    armMask = 0;
+    for (unsigned k = 0; k < BLOCK; ++k) {
+        triggerMask |= (unsigned)(rising ? samples[k] > level : samples[k] < level) << k;
+        armMask |= (unsigned)(rising ? samples[k] < armLevel : samples[k] > armLevel) << k;
+    }
+#endif
+}
+
+template <bool rising>
+void findEdgesImpl(const double *samples, size_t begin, size_t end, double level, double hysteresis,
+                   std::vector<double> &edges, size_t reportFrom, size_t maxEdges) {
+    const double armLevel = rising ? level - hysteresis : level + hysteresis;
+    bool armed = false;
+
+    // Apply one sample to the trigger state machine. Returns false if enough edges have been found.
+    auto step = [&](size_t index, bool triggers, bool arms) {
+        if (!armed) {
+            armed = arms;
+            return true;
+        }
+        if (!triggers) return true;
+        armed = arms;
+        if (index < reportFrom) return true;
+        // The previous sample is on the other side of the level, interpolate the exact crossing
+        const double previous = samples[index - 1];
+        edges.push_back((double)(index - 1) + (level - previous) / (samples[index] - previous));
+        return !maxEdges || edges.size() < maxEdges;
+    };
+
+    size_t index = begin;
+    for (; index + BLOCK <= end; index += BLOCK) {
+        unsigned triggerMask, armMask;
+        blockMasks<rising>(samples + index, level, armLevel, triggerMask, armMask);
+        // Nothing can change while disarmed without arming samples or while armed without triggering samples
+        if (armed ? !triggerMask : !armMask) continue;
+        for (unsigned k = 0; k < BLOCK; ++k)
+            if (!step(index + k, (triggerMask >> k) & 1, (armMask >> k) & 1)) return;
+    }
+    for (; index < end; ++index) {
+        const double v = samples[index];
+        if (!step(index, rising ? v > level : v < level, rising ? v < armLevel : v > armLevel)) return;
+    }
+}
+}
+
+void SoftwareTrigger::findEdges(const double *samples, size_t begin, size_t end, double level, double hysteresis,
+                                Dso::Slope slope, std::vector<double> &edges, size_t reportFrom, size_t maxEdges) {
+    if (hysteresis < 0.0) hysteresis = 0.0;
+    if (slope == Dso::Slope::Positive)
+        findEdgesImpl<true>(samples, begin, end, level, hysteresis, edges, reportFrom, maxEdges);
+    else
+        findEdgesImpl<false>(samples, begin, end, level, hysteresis, edges, reportFrom, maxEdges);
+}
+
 SoftwareTrigger::PrePostStartTriggerSamples SoftwareTrigger::compute(const PPresult *data,
                                                                               const DsoSettingsScope *scope)
 {
     unsigned int preTrigSamples = 0;
     unsigned int postTrigSamples = 0;
     unsigned int swTriggerStart = 0;
+    double swTriggerFraction = 0.0;
     ChannelID channel = scope->trigger.source;
 
     // Trigger channel not in use
     if (!scope->voltage[channel].used || !data->data(channel) ||
             data->data(channel)->voltage.sample.empty())
-        return PrePostStartTriggerSamples(preTrigSamples, postTrigSamples, swTriggerStart);
+        return PrePostStartTriggerSamples(preTrigSamples, postTrigSamples, swTriggerStart, swTriggerFraction);
 
     const std::vector<double>& samples = data->data(channel)->voltage.sample;
     double level = scope->voltage[channel].trigger;
@@ -32,42 +118,23 @@ SoftwareTrigger::PrePostStartTriggerSamples SoftwareTrigger::compute(const PPres
         // For now #3 is chosen
         timestampDebug(QString("Too few samples to make a steady "
                                "picture. Decrease sample rate"));
-        return PrePostStartTriggerSamples(preTrigSamples, postTrigSamples, swTriggerStart);
+        return PrePostStartTriggerSamples(preTrigSamples, postTrigSamples, swTriggerStart, swTriggerFraction);
     }
     preTrigSamples = (unsigned)(scope->trigger.position * samplesDisplay);
     postTrigSamples = (unsigned)sampleCount - ((unsigned)samplesDisplay - preTrigSamples);
 
-    double prev;
-    bool (*opcmp)(double,double,double);
-    bool (*smplcmp)(double,double);
-    if (scope->trigger.slope == Dso::Slope::Positive) {
-        prev = INT_MAX;
-        opcmp = [](double value, double level, double prev) { return value > level && prev <= level;};
-        smplcmp = [](double sampleK, double value) { return sampleK >= value;};
-    } else {
-        prev = INT_MIN;
-        opcmp = [](double value, double level, double prev) { return value < level && prev >= level;};
-        smplcmp = [](double sampleK, double value) { return sampleK < value;};
-    }
+    // The samples before the pretrigger area are only used to arm the trigger
+    std::vector<double> edges;
+    const double hysteresis = scope->trigger.swTriggerHysteresis * scope->gain(channel);
+    findEdges(samples.data(), 0, postTrigSamples, level, hysteresis, scope->trigger.slope, edges, preTrigSamples, 1);
 
-    for (unsigned int i = preTrigSamples; i < postTrigSamples; i++) {
-        double value = samples[i];
-        if (opcmp(value, level, prev)) {
-            unsigned rising = 0;
-            for (unsigned int k = i + 1; k < i + scope->trigger.swTriggerSampleSet && k < sampleCount; k++) {
-                if (smplcmp(samples[k], value)) { rising++; }
-            }
-            if (rising > scope->trigger.swTriggerThreshold) {
-                swTriggerStart = i;
-                break;
-            }
-        }
-        prev = value;
-    }
-    if (swTriggerStart == 0) {
+    if (edges.empty()) {
         timestampDebug(QString("Trigger not asserted. Data ignored"));
         preTrigSamples = 0; // preTrigSamples may never be greater than swTriggerStart
         postTrigSamples = 0;
+    } else {
+        swTriggerStart = (unsigned)std::floor(edges.front()) + 1;
+        swTriggerFraction = swTriggerStart - edges.front();
     }
-    return PrePostStartTriggerSamples(preTrigSamples, postTrigSamples, swTriggerStart);
+    return PrePostStartTriggerSamples(preTrigSamples, postTrigSamples, swTriggerStart, swTriggerFraction);
 }
@@ -1,5 +1,10 @@
 #pragma once
+#include <stddef.h>
 #include <tuple>
+#include <vector>
+
+#include "hantekdso/enums.h"
+
 struct DsoSettingsScope;
 class PPresult;
 
@@ -11,12 +16,33 @@ class PPresult;
  */
 class SoftwareTrigger {
   public:
-    typedef std::tuple<unsigned, unsigned, unsigned> PrePostStartTriggerSamples;
+    typedef std::tuple<unsigned, unsigned, unsigned, double> PrePostStartTriggerSamples;
     /**
      * @brief Computes a software trigger point.
      * @param data Analysed data from the
      * @param scope Scope settings
-     * @return Returns a tuple of positions [preTrigger, postTrigger, startTrigger]
+     * @return Returns a tuple of positions [preTrigger, postTrigger, startTrigger, startFraction].
+     * startTrigger is the first sample beyond the trigger level, startFraction the part of a sample
+     * interval the exact level crossing lies before it. Shift the graph by that fraction for a jitter free display.
      */
     static PrePostStartTriggerSamples compute(const PPresult *data, const DsoSettingsScope *scope);
+
+    /**
+     * @brief Finds all trigger edges in a sample buffer.
+     * An edge is armed as soon as the signal was below `level - hysteresis` (rising slope) or above
+     * `level + hysteresis` (falling slope) and fires when the signal crosses `level` afterwards. Noise smaller
+     * than the hysteresis therefore never causes a trigger. Blocks of samples without any state change are
+     * skipped with vectorized comparisons.
+     * @param samples The sample buffer
+     * @param begin First sample to look at, the trigger is not armed at this point
+     * @param end One past the last sample to look at
+     * @param level The trigger level
+     * @param hysteresis Distance from the level the signal has to reach to re-arm the trigger, >= 0
+     * @param slope Rising or falling edges
+     * @param edges Receives the interpolated sub-sample positions of the level crossings
+     * @param reportFrom Edges located before this sample index are not reported
+     * @param maxEdges Stop after this many edges were found, 0 for no limit
+     */
+    static void findEdges(const double *samples, size_t begin, size_t end, double level, double hysteresis,
+                          Dso::Slope slope, std::vector<double> &edges, size_t reportFrom = 0, size_t maxEdges = 0);
 };
@@ -14,214 +14,320 @@
 #include "glscope.h"
 #include "settings.h"
 #include "utils/printutils.h"
+#include "viewconstants.h"
+
+
+#include <algorithm>
+#include <thread>
+
+/// Upper limit of the FFT threads
+static const unsigned MAX_THREADS = 8;
+/// Transforms of more samples in total are distributed over several threads
+static const size_t PARALLEL_SAMPLES = 1 << 16;
+/// Plans up to this length are measured, longer ones estimated because measuring takes too long
+static const size_t MEASURE_LIMIT = 1 << 14;
+/// Shortest Welch segment
+static const size_t MIN_SEGMENT = 64;
+
+/// \brief Fill the buffer with the window function.
+static void createWindow(Dso::WindowFunction window, double *buffer, unsigned length) {
+    unsigned int windowEnd = length - 1;
+    switch (window) {
+    case Dso::WindowFunction::HAMMING:
+        for (unsigned int windowPosition = 0; windowPosition < length; ++windowPosition)
+            *(buffer + windowPosition) = 0.54 - 0.46 * cos(2.0 * M_PI * windowPosition / windowEnd);
+        break;
+    case Dso::WindowFunction::HANN:
+        for (unsigned int windowPosition = 0; windowPosition < length; ++windowPosition)
+            *(buffer + windowPosition) = 0.5 * (1.0 - cos(2.0 * M_PI * windowPosition / windowEnd));
+        break;
+    case Dso::WindowFunction::COSINE:
+        for (unsigned int windowPosition = 0; windowPosition < length; ++windowPosition)
+            *(buffer + windowPosition) = sin(M_PI * windowPosition / windowEnd);
+        break;
+    case Dso::WindowFunction::LANCZOS:
+        for (unsigned int windowPosition = 0; windowPosition < length; ++windowPosition) {
+            double sincParameter = (2.0 * windowPosition / windowEnd - 1.0) * M_PI;
+            if (sincParameter == 0)
+                *(buffer + windowPosition) = 1;
+            else
+                *(buffer + windowPosition) = sin(sincParameter) / sincParameter;
+        }
+        break;
+    case Dso::WindowFunction::BARTLETT:
+        for (unsigned int windowPosition = 0; windowPosition < length; ++windowPosition)
+            *(buffer + windowPosition) =
+                2.0 / windowEnd * (windowEnd / 2 - std::abs((double)(windowPosition - windowEnd / 2.0)));
+        break;
+    case Dso::WindowFunction::TRIANGULAR:
+        for (unsigned int windowPosition = 0; windowPosition < length; ++windowPosition)
+            *(buffer + windowPosition) =
+                2.0 / length * (length / 2 - std::abs((double)(windowPosition - windowEnd / 2.0)));
+        break;
+    case Dso::WindowFunction::GAUSS: {
+        double sigma = 0.4;
+        for (unsigned int windowPosition = 0; windowPosition < length; ++windowPosition)
+            *(buffer + windowPosition) =
+                exp(-0.5 * pow(((windowPosition - windowEnd / 2) / (sigma * windowEnd / 2)), 2));
+    } break;
+    case Dso::WindowFunction::BARTLETTHANN:
+        for (unsigned int windowPosition = 0; windowPosition < length; ++windowPosition)
+            *(buffer + windowPosition) = 0.62 -
+                                         0.48 * std::abs((double)(windowPosition / windowEnd - 0.5)) -
+                                         0.38 * cos(2.0 * M_PI * windowPosition / windowEnd);
+        break;
+    case Dso::WindowFunction::BLACKMAN: {
+        double alpha = 0.16;
+        for (unsigned int windowPosition = 0; windowPosition < length; ++windowPosition)
+            *(buffer + windowPosition) = (1 - alpha) / 2 -
+                                         0.5 * cos(2.0 * M_PI * windowPosition / windowEnd) +
+                                         alpha / 2 * cos(4.0 * M_PI * windowPosition / windowEnd);
+    } break;
+    // case Dso::WindowFunction::WINDOW_KAISER:
+    // TODO WINDOW_KAISER
+    // double alpha = 3.0;
+    // for(unsigned int windowPosition = 0; windowPosition <
+    // length; ++windowPosition)
+    //*(window + windowPosition) = ;
+    // break;
+    case Dso::WindowFunction::NUTTALL:
+        for (unsigned int windowPosition = 0; windowPosition < length; ++windowPosition)
+            *(buffer + windowPosition) = 0.355768 -
+                                         0.487396 * cos(2 * M_PI * windowPosition / windowEnd) +
+                                         0.144232 * cos(4 * M_PI * windowPosition / windowEnd) -
+                                         0.012604 * cos(6 * M_PI * windowPosition / windowEnd);
+        break;
+    case Dso::WindowFunction::BLACKMANHARRIS:
+        for (unsigned int windowPosition = 0; windowPosition < length; ++windowPosition)
+            *(buffer + windowPosition) = 0.35875 -
+                                         0.48829 * cos(2 * M_PI * windowPosition / windowEnd) +
+                                         0.14128 * cos(4 * M_PI * windowPosition / windowEnd) -
+                                         0.01168 * cos(6 * M_PI * windowPosition / windowEnd);
+        break;
+    case Dso::WindowFunction::BLACKMANNUTTALL:
+        for (unsigned int windowPosition = 0; windowPosition < length; ++windowPosition)
+            *(buffer + windowPosition) = 0.3635819 -
+                                         0.4891775 * cos(2 * M_PI * windowPosition / windowEnd) +
+                                         0.1365995 * cos(4 * M_PI * windowPosition / windowEnd) -
+                                         0.0106411 * cos(6 * M_PI * windowPosition / windowEnd);
+        break;
+    case Dso::WindowFunction::FLATTOP:
+        for (unsigned int windowPosition = 0; windowPosition < length; ++windowPosition)
+            *(buffer + windowPosition) = 1.0 - 1.93 * cos(2 * M_PI * windowPosition / windowEnd) +
+                                         1.29 * cos(4 * M_PI * windowPosition / windowEnd) -
+                                         0.388 * cos(6 * M_PI * windowPosition / windowEnd) +
+                                         0.032 * cos(8 * M_PI * windowPosition / windowEnd);
+        break;
+    default: // Dso::WINDOW_RECTANGULAR
+        for (unsigned int windowPosition = 0; windowPosition < length; ++windowPosition)
+            *(buffer + windowPosition) = 1.0;
+    }
+}
 
 /// \brief Analyzes the data from the dso.
 SpectrumGenerator::SpectrumGenerator(const DsoSettingsScope *scope, const DsoSettingsPostProcessing *postprocessing)
     : scope(scope), postprocessing(postprocessing) {}
 
-SpectrumGenerator::~SpectrumGenerator() {
+SpectrumGenerator::~SpectrumGenerator() { release(); }
+
+void SpectrumGenerator::release() {
+    if (plan) fftw_destroy_plan(plan);
+    plan = nullptr;
     if (lastWindowBuffer) fftw_free(lastWindowBuffer);
+    lastWindowBuffer = nullptr;
+    for (Worker &worker : workers) {
+        fftw_free(worker.input);
+        fftw_free(worker.output);
+    }
+    workers.clear();
+    transformLength = 0;
+}
+
+void SpectrumGenerator::prepare(size_t length) {
+    if (!plan || length != transformLength) {
+        release();
+        transformLength = length;
+        workers.resize(std::max(std::min(std::thread::hardware_concurrency(), MAX_THREADS), 1u));
+        for (Worker &worker : workers) {
+            worker.input = fftw_alloc_real(length);
+            worker.output = fftw_alloc_real(length);
+            worker.power.resize(length / 2 + 1);
+        }
+        lastWindowBuffer = fftw_alloc_real(length);
+        lastWindow = (Dso::WindowFunction)-1;
+
+        // Measuring overwrites the buffers, they are filled before every transform anyway
+        plan = fftw_plan_r2r_1d((int)length, workers.front().input, workers.front().output, FFTW_R2HC,
+                                length <= MEASURE_LIMIT ? FFTW_MEASURE : FFTW_ESTIMATE);
+    }
+    if (lastWindow != postprocessing->spectrumWindow) {
+        lastWindow = postprocessing->spectrumWindow;
+        createWindow(lastWindow, lastWindowBuffer, (unsigned)length);
+    }
+}
+
+void SpectrumGenerator::powerSpectrum(const double *samples, size_t segments, size_t step, std::vector<double> &power) {
+    const size_t length = transformLength;
+    auto transform = [this, samples, step, length](Worker *worker, size_t first, size_t last) {
+        std::fill(worker->power.begin(), worker->power.end(), 0.0);
+        for (size_t segment = first; segment < last; ++segment) {
+            const double *segmentSamples = samples + segment * step;
+            for (size_t position = 0; position < length; ++position)
+                worker->input[position] = lastWindowBuffer[position] * segmentSamples[position];
+            // Executing a plan with other buffers is thread safe
+            fftw_execute_r2r(plan, worker->input, worker->output);
+
+            // Half complex order: r0, r1, ..., r(n/2), i((n+1)/2-1), ..., i1
+            const double *output = worker->output;
+            worker->power[0] += output[0] * output[0];
+            for (size_t bin = 1; bin < (length + 1) / 2; ++bin)
+                worker->power[bin] += output[bin] * output[bin] + output[length - bin] * output[length - bin];
+            if (length % 2 == 0) worker->power[length / 2] += output[length / 2] * output[length / 2];
+        }
+    };
+
+    size_t threads = 1;
+    if (segments > 1 && segments * length >= PARALLEL_SAMPLES) threads = std::min(workers.size(), segments);
+    std::vector<std::thread> pool;
+    for (size_t thread = 1; thread < threads; ++thread)
+        pool.emplace_back(transform, &workers[thread], segments * thread / threads,
+                          segments * (thread + 1) / threads);
+    transform(&workers.front(), 0, segments / threads);
+    for (std::thread &thread : pool) thread.join();
+
+    power = workers.front().power;
+    for (size_t thread = 1; thread < threads; ++thread)
+        for (size_t bin = 0; bin < power.size(); ++bin) power[bin] += workers[thread].power[bin];
+    if (segments > 1)
+        for (double &value : power) value /= segments;
+}
+
+void SpectrumGenerator::accumulate(Accumulator &accumulator, Dso::SpectrumAveraging averaging, unsigned count,
+                                   size_t length, double interval) {
+    // Restart the averaging if the bins have changed
+    if (accumulator.power.size() != framePower.size() || accumulator.interval != interval ||
+        accumulator.averaging != averaging || accumulator.window != postprocessing->spectrumWindow) {
+        accumulator.frames = 0;
+        accumulator.interval = interval;
+        accumulator.averaging = averaging;
+        accumulator.window = postprocessing->spectrumWindow;
+    }
+    accumulator.length = length;
+
+    std::vector<double> &power = accumulator.power;
+    if (!accumulator.frames || averaging == Dso::SpectrumAveraging::OFF || averaging == Dso::SpectrumAveraging::WELCH) {
+        power.swap(framePower);
+    } else if (averaging == Dso::SpectrumAveraging::MAXHOLD) {
+        for (size_t bin = 0; bin < power.size(); ++bin) power[bin] = std::max(power[bin], framePower[bin]);
+    } else if (averaging == Dso::SpectrumAveraging::MINHOLD) {
+        for (size_t bin = 0; bin < power.size(); ++bin) power[bin] = std::min(power[bin], framePower[bin]);
+    } else {
+        // The linear average weights all frames equally until `count` frames are averaged
+        const double weight = averaging == Dso::SpectrumAveraging::LINEAR
+                                  ? 1.0 / std::min(accumulator.frames + 1, count)
+                                  : 1.0 / count;
+        for (size_t bin = 0; bin < power.size(); ++bin) power[bin] += (framePower[bin] - power[bin]) * weight;
+    }
+    if (accumulator.frames < count) ++accumulator.frames;
+}
+
+void SpectrumGenerator::output(const Accumulator &accumulator, ChannelID channel, DataChannel *channelData) const {
+    // Set sampling interval
+    channelData->spectrum.interval = accumulator.interval;
+    channelData->spectrum.sample.resize(accumulator.power.size());
+
+    // Convert values into dB (Relative to the reference level)
+    double offset = 60 - postprocessing->spectrumReference - 20 * log10(accumulator.length / 2.0);
+    double offsetLimit = postprocessing->spectrumLimit - postprocessing->spectrumReference;
+    for (size_t bin = 0; bin < accumulator.power.size(); ++bin) {
+        double value = 10 * log10(accumulator.power[bin]) + offset;
+
+        // Check if this value has to be limited
+        if (offsetLimit > value) value = offsetLimit;
+
+        channelData->spectrum.sample[bin] = value;
+    }
+
+    // Append a waterfall row, quantized to the screen height like the graph
+    const double magnitude = scope->spectrum[channel].magnitude;
+    const double screenOffset = scope->spectrum[channel].offset;
+    std::vector<uint8_t> &rows = channelData->spectrogram;
+    for (double value : channelData->spectrum.sample) {
+        const double level = ((value / magnitude + screenOffset) / DIVS_VOLTAGE + 0.5) * 255.0;
+        rows.push_back((uint8_t)std::max(std::min(level, 255.0), 0.0));
+    }
 }
 
 void SpectrumGenerator::process(PPresult *result) {
-    // Calculate frequencies and spectrums
+    const unsigned count = std::max(postprocessing->spectrumAverageCount, 2u);
+    accumulators.resize(result->channelCount());
+
+    // Calculate spectrums
     for (ChannelID channel = 0; channel < result->channelCount(); ++channel) {
         DataChannel *const channelData = result->modifyData(channel);
+        Accumulator &accumulator = accumulators[channel];
+        channelData->spectrogram.clear();
 
-        if (channelData->voltage.sample.empty()) {
+        if (channelData->voltage.sample.empty() || channel >= scope->spectrum.size() ||
+            !scope->spectrum[channel].used) {
             // Clear unused channels
             channelData->spectrum.interval = 0;
             channelData->spectrum.sample.clear();
+            accumulator.frames = 0;
+            accumulator.stream.clear();
             continue;
         }
+        const std::vector<double> &samples = channelData->voltage.sample;
+
+        if (result->append) {
+            // Roll mode blocks are too short for a useful spectrum, compute a continuous STFT over the stream
+            // instead. Every transform is one row, the Welch PSD doesn't apply.
+            const Dso::SpectrumAveraging averaging = postprocessing->spectrumAveraging == Dso::SpectrumAveraging::WELCH
+                                                         ? Dso::SpectrumAveraging::OFF
+                                                         : postprocessing->spectrumAveraging;
+            const size_t length = std::max<size_t>(postprocessing->spectrogramLength, MIN_SEGMENT);
+            const double overlap = std::max(std::min(postprocessing->spectrogramOverlap, 0.95), 0.0);
+            const size_t hop = std::max<size_t>((size_t)(length * (1.0 - overlap)), 1);
 
-        // Calculate new window
-        size_t sampleCount = channelData->voltage.sample.size();
-        if (!lastWindowBuffer || lastWindow != postprocessing->spectrumWindow || lastRecordLength != sampleCount) {
-            if (lastWindowBuffer) fftw_free(lastWindowBuffer);
-            lastWindowBuffer = fftw_alloc_real(sampleCount);
-            lastRecordLength = (unsigned)sampleCount;
-
-            unsigned int windowEnd = lastRecordLength - 1;
-            lastWindow = postprocessing->spectrumWindow;
-
-            switch (postprocessing->spectrumWindow) {
-            case Dso::WindowFunction::HAMMING:
-                for (unsigned int windowPosition = 0; windowPosition < lastRecordLength; ++windowPosition)
-                    *(lastWindowBuffer + windowPosition) = 0.54 - 0.46 * cos(2.0 * M_PI * windowPosition / windowEnd);
-                break;
-            case Dso::WindowFunction::HANN:
-                for (unsigned int windowPosition = 0; windowPosition < lastRecordLength; ++windowPosition)
-                    *(lastWindowBuffer + windowPosition) = 0.5 * (1.0 - cos(2.0 * M_PI * windowPosition / windowEnd));
-                break;
-            case Dso::WindowFunction::COSINE:
-                for (unsigned int windowPosition = 0; windowPosition < lastRecordLength; ++windowPosition)
-                    *(lastWindowBuffer + windowPosition) = sin(M_PI * windowPosition / windowEnd);
-                break;
-            case Dso::WindowFunction::LANCZOS:
-                for (unsigned int windowPosition = 0; windowPosition < lastRecordLength; ++windowPosition) {
-                    double sincParameter = (2.0 * windowPosition / windowEnd - 1.0) * M_PI;
-                    if (sincParameter == 0)
-                        *(lastWindowBuffer + windowPosition) = 1;
-                    else
-                        *(lastWindowBuffer + windowPosition) = sin(sincParameter) / sincParameter;
+            accumulator.stream.insert(accumulator.stream.end(), samples.begin(), samples.end());
+            prepare(length);
+            size_t position = 0;
+            for (; position + length <= accumulator.stream.size(); position += hop) {
+                powerSpectrum(accumulator.stream.data() + position, 1, 0, framePower);
+                accumulate(accumulator, averaging, count, length, 1.0 / channelData->voltage.interval / length);
+                output(accumulator, channel, channelData);
+            }
+            accumulator.stream.erase(accumulator.stream.begin(),
+                                     accumulator.stream.begin() + std::min(position, accumulator.stream.size()));
+            if (!position) {
+                // Not enough samples for a new row yet, keep showing the previous one
+                if (accumulator.power.empty()) {
+                    channelData->spectrum.interval = 0;
+                    channelData->spectrum.sample.clear();
+                } else {
+                    output(accumulator, channel, channelData);
+                    channelData->spectrogram.clear();
                 }
-                break;
-            case Dso::WindowFunction::BARTLETT:
-                for (unsigned int windowPosition = 0; windowPosition < lastRecordLength; ++windowPosition)
-                    *(lastWindowBuffer + windowPosition) =
-                        2.0 / windowEnd * (windowEnd / 2 - std::abs((double)(windowPosition - windowEnd / 2.0)));
-                break;
-            case Dso::WindowFunction::TRIANGULAR:
-                for (unsigned int windowPosition = 0; windowPosition < lastRecordLength; ++windowPosition)
-                    *(lastWindowBuffer + windowPosition) =
-                        2.0 / lastRecordLength *
-                        (lastRecordLength / 2 - std::abs((double)(windowPosition - windowEnd / 2.0)));
-                break;
-            case Dso::WindowFunction::GAUSS: {
-                double sigma = 0.4;
-                for (unsigned int windowPosition = 0; windowPosition < lastRecordLength; ++windowPosition)
-                    *(lastWindowBuffer + windowPosition) =
-                        exp(-0.5 * pow(((windowPosition - windowEnd / 2) / (sigma * windowEnd / 2)), 2));
-            } break;
-            case Dso::WindowFunction::BARTLETTHANN:
-                for (unsigned int windowPosition = 0; windowPosition < lastRecordLength; ++windowPosition)
-                    *(lastWindowBuffer + windowPosition) = 0.62 -
-                                                           0.48 * std::abs((double)(windowPosition / windowEnd - 0.5)) -
-                                                           0.38 * cos(2.0 * M_PI * windowPosition / windowEnd);
-                break;
-            case Dso::WindowFunction::BLACKMAN: {
-                double alpha = 0.16;
-                for (unsigned int windowPosition = 0; windowPosition < lastRecordLength; ++windowPosition)
-                    *(lastWindowBuffer + windowPosition) = (1 - alpha) / 2 -
-                                                           0.5 * cos(2.0 * M_PI * windowPosition / windowEnd) +
-                                                           alpha / 2 * cos(4.0 * M_PI * windowPosition / windowEnd);
-            } break;
-            // case Dso::WindowFunction::WINDOW_KAISER:
-            // TODO WINDOW_KAISER
-            // double alpha = 3.0;
-            // for(unsigned int windowPosition = 0; windowPosition <
-            // lastRecordLength; ++windowPosition)
-            //*(window + windowPosition) = ;
-            // break;
-            case Dso::WindowFunction::NUTTALL:
-                for (unsigned int windowPosition = 0; windowPosition < lastRecordLength; ++windowPosition)
-                    *(lastWindowBuffer + windowPosition) = 0.355768 -
-                                                           0.487396 * cos(2 * M_PI * windowPosition / windowEnd) +
-                                                           0.144232 * cos(4 * M_PI * windowPosition / windowEnd) -
-                                                           0.012604 * cos(6 * M_PI * windowPosition / windowEnd);
-                break;
-            case Dso::WindowFunction::BLACKMANHARRIS:
-                for (unsigned int windowPosition = 0; windowPosition < lastRecordLength; ++windowPosition)
-                    *(lastWindowBuffer + windowPosition) = 0.35875 -
-                                                           0.48829 * cos(2 * M_PI * windowPosition / windowEnd) +
-                                                           0.14128 * cos(4 * M_PI * windowPosition / windowEnd) -
-                                                           0.01168 * cos(6 * M_PI * windowPosition / windowEnd);
-                break;
-            case Dso::WindowFunction::BLACKMANNUTTALL:
-                for (unsigned int windowPosition = 0; windowPosition < lastRecordLength; ++windowPosition)
-                    *(lastWindowBuffer + windowPosition) = 0.3635819 -
-                                                           0.4891775 * cos(2 * M_PI * windowPosition / windowEnd) +
-                                                           0.1365995 * cos(4 * M_PI * windowPosition / windowEnd) -
-                                                           0.0106411 * cos(6 * M_PI * windowPosition / windowEnd);
-                break;
-            case Dso::WindowFunction::FLATTOP:
-                for (unsigned int windowPosition = 0; windowPosition < lastRecordLength; ++windowPosition)
-                    *(lastWindowBuffer + windowPosition) = 1.0 - 1.93 * cos(2 * M_PI * windowPosition / windowEnd) +
-                                                           1.29 * cos(4 * M_PI * windowPosition / windowEnd) -
-                                                           0.388 * cos(6 * M_PI * windowPosition / windowEnd) +
-                                                           0.032 * cos(8 * M_PI * windowPosition / windowEnd);
-                break;
-            default: // Dso::WINDOW_RECTANGULAR
-                for (unsigned int windowPosition = 0; windowPosition < lastRecordLength; ++windowPosition)
-                    *(lastWindowBuffer + windowPosition) = 1.0;
             }
+            continue;
         }
+        accumulator.stream.clear();
 
-        // Set sampling interval
-        channelData->spectrum.interval = 1.0 / channelData->voltage.interval / sampleCount;
-
-        // Number of real/complex samples
-        unsigned int dftLength = sampleCount / 2;
-
-        // Reallocate memory for samples if the sample count has changed
-        channelData->spectrum.sample.resize(sampleCount);
-
-        // Create sample buffer and apply window
-        std::unique_ptr<double[]> windowedValues = std::unique_ptr<double[]>(new double[sampleCount]);
-
-        for (unsigned int position = 0; position < sampleCount; ++position)
-            windowedValues[position] = lastWindowBuffer[position] * channelData->voltage.sample[position];
-
-        {
-            // Do discrete real to half-complex transformation
-            /// \todo Check if record length is multiple of 2
-            /// \todo Reuse plan and use FFTW_MEASURE to get fastest algorithm
-            fftw_plan fftPlan = fftw_plan_r2r_1d(sampleCount, windowedValues.get(),
-                                                 &channelData->spectrum.sample.front(), FFTW_R2HC, FFTW_ESTIMATE);
-            fftw_execute(fftPlan);
-            fftw_destroy_plan(fftPlan);
-        }
-
-        // Do an autocorrelation to get the frequency of the signal
-        std::unique_ptr<double[]> conjugateComplex = std::move(windowedValues);
-
-        // Real values
-        unsigned int position;
-        double correctionFactor = 1.0 / dftLength / dftLength;
-        conjugateComplex[0] = (channelData->spectrum.sample[0] * channelData->spectrum.sample[0]) * correctionFactor;
-        for (position = 1; position < dftLength; ++position)
-            conjugateComplex[position] =
-                (channelData->spectrum.sample[position] * channelData->spectrum.sample[position] +
-                 channelData->spectrum.sample[sampleCount - position] *
-                     channelData->spectrum.sample[sampleCount - position]) *
-                correctionFactor;
-        // Complex values, all zero for autocorrelation
-        conjugateComplex[dftLength] =
-            (channelData->spectrum.sample[dftLength] * channelData->spectrum.sample[dftLength]) * correctionFactor;
-        for (++position; position < sampleCount; ++position) conjugateComplex[position] = 0;
-
-        // Do half-complex to real inverse transformation
-        std::unique_ptr<double[]> correlation = std::unique_ptr<double[]>(new double[sampleCount]);
-        fftw_plan fftPlan =
-            fftw_plan_r2r_1d(sampleCount, conjugateComplex.get(), correlation.get(), FFTW_HC2R, FFTW_ESTIMATE);
-        fftw_execute(fftPlan);
-        fftw_destroy_plan(fftPlan);
-
-        // Get the frequency from the correlation results
-        double minimumCorrelation = correlation[0];
-        double peakCorrelation = 0;
-        unsigned int peakPosition = 0;
-
-        for (unsigned int position = 1; position < sampleCount / 2; ++position) {
-            if (correlation[position] > peakCorrelation && correlation[position] > minimumCorrelation * 2) {
-                peakCorrelation = correlation[position];
-                peakPosition = position;
-            } else if (correlation[position] < minimumCorrelation)
-                minimumCorrelation = correlation[position];
-        }
-        correlation.reset(nullptr);
-
-        // Calculate the frequency in Hz
-        if (peakPosition)
-            channelData->frequency = 1.0 / (channelData->voltage.interval * peakPosition);
-        else
-            channelData->frequency = 0;
-
-        // Finally calculate the real spectrum if we want it
-        if (scope->spectrum[channel].used) {
-            // Convert values into dB (Relative to the reference level)
-            double offset = 60 - postprocessing->spectrumReference - 20 * log10(dftLength);
-            double offsetLimit = postprocessing->spectrumLimit - postprocessing->spectrumReference;
-            for (std::vector<double>::iterator spectrumIterator = channelData->spectrum.sample.begin();
-                 spectrumIterator != channelData->spectrum.sample.end(); ++spectrumIterator) {
-                double value = 20 * log10(fabs(*spectrumIterator)) + offset;
-
-                // Check if this value has to be limited
-                if (offsetLimit > value) value = offsetLimit;
-
-                *spectrumIterator = value;
+        // The Welch PSD splits the record into half overlapping segments
+        const Dso::SpectrumAveraging averaging = postprocessing->spectrumAveraging;
+        size_t length = samples.size();
+        size_t segments = 1;
+        if (averaging == Dso::SpectrumAveraging::WELCH) {
+            const size_t segmentLength = std::max<size_t>((2 * samples.size() / (count + 1)) & ~(size_t)1, MIN_SEGMENT);
+            if (segmentLength < samples.size()) {
+                length = segmentLength;
+                segments = (samples.size() - length) / (length / 2) + 1;
             }
         }
+
+        prepare(length);
+        powerSpectrum(samples.data(), segments, length / 2, framePower);
+        accumulate(accumulator, averaging, count, length, 1.0 / channelData->voltage.interval / length);
+        output(accumulator, channel, channelData);
     }
 }
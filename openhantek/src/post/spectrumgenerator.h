@@ -17,10 +17,16 @@
 
 class DsoSettings;
 struct DsoSettingsScope;
+struct fftw_plan_s;
 
 /// \brief Analyzes the data from the dso.
-/// Calculates the spectrum and various data about the signal and saves the
-/// time-/frequencysteps between two values.
+/// Calculates the spectrum of the channels with enabled spectrum and saves the
+/// frequencysteps between two values. The power spectra are combined according to the
+/// spectrum averaging mode, either over consecutive frames or as Welch PSD over half
+/// overlapping segments of one record. The FFT plan and the window are reused as long as
+/// the transform length doesn't change, long records are transformed by several threads.
+/// Every computed spectrum is also quantized to one 8 bit row of the waterfall. Roll mode blocks
+/// are treated as one stream, transformed by a STFT with the configured length and overlap.
 class SpectrumGenerator : public Processor {
   public:
     SpectrumGenerator(const DsoSettingsScope* scope, const DsoSettingsPostProcessing* postprocessing);
@@ -28,9 +34,46 @@ class SpectrumGenerator : public Processor {
     virtual void process(PPresult *data) override;
 
   private:
+    /// \brief Buffers of one FFT thread, allocated by fftw for the SIMD alignment the plan expects.
+    struct Worker {
+        double *input = nullptr;
+        double *output = nullptr;
+        std::vector<double> power; ///< Sum of the segment power spectra of this thread
+    };
+    /// \brief Averaged power spectrum of one channel.
+    struct Accumulator {
+        std::vector<double> power;
+        unsigned frames = 0;        ///< Number of averaged frames
+        size_t length = 0;          ///< Transform length of the power bins
+        double interval = 0.0;      ///< Frequency step of the power bins
+        std::vector<double> stream; ///< Roll mode: Samples not yet transformed by the STFT
+        Dso::SpectrumAveraging averaging = Dso::SpectrumAveraging::OFF;
+        Dso::WindowFunction window = Dso::WindowFunction::RECTANGULAR;
+    };
+
+    /// \brief Create the plan, window and thread buffers for the given transform length, if it has changed.
+    void prepare(size_t length);
+    /// \brief Free the plan and all buffers.
+    void release();
+    /// \brief Compute the mean power spectrum of half complex bins 0..length/2.
+    /// \param samples The first segment.
+    /// \param segments Number of segments.
+    /// \param step Distance between the segment starts.
+    /// \param power Receives the length/2 + 1 power values.
+    void powerSpectrum(const double *samples, size_t segments, size_t step, std::vector<double> &power);
+    /// \brief Combine `framePower` with the averaged spectrum of a channel.
+    void accumulate(Accumulator &accumulator, Dso::SpectrumAveraging averaging, unsigned count, size_t length,
+                    double interval);
+    /// \brief Convert the averaged spectrum to dB and append it as waterfall row.
+    void output(const Accumulator &accumulator, ChannelID channel, DataChannel *channelData) const;
+
     const DsoSettingsScope* scope;
     const DsoSettingsPostProcessing* postprocessing;
-    unsigned int lastRecordLength = 0;                        ///< The record length of the previously analyzed data
+    size_t transformLength = 0;                               ///< Length of the planned transform
     Dso::WindowFunction lastWindow = (Dso::WindowFunction)-1; ///< The previously used dft window function
     double *lastWindowBuffer = nullptr;
+    fftw_plan_s *plan = nullptr;              ///< Real to half complex transform of transformLength samples
+    std::vector<Worker> workers;              ///< Buffers of the FFT threads, the first is the calling thread
+    std::vector<Accumulator> accumulators;    ///< Averaged spectrum of each channel
+    std::vector<double> framePower;           ///< Power spectrum of the current frame
 };
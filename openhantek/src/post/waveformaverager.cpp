@@ -0,0 +1,258 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QHash>
+#include <algorithm>
+#include <cmath>
+
+#include "waveformaverager.h"
+
+#include "post/mathchannelgenerator.h"
+#include "post/ppresult.h"
+#include "post/softwaretrigger.h"
+#include "scopesettings.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AVERAGER_SSE2
+#endif
+
+/// Quantization steps per vertical division
+static const double STEPS_PER_DIV = 1024.0;
+/// Running average: Upper limit of the samples per channel held in the ring
+static const size_t RING_LIMIT = 1 << 25;
+/// Upper limit of the averaged records or samples, keeps the 32 bit accumulators from overflowing
+static const unsigned COUNT_LIMIT = 256;
+
+/// \brief Convert samples to 16 bit steps, saturating.
+static void quantize(const double *samples, size_t count, double scale, int16_t *out) {
+    size_t position = 0;
+#ifdef AVERAGER_SSE2
+    const __m128d vScale = _mm_set1_pd(scale);
+    for (; position + 4 <= count; position += 4) {
+        const __m128i a = _mm_cvtpd_epi32(_mm_mul_pd(_mm_loadu_pd(samples + position), vScale));
+        const __m128i b = _mm_cvtpd_epi32(_mm_mul_pd(_mm_loadu_pd(samples + position + 2), vScale));
+        const __m128i values = _mm_unpacklo_epi64(a, b);
+        _mm_storel_epi64((__m128i *)(out + position), _mm_packs_epi32(values, values));
+    }
+#endif
+    for (; position < count; ++position) {
+        const double value = std::round(samples[position] * scale);
+        out[position] = (int16_t)std::max(std::min(value, 32767.0), -32768.0);
+    }
+}
+
+/// \brief Add a record to the accumulator and remove an old one, if given.
+template <bool remove> static void accumulate(int32_t *sum, const int16_t *added, const int16_t *removed, size_t count) {
+    size_t position = 0;
+#ifdef AVERAGER_SSE2
+    for (; position + 8 <= count; position += 8) {
+        const __m128i a = _mm_loadu_si128((const __m128i *)(added + position));
+        // Sign extension of the 16 bit values
+        __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(a, a), 16);
+        __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(a, a), 16);
+        if (remove) {
+            const __m128i r = _mm_loadu_si128((const __m128i *)(removed + position));
+            low = _mm_sub_epi32(low, _mm_srai_epi32(_mm_unpacklo_epi16(r, r), 16));
+            high = _mm_sub_epi32(high, _mm_srai_epi32(_mm_unpackhi_epi16(r, r), 16));
+        }
+        __m128i *target = (__m128i *)(sum + position);
+        _mm_storeu_si128(target, _mm_add_epi32(_mm_loadu_si128(target), low));
+        _mm_storeu_si128(target + 1, _mm_add_epi32(_mm_loadu_si128(target + 1), high));
+    }
+#endif
+    for (; position < count; ++position) sum[position] += added[position] - (remove ? removed[position] : 0);
+}
+
+/// \brief Exponential average with a weight of 2^-shift: sum += added - sum / 2^shift
+static void exponential(int32_t *sum, const int16_t *added, size_t count, int shift) {
+    size_t position = 0;
+#ifdef AVERAGER_SSE2
+    const __m128i vShift = _mm_cvtsi32_si128(shift);
+    for (; position + 8 <= count; position += 8) {
+        const __m128i a = _mm_loadu_si128((const __m128i *)(added + position));
+        const __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(a, a), 16);
+        const __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(a, a), 16);
+        __m128i *target = (__m128i *)(sum + position);
+        const __m128i s0 = _mm_loadu_si128(target);
+        const __m128i s1 = _mm_loadu_si128(target + 1);
+        _mm_storeu_si128(target, _mm_add_epi32(s0, _mm_sub_epi32(low, _mm_sra_epi32(s0, vShift))));
+        _mm_storeu_si128(target + 1, _mm_add_epi32(s1, _mm_sub_epi32(high, _mm_sra_epi32(s1, vShift))));
+    }
+#endif
+    for (; position < count; ++position) sum[position] += added[position] - (sum[position] >> shift);
+}
+
+/// \brief Convert the accumulator back to voltages.
+static void output(const int32_t *sum, size_t count, double factor, double *out) {
+    size_t position = 0;
+#ifdef AVERAGER_SSE2
+    const __m128d vFactor = _mm_set1_pd(factor);
+    for (; position + 4 <= count; position += 4) {
+        const __m128i values = _mm_loadu_si128((const __m128i *)(sum + position));
+        _mm_storeu_pd(out + position, _mm_mul_pd(_mm_cvtepi32_pd(values), vFactor));
+        _mm_storeu_pd(out + position + 2, _mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(values, 8)), vFactor));
+    }
+#endif
+    for (; position < count; ++position) out[position] = sum[position] * factor;
+}
+
+WaveformAverager::WaveformAverager(const DsoSettingsScope *scope, const MathChannelGenerator *mathChannelGenerator,
+                                   bool isSoftwareTriggerDevice)
+    : scope(scope), mathChannelGenerator(mathChannelGenerator), isSoftwareTriggerDevice(isSoftwareTriggerDevice) {}
+
+void WaveformAverager::process(PPresult *result) {
+    typedef DsoSettingsScopeAveraging::Mode Mode;
+    // Roll mode blocks can't be averaged
+    if (scope->averaging.mode == Mode::OFF || result->append) {
+        signature.clear();
+        return;
+    }
+    if (scope->averaging.mode == Mode::HIGHRES) {
+        signature.clear();
+        highResolution(result);
+        return;
+    }
+
+    size_t sampleCount = 0;
+    for (ChannelID channel = 0; channel < result->channelCount() && channel < scope->voltage.size(); ++channel)
+        if (scope->voltage[channel].used) sampleCount = std::max(sampleCount, result->data(channel)->voltage.sample.size());
+    if (!sampleCount) return;
+
+    if (!isSoftwareTriggerDevice) {
+        average(result, 0, sampleCount);
+        return;
+    }
+
+    // Align the records to the software trigger. The shortest possible aligned record is one screen width.
+    unsigned preTrigSamples, postTrigSamples, swTriggerStart;
+    double swTriggerFraction;
+    std::tie(preTrigSamples, postTrigSamples, swTriggerStart, swTriggerFraction) =
+        SoftwareTrigger::compute(result, scope);
+    if (postTrigSamples > preTrigSamples)
+        average(result, swTriggerStart - preTrigSamples, sampleCount - (postTrigSamples - preTrigSamples),
+                swTriggerFraction);
+    else
+        // Not triggered, keep showing the average
+        average(result, 0, 0);
+}
+
+std::vector<double> WaveformAverager::currentSignature(const PPresult *result, size_t length) const {
+    const ChannelID source = scope->trigger.source;
+    std::vector<double> values = {(double)scope->averaging.mode,
+                                  (double)scope->averaging.count,
+                                  (double)length,
+                                  scope->horizontal.timebase,
+                                  scope->trigger.position,
+                                  (double)scope->trigger.slope,
+                                  (double)source,
+                                  (double)scope->trigger.special,
+                                  source < scope->voltage.size() ? scope->voltage[source].trigger : 0.0};
+    for (ChannelID channel = 0; channel < result->channelCount() && channel < scope->voltage.size(); ++channel) {
+        values.push_back(scope->voltage[channel].used);
+        values.push_back(scope->gain(channel));
+        values.push_back(scope->voltage[channel].couplingOrMathIndex);
+        values.push_back(qHash(mathChannelGenerator->expression(channel)));
+        values.push_back(result->data(channel)->voltage.interval);
+    }
+    return values;
+}
+
+void WaveformAverager::average(PPresult *result, size_t offset, size_t length, double fraction) {
+    typedef DsoSettingsScopeAveraging::Mode Mode;
+    const bool running = scope->averaging.mode == Mode::RUNNING;
+    const unsigned count = std::max(std::min(scope->averaging.count, COUNT_LIMIT), 2u);
+    // The exponential average uses a power of two as weight
+    int shift = 0;
+    while ((2u << shift) <= count) ++shift;
+
+    if (length) {
+        const std::vector<double> current = currentSignature(result, length);
+        if (current != signature) {
+            // Restart averaging
+            signature = current;
+            records = 0;
+            ringNext = 0;
+            ringSize = running ? (unsigned)std::max<size_t>(std::min<size_t>(count, RING_LIMIT / length), 1) : 0;
+            channels.resize(result->channelCount());
+            for (ChannelID channel = 0; channel < channels.size(); ++channel) {
+                Channel &target = channels[channel];
+                const bool used = channel < scope->voltage.size() && scope->voltage[channel].used;
+                target.resolution = used ? scope->gain(channel) / STEPS_PER_DIV : 0.0;
+                target.sum.assign(used ? length : 0, 0);
+                target.record.resize(used ? length : 0);
+                target.ring.assign(used ? (size_t)ringSize * length : 0, 0);
+            }
+        }
+
+        for (ChannelID channel = 0; channel < channels.size(); ++channel) {
+            Channel &target = channels[channel];
+            const std::vector<double> &samples = result->data(channel)->voltage.sample;
+            if (target.sum.empty() || samples.size() < offset + length) continue;
+
+            // The level crossing lies `fraction` before the trigger sample, interpolate the samples at the same
+            // distance before each sample so that the edges of all records line up
+            const double *record = samples.data() + offset;
+            if (fraction > 0.0) {
+                aligned.resize(length);
+                for (size_t position = 0; position < length; ++position) {
+                    const double before = offset + position ? record[(ptrdiff_t)position - 1] : record[0];
+                    aligned[position] = record[position] + fraction * (before - record[position]);
+                }
+                record = aligned.data();
+            }
+            quantize(record, length, 1.0 / target.resolution, target.record.data());
+            if (running) {
+                int16_t *slot = target.ring.data() + (size_t)ringNext * length;
+                if (records >= ringSize)
+                    accumulate<true>(target.sum.data(), target.record.data(), slot, length);
+                else
+                    accumulate<false>(target.sum.data(), target.record.data(), nullptr, length);
+                std::copy(target.record.begin(), target.record.end(), slot);
+            } else if (records == 0) {
+                for (size_t position = 0; position < length; ++position)
+                    target.sum[position] = (int32_t)target.record[position] << shift;
+            } else
+                exponential(target.sum.data(), target.record.data(), length, shift);
+        }
+        if (running) ringNext = (ringNext + 1) % ringSize;
+        if (records < COUNT_LIMIT) ++records;
+    }
+    if (!records) return;
+
+    // Replace the samples by the average
+    const double divisor = running ? std::min(records, ringSize) : (double)(1 << shift);
+    for (ChannelID channel = 0; channel < channels.size() && channel < result->channelCount(); ++channel) {
+        const Channel &source = channels[channel];
+        if (source.sum.empty()) continue;
+        std::vector<double> &samples = result->modifyData(channel)->voltage.sample;
+        samples.resize(source.sum.size());
+        output(source.sum.data(), source.sum.size(), source.resolution / divisor, samples.data());
+    }
+    result->triggerAligned = isSoftwareTriggerDevice;
+}
+
+void WaveformAverager::highResolution(PPresult *result) {
+    const size_t width = std::max(std::min(scope->averaging.count, COUNT_LIMIT), 2u);
+    channels.resize(result->channelCount());
+    for (ChannelID channel = 0; channel < result->channelCount() && channel < scope->voltage.size(); ++channel) {
+        std::vector<double> &samples = result->modifyData(channel)->voltage.sample;
+        if (!scope->voltage[channel].used || samples.size() < width) continue;
+
+        Channel &target = channels[channel];
+        target.resolution = scope->gain(channel) / STEPS_PER_DIV;
+        target.record.resize(samples.size());
+        quantize(samples.data(), samples.size(), 1.0 / target.resolution, target.record.data());
+
+        // Sliding window centered on each sample, shortened at the record boundaries
+        const size_t half = width / 2;
+        int32_t sum = 0;
+        size_t begin = 0, end = 0;
+        for (size_t position = 0; position < samples.size(); ++position) {
+            const size_t windowBegin = position > half ? position - half : 0;
+            const size_t windowEnd = std::min(windowBegin + width, samples.size());
+            for (; end < windowEnd; ++end) sum += target.record[end];
+            for (; begin < windowBegin; ++begin) sum -= target.record[begin];
+            samples[position] = (double)sum * target.resolution / (double)(end - begin);
+        }
+    }
+}
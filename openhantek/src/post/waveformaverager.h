@@ -0,0 +1,54 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "processor.h"
+
+struct DsoSettingsScope;
+class MathChannelGenerator;
+class PPresult;
+
+/// \brief Averages the voltage samples to reduce noise, see DsoSettingsScopeAveraging.
+/// The records are quantized to 16 bit with a resolution of 1/1024 div and accumulated in 32 bit integers with
+/// vectorized loops. The running average keeps the last records in a ring to subtract the oldest one, the
+/// exponential average needs only the accumulator. The accumulators are reset whenever a setting changes
+/// that affects the samples (gain, samplerate, timebase, trigger). For devices with software trigger the records
+/// are aligned to the trigger point before they are averaged, including the sub-sample position of the level
+/// crossing by linear interpolation, records without trigger are skipped.
+class WaveformAverager : public Processor {
+  public:
+    /// \param mathChannelGenerator Holds the math expressions, a changed expression restarts averaging.
+    WaveformAverager(const DsoSettingsScope *scope, const MathChannelGenerator *mathChannelGenerator,
+                     bool isSoftwareTriggerDevice);
+    virtual void process(PPresult *result) override;
+
+  private:
+    struct Channel {
+        double resolution = 0.0;     ///< Voltage of one quantization step
+        std::vector<int32_t> sum;    ///< The accumulator
+        std::vector<int16_t> ring;   ///< Running average: The last records
+        std::vector<int16_t> record; ///< The quantized new record
+    };
+
+    /// \brief Average the records of all used channels, starting at `offset`.
+    /// \param fraction The records are moved this part of a sample interval later, see SoftwareTrigger::compute.
+    void average(PPresult *result, size_t offset, size_t length, double fraction = 0.0);
+    /// \brief Boxcar average within each record.
+    void highResolution(PPresult *result);
+    /// \return Values of all settings that invalidate the accumulated records
+    std::vector<double> currentSignature(const PPresult *result, size_t length) const;
+
+    const DsoSettingsScope *scope;
+    const MathChannelGenerator *mathChannelGenerator;
+    const bool isSoftwareTriggerDevice;
+
+    std::vector<Channel> channels;
+    std::vector<double> signature; ///< Settings the accumulators were started with
+    unsigned records = 0;          ///< Number of records in the accumulators
+    unsigned ringSize = 0;         ///< Running average: Number of records in the ring
+    unsigned ringNext = 0;         ///< Running average: Ring position of the next record
+    std::vector<double> aligned;   ///< Software trigger: The record moved by the trigger fraction
+};
@@ -0,0 +1,423 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QCoreApplication>
+#include <QHostAddress>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QtEndian>
+
+#include <cmath>
+#include <cstring>
+#include <map>
+
+#include "scpiserver.h"
+
+#include "hantekdsocontrol.h"
+#include "post/ppresult.h"
+#include "scopesettings.h"
+#include "utils/metrics.h"
+#include "viewconstants.h"
+
+/// Frames are dropped for a client while more than this number of bytes wait to be sent to it
+static const qint64 MAX_PENDING_BYTES = 64 * 1024 * 1024;
+/// Longer command lines are discarded
+static const qint64 MAX_LINE_LENGTH = 4096;
+/// Number of error messages that are kept for a client
+static const size_t MAX_ERRORS = 32;
+
+/// \brief Compare a command node with an SCPI keyword.
+/// The upper case letters of the keyword are the short form, e.g. "CHANnel" matches "CHAN" and "channel".
+static bool matches(const QString &node, const char *keyword) {
+    const QString name = QString::fromLatin1(keyword);
+    int shortLength = 0;
+    while (shortLength < name.size() && !name.at(shortLength).isLower()) ++shortLength;
+    const QString upper = node.toUpper();
+    return upper == name.toUpper() || upper == name.left(shortLength);
+}
+
+/// \brief Compare a command node with an SCPI keyword that ends with a number, e.g. "CHAN2".
+/// \param number Returns the number, 1 if it is omitted.
+static bool matches(const QString &node, const char *keyword, unsigned &number) {
+    int digits = node.size();
+    while (digits > 0 && node.at(digits - 1).isDigit()) --digits;
+    if (!matches(node.left(digits), keyword)) return false;
+    number = digits < node.size() ? node.mid(digits).toUInt() : 1;
+    return true;
+}
+
+/// \brief Parse a boolean parameter.
+static bool toBool(const QString &parameter, bool &ok) {
+    const QString upper = parameter.toUpper();
+    ok = true;
+    if (upper == "ON" || upper == "1") return true;
+    if (upper == "OFF" || upper == "0") return false;
+    ok = false;
+    return false;
+}
+
+static QByteArray number(double value) { return QByteArray::number(value, 'g', 10); }
+
+template <typename T> static void appendLittleEndian(QByteArray &target, T value) {
+    T little = qToLittleEndian(value);
+    target.append(reinterpret_cast<const char *>(&little), (int)sizeof(T));
+}
+
+static void appendDouble(QByteArray &target, double value) {
+    quint64 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    appendLittleEndian(target, bits);
+}
+
+ScpiServer::ScpiServer(HantekDsoControl *dsoControl, DsoSettingsScope *scope, const Dso::ControlSpecification *spec,
+                       const QString &modelName)
+    : dsoControl(dsoControl), scope(scope), spec(spec), modelName(modelName) {
+    streamedFrames = Metrics::Registry::get()->counter("scpi.frames");
+    droppedFrames = Metrics::Registry::get()->counter("scpi.dropped");
+    streamedBytes = Metrics::Registry::get()->counter("scpi.bytes", Metrics::Counter::Unit::BYTES);
+}
+
+ScpiServer::~ScpiServer() {
+    for (Client &client : clients) client.device->disconnect(this);
+}
+
+bool ScpiServer::listenTcp(quint16 port) {
+    if (!tcpServer) {
+        tcpServer = new QTcpServer(this);
+        connect(tcpServer, &QTcpServer::newConnection, [this]() {
+            while (QTcpSocket *socket = tcpServer->nextPendingConnection()) {
+                socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+                accept(socket);
+            }
+        });
+    }
+    if (tcpServer->listen(QHostAddress::LocalHost, port)) return true;
+    qWarning() << "SCPI server can't listen on port" << port << ":" << tcpServer->errorString();
+    return false;
+}
+
+bool ScpiServer::listenLocal(const QString &name) {
+    if (!localServer) {
+        localServer = new QLocalServer(this);
+        localServer->setSocketOptions(QLocalServer::UserAccessOption);
+        connect(localServer, &QLocalServer::newConnection, [this]() {
+            while (QLocalSocket *socket = localServer->nextPendingConnection()) accept(socket);
+        });
+    }
+    // Remove a stale socket of a crashed instance
+    QLocalServer::removeServer(name);
+    if (localServer->listen(name)) return true;
+    qWarning() << "SCPI server can't listen on" << name << ":" << localServer->errorString();
+    return false;
+}
+
+void ScpiServer::accept(QIODevice *device) {
+    clients.emplace_back();
+    Client *client = &clients.back();
+    client->device = device;
+    connect(device, &QIODevice::readyRead, this, [this, client]() { receive(client); });
+
+    auto disconnected = [this, device]() {
+        clients.remove_if([device](const Client &client) { return client.device == device; });
+        device->deleteLater();
+    };
+    if (QTcpSocket *socket = qobject_cast<QTcpSocket *>(device))
+        connect(socket, &QTcpSocket::disconnected, this, disconnected);
+    else if (QLocalSocket *socket = qobject_cast<QLocalSocket *>(device))
+        connect(socket, &QLocalSocket::disconnected, this, disconnected);
+}
+
+void ScpiServer::receive(Client *client) {
+    QIODevice *device = client->device;
+    while (device->canReadLine()) {
+        const QString line = QString::fromLatin1(device->readLine(MAX_LINE_LENGTH)).trimmed();
+        // Several commands may be given in one line
+        for (const QString &command : line.split(';', QString::SkipEmptyParts)) {
+            const QByteArray reply = execute(*client, command.trimmed());
+            if (!reply.isEmpty()) device->write(reply + '\n');
+        }
+    }
+    // A line without end that is already too long can't become valid
+    if (device->bytesAvailable() > MAX_LINE_LENGTH) {
+        device->readAll();
+        error(*client, -112, "Program mnemonic too long");
+    }
+}
+
+void ScpiServer::error(Client &client, int code, const char *message) {
+    if (client.errors.size() >= MAX_ERRORS) client.errors.pop_front();
+    client.errors.push_back(QByteArray::number(code) + ",\"" + message + "\"");
+}
+
+void ScpiServer::updateUsedChannels() {
+    const bool mathUsed = scope->anyMathUsed(spec);
+    for (ChannelID channel = 0; channel < spec->channels; ++channel)
+        dsoControl->setChannelUsed(channel, mathUsed | scope->anyUsed(channel));
+}
+
+QByteArray ScpiServer::execute(Client &client, const QString &command) {
+    if (command.isEmpty()) return QByteArray();
+
+    // Split into header and parameter
+    const int space = command.indexOf(' ');
+    QString header = space < 0 ? command : command.left(space);
+    const QString parameter = space < 0 ? QString() : command.mid(space + 1).trimmed();
+    const bool query = header.endsWith("?");
+    if (query) header.chop(1);
+    const QStringList nodes = header.split(':', QString::SkipEmptyParts);
+
+    bool ok = false;
+    const double value = parameter.toDouble(&ok);
+    auto invalid = [this, &client]() {
+        error(client, -224, "Illegal parameter value");
+        return QByteArray();
+    };
+
+    // Common commands
+    if (header.compare("*IDN", Qt::CaseInsensitive) == 0 && query)
+        return "OpenHantek," + modelName.toLatin1() + ",0," + QCoreApplication::applicationVersion().toLatin1();
+    if (header.compare("*OPC", Qt::CaseInsensitive) == 0 && query) return "1";
+    if (header.compare("*CLS", Qt::CaseInsensitive) == 0 && !query) {
+        client.errors.clear();
+        return QByteArray();
+    }
+
+    unsigned index = 0;
+    if (nodes.size() == 1 && !query) {
+        if (matches(nodes[0], "RUN")) {
+            dsoControl->enableSampling(true);
+            return QByteArray();
+        } else if (matches(nodes[0], "STOP")) {
+            dsoControl->enableSampling(false);
+            return QByteArray();
+        } else if (matches(nodes[0], "SINGle")) {
+            scope->trigger.mode = Dso::TriggerMode::SINGLE;
+            dsoControl->setTriggerMode(scope->trigger.mode);
+            dsoControl->enableSampling(true);
+            return QByteArray();
+        } else if (matches(nodes[0], "FORCe")) {
+            dsoControl->forceTrigger();
+            return QByteArray();
+        }
+    } else if (nodes.size() == 2 && matches(nodes[0], "CHANnel", index)) {
+        // Voltage channels, the math channel follows the physical ones
+        if (index < 1 || index > scope->voltage.size()) {
+            error(client, -114, "Header suffix out of range");
+            return QByteArray();
+        }
+        const ChannelID channel = index - 1;
+        DsoSettingsScopeVoltage &voltage = scope->voltage[channel];
+        const bool physical = channel < spec->channels;
+        if (matches(nodes[1], "SCALe")) {
+            if (query) return number(scope->gain(channel));
+            if (!ok || !(value > 0.0)) return invalid();
+            // The nearest gain step
+            unsigned nearest = 0;
+            for (unsigned step = 1; step < scope->gainSteps.size(); ++step)
+                if (std::abs(std::log(scope->gainSteps[step] / value)) <
+                    std::abs(std::log(scope->gainSteps[nearest] / value)))
+                    nearest = step;
+            voltage.gainStepIndex = nearest;
+            if (physical) dsoControl->setGain(channel, scope->gain(channel) * DIVS_VOLTAGE);
+            return QByteArray();
+        } else if (matches(nodes[1], "OFFSet")) {
+            if (query) return number(voltage.offset);
+            if (!ok || std::abs(value) > DIVS_VOLTAGE / 2) return invalid();
+            voltage.offset = value;
+            if (physical) dsoControl->setOffset(channel, (value / DIVS_VOLTAGE) + 0.5);
+            return QByteArray();
+        } else if (matches(nodes[1], "DISPlay")) {
+            if (query) return voltage.used ? "1" : "0";
+            const bool used = toBool(parameter, ok);
+            if (!ok) return invalid();
+            voltage.used = used;
+            updateUsedChannels();
+            return QByteArray();
+        } else if (matches(nodes[1], "COUPling") && physical) {
+            static const char *names[] = {"AC", "DC", "GND"};
+            if (query) return names[(int)scope->coupling(channel, spec)];
+            for (unsigned coupling = 0; coupling < spec->couplings.size(); ++coupling) {
+                if (parameter.toUpper() != names[(int)spec->couplings[coupling]]) continue;
+                voltage.couplingOrMathIndex = coupling;
+                dsoControl->setCoupling(channel, spec->couplings[coupling]);
+                return QByteArray();
+            }
+            return invalid();
+        }
+    } else if (nodes.size() == 2 && matches(nodes[0], "TIMebase") && matches(nodes[1], "SCALe")) {
+        if (query) return number(scope->horizontal.timebase);
+        if (!ok || !(value > 0.0)) return invalid();
+        scope->horizontal.timebase = value;
+        scope->horizontal.samplerateSource = DsoSettingsScopeHorizontal::Duration;
+        dsoControl->setRecordTime(value * DIVS_TIME);
+        return QByteArray();
+    } else if (nodes.size() == 2 && matches(nodes[0], "ACQuire") && matches(nodes[1], "SRATe")) {
+        if (query) return number(scope->horizontal.samplerate);
+        if (!ok || !(value > 0.0)) return invalid();
+        scope->horizontal.samplerate = value;
+        scope->horizontal.samplerateSource = DsoSettingsScopeHorizontal::Samplerrate;
+        dsoControl->setSamplerate(value);
+        return QByteArray();
+    } else if (nodes.size() == 2 && matches(nodes[0], "TRIGger")) {
+        DsoSettingsScopeTrigger &trigger = scope->trigger;
+        if (matches(nodes[1], "MODE")) {
+            if (query) {
+                switch (trigger.mode) {
+                case Dso::TriggerMode::WAIT_FORCE: return "AUTO";
+                case Dso::TriggerMode::SINGLE: return "SING";
+                default: return "NORM";
+                }
+            }
+            if (matches(parameter, "AUTO"))
+                trigger.mode = Dso::TriggerMode::WAIT_FORCE;
+            else if (matches(parameter, "NORMal"))
+                trigger.mode = Dso::TriggerMode::HARDWARE_SOFTWARE;
+            else if (matches(parameter, "SINGle"))
+                trigger.mode = Dso::TriggerMode::SINGLE;
+            else
+                return invalid();
+            dsoControl->setTriggerMode(trigger.mode);
+            return QByteArray();
+        } else if (matches(nodes[1], "SOURce")) {
+            if (query) {
+                if (trigger.special && trigger.source < spec->specialTriggerChannels.size())
+                    return QByteArray(spec->specialTriggerChannels[trigger.source].name.c_str());
+                return "CHAN" + QByteArray::number(trigger.source + 1);
+            }
+            unsigned source = 0;
+            if (matches(parameter, "CHANnel", source) && source >= 1 && source <= spec->channels) {
+                trigger.special = false;
+                trigger.source = source - 1;
+            } else {
+                unsigned special = 0;
+                while (special < spec->specialTriggerChannels.size() &&
+                       parameter.compare(QString::fromStdString(spec->specialTriggerChannels[special].name),
+                                         Qt::CaseInsensitive) != 0)
+                    ++special;
+                if (special >= spec->specialTriggerChannels.size()) return invalid();
+                trigger.special = true;
+                trigger.source = special;
+            }
+            dsoControl->setTriggerSource(trigger.special, trigger.source);
+            return QByteArray();
+        } else if (matches(nodes[1], "LEVel")) {
+            // The level of the trigger source channel
+            if (trigger.special || trigger.source >= spec->channels) {
+                error(client, -221, "Settings conflict");
+                return QByteArray();
+            }
+            if (query) return number(scope->voltage[trigger.source].trigger);
+            if (!ok) return invalid();
+            scope->voltage[trigger.source].trigger = value;
+            dsoControl->setTriggerLevel(trigger.source, value);
+            return QByteArray();
+        } else if (matches(nodes[1], "SLOPe")) {
+            if (query) return trigger.slope == Dso::Slope::Positive ? "POS" : "NEG";
+            if (matches(parameter, "POSitive"))
+                trigger.slope = Dso::Slope::Positive;
+            else if (matches(parameter, "NEGative"))
+                trigger.slope = Dso::Slope::Negative;
+            else
+                return invalid();
+            dsoControl->setTriggerSlope(trigger.slope);
+            return QByteArray();
+        } else if (matches(nodes[1], "POSition")) {
+            // Fraction of the screen width before the trigger point
+            if (query) return number(trigger.position);
+            if (!ok || value < 0.0 || value > 1.0) return invalid();
+            trigger.position = value;
+            dsoControl->setPretriggerPosition(value * scope->horizontal.timebase * DIVS_TIME);
+            return QByteArray();
+        }
+    } else if (nodes.size() == 2 && matches(nodes[0], "WAVeform")) {
+        if (matches(nodes[1], "STReam")) {
+            if (query) return client.streaming ? "1" : "0";
+            const bool streaming = toBool(parameter, ok);
+            if (!ok) return invalid();
+            client.streaming = streaming;
+            return QByteArray();
+        } else if (matches(nodes[1], "DECimation")) {
+            if (query) return QByteArray::number(client.decimation);
+            if (!ok || value < 1.0 || value > 1e6 || value != std::floor(value)) return invalid();
+            client.decimation = (unsigned)value;
+            return QByteArray();
+        }
+    } else if (nodes.size() == 2 && matches(nodes[0], "SYSTem")) {
+        if (matches(nodes[1], "ERRor") && query) {
+            if (client.errors.empty()) return "0,\"No error\"";
+            const QByteArray message = client.errors.front();
+            client.errors.pop_front();
+            return message;
+        } else if (matches(nodes[1], "RAW") && !query) {
+            // The raw bulk and control commands of the manual command line
+            QString raw = parameter;
+            if (raw.size() >= 2 && raw.startsWith("\"") && raw.endsWith("\"")) raw = raw.mid(1, raw.size() - 2);
+            if (dsoControl->stringCommand(raw) != Dso::ErrorCode::NONE) return invalid();
+            return QByteArray();
+        }
+    }
+
+    error(client, -113, "Undefined header");
+    return QByteArray();
+}
+
+QByteArray ScpiServer::encode(const PPresult *data, unsigned decimation) const {
+    std::vector<ChannelID> channels;
+    size_t size = 4 + 3 * sizeof(quint32) + sizeof(double);
+    for (ChannelID channel = 0; channel < data->channelCount(); ++channel) {
+        const std::vector<double> &samples = data->data(channel)->voltage.sample;
+        if (samples.empty()) continue;
+        channels.push_back(channel);
+        size += 2 * sizeof(quint32) + sizeof(double) + (samples.size() + decimation - 1) / decimation * sizeof(float);
+    }
+
+    QByteArray payload;
+    payload.reserve((int)size);
+    payload.append("OHWF", 4);
+    appendLittleEndian<quint32>(payload, frameNumber);
+    appendLittleEndian<quint32>(payload, data->append ? 1 : 0);
+    appendLittleEndian<quint32>(payload, (quint32)channels.size());
+    // The GraphGenerator placed the first sample relative to the trigger point on the screen
+    const double trigger = (scope->trigger.position - 0.5) * DIVS_TIME;
+    appendDouble(payload, data->graphScale > 0.0 ? (data->graphOrigin - trigger) / data->graphScale : NAN);
+    for (ChannelID channel : channels) {
+        const SampleValues &voltage = data->data(channel)->voltage;
+        const size_t count = (voltage.sample.size() + decimation - 1) / decimation;
+        appendLittleEndian<quint32>(payload, channel);
+        appendLittleEndian<quint32>(payload, (quint32)count);
+        appendDouble(payload, voltage.interval * decimation);
+
+        // Convert all samples of the channel at once
+        const int offset = payload.size();
+        payload.resize(offset + (int)(count * sizeof(float)));
+        char *target = payload.data() + offset;
+        for (size_t index = 0; index < count; ++index) {
+            const float sample = (float)voltage.sample[index * decimation];
+            quint32 bits;
+            std::memcpy(&bits, &sample, sizeof(bits));
+            qToLittleEndian(bits, reinterpret_cast<uchar *>(target + index * sizeof(float)));
+        }
+    }
+
+    const QByteArray length = QByteArray::number(payload.size());
+    return '#' + QByteArray::number(length.size()) + length + payload + '\n';
+}
+
+void ScpiServer::input(std::shared_ptr<PPresult> data) {
+    ++frameNumber;
+    // Each decimation is only encoded once
+    std::map<unsigned, QByteArray> blocks;
+    for (Client &client : clients) {
+        if (!client.streaming) continue;
+        if (client.device->bytesToWrite() > MAX_PENDING_BYTES) {
+            droppedFrames->add();
+            continue;
+        }
+        QByteArray &block = blocks[client.decimation];
+        if (block.isEmpty()) block = encode(data.get(), client.decimation);
+        client.device->write(block);
+        streamedFrames->add();
+        streamedBytes->add((uint64_t)block.size());
+    }
+}
@@ -0,0 +1,107 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QByteArray>
+#include <QObject>
+#include <QString>
+
+#include <deque>
+#include <list>
+#include <memory>
+
+class HantekDsoControl;
+class PPresult;
+class QIODevice;
+class QLocalServer;
+class QTcpServer;
+struct DsoSettingsScope;
+namespace Dso {
+struct ControlSpecification;
+}
+namespace Metrics {
+class Counter;
+}
+
+/// \brief Remote control of the oscilloscope for automated test setups.
+/// Clients connect to a TCP port on localhost or to a local socket (Unix domain socket or named pipe) and send
+/// SCPI-like commands, one per line, e.g. `:CHAN1:SCAL 0.5` or `:TRIG:LEV?`. The commands change the scope
+/// settings and call the matching HantekDsoControl slots, like the docks do. Queries are answered with one line,
+/// errors are queued and read with `:SYST:ERR?`.
+///
+/// After `:WAV:STR ON` every post processing result is sent to the client as a SCPI definite length block
+/// (`#<digits><length><payload>`), optionally decimated with `:WAV:DEC <n>`. The payload is little endian:
+///
+///     char[4]  "OHWF"
+///     uint32   frame number
+///     uint32   flags, bit 0: roll mode samples that continue the previous frame
+///     uint32   number of channels
+///     double   time of the first sample relative to the trigger point (s), NaN if unknown
+///     per channel:
+///         uint32   channel index, 0 is CH1
+///         uint32   sample count
+///         double   sample interval (s)
+///         float    samples (V)
+///
+/// Frames are dropped for a client that doesn't read fast enough instead of buffering them without limit.
+/// The docks don't follow remote changes.
+class ScpiServer : public QObject {
+    Q_OBJECT
+
+  public:
+    /// \param dsoControl The controlled device.
+    /// \param scope The scope settings, kept in sync with the device.
+    /// \param spec The device specification.
+    /// \param modelName The model name that is returned by `*IDN?`.
+    ScpiServer(HantekDsoControl *dsoControl, DsoSettingsScope *scope, const Dso::ControlSpecification *spec,
+               const QString &modelName);
+    ~ScpiServer();
+
+    /// \brief Accept clients on the given TCP port of the loopback interface.
+    /// \return false if the port is not available.
+    bool listenTcp(quint16 port);
+    /// \brief Accept clients on the given local socket.
+    /// \return false if the socket can't be created.
+    bool listenLocal(const QString &name);
+
+  public slots:
+    /// \brief Stream a post processing result to all clients that requested it.
+    void input(std::shared_ptr<PPresult> data);
+
+  private:
+    struct Client {
+        QIODevice *device;
+        bool streaming = false;        ///< true if the results are sent to this client
+        unsigned decimation = 1;       ///< Only every n-th sample is sent
+        std::deque<QByteArray> errors; ///< Queued error messages, the oldest is read first
+    };
+
+    /// \brief Start serving a new connection.
+    void accept(QIODevice *device);
+    /// \brief Execute the complete lines received from the client.
+    void receive(Client *client);
+    /// \brief Execute a single command.
+    /// \return The reply without the line end, empty for commands that don't reply.
+    QByteArray execute(Client &client, const QString &command);
+    /// \brief Queue an error message for `:SYST:ERR?`.
+    void error(Client &client, int code, const char *message);
+    /// \brief Encode the result as binary block.
+    QByteArray encode(const PPresult *data, unsigned decimation) const;
+
+    /// \brief Update the used channels of the device, math channels need all physical channels.
+    void updateUsedChannels();
+
+    HantekDsoControl *dsoControl;
+    DsoSettingsScope *scope;
+    const Dso::ControlSpecification *spec;
+    const QString modelName;
+
+    QTcpServer *tcpServer = nullptr;
+    QLocalServer *localServer = nullptr;
+    std::list<Client> clients;
+    unsigned frameNumber = 0;
+
+    Metrics::Counter *streamedFrames;
+    Metrics::Counter *droppedFrames;
+    Metrics::Counter *streamedBytes;
+};
@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+/// \file
+/// Layout of the shared memory ring the SharedMemoryPublisher writes the post processing results to. The file
+/// has no dependencies, so that reader processes can include it directly.
+///
+/// The memory starts with a ShmRingHeader, followed by `slotCount` slots of `slotSize` bytes each. A slot starts
+/// with a ShmSlotHeader, followed by room for `channelCount` channels of `sampleCapacity` doubles each. The samples
+/// of a channel are at the offset given in its ShmChannelHeader. Frame n is written to slot
+/// n % slotCount. Every slot is guarded by a sequence lock, readers never block the writer:
+///
+///     const uint64_t frame = header->lastFrame.load(std::memory_order_acquire);
+///     ShmSlotHeader *slot = slot `frame % slotCount`;
+///     const uint64_t before = slot->generation.load(std::memory_order_acquire);
+///     if (before & 1) retry; // The slot is being written
+///     ... read the slot header and the samples in place ...
+///     std::atomic_thread_fence(std::memory_order_acquire);
+///     if (slot->generation.load(std::memory_order_relaxed) != before) discard; // Overwritten while reading
+///
+/// A reader that keeps up reads each frame exactly once by following `frame` instead of `lastFrame`.
+
+#define SHM_RING_MAGIC "OHSHMRG" ///< Followed by a zero byte
+#define SHM_RING_VERSION 2
+#define SHM_RING_MAX_CHANNELS 16 ///< Channels of a slot, including the math channels and other devices
+#define SHM_RING_SLOT_ALIGNMENT 64
+
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t), "Shared memory needs plain 64 bit atomics");
+
+/// \brief Start of the shared memory.
+struct ShmRingHeader {
+    char magic[8];                   ///< SHM_RING_MAGIC, written last when the ring is ready
+    uint32_t version;                ///< SHM_RING_VERSION
+    uint32_t slotCount;              ///< Number of slots in the ring
+    uint64_t slotSize;               ///< Bytes per slot, including its header
+    uint64_t slotOffset;             ///< Offset of the first slot from the start of the memory
+    uint64_t sampleCapacity;         ///< Samples per channel that fit into a slot
+    std::atomic<uint64_t> lastFrame; ///< Number of the last completely written frame, 0 if none yet
+    uint32_t writerPid;              ///< Process id of OpenHantek
+    uint32_t channelCount;           ///< Channels that fit into a slot, at most SHM_RING_MAX_CHANNELS
+};
+
+/// \brief Metadata of one channel of a frame.
+struct ShmChannelHeader {
+    uint32_t channel;      ///< Channel index, 0 is CH1
+    uint32_t sampleCount;  ///< Number of samples
+    double samplerate;     ///< Samples per second
+    double gain;           ///< Vertical scale of the screen in V/div
+    double offset;         ///< Vertical screen offset in divs
+    uint64_t sampleOffset; ///< Offset of the first sample (double, V) from the start of the slot
+};
+
+/// \brief Start of a slot.
+struct ShmSlotHeader {
+    std::atomic<uint64_t> generation; ///< Odd while the slot is being written
+    uint64_t frame;                   ///< Frame number, counts from 1
+    int64_t timestamp;                ///< Time the frame was published in ns since the epoch
+    double firstSampleTime;           ///< Time of the first sample relative to the trigger point in s, NaN if unknown
+    uint32_t flags;                   ///< SHM_FLAG_*
+    uint32_t channelCount;            ///< Number of valid entries in channels
+    ShmChannelHeader channels[SHM_RING_MAX_CHANNELS];
+};
+
+#define SHM_FLAG_APPEND 1    ///< Roll mode samples that continue the previous frame
+#define SHM_FLAG_TRUNCATED 2 ///< A channel had more samples than the slot capacity
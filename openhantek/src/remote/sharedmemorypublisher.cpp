@@ -0,0 +1,147 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QDebug>
+#include <QtGlobal>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "sharedmemorypublisher.h"
+
+#include "scopesettings.h"
+#include "utils/metrics.h"
+#include "viewconstants.h"
+
+/// \return The size rounded up to the slot alignment.
+static size_t aligned(size_t size) {
+    return (size + SHM_RING_SLOT_ALIGNMENT - 1) / SHM_RING_SLOT_ALIGNMENT * SHM_RING_SLOT_ALIGNMENT;
+}
+
+SharedMemoryPublisher::SharedMemoryPublisher(const DsoSettingsScope *scope, const QString &name,
+                                             size_t sampleCapacity, unsigned channelCount, unsigned slotCount)
+    : scope(scope), name(name.startsWith("/") ? name : "/" + name), sampleCapacity(sampleCapacity),
+      channelCount(std::min(channelCount, (unsigned)SHM_RING_MAX_CHANNELS)), slotCount(std::max(slotCount, 2u)) {
+    publishedFrames = Metrics::Registry::get()->counter("shm.frames");
+    truncatedFrames = Metrics::Registry::get()->counter("shm.truncated");
+}
+
+SharedMemoryPublisher::~SharedMemoryPublisher() {
+#ifdef Q_OS_UNIX
+    if (!memory) return;
+    munmap(memory, size);
+    shm_unlink(name.toLocal8Bit().constData());
+#endif
+}
+
+bool SharedMemoryPublisher::open() {
+#ifdef Q_OS_UNIX
+    const size_t slotSize =
+        aligned(sizeof(ShmSlotHeader)) + channelCount * aligned(sampleCapacity * sizeof(double));
+    const size_t slotOffset = aligned(sizeof(ShmRingHeader));
+    size = slotOffset + slotCount * slotSize;
+
+    // A leftover of a crashed instance is replaced, its readers keep their old mapping
+    const QByteArray path = name.toLocal8Bit();
+    shm_unlink(path.constData());
+    const int fd = shm_open(path.constData(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        qWarning() << "Can't create shared memory" << name << ":" << strerror(errno);
+        return false;
+    }
+    if (ftruncate(fd, (off_t)size) != 0) {
+        qWarning() << "Can't resize shared memory" << name << ":" << strerror(errno);
+        close(fd);
+        shm_unlink(path.constData());
+        return false;
+    }
+    void *mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        qWarning() << "Can't map shared memory" << name << ":" << strerror(errno);
+        shm_unlink(path.constData());
+        return false;
+    }
+
+    // The new object is zero filled, so all generations and lastFrame start at 0
+    memory = mapping;
+    header = static_cast<ShmRingHeader *>(memory);
+    header->version = SHM_RING_VERSION;
+    header->slotCount = slotCount;
+    header->slotSize = slotSize;
+    header->slotOffset = slotOffset;
+    header->sampleCapacity = sampleCapacity;
+    header->channelCount = channelCount;
+    header->writerPid = (uint32_t)getpid();
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(header->magic, SHM_RING_MAGIC, sizeof(header->magic));
+    return true;
+#else
+    qWarning() << "Shared memory is not supported on this platform";
+    return false;
+#endif
+}
+
+void SharedMemoryPublisher::process(PPresult *result) {
+    if (!memory) {
+        if (failed) return;
+        failed = !open();
+        if (failed) return;
+    }
+
+    ++frame;
+    char *slotStart = static_cast<char *>(memory) + header->slotOffset + (frame % slotCount) * header->slotSize;
+    ShmSlotHeader *slot = reinterpret_cast<ShmSlotHeader *>(slotStart);
+
+    // Odd generation: Readers discard what they read from now on
+    const uint64_t generation = slot->generation.load(std::memory_order_relaxed);
+    slot->generation.store(generation + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot->frame = frame;
+    slot->timestamp =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    // The GraphGenerator placed the first sample relative to the trigger point on the screen
+    const double trigger = (scope->trigger.position - 0.5) * DIVS_TIME;
+    slot->firstSampleTime = result->graphScale > 0.0 ? (result->graphOrigin - trigger) / result->graphScale : NAN;
+    slot->flags = result->append ? SHM_FLAG_APPEND : 0;
+
+    uint32_t channels = 0;
+    size_t sampleOffset = aligned(sizeof(ShmSlotHeader));
+    for (ChannelID channel = 0; channel < result->channelCount() && channels < channelCount; ++channel) {
+        const SampleValues &voltage = result->data(channel)->voltage;
+        if (voltage.sample.empty()) continue;
+
+        size_t count = voltage.sample.size();
+        if (count > sampleCapacity) {
+            count = sampleCapacity;
+            slot->flags |= SHM_FLAG_TRUNCATED;
+        }
+        ShmChannelHeader &target = slot->channels[channels++];
+        target.channel = channel;
+        target.sampleCount = (uint32_t)count;
+        target.samplerate = voltage.interval > 0.0 ? 1.0 / voltage.interval : 0.0;
+        target.gain = channel < scope->voltage.size() ? scope->gain(channel) : NAN;
+        target.offset = channel < scope->voltage.size() ? scope->voltage[channel].offset : NAN;
+        target.sampleOffset = sampleOffset;
+        std::memcpy(slotStart + sampleOffset, voltage.sample.data(), count * sizeof(double));
+        sampleOffset += aligned(sampleCapacity * sizeof(double));
+    }
+    slot->channelCount = channels;
+    if (slot->flags & SHM_FLAG_TRUNCATED) truncatedFrames->add();
+
+    // Even generation: The slot is complete
+    slot->generation.store(generation + 2, std::memory_order_release);
+    header->lastFrame.store(frame, std::memory_order_release);
+    publishedFrames->add();
+}
@@ -0,0 +1,53 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QString>
+
+#include <stddef.h>
+
+#include "post/processor.h"
+#include "sharedmemorylayout.h"
+
+struct DsoSettingsScope;
+namespace Metrics {
+class Counter;
+}
+
+/// \brief Publishes every post processing result into a POSIX shared memory ring, so that analysis tools in other
+/// processes can read the samples in place. The layout and the lock free read protocol are described in
+/// sharedmemorylayout.h. The ring is created with the first result and removed when OpenHantek exits.
+/// Only available on Unix-like systems.
+class SharedMemoryPublisher : public Processor {
+  public:
+    /// \param scope The scope settings for the channel metadata.
+    /// \param name Name of the shared memory object, e.g. "/openhantek".
+    /// \param sampleCapacity Samples per channel that fit into a slot, longer records are truncated.
+    /// \param channelCount Channels of a result, the slots only have room for these.
+    /// \param slotCount Number of frames in the ring, the time a reader has to process a frame.
+    SharedMemoryPublisher(const DsoSettingsScope *scope, const QString &name, size_t sampleCapacity,
+                          unsigned channelCount, unsigned slotCount = 8);
+    ~SharedMemoryPublisher();
+
+    virtual void process(PPresult *result) override;
+
+  private:
+    /// \brief Create and map the shared memory.
+    /// \return false if the shared memory is not available.
+    bool open();
+
+    const DsoSettingsScope *scope;
+    const QString name;
+    const size_t sampleCapacity;
+    const unsigned channelCount;
+    const unsigned slotCount;
+
+    bool failed = false;             ///< true if the shared memory couldn't be created, it isn't retried
+    size_t size = 0;                 ///< Size of the mapping
+    void *memory = nullptr;          ///< The mapping, nullptr before the first result
+    ShmRingHeader *header = nullptr; ///< The start of the mapping
+    uint64_t frame = 0;              ///< Number of the last published frame
+
+    Metrics::Counter *publishedFrames;
+    Metrics::Counter *truncatedFrames;
+};
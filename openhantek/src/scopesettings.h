@@ -2,6 +2,7 @@
 
 #pragma once
 
+#include <QPolygonF>
 #include <QString>
 
 #include "hantekdso/controlspecification.h"
@@ -22,8 +23,9 @@ struct DsoSettingsScopeHorizontal {
     unsigned int recordLength = 0; ///< Sample count
 
     /// TODO Use ControlSettingsSamplerateTarget
-    double timebase = 1e-3;  ///< Timebase in s/div
-    double samplerate = 1e6; ///< The samplerate of the oscilloscope in S
+    double timebase = 1e-3;     ///< Timebase in s/div
+    double samplerate = 1e6;    ///< The samplerate of the oscilloscope in S
+    double rollHistory = 600.0; ///< Roll mode: Duration of the rolling history in s
     enum SamplerateSource { Samplerrate, Duration } samplerateSource = Samplerrate;
 };
 
@@ -35,8 +37,75 @@ struct DsoSettingsScopeTrigger {
     Dso::Slope slope = Dso::Slope::Positive;                     ///< Rising or falling edge causes trigger
     unsigned int source = 0;                                     ///< Channel that is used as trigger source
     bool special = false;             ///< true if the trigger source is not a standard channel
-    unsigned swTriggerThreshold = 7;  ///< Software trigger, threshold
-    unsigned swTriggerSampleSet = 11; ///< Software trigger, sample set
+    double swTriggerHysteresis = 0.1; ///< Software trigger, hysteresis in divisions
+};
+
+/// \brief Holds the settings for the segmented acquisition.
+/// Every trigger event within a record is stored as a segment of one screen width.
+struct DsoSettingsScopeSegments {
+    bool enabled = false;     ///< true if trigger events are collected into the segment buffer
+    unsigned capacity = 1000; ///< Number of segments the buffer holds, the oldest ones get overwritten
+    unsigned overlay = 0;     ///< Number of most recent segments drawn on top of the live graphs
+    int review = -1;          ///< Index of the segment that is shown instead of the live graphs, -1 for none
+};
+
+/// \brief Holds the settings for the waveform averaging.
+struct DsoSettingsScopeAveraging {
+    enum class Mode : int {
+        OFF,         ///< The samples are shown as acquired
+        RUNNING,     ///< Average of the last `count` records
+        EXPONENTIAL, ///< Exponential average with a weight of 1/`count` for a new record
+        HIGHRES      ///< Boxcar average of `count` neighbouring samples within each record
+    };
+    Mode mode = Mode::OFF; ///< The averaging mode
+    unsigned count = 16;   ///< Number of averaged records or samples, 2..256
+};
+
+/// \brief Holds the settings for the mask test.
+/// The masks themselves belong to the channels, see DsoSettingsScopeVoltage.
+struct DsoSettingsScopeMask {
+    bool enabled = false;       ///< true if the waveforms are tested against the masks
+    bool stopOnFailure = false; ///< Stop the acquisition when a waveform fails
+    bool saveFailures = false;  ///< Keep the failing waveforms for the export
+    double toleranceX = 0.2;    ///< Horizontal tolerance of a mask created from a waveform in divs
+    double toleranceY = 0.4;    ///< Vertical tolerance of a mask created from a waveform in divs
+};
+
+/// \brief Holds the settings for the histogram analysis.
+/// Values are accumulated over many waveforms within a time window, the markers or the whole screen.
+struct DsoSettingsScopeHistogram {
+    enum class Mode : int {
+        OFF,          ///< No histogram
+        AMPLITUDE,    ///< Voltages of all samples within the window
+        PERIOD,       ///< Time between two edges of the trigger slope
+        PULSE_WIDTH,  ///< Time from an edge of the trigger slope to the next opposite edge
+        EDGE_POSITION ///< Time of the edges of the trigger slope relative to the trigger point
+    };
+    Mode mode = Mode::OFF;      ///< The histogram quantity
+    ChannelID channel = 0;      ///< The analyzed channel
+    bool betweenMarkers = true; ///< Limit the window to the markers, else the whole screen
+};
+
+/// \brief Holds the settings for the eye diagram.
+struct DsoSettingsScopeEye {
+    bool enabled = false;  ///< true replaces the voltage graphs by the eye diagram
+    ChannelID channel = 0; ///< The analyzed channel
+    double bitrate = 0.0;  ///< Nominal bit rate in bit/s, 0 estimates it from the shortest pulses
+};
+
+/// \brief Holds the settings for the serial protocol decoder.
+struct DsoSettingsScopeDecoder {
+    enum class Protocol : int { OFF, UART, SPI, I2C };
+    enum class Parity : int { NONE, EVEN, ODD };
+    Protocol protocol = Protocol::OFF; ///< The decoded protocol
+    ChannelID dataChannel = 0;         ///< UART RX, SPI data (MOSI or MISO) or I2C SDA
+    ChannelID clockChannel = 1;        ///< SPI clock or I2C SCL
+    double threshold = 1.4;            ///< Logic level threshold in V
+    double baudrate = 9600.0;          ///< UART bit rate in Bd
+    unsigned dataBits = 8;             ///< UART and SPI word size, 4..16
+    Parity parity = Parity::NONE;      ///< UART parity bit
+    unsigned spiMode = 0;              ///< SPI mode 0..3, bit 1 is CPOL and bit 0 is CPHA
+    bool lsbFirst = false;             ///< SPI bit order, UART always sends the LSB first
 };
 
 /// \brief Holds the settings for the spectrum analysis.
@@ -55,7 +124,10 @@ struct DsoSettingsScopeVoltage {
     double trigger = 0.0;             ///< Trigger level in V
     unsigned gainStepIndex = 6;       ///< The vertical resolution in V/div (default = 1.0)
     unsigned couplingOrMathIndex = 0; ///< Different index: coupling for real- and mode for math-channels
+    QString mathExpression;           ///< Math channels: The expression, see MathExpression
     QString name;                     ///< Name of this channel
+    QPolygonF maskUpper;              ///< Upper limit line of the mask test in divs, sorted by x, empty for none
+    QPolygonF maskLower;              ///< Lower limit line of the mask test in divs, sorted by x, empty for none
     bool inverted = false;            ///< true if the channel is inverted (mirrored on cross-axis)
     bool used = false;                ///< true if this channel is enabled
 };
@@ -68,9 +140,21 @@ struct DsoSettingsScope {
     std::vector<DsoSettingsScopeVoltage> voltage;                   ///< Settings for the normal graphs
     DsoSettingsScopeHorizontal horizontal;                          ///< Settings for the horizontal axis
     DsoSettingsScopeTrigger trigger;                                ///< Settings for the trigger
+    DsoSettingsScopeSegments segments;                              ///< Settings for the segmented acquisition
+    DsoSettingsScopeAveraging averaging;                            ///< Settings for the waveform averaging
+    DsoSettingsScopeDecoder decoder;                                ///< Settings for the protocol decoder
+    DsoSettingsScopeMask mask;                                      ///< Settings for the mask test
+    DsoSettingsScopeHistogram histogram;                            ///< Settings for the histogram analysis
+    DsoSettingsScopeEye eye;                                        ///< Settings for the eye diagram
 
     double gain(unsigned channel) const { return gainSteps[voltage[channel].gainStepIndex]; }
     bool anyUsed(ChannelID channel) { return voltage[channel].used | spectrum[channel].used; }
+    /// \brief Math channels follow the physical ones and may read all of them.
+    bool anyMathUsed(const Dso::ControlSpecification *deviceSpecification) {
+        for (ChannelID channel = deviceSpecification->channels; channel < voltage.size(); ++channel)
+            if (anyUsed(channel)) return true;
+        return false;
+    }
 
     Dso::Coupling coupling(ChannelID channel, const Dso::ControlSpecification *deviceSpecification) const {
         return deviceSpecification->couplings[voltage[channel].couplingOrMathIndex];
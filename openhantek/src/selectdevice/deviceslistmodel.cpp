@@ -3,6 +3,7 @@
 #include "usb/uploadFirmware.h"
 #include "dsomodel.h"
 #include <QColor>
+#include <thread>
 
 DevicesListModel::DevicesListModel(FindDevices *findDevices) :findDevices(findDevices) {}
 
@@ -60,15 +61,32 @@ void DevicesListModel::updateDeviceList()
     entries.clear();
     endResetModel();
     const FindDevices::DeviceList* devices = findDevices->getDevices();
+
+    // Upload the firmware to all devices in parallel, so that several scopes are ready at the same time
+    std::vector<UploadFirmware> uploads(devices->size());
+    std::vector<char> uploaded(devices->size(), false);
+    std::vector<std::thread> threads;
+    size_t index = 0;
+    for (auto &i : *devices) {
+        if (i.second->needsFirmware()) {
+            USBDevice *device = i.second.get();
+            UploadFirmware *upload = &uploads[index];
+            char *success = &uploaded[index];
+            threads.emplace_back([device, upload, success]() { *success = upload->startUpload(device); });
+        }
+        ++index;
+    }
+    for (std::thread &thread : threads) thread.join();
+
     beginInsertRows(QModelIndex(),0,(int)devices->size());
+    index = 0;
     for (auto &i : *devices) {
         DeviceListEntry entry;
         entry.name= QString::fromStdString(i.second->getModel()->name);
         entry.id = i.first;
         if (i.second->needsFirmware()) {
-            UploadFirmware uf;
-            if (!uf.startUpload(i.second.get())) {
-                entry.errorMessage = uf.getErrorMessage();
+            if (!uploaded[index]) {
+                entry.errorMessage = uploads[index].getErrorMessage();
             }
             entry.needFirmware = true;
         } else if (i.second->connectDevice(entry.errorMessage)) {
@@ -78,6 +96,7 @@ void DevicesListModel::updateDeviceList()
             entry.canConnect = false;
         }
         entries.push_back(entry);
+        ++index;
     }
     endInsertRows();
 }
@@ -78,9 +78,12 @@ std::unique_ptr<USBDevice> SelectSupportedDevice::showSelectDeviceModal(libusb_c
 
     updateSupportedDevices();
 
+    // With hotplug events the device list is only updated when devices arrive or leave, e.g. after the firmware
+    // upload. The short interval picks them up without delay.
     QTimer timer;
-    timer.setInterval(1000);
+    timer.setInterval(findDevices->startHotplug() ? 50 : 1000);
     connect(&timer, &QTimer::timeout, [this, &model, &findDevices, &messageNoDevices]() {
+        if (!findDevices->devicesChanged()) return;
         if (findDevices->updateDeviceList())
             model->updateDeviceList();
         if (model->rowCount(QModelIndex())) {
@@ -9,6 +9,9 @@
 
 #include "dsowidget.h"
 
+/// Number of math channels after the physical ones
+static const unsigned MATH_CHANNELS = 2;
+
 /// \brief Set the number of channels.
 /// \param channels The new channel count, that will be applied to lists.
 DsoSettings::DsoSettings(const Dso::ControlSpecification* deviceSpecification) {
@@ -30,20 +33,23 @@ DsoSettings::DsoSettings(const Dso::ControlSpecification* deviceSpecification) {
         view.print.spectrum.push_back(view.screen.voltage.back().darker());
     }
 
-    DsoSettingsScopeSpectrum newSpectrum;
-    newSpectrum.name = QApplication::tr("SPM");
-    scope.spectrum.push_back(newSpectrum);
-
-    DsoSettingsScopeVoltage newVoltage;
-    newVoltage.couplingOrMathIndex = (unsigned)Dso::MathMode::ADD_CH1_CH2;
-    newVoltage.name = QApplication::tr("MATH");
-    scope.voltage.push_back(newVoltage);
+    for (unsigned math = 0; math < MATH_CHANNELS; ++math) {
+        DsoSettingsScopeSpectrum newSpectrum;
+        newSpectrum.name = QApplication::tr("SPM%1").arg(math + 1);
+        scope.spectrum.push_back(newSpectrum);
 
-    view.screen.voltage.push_back(QColor(0x7f, 0x7f, 0x7f, 0xff));
-    view.screen.spectrum.push_back(view.screen.voltage.back().lighter());
-    view.print.voltage.push_back(view.screen.voltage.back());
-    view.print.spectrum.push_back(view.print.voltage.back().darker());
+        DsoSettingsScopeVoltage newVoltage;
+        newVoltage.mathExpression =
+            Dso::mathModeExpression((Dso::MathMode)math, scope.voltage[0].name, scope.voltage[1].name);
+        newVoltage.name = QApplication::tr("MATH%1").arg(math + 1);
+        scope.voltage.push_back(newVoltage);
 
+        const int grey = 0x7f + 0x40 * (int)math;
+        view.screen.voltage.push_back(QColor(grey, grey, grey, 0xff));
+        view.screen.spectrum.push_back(view.screen.voltage.back().lighter());
+        view.print.voltage.push_back(view.screen.voltage.back());
+        view.print.spectrum.push_back(view.print.voltage.back().darker());
+    }
 
     load();
 }
@@ -83,6 +89,7 @@ void DsoSettings::load() {
     if (store->contains("timebase")) scope.horizontal.timebase = store->value("timebase").toDouble();
     if (store->contains("recordLength")) scope.horizontal.recordLength = store->value("recordLength").toUInt();
     if (store->contains("samplerate")) scope.horizontal.samplerate = store->value("samplerate").toDouble();
+    if (store->contains("rollHistory")) scope.horizontal.rollHistory = store->value("rollHistory").toDouble();
     if (store->contains("samplerateSet")) scope.horizontal.samplerateSource = (DsoSettingsScopeHorizontal::SamplerateSource)store->value("samplerateSet").toInt();
     store->endGroup();
     // Trigger
@@ -92,6 +99,54 @@ void DsoSettings::load() {
     if (store->contains("slope")) scope.trigger.slope = (Dso::Slope)store->value("slope").toUInt();
     if (store->contains("source")) scope.trigger.source = store->value("source").toUInt();
     if (store->contains("special")) scope.trigger.special = store->value("special").toInt();
+    if (store->contains("hysteresis")) scope.trigger.swTriggerHysteresis = store->value("hysteresis").toDouble();
+    store->endGroup();
+    // Segmented acquisition
+    store->beginGroup("segments");
+    if (store->contains("enabled")) scope.segments.enabled = store->value("enabled").toBool();
+    if (store->contains("capacity")) scope.segments.capacity = store->value("capacity").toUInt();
+    if (store->contains("overlay")) scope.segments.overlay = store->value("overlay").toUInt();
+    store->endGroup();
+    // Averaging
+    store->beginGroup("averaging");
+    if (store->contains("mode"))
+        scope.averaging.mode = (DsoSettingsScopeAveraging::Mode)store->value("mode").toInt();
+    if (store->contains("count")) scope.averaging.count = store->value("count").toUInt();
+    store->endGroup();
+    // Mask test
+    store->beginGroup("mask");
+    if (store->contains("enabled")) scope.mask.enabled = store->value("enabled").toBool();
+    if (store->contains("stopOnFailure")) scope.mask.stopOnFailure = store->value("stopOnFailure").toBool();
+    if (store->contains("saveFailures")) scope.mask.saveFailures = store->value("saveFailures").toBool();
+    if (store->contains("toleranceX")) scope.mask.toleranceX = store->value("toleranceX").toDouble();
+    if (store->contains("toleranceY")) scope.mask.toleranceY = store->value("toleranceY").toDouble();
+    store->endGroup();
+    // Histogram
+    store->beginGroup("histogram");
+    if (store->contains("mode"))
+        scope.histogram.mode = (DsoSettingsScopeHistogram::Mode)store->value("mode").toInt();
+    if (store->contains("channel")) scope.histogram.channel = store->value("channel").toUInt();
+    if (store->contains("betweenMarkers")) scope.histogram.betweenMarkers = store->value("betweenMarkers").toBool();
+    store->endGroup();
+    // Eye diagram
+    store->beginGroup("eye");
+    if (store->contains("enabled")) scope.eye.enabled = store->value("enabled").toBool();
+    if (store->contains("channel")) scope.eye.channel = store->value("channel").toUInt();
+    if (store->contains("bitrate")) scope.eye.bitrate = store->value("bitrate").toDouble();
+    store->endGroup();
+    // Protocol decoder
+    store->beginGroup("decoder");
+    if (store->contains("protocol"))
+        scope.decoder.protocol = (DsoSettingsScopeDecoder::Protocol)store->value("protocol").toInt();
+    if (store->contains("dataChannel")) scope.decoder.dataChannel = store->value("dataChannel").toUInt();
+    if (store->contains("clockChannel")) scope.decoder.clockChannel = store->value("clockChannel").toUInt();
+    if (store->contains("threshold")) scope.decoder.threshold = store->value("threshold").toDouble();
+    if (store->contains("baudrate")) scope.decoder.baudrate = store->value("baudrate").toDouble();
+    if (store->contains("dataBits")) scope.decoder.dataBits = store->value("dataBits").toUInt();
+    if (store->contains("parity"))
+        scope.decoder.parity = (DsoSettingsScopeDecoder::Parity)store->value("parity").toInt();
+    if (store->contains("spiMode")) scope.decoder.spiMode = store->value("spiMode").toUInt();
+    if (store->contains("lsbFirst")) scope.decoder.lsbFirst = store->value("lsbFirst").toBool();
     store->endGroup();
     // Spectrum
     for (ChannelID channel = 0; channel < scope.spectrum.size(); ++channel) {
@@ -106,8 +161,18 @@ void DsoSettings::load() {
     for (ChannelID channel = 0; channel < scope.voltage.size(); ++channel) {
         store->beginGroup(QString("vertical%1").arg(channel));
         if (store->contains("gainStepIndex")) scope.voltage[channel].gainStepIndex = store->value("gainStepIndex").toUInt();
-        if (store->contains("couplingOrMathIndex")) scope.voltage[channel].couplingOrMathIndex = store->value("couplingIndex").toUInt();
+        if (store->contains("couplingOrMathIndex")) scope.voltage[channel].couplingOrMathIndex = store->value("couplingOrMathIndex").toUInt();
+        if (store->contains("mathExpression"))
+            scope.voltage[channel].mathExpression = store->value("mathExpression").toString();
+        else if (!scope.voltage[channel].mathExpression.isEmpty() && store->contains("couplingOrMathIndex"))
+            // Settings of older versions only have the math mode
+            scope.voltage[channel].mathExpression = Dso::mathModeExpression(
+                Dso::getMathMode(scope.voltage[channel]), scope.voltage[0].name, scope.voltage[1].name);
         if (store->contains("inverted")) scope.voltage[channel].inverted = store->value("inverted").toBool();
+        if (store->contains("maskUpper"))
+            scope.voltage[channel].maskUpper = store->value("maskUpper").value<QPolygonF>();
+        if (store->contains("maskLower"))
+            scope.voltage[channel].maskLower = store->value("maskLower").value<QPolygonF>();
         if (store->contains("offset")) scope.voltage[channel].offset = store->value("offset").toDouble();
         if (store->contains("trigger")) scope.voltage[channel].trigger = store->value("trigger").toDouble();
         if (store->contains("used")) scope.voltage[channel].used = store->value("used").toBool();
@@ -120,6 +185,19 @@ void DsoSettings::load() {
         post.spectrumReference = store->value("spectrumReference").toDouble();
     if (store->contains("spectrumWindow"))
         post.spectrumWindow = (Dso::WindowFunction)store->value("spectrumWindow").toInt();
+    if (store->contains("spectrumAveraging"))
+        post.spectrumAveraging = (Dso::SpectrumAveraging)store->value("spectrumAveraging").toInt();
+    if (store->contains("spectrumAverageCount"))
+        post.spectrumAverageCount = store->value("spectrumAverageCount").toUInt();
+    if (store->contains("spectrogramLength")) post.spectrogramLength = store->value("spectrogramLength").toUInt();
+    if (store->contains("spectrogramOverlap"))
+        post.spectrogramOverlap = store->value("spectrogramOverlap").toDouble();
+    if (store->contains("filterType")) post.filterType = (Dso::FilterType)store->value("filterType").toInt();
+    if (store->contains("filterDesign")) post.filterDesign = (Dso::FilterDesign)store->value("filterDesign").toInt();
+    if (store->contains("filterFrequency")) post.filterFrequency = store->value("filterFrequency").toDouble();
+    if (store->contains("filterBandwidth")) post.filterBandwidth = store->value("filterBandwidth").toDouble();
+    if (store->contains("filterOrder")) post.filterOrder = store->value("filterOrder").toUInt();
+    if (store->contains("filterTaps")) post.filterTaps = store->value("filterTaps").toUInt();
     store->endGroup();
 
     // View
@@ -159,6 +237,10 @@ void DsoSettings::load() {
         view.interpolation = (Dso::InterpolationMode)store->value("interpolation").toInt();
     if (store->contains("screenColorImages")) view.screenColorImages = store->value("screenColorImages").toBool();
     if (store->contains("zoom")) view.zoom = (Dso::InterpolationMode)store->value("zoom").toBool();
+    if (store->contains("waterfall")) view.waterfall = store->value("waterfall").toBool();
+    if (store->contains("waterfallDepth")) view.waterfallDepth = store->value("waterfallDepth").toUInt();
+    if (store->contains("xyDensity")) view.xyDensity = store->value("xyDensity").toBool();
+    if (store->contains("xyPersistence")) view.xyPersistence = store->value("xyPersistence").toDouble();
     store->endGroup();
 
     store->beginGroup("window");
@@ -188,6 +270,7 @@ void DsoSettings::save() {
     store->setValue("timebase", scope.horizontal.timebase);
     store->setValue("recordLength", scope.horizontal.recordLength);
     store->setValue("samplerate", scope.horizontal.samplerate);
+    store->setValue("rollHistory", scope.horizontal.rollHistory);
     store->setValue("samplerateSet", (int)scope.horizontal.samplerateSource);
     store->endGroup();
     // Trigger
@@ -197,6 +280,49 @@ void DsoSettings::save() {
     store->setValue("slope", (unsigned)scope.trigger.slope);
     store->setValue("source", scope.trigger.source);
     store->setValue("special", scope.trigger.special);
+    store->setValue("hysteresis", scope.trigger.swTriggerHysteresis);
+    store->endGroup();
+    // Segmented acquisition
+    store->beginGroup("segments");
+    store->setValue("enabled", scope.segments.enabled);
+    store->setValue("capacity", scope.segments.capacity);
+    store->setValue("overlay", scope.segments.overlay);
+    store->endGroup();
+    store->beginGroup("averaging");
+    store->setValue("mode", (int)scope.averaging.mode);
+    store->setValue("count", scope.averaging.count);
+    store->endGroup();
+    // Mask test
+    store->beginGroup("mask");
+    store->setValue("enabled", scope.mask.enabled);
+    store->setValue("stopOnFailure", scope.mask.stopOnFailure);
+    store->setValue("saveFailures", scope.mask.saveFailures);
+    store->setValue("toleranceX", scope.mask.toleranceX);
+    store->setValue("toleranceY", scope.mask.toleranceY);
+    store->endGroup();
+    // Histogram
+    store->beginGroup("histogram");
+    store->setValue("mode", (int)scope.histogram.mode);
+    store->setValue("channel", scope.histogram.channel);
+    store->setValue("betweenMarkers", scope.histogram.betweenMarkers);
+    store->endGroup();
+    // Eye diagram
+    store->beginGroup("eye");
+    store->setValue("enabled", scope.eye.enabled);
+    store->setValue("channel", scope.eye.channel);
+    store->setValue("bitrate", scope.eye.bitrate);
+    store->endGroup();
+    // Protocol decoder
+    store->beginGroup("decoder");
+    store->setValue("protocol", (int)scope.decoder.protocol);
+    store->setValue("dataChannel", scope.decoder.dataChannel);
+    store->setValue("clockChannel", scope.decoder.clockChannel);
+    store->setValue("threshold", scope.decoder.threshold);
+    store->setValue("baudrate", scope.decoder.baudrate);
+    store->setValue("dataBits", scope.decoder.dataBits);
+    store->setValue("parity", (int)scope.decoder.parity);
+    store->setValue("spiMode", scope.decoder.spiMode);
+    store->setValue("lsbFirst", scope.decoder.lsbFirst);
     store->endGroup();
     // Spectrum
     for (ChannelID channel = 0; channel < scope.spectrum.size(); ++channel) {
@@ -211,7 +337,11 @@ void DsoSettings::save() {
         store->beginGroup(QString("vertical%1").arg(channel));
         store->setValue("gainStepIndex", scope.voltage[channel].gainStepIndex);
         store->setValue("couplingOrMathIndex", scope.voltage[channel].couplingOrMathIndex);
+        if (!scope.voltage[channel].mathExpression.isEmpty())
+            store->setValue("mathExpression", scope.voltage[channel].mathExpression);
         store->setValue("inverted", scope.voltage[channel].inverted);
+        store->setValue("maskUpper", QVariant::fromValue(scope.voltage[channel].maskUpper));
+        store->setValue("maskLower", QVariant::fromValue(scope.voltage[channel].maskLower));
         store->setValue("offset", scope.voltage[channel].offset);
         store->setValue("trigger", scope.voltage[channel].trigger);
         store->setValue("used", scope.voltage[channel].used);
@@ -222,6 +352,16 @@ void DsoSettings::save() {
     store->setValue("spectrumLimit", post.spectrumLimit);
     store->setValue("spectrumReference", post.spectrumReference);
     store->setValue("spectrumWindow", (int)post.spectrumWindow);
+    store->setValue("spectrumAveraging", (int)post.spectrumAveraging);
+    store->setValue("spectrumAverageCount", post.spectrumAverageCount);
+    store->setValue("spectrogramLength", post.spectrogramLength);
+    store->setValue("spectrogramOverlap", post.spectrogramOverlap);
+    store->setValue("filterType", (int)post.filterType);
+    store->setValue("filterDesign", (int)post.filterDesign);
+    store->setValue("filterFrequency", post.filterFrequency);
+    store->setValue("filterBandwidth", post.filterBandwidth);
+    store->setValue("filterOrder", post.filterOrder);
+    store->setValue("filterTaps", post.filterTaps);
     store->endGroup();
 
     // View
@@ -258,6 +398,10 @@ void DsoSettings::save() {
     store->setValue("interpolation", view.interpolation);
     store->setValue("screenColorImages", view.screenColorImages);
     store->setValue("zoom", view.zoom);
+    store->setValue("waterfall", view.waterfall);
+    store->setValue("waterfallDepth", view.waterfallDepth);
+    store->setValue("xyDensity", view.xyDensity);
+    store->setValue("xyPersistence", view.xyPersistence);
     store->endGroup();
 
     store->beginGroup("window");
@@ -200,93 +200,74 @@ static bool ezusb_fx3_jump(libusb_device_handle *device, uint32_t addr) {
 /*****************************************************************************/
 
 /*
- * Parse an Intel HEX image file and invoke the poke() function on the
- * various segments to implement policies such as writing to RAM (with
- * a one or two stage loader setup, depending on the firmware) or to
- * EEPROM (two stages required).
+ * Parse an Intel HEX image in memory into segments of contiguous data,
+ * sorted by address.  Each line holds a max of 16 bytes (usually), but
+ * uploading is faster if we merge those lines into larger chunks.  The
+ * records are collected into a memory image first, so that records that
+ * aren't sorted by address are merged as well and a later record
+ * overwrites an earlier one like with a sequential upload.
  *
- * image       - the hex image file
- * context     - for use by poke()
- * is_external - if non-null, used to check which segments go into
- *               external memory (writable only by software loader)
- * poke        - called with each memory segment; errors indicated
- *               by returning negative values.
- *
- * Caller is responsible for halting CPU as needed, such as when
- * overwriting a second stage loader.
+ * Only data (0) and EOF (1) records are supported, the addresses are
+ * limited to 64 KBytes.
  */
-static int parse_ihex(FILE *image, void *context, bool (*is_external)(uint32_t addr, size_t len),
-                      int (*poke)(void *context, uint32_t addr, bool external, const unsigned char *data, size_t len)) {
-    unsigned char data[1023];
-    uint32_t data_addr = 0;
-    size_t data_len = 0;
-    int rc;
-    int first_line = 1;
-    bool external = false;
-
-    /* Read the input file as an IHEX file, and report the memory segments
-     * as we go.  Each line holds a max of 16 bytes, but uploading is
-     * faster (and EEPROM space smaller) if we merge those lines into larger
-     * chunks.  Most hex files keep memory segments together, which makes
-     * such merging all but free.  (But it may still be worth sorting the
-     * hex files to make up for undesirable behavior from tools.)
-     *
-     * Note that EEPROM segments max out at 1023 bytes; the upload protocol
-     * allows segments of up to 64 KBytes (more than a loader could handle).
-     */
-    for (;;) {
-        char buf[512], *cp;
-        char tmp, type;
-        size_t len;
-        unsigned idx, off;
-
-        cp = fgets(buf, sizeof(buf), image);
-        if (cp == NULL) {
-            logerror("EOF without EOF record!\n");
-            break;
-        }
+int ezusb_parse_ihex(const char *image, size_t length, std::vector<ezusb_segment> &segments) {
+    std::vector<unsigned char> memory(0x10000);
+    std::vector<bool> used(0x10000);
+    const char *end = image + length;
+    bool eof = false;
+
+    segments.clear();
+    for (const char *line = image; line < end && !eof;) {
+        const char *next = (const char *)memchr(line, '\n', end - line);
+        if (!next) next = end;
+        size_t lineLength = next - line;
+        const char *cp = line;
+        line = next + 1;
+
+        /* ignore any newline and empty lines */
+        while (lineLength && (cp[lineLength - 1] == '\r' || cp[lineLength - 1] == '\n')) --lineLength;
+        if (lineLength == 0) continue;
 
         /* EXTENSION: "# comment-till-end-of-line", for copyrights etc */
-        if (buf[0] == '#') continue;
+        if (cp[0] == '#') continue;
 
-        if (buf[0] != ':') {
-            logerror("not an ihex record: %s", buf);
+        if (cp[0] != ':' || lineLength < 11) {
+            logerror("not an ihex record: %.*s\n", (int)lineLength, cp);
             return -2;
         }
 
-        /* ignore any newline */
-        cp = strchr(buf, '\n');
-        if (cp) *cp = 0;
-
+        char buf[512];
+        if (lineLength >= sizeof(buf)) {
+            logerror("record too long\n");
+            return -4;
+        }
+        memcpy(buf, cp, lineLength);
+        buf[lineLength] = 0;
         if (verbose >= 3) logerror("** LINE: %s\n", buf);
 
+        char tmp;
         /* Read the length field (up to 16 bytes) */
         tmp = buf[3];
         buf[3] = 0;
-        len = strtoul(buf + 1, NULL, 16);
+        size_t len = strtoul(buf + 1, NULL, 16);
         buf[3] = tmp;
 
         /* Read the target offset (address up to 64KB) */
         tmp = buf[7];
         buf[7] = 0;
-        off = (int)strtoul(buf + 3, NULL, 16);
+        uint32_t off = (uint32_t)strtoul(buf + 3, NULL, 16);
         buf[7] = tmp;
 
-        /* Initialize data_addr */
-        if (first_line) {
-            data_addr = off;
-            first_line = 0;
-        }
-
         /* Read the record type */
         tmp = buf[9];
         buf[9] = 0;
-        type = (char)strtoul(buf + 7, NULL, 16);
+        unsigned type = (unsigned)strtoul(buf + 7, NULL, 16);
         buf[9] = tmp;
 
         /* If this is an EOF record, then make it so. */
         if (type == 1) {
             if (verbose >= 2) logerror("EOF on hexfile\n");
+            eof = true;
             break;
         }
 
@@ -295,39 +276,36 @@ static int parse_ihex(FILE *image, void *context, bool (*is_external)(uint32_t a
             return -3;
         }
 
-        if ((len * 2) + 11 > strlen(buf)) {
+        if ((len * 2) + 11 > lineLength) {
             logerror("record too short?\n");
             return -4;
         }
-
-        /* flush the saved data if it's not contiguous,
-        * or when we've buffered as much as we can.
-        */
-        if (data_len != 0 && (off != (data_addr + data_len)
-                              /* || !merge */
-                              || (data_len + len) > sizeof(data))) {
-            if (is_external) external = is_external(data_addr, data_len);
-            rc = poke(context, data_addr, external, data, data_len);
-            if (rc < 0) return -1;
-            data_addr = off;
-            data_len = 0;
+        if (off + len > memory.size()) {
+            logerror("record beyond 64 KBytes at 0x%04x\n", off);
+            return -4;
         }
 
-        /* append to saved data, flush later */
-        for (idx = 0, cp = buf + 9; idx < len; idx += 1, cp += 2) {
-            tmp = cp[2];
-            cp[2] = 0;
-            data[data_len + idx] = (uint8_t)strtoul(cp, NULL, 16);
-            cp[2] = tmp;
+        for (size_t idx = 0; idx < len; ++idx) {
+            char byte[3] = {buf[9 + 2 * idx], buf[10 + 2 * idx], 0};
+            memory[off + idx] = (uint8_t)strtoul(byte, NULL, 16);
+            used[off + idx] = true;
         }
-        data_len += len;
     }
+    if (!eof) logerror("EOF without EOF record!\n");
 
-    /* flush any data remaining */
-    if (data_len != 0) {
-        if (is_external) external = is_external(data_addr, data_len);
-        rc = poke(context, data_addr, external, data, data_len);
-        if (rc < 0) return -1;
+    /* Collect the contiguous runs */
+    for (uint32_t addr = 0; addr < memory.size();) {
+        if (!used[addr]) {
+            ++addr;
+            continue;
+        }
+        uint32_t last = addr;
+        while (last < memory.size() && used[last]) ++last;
+        ezusb_segment segment;
+        segment.addr = addr;
+        segment.data.assign(memory.begin() + addr, memory.begin() + last);
+        segments.push_back(std::move(segment));
+        addr = last;
     }
     return 0;
 }
@@ -530,9 +508,64 @@ exit:
 }
 
 /*
- * Load a firmware file into target RAM. device is the open libusb
- * device, and the path is the name of the source file. Open the file,
- * parse the bytes, and write them in one or two phases.
+ * Largest write request. The loaders accept up to 64 KBytes, but some
+ * platforms (e.g. Linux usbfs) limit control transfers to one page.
+ */
+#define MAX_WRITE_LENGTH 4096
+
+/*
+ * Return the first address after addr where a write has to be split, so
+ * that no write mixes on-chip and external memory.
+ */
+static uint32_t ezusb_next_boundary(int fx_type, uint32_t addr) {
+    static const uint32_t fx_boundaries[] = {0x1b40};
+    static const uint32_t fx2_boundaries[] = {0x2000, 0xe000, 0xe200};
+    static const uint32_t fx2lp_boundaries[] = {0x4000, 0xe000, 0xe200};
+    const uint32_t *boundaries;
+    size_t count;
+
+    switch (fx_type) {
+    case FX_TYPE_FX2LP:
+        boundaries = fx2lp_boundaries;
+        count = sizeof(fx2lp_boundaries) / sizeof(fx2lp_boundaries[0]);
+        break;
+    case FX_TYPE_FX2:
+        boundaries = fx2_boundaries;
+        count = sizeof(fx2_boundaries) / sizeof(fx2_boundaries[0]);
+        break;
+    default:
+        boundaries = fx_boundaries;
+        count = sizeof(fx_boundaries) / sizeof(fx_boundaries[0]);
+        break;
+    }
+    for (size_t idx = 0; idx < count; ++idx)
+        if (boundaries[idx] > addr) return boundaries[idx];
+    return UINT32_MAX;
+}
+
+/*
+ * Write the segments in as few requests as possible.
+ */
+static int ezusb_poke_segments(struct ram_poke_context *ctx, const std::vector<ezusb_segment> &segments, int fx_type,
+                               bool (*is_external)(uint32_t off, size_t len)) {
+    for (const ezusb_segment &segment : segments) {
+        for (size_t done = 0; done < segment.data.size();) {
+            const uint32_t addr = segment.addr + (uint32_t)done;
+            size_t len = segment.data.size() - done;
+            if (len > MAX_WRITE_LENGTH) len = MAX_WRITE_LENGTH;
+            const uint32_t boundary = ezusb_next_boundary(fx_type, addr);
+            if (boundary != UINT32_MAX && addr + len > boundary) len = boundary - addr;
+            if (ram_poke(ctx, addr, is_external(addr, len), segment.data.data() + done, len) < 0) return -1;
+            done += len;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Load a parsed firmware image into target RAM. device is the open libusb
+ * device, the segments are the result of ezusb_parse_ihex(). They are
+ * written in one or two phases.
  *
  * If stage == 0, this uses the first stage loader, built into EZ-USB
  * hardware but limited to writing on-chip memory or CPUCS.  Everything
@@ -541,25 +574,14 @@ exit:
  *
  * Otherwise, things are written in two stages.  First the external
  * memory is written, expecting a second stage loader to have already
- * been loaded.  Then file is re-parsed and on-chip memory is written.
+ * been loaded.  Then the on-chip memory is written.
  */
-int ezusb_load_ram(libusb_device_handle *device, const char *path, int fx_type, int stage) {
-    FILE *image;
+int ezusb_load_ram_segments(libusb_device_handle *device, const std::vector<ezusb_segment> &segments, int fx_type,
+                            int stage) {
     uint32_t cpucs_addr;
     bool (*is_external)(uint32_t off, size_t len);
     struct ram_poke_context ctx;
     int status;
-    int ret = 0;
-
-    if (fx_type == FX_TYPE_FX3) return fx3_load_ram(device, path);
-
-    image = fopen(path, "rb");
-    if (image == NULL) {
-        logerror("%s: unable to open for input.\n", path);
-        return -2;
-    } else if (verbose > 1)
-        logerror("open firmware image %s for RAM upload\n", path);
-
 
     /* EZ-USB original/FX and FX2 devices differ, apart from the 8051 core */
     switch (fx_type) {
@@ -582,10 +604,7 @@ int ezusb_load_ram(libusb_device_handle *device, const char *path, int fx_type,
         ctx.mode = internal_only;
 
         /* if required, halt the CPU while we overwrite its code/data */
-        if (cpucs_addr && !ezusb_cpucs(device, cpucs_addr, false)) {
-            ret = -1;
-            goto exit;
-        }
+        if (cpucs_addr && !ezusb_cpucs(device, cpucs_addr, false)) return -1;
 
         /* 2nd stage, first part? loader was already uploaded */
     } else {
@@ -595,34 +614,28 @@ int ezusb_load_ram(libusb_device_handle *device, const char *path, int fx_type,
         if (verbose) logerror("2nd stage: write external memory\n");
     }
 
-    /* scan the image, first (maybe only) time */
+    /* write the image, first (maybe only) time */
     ctx.device = device;
     ctx.total = ctx.count = 0;
-    status = parse_ihex(image, &ctx, is_external, ram_poke);
+    status = ezusb_poke_segments(&ctx, segments, fx_type, is_external);
     if (status < 0) {
-        logerror("unable to upload %s\n", path);
-        ret = status;
-        goto exit;
+        logerror("unable to upload the firmware\n");
+        return status;
     }
 
-    /* second part of 2nd stage: rescan */
+    /* second part of 2nd stage: write again */
     if (stage) {
         ctx.mode = skip_external;
 
         /* if needed, halt the CPU while we overwrite the 1st stage loader */
-        if (cpucs_addr && !ezusb_cpucs(device, cpucs_addr, false)) {
-            ret = -1;
-            goto exit;
-        }
+        if (cpucs_addr && !ezusb_cpucs(device, cpucs_addr, false)) return -1;
 
         /* at least write the interrupt vectors (at 0x0000) for reset! */
-        rewind(image);
         if (verbose) logerror("2nd stage: write on-chip memory\n");
-        status = parse_ihex(image, &ctx, is_external, ram_poke);
+        status = ezusb_poke_segments(&ctx, segments, fx_type, is_external);
         if (status < 0) {
-            logerror("unable to completely upload %s\n", path);
-            ret = status;
-            goto exit;
+            logerror("unable to completely upload the firmware\n");
+            return status;
         }
     }
 
@@ -632,9 +645,34 @@ int ezusb_load_ram(libusb_device_handle *device, const char *path, int fx_type,
     }
 
     /* if required, reset the CPU so it runs what we just uploaded */
-    if (cpucs_addr && !ezusb_cpucs(device, cpucs_addr, true)) ret = -1;
+    if (cpucs_addr && !ezusb_cpucs(device, cpucs_addr, true)) return -1;
+    return 0;
+}
 
-exit:
+/*
+ * Load a firmware file into target RAM, see ezusb_load_ram_segments().
+ */
+int ezusb_load_ram(libusb_device_handle *device, const char *path, int fx_type, int stage) {
+    FILE *image;
+    std::vector<char> content;
+    std::vector<ezusb_segment> segments;
+    char buf[4096];
+    size_t read;
+
+    if (fx_type == FX_TYPE_FX3) return fx3_load_ram(device, path);
+
+    image = fopen(path, "rb");
+    if (image == NULL) {
+        logerror("%s: unable to open for input.\n", path);
+        return -2;
+    } else if (verbose > 1)
+        logerror("open firmware image %s for RAM upload\n", path);
+    while ((read = fread(buf, 1, sizeof(buf), image)) > 0) content.insert(content.end(), buf, buf + read);
     fclose(image);
-    return ret;
+
+    if (ezusb_parse_ihex(content.data(), content.size(), segments) < 0) {
+        logerror("unable to upload %s\n", path);
+        return -1;
+    }
+    return ezusb_load_ram_segments(device, segments, fx_type, stage);
 }
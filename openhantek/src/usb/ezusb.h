@@ -21,12 +21,36 @@
  */
 
 #include <inttypes.h>
+#include <stddef.h>
+#include <vector>
 
 struct libusb_device_handle;
 #define FX_TYPE_FX2 2   /* USB 2.0 versions */
 #define FX_TYPE_FX2LP 3 /* Updated FX2 */
 #define FX_TYPE_FX3 4   /* USB 3.0 versions */
 
+/*
+ * Contiguous data of a firmware image.
+ */
+struct ezusb_segment {
+    uint32_t addr;
+    std::vector<unsigned char> data;
+};
+
+/*
+ * This function parses an Intel HEX image into contiguous segments,
+ * sorted by address. Returns a negative value on error.
+ */
+extern int ezusb_parse_ihex(const char *image, size_t length, std::vector<ezusb_segment> &segments);
+
+/*
+ * This function uploads the firmware segments into RAM, the stages are
+ * the same as for ezusb_load_ram(). Adjacent segments are written with
+ * the largest possible requests.
+ */
+extern int ezusb_load_ram_segments(libusb_device_handle *device, const std::vector<ezusb_segment> &segments,
+                                   int fx_type, int stage);
+
 /*
  * This function uploads the firmware from the given file into RAM.
  * Stage == 0 means this is a single stage load (or the first of
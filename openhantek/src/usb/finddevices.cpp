@@ -16,6 +16,55 @@
 
 FindDevices::FindDevices(libusb_context *context) : context(context) {}
 
+FindDevices::~FindDevices() {
+    if (!hotplug) return;
+#ifdef LIBUSB_HOTPLUG_MATCH_ANY
+    libusb_hotplug_deregister_callback(context, hotplugHandle);
+#endif
+    hotplugRunning = false;
+    if (hotplugThread.joinable()) hotplugThread.join();
+}
+
+#ifdef LIBUSB_HOTPLUG_MATCH_ANY
+/// Called by libusb from the hotplug event thread. The device list is updated in the thread of the caller.
+static int LIBUSB_CALL hotplugCallback(libusb_context *, libusb_device *, libusb_hotplug_event, void *userData) {
+    static_cast<std::atomic<bool> *>(userData)->store(true);
+    return 0;
+}
+#endif
+
+bool FindDevices::startHotplug() {
+#ifdef LIBUSB_HOTPLUG_MATCH_ANY
+    if (hotplug) return true;
+    if (!libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG)) return false;
+    libusb_hotplug_callback_handle handle;
+    const int errorCode = libusb_hotplug_register_callback(
+        context, (libusb_hotplug_event)(LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED | LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT),
+        (libusb_hotplug_flag)0, LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY,
+        hotplugCallback, &changed, &handle);
+    if (errorCode != LIBUSB_SUCCESS) return false;
+    hotplugHandle = handle;
+    hotplug = true;
+    hotplugRunning = true;
+    hotplugThread = std::thread(&FindDevices::hotplugEventLoop, this);
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool FindDevices::devicesChanged() {
+    if (!hotplug) return true;
+    return changed.exchange(false);
+}
+
+void FindDevices::hotplugEventLoop() {
+    while (hotplugRunning) {
+        timeval timeout = {0, 100000};
+        libusb_handle_events_timeout_completed(context, &timeout, nullptr);
+    }
+}
+
 // Iterate through all usb devices
 int FindDevices::updateDeviceList() {
     libusb_device **deviceList;
@@ -47,7 +96,7 @@ int FindDevices::updateDeviceList() {
             supported |= descriptor.idVendor == model->vendorIDnoFirmware && descriptor.idProduct == model->productIDnoFirmware;
             if (supported) {
                 ++changes;
-                devices[USBDevice::computeUSBdeviceID(device)] = std::unique_ptr<USBDevice>(new USBDevice(model, device, findIteration));
+                devices[USBDevice::computeUSBdeviceID(device)] = std::unique_ptr<USBDevice>(new USBDevice(model, device, context, findIteration));
             }
         }
     }
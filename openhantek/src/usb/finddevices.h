@@ -3,9 +3,11 @@
 #pragma once
 
 #include <QString>
+#include <atomic>
 #include <memory>
 #include <map>
 #include <list>
+#include <thread>
 
 #include "usbdevice.h"
 
@@ -14,7 +16,8 @@ struct libusb_context;
 /**
  * @brief Search for Hantek devices.
  * Use usually want to call `updateDeviceList` and then retrieve the list via `getDevices`.
- * You can call `updateDeviceList` as often as you want.
+ * You can call `updateDeviceList` as often as you want. After `startHotplug` it is enough to call it when
+ * `devicesChanged` returns true.
  * If you have found your favorite device, you want to call `takeDevice`. The device will
  * not be available in `getDevices` anymore and this will not change with calls to `updateDeviceList`.
  *
@@ -24,6 +27,7 @@ class FindDevices{
   public:
     typedef std::map<UniqueUSBid, std::unique_ptr<USBDevice>> DeviceList;
     FindDevices(libusb_context *context);
+    ~FindDevices();
     /// Updates the device list. To clear the list, just dispose this object
     /// \return If negative it represents a libusb error code otherwise the amount of updates
     int updateDeviceList();
@@ -34,8 +38,21 @@ class FindDevices{
      * @return A shared reference to the
      */
     std::unique_ptr<USBDevice> takeDevice(UniqueUSBid id);
+    /// Watch for arriving and leaving usb devices with libusb hotplug events, handled by an own thread.
+    /// \return false if hotplug events are not supported on this platform, poll `updateDeviceList` then.
+    bool startHotplug();
+    /// \return true if usb devices arrived or left since the last call. Always true without hotplug events.
+    bool devicesChanged();
   private:
+    void hotplugEventLoop();
     libusb_context *context; ///< The usb context used for this device
     DeviceList devices;
     unsigned findIteration = 0;
+
+    // Hotplug events
+    bool hotplug = false;                    ///< true if the hotplug callback is registered
+    int hotplugHandle = 0;                   ///< The libusb_hotplug_callback_handle
+    std::atomic<bool> changed{true};         ///< Set by the hotplug callback
+    std::atomic<bool> hotplugRunning{false}; ///< Keeps the event thread running
+    std::thread hotplugThread;
 };
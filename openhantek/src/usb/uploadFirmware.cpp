@@ -2,9 +2,11 @@
 
 #include <QCoreApplication>
 #include <QDebug>
+#include <QFile>
+#include <QMutex>
 #include <QString>
-#include <QTemporaryFile>
 #include <libusb-1.0/libusb.h>
+#include <map>
 #include <memory>
 
 #include "ezusb.h"
@@ -15,6 +17,24 @@
 
 #define TR(str) QCoreApplication::translate("UploadFirmware", str)
 
+/// \brief Parse a firmware image of the resources, every image is only parsed once.
+/// \return The segments of the image, nullptr if it can't be read. Valid until the program ends.
+static const std::vector<ezusb_segment> *firmwareImage(const QString &resource) {
+    static QMutex mutex;
+    static std::map<QString, std::vector<ezusb_segment>> images;
+
+    QMutexLocker locker(&mutex);
+    auto cached = images.find(resource);
+    if (cached != images.end()) return &cached->second;
+
+    QFile file(resource);
+    if (!file.open(QIODevice::ReadOnly)) return nullptr;
+    const QByteArray content = file.readAll();
+    std::vector<ezusb_segment> segments;
+    if (ezusb_parse_ihex(content.constData(), (size_t)content.size(), segments) < 0) return nullptr;
+    return &(images[resource] = std::move(segments));
+}
+
 bool UploadFirmware::startUpload(USBDevice *device) {
     if (device->isConnected() || !device->needsFirmware()) return false;
 
@@ -27,16 +47,15 @@ bool UploadFirmware::startUpload(USBDevice *device) {
         return false;
     }
 
-    // Write firmware from resources to temp files
-    QFile firmwareRes(
-        QString(":/firmware/%1-firmware.hex").arg(QString::fromStdString(device->getModel()->firmwareToken)));
-    auto temp_firmware_path = std::unique_ptr<QTemporaryFile>(QTemporaryFile::createNativeFile(firmwareRes));
-    if (!temp_firmware_path) return false;
-    temp_firmware_path->open();
-    QFile loaderRes(QString(":/firmware/%1-loader.hex").arg(QString::fromStdString(device->getModel()->firmwareToken)));
-    auto temp_loader_path = std::unique_ptr<QTemporaryFile>(QTemporaryFile::createNativeFile(loaderRes));
-    if (!temp_loader_path) return false;
-    temp_loader_path->open();
+    // The firmware is taken from the resources directly
+    const QString token = QString::fromStdString(device->getModel()->firmwareToken);
+    const std::vector<ezusb_segment> *firmware = firmwareImage(QString(":/firmware/%1-firmware.hex").arg(token));
+    const std::vector<ezusb_segment> *loader = firmwareImage(QString(":/firmware/%1-loader.hex").arg(token));
+    if (!firmware || !loader) {
+        errorMessage = TR("The firmware for %1 is missing").arg(token);
+        libusb_close(handle);
+        return false;
+    }
 
     /* We need to claim the first interface */
     libusb_set_auto_detach_kernel_driver(handle, 1);
@@ -48,7 +67,7 @@ bool UploadFirmware::startUpload(USBDevice *device) {
     }
 
     // Write loader
-    status = ezusb_load_ram(handle, temp_loader_path->fileName().toUtf8().constData(), FX_TYPE_FX2, 0);
+    status = ezusb_load_ram_segments(handle, *loader, FX_TYPE_FX2, 0);
 
     if (status != LIBUSB_SUCCESS) {
         errorMessage = TR("Writing the loader firmware failed: %1").arg(libusb_error_name(status));
@@ -58,7 +77,7 @@ bool UploadFirmware::startUpload(USBDevice *device) {
     }
 
     // Write firmware
-    status = ezusb_load_ram(handle, temp_firmware_path->fileName().toUtf8().constData(), FX_TYPE_FX2, 1);
+    status = ezusb_load_ram_segments(handle, *firmware, FX_TYPE_FX2, 1);
 
     if (status != LIBUSB_SUCCESS) {
         errorMessage = TR("Writing the main firmware failed: %1").arg(libusb_error_name(status));
@@ -8,7 +8,9 @@ class USBDevice;
 
 /**
  * Extracts the firmware from the applications resources, and uploads the
- * firmware to the given device.
+ * firmware to the given device. The images are parsed once and kept in
+ * memory. Uploads to different devices may run in parallel threads, with
+ * one object per device.
  */
 class UploadFirmware {
   public:
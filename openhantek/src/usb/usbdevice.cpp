@@ -9,6 +9,7 @@
 #include "hantekdso/dsomodel.h"
 #include "hantekprotocol/bulkStructs.h"
 #include "hantekprotocol/controlStructs.h"
+#include "utils/metrics.h"
 
 #include <QCoreApplication>
 
@@ -51,12 +52,29 @@ UniqueUSBid USBDevice::computeUSBdeviceID(libusb_device *device) {
     return v;
 }
 
-USBDevice::USBDevice(DSOModel *model, libusb_device *device, unsigned findIteration)
-    : model(model), device(device), findIteration(findIteration), uniqueUSBdeviceID(computeUSBdeviceID(device)) {
+USBDevice::USBDevice(DSOModel *model, libusb_device *device, libusb_context *context, unsigned findIteration)
+    : model(model), device(device), context(context), findIteration(findIteration),
+      uniqueUSBdeviceID(computeUSBdeviceID(device)) {
+    setMetricsName(QString());
     libusb_ref_device(device);
     libusb_get_device_descriptor(device, &descriptor);
 }
 
+void USBDevice::setMetricsName(const QString &name) {
+    const QString prefix = name.isEmpty() ? QString("usb.") : "usb." + name + ".";
+    Metrics::Registry *metrics = Metrics::Registry::get();
+    bytesIn = metrics->counter(prefix + "bytesIn", Metrics::Counter::Unit::BYTES);
+    bytesOut = metrics->counter(prefix + "bytesOut", Metrics::Counter::Unit::BYTES);
+    transferErrors = metrics->counter(prefix + "errors");
+    transferRetries = metrics->counter(prefix + "retries");
+    transfers = metrics->counter(prefix + "transfers");
+    controlReads = metrics->counter(prefix + "controlReads");
+}
+
+uint64_t USBDevice::getTransferCount() const { return transfers->get(); }
+
+uint64_t USBDevice::getControlReadCount() const { return controlReads->get(); }
+
 bool USBDevice::connectDevice(QString &errorMessage) {
     if (needsFirmware()) return false;
     if (isConnected()) return true;
@@ -126,6 +144,9 @@ void USBDevice::disconnectFromDevice() {
     if (!device) return;
 
     if (this->handle) {
+        // Return all pending transfers before the handle is closed
+        stream.reset();
+
         // Release claimed interface
         if (this->interface != -1) libusb_release_interface(this->handle, this->interface);
         this->interface = -1;
@@ -152,15 +173,21 @@ int USBDevice::bulkTransfer(unsigned char endpoint, const unsigned char *data, u
 
     int errorCode = LIBUSB_ERROR_TIMEOUT;
     int transferred = 0;
-    for (int attempt = 0; (attempt < attempts || attempts == -1) && errorCode == LIBUSB_ERROR_TIMEOUT; ++attempt)
+    for (int attempt = 0; (attempt < attempts || attempts == -1) && errorCode == LIBUSB_ERROR_TIMEOUT; ++attempt) {
+        if (attempt) transferRetries->add();
+        transfers->add();
         errorCode =
             libusb_bulk_transfer(this->handle, endpoint, (unsigned char *)data, (int)length, &transferred, timeout);
+    }
 
     if (errorCode == LIBUSB_ERROR_NO_DEVICE) disconnectFromDevice();
-    if (errorCode < 0)
+    if (errorCode < 0) {
+        transferErrors->add();
         return errorCode;
-    else
-        return transferred;
+    }
+
+    ((endpoint & LIBUSB_ENDPOINT_IN) ? bytesIn : bytesOut)->add((unsigned)transferred);
+    return transferred;
 }
 
 int USBDevice::bulkReadMulti(unsigned char *data, unsigned length, int attempts) {
@@ -181,15 +208,36 @@ int USBDevice::bulkReadMulti(unsigned char *data, unsigned length, int attempts)
         return errorCode;
 }
 
+int USBDevice::startStream(unsigned transferLength, unsigned transferCount, USBStream::Receiver receiver) {
+    if (!this->handle) return LIBUSB_ERROR_NO_DEVICE;
+
+    if (!stream)
+        stream = std::unique_ptr<USBStream>(
+            new USBStream(context, this->handle, HANTEK_EP_IN, bytesIn, transferErrors));
+    return stream->start(transferLength, transferCount, std::move(receiver));
+}
+
+void USBDevice::stopStream() {
+    if (stream) stream->stop();
+}
+
 int USBDevice::controlTransfer(unsigned char type, unsigned char request, unsigned char *data, unsigned int length,
                                int value, int index, int attempts) {
     if (!this->handle) return LIBUSB_ERROR_NO_DEVICE;
 
     int errorCode = LIBUSB_ERROR_TIMEOUT;
-    for (int attempt = 0; (attempt < attempts || attempts == -1) && errorCode == LIBUSB_ERROR_TIMEOUT; ++attempt)
+    for (int attempt = 0; (attempt < attempts || attempts == -1) && errorCode == LIBUSB_ERROR_TIMEOUT; ++attempt) {
+        if (attempt) transferRetries->add();
+        transfers->add();
+        if (type & LIBUSB_ENDPOINT_IN) controlReads->add();
         errorCode = libusb_control_transfer(this->handle, type, request, value, index, data, length, HANTEK_TIMEOUT);
+    }
 
     if (errorCode == LIBUSB_ERROR_NO_DEVICE) disconnectFromDevice();
+    if (errorCode < 0)
+        transferErrors->add();
+    else
+        ((type & LIBUSB_ENDPOINT_IN) ? bytesIn : bytesOut)->add((unsigned)errorCode);
     return errorCode;
 }
 
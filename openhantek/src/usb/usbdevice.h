@@ -8,8 +8,12 @@
 #include <memory>
 
 #include "usbdevicedefinitions.h"
+#include "usbstream.h"
 
 class DSOModel;
+namespace Metrics {
+class Counter;
+}
 
 typedef unsigned long UniqueUSBid;
 
@@ -25,7 +29,8 @@ class USBDevice : public QObject {
     Q_OBJECT
 
   public:
-    explicit USBDevice(DSOModel* model, libusb_device *device, unsigned findIteration = 0);
+    explicit USBDevice(DSOModel* model, libusb_device *device, libusb_context *context = nullptr,
+                       unsigned findIteration = 0);
     USBDevice(const USBDevice&) = delete;
     ~USBDevice();
     bool connectDevice(QString &errorMessage);
@@ -116,6 +121,23 @@ class USBDevice : public QObject {
                                HANTEK_ATTEMPTS);
     }
 
+    /// \brief Start a continuous read of the IN endpoint with several transfers in flight.
+    /// Other transfers on the IN endpoint must not be used while the stream is running.
+    /// \param transferLength The size of each transfer.
+    /// \param transferCount The number of queued transfers.
+    /// \param receiver Called with the received data from the usb event thread.
+    /// \return LIBUSB_SUCCESS or a libusb error code.
+    int startStream(unsigned transferLength, unsigned transferCount, USBStream::Receiver receiver);
+
+    /// \brief Stop the continuous read, all pending transfers are cancelled.
+    void stopStream();
+
+    /// \return true if the continuous read is running
+    inline bool isStreaming() const { return stream && stream->isRunning(); }
+
+    /// \return The libusb error that stopped the continuous read, LIBUSB_SUCCESS otherwise
+    inline int streamError() const { return stream ? stream->lastError() : LIBUSB_SUCCESS; }
+
     /**
      * @return Returns the raw libusb device
      */
@@ -144,6 +166,16 @@ class USBDevice : public QObject {
      * that much data though and need an artification restriction.
      */
     inline void overwriteInPacketLength(int len) { inPacketLength = len; }
+
+    /// \brief Count the throughput and errors of this device separately, e.g. "usb.dev1.bytesIn" instead of
+    /// "usb.bytesIn". Call it before the device is used.
+    /// \param name The device name in the metric names.
+    void setMetricsName(const QString &name);
+
+    /// \return The number of synchronous transfers (round trips) to this device so far, including retries.
+    uint64_t getTransferCount() const;
+    /// \return The number of control reads from this device so far, including retries.
+    uint64_t getControlReadCount() const;
   protected:
     int claimInterface(const libusb_interface_descriptor *interfaceDescriptor, int endpointOut, int endPointIn);
 
@@ -153,12 +185,22 @@ class USBDevice : public QObject {
     // Libusb specific variables
     struct libusb_device_descriptor descriptor;
     libusb_device *device; ///< The USB handle for the oscilloscope
+    libusb_context *context; ///< The libusb context the device was found in
     libusb_device_handle *handle = nullptr;
+    std::unique_ptr<USBStream> stream; ///< The continuous read, if started
     unsigned findIteration;
     const unsigned long uniqueUSBdeviceID;
     int interface;
     int outPacketLength; ///< Packet length for the OUT endpoint
     int inPacketLength;  ///< Packet length for the IN endpoint
+
+    // Throughput and error statistics
+    Metrics::Counter *bytesIn;
+    Metrics::Counter *bytesOut;
+    Metrics::Counter *transferErrors;
+    Metrics::Counter *transferRetries;
+    Metrics::Counter *transfers;    ///< Synchronous bulk and control transfers, every attempt is a round trip
+    Metrics::Counter *controlReads; ///< Control transfers from the device, every attempt is a round trip
   signals:
     void deviceDisconnected(); ///< The device has been disconnected
 };
@@ -0,0 +1,111 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include "usbstream.h"
+#include "usbdevicedefinitions.h"
+#include "utils/metrics.h"
+
+USBStream::USBStream(libusb_context *context, libusb_device_handle *handle, unsigned char endpoint,
+                     Metrics::Counter *bytesIn, Metrics::Counter *transferErrors)
+    : context(context), handle(handle), endpoint(endpoint), bytesIn(bytesIn), transferErrors(transferErrors) {}
+
+USBStream::~USBStream() { stop(); }
+
+int USBStream::start(unsigned transferLength, unsigned transferCount, Receiver receiver) {
+    stop();
+    this->receiver = std::move(receiver);
+    error = LIBUSB_SUCCESS;
+    running = true;
+
+    buffers.resize(transferCount);
+    for (unsigned index = 0; index < transferCount; ++index) {
+        libusb_transfer *transfer = libusb_alloc_transfer(0);
+        if (!transfer) {
+            error = LIBUSB_ERROR_NO_MEM;
+            break;
+        }
+        transfers.push_back(transfer);
+        buffers[index].resize(transferLength);
+        // A timeout makes sure that stop() never waits for a device that stopped sending
+        libusb_fill_bulk_transfer(transfer, handle, endpoint, buffers[index].data(), (int)transferLength,
+                                  &USBStream::transferCompleted, this, HANTEK_TIMEOUT);
+        const int errorCode = libusb_submit_transfer(transfer);
+        if (errorCode < 0) {
+            error = errorCode;
+            break;
+        }
+        ++inFlight;
+    }
+
+    if (error != LIBUSB_SUCCESS) {
+        transferErrors->add();
+        stop();
+        return error;
+    }
+
+    eventThread = std::thread(&USBStream::eventLoop, this);
+    return LIBUSB_SUCCESS;
+}
+
+void USBStream::stop() {
+    running = false;
+    for (libusb_transfer *transfer : transfers) libusb_cancel_transfer(transfer);
+
+    if (eventThread.joinable())
+        eventThread.join();
+    else
+        // The event thread didn't start, collect the cancelled transfers here
+        while (inFlight > 0) {
+            timeval timeout = {0, 100000};
+            libusb_handle_events_timeout_completed(context, &timeout, nullptr);
+        }
+    freeTransfers();
+}
+
+void USBStream::freeTransfers() {
+    for (libusb_transfer *transfer : transfers) libusb_free_transfer(transfer);
+    transfers.clear();
+    buffers.clear();
+}
+
+void USBStream::eventLoop() {
+    // Keep handling events until all cancelled transfers are returned
+    while (running || inFlight > 0) {
+        timeval timeout = {0, 100000};
+        libusb_handle_events_timeout_completed(context, &timeout, nullptr);
+    }
+}
+
+void LIBUSB_CALL USBStream::transferCompleted(libusb_transfer *transfer) {
+    USBStream *self = static_cast<USBStream *>(transfer->user_data);
+
+    switch (transfer->status) {
+    case LIBUSB_TRANSFER_COMPLETED:
+    case LIBUSB_TRANSFER_TIMED_OUT:
+        // A timed out transfer may still contain data
+        if (transfer->actual_length > 0) {
+            self->bytesIn->add((unsigned)transfer->actual_length);
+            if (self->running) self->receiver(transfer->buffer, transfer->actual_length);
+        }
+        if (self->running) {
+            const int errorCode = libusb_submit_transfer(transfer);
+            if (errorCode == LIBUSB_SUCCESS) return;
+            self->transferErrors->add();
+            self->error = errorCode;
+            self->running = false;
+        }
+        break;
+    case LIBUSB_TRANSFER_CANCELLED:
+        break;
+    case LIBUSB_TRANSFER_NO_DEVICE:
+        self->transferErrors->add();
+        self->error = LIBUSB_ERROR_NO_DEVICE;
+        self->running = false;
+        break;
+    default:
+        self->transferErrors->add();
+        self->error = LIBUSB_ERROR_IO;
+        self->running = false;
+        break;
+    }
+    --self->inFlight;
+}
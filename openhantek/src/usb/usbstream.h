@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <libusb-1.0/libusb.h>
+
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace Metrics {
+class Counter;
+}
+
+/// \brief Continuous bulk IN transfer with several requests in flight.
+/// A blocking bulk read leaves the endpoint idle between two requests, the device buffer may overflow meanwhile.
+/// This class keeps a number of asynchronous transfers queued back to back, so the host controller always has
+/// a pending request. Completed transfers are handed to the receiver and submitted again immediately. The
+/// libusb events are handled by an own thread, the receiver is called from that thread.
+class USBStream {
+  public:
+    /// Called with the data of every completed transfer, in order
+    typedef std::function<void(const unsigned char *data, int length)> Receiver;
+
+    /// \param context The libusb context of the device, nullptr for the default context
+    /// \param handle The opened device
+    /// \param endpoint The bulk IN endpoint
+    /// \param bytesIn Counts the received bytes
+    /// \param transferErrors Counts failed transfers
+    USBStream(libusb_context *context, libusb_device_handle *handle, unsigned char endpoint,
+              Metrics::Counter *bytesIn, Metrics::Counter *transferErrors);
+    USBStream(const USBStream &) = delete;
+    ~USBStream();
+
+    /// \brief Allocate and submit the transfers and start the event thread.
+    /// \param transferLength The size of each transfer, a multiple of the packet size
+    /// \param transferCount The number of transfers in flight
+    /// \param receiver Called for every completed transfer
+    /// \return LIBUSB_SUCCESS or the libusb error code of the first failed submission
+    int start(unsigned transferLength, unsigned transferCount, Receiver receiver);
+
+    /// \brief Cancel all transfers and wait until they are returned by libusb.
+    void stop();
+
+    /// \return true while transfers are in flight. A device error stops the stream.
+    inline bool isRunning() const { return running; }
+    /// \return The libusb error that stopped the stream, LIBUSB_SUCCESS otherwise
+    inline int lastError() const { return error; }
+
+  private:
+    static void LIBUSB_CALL transferCompleted(libusb_transfer *transfer);
+    void eventLoop();
+    void freeTransfers();
+
+    libusb_context *context;
+    libusb_device_handle *handle;
+    const unsigned char endpoint;
+    Metrics::Counter *bytesIn;
+    Metrics::Counter *transferErrors;
+
+    Receiver receiver;
+    std::vector<libusb_transfer *> transfers;
+    std::vector<std::vector<unsigned char>> buffers;
+    std::atomic<bool> running{false}; ///< Resubmit completed transfers
+    std::atomic<int> inFlight{0};     ///< Number of submitted transfers not yet returned by libusb
+    std::atomic<int> error{LIBUSB_SUCCESS};
+    std::thread eventThread;
+};
@@ -0,0 +1,170 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include "metrics.h"
+
+#include <QDebug>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutexLocker>
+#include <QTextStream>
+
+namespace Metrics {
+
+Histogram::Histogram(const QString &name) : name(name) {
+    for (auto &bucket : buckets) bucket.store(0, std::memory_order_relaxed);
+}
+
+void Histogram::record(qint64 nanoseconds) {
+    if (nanoseconds < 0) nanoseconds = 0;
+    const uint64_t ns = (uint64_t)nanoseconds;
+
+    // Bucket index is the bit length of the duration in microseconds
+    unsigned index = 0;
+    for (uint64_t us = ns / 1000; us && index < BUCKETS - 1; us >>= 1) ++index;
+
+    buckets[index].fetch_add(1, std::memory_order_relaxed);
+    sumNs.fetch_add(ns, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t currentMax = maxNs.load(std::memory_order_relaxed);
+    while (ns > currentMax && !maxNs.compare_exchange_weak(currentMax, ns, std::memory_order_relaxed)) {}
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+    Snapshot s;
+    s.count = count.load(std::memory_order_relaxed);
+    s.sumNs = sumNs.load(std::memory_order_relaxed);
+    s.maxNs = maxNs.load(std::memory_order_relaxed);
+    for (unsigned i = 0; i < BUCKETS; ++i) s.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+    return s;
+}
+
+double Histogram::Snapshot::mean() const { return count ? (double)sumNs / count / 1e6 : 0.0; }
+
+double Histogram::Snapshot::percentile(double fraction) const {
+    uint64_t total = 0;
+    for (unsigned i = 0; i < BUCKETS; ++i) total += buckets[i];
+    if (!total) return 0.0;
+
+    const double target = fraction * total;
+    uint64_t accumulated = 0;
+    for (unsigned i = 0; i < BUCKETS; ++i) {
+        accumulated += buckets[i];
+        if (accumulated >= target) return (double)(1ull << i) / 1e3;
+    }
+    return max();
+}
+
+double Snapshot::counterRate(size_t index, const Snapshot &previous) const {
+    const double seconds = (timestamp - previous.timestamp) / 1e3;
+    if (seconds <= 0.0) return 0.0;
+    const uint64_t last = index < previous.counters.size() ? previous.counters[index].value : 0;
+    return (counters[index].value - last) / seconds;
+}
+
+double Snapshot::histogramRate(size_t index, const Snapshot &previous) const {
+    const double seconds = (timestamp - previous.timestamp) / 1e3;
+    if (seconds <= 0.0) return 0.0;
+    const uint64_t last = index < previous.histograms.size() ? previous.histograms[index].value.count : 0;
+    return (histograms[index].value.count - last) / seconds;
+}
+
+QString Snapshot::toText(const Snapshot &previous) const {
+    QString text;
+    QTextStream stream(&text);
+    stream << "time " << timestamp << " ms\n";
+    for (size_t i = 0; i < counters.size(); ++i)
+        stream << counters[i].name << " " << counters[i].value << " (" << counterRate(i, previous) << "/s)\n";
+    for (size_t i = 0; i < histograms.size(); ++i) {
+        const Histogram::Snapshot &h = histograms[i].value;
+        stream << histograms[i].name << " n=" << h.count << " (" << histogramRate(i, previous) << "/s)"
+               << " mean=" << h.mean() << "ms p50=" << h.percentile(0.5) << "ms p95=" << h.percentile(0.95)
+               << "ms max=" << h.max() << "ms\n";
+    }
+    stream.flush();
+    return text;
+}
+
+QByteArray Snapshot::toJson(const Snapshot &previous) const {
+    QJsonObject counterObjects;
+    for (size_t i = 0; i < counters.size(); ++i) {
+        QJsonObject c;
+        c["value"] = (double)counters[i].value;
+        c["rate"] = counterRate(i, previous);
+        counterObjects[counters[i].name] = c;
+    }
+    QJsonObject histogramObjects;
+    for (size_t i = 0; i < histograms.size(); ++i) {
+        const Histogram::Snapshot &h = histograms[i].value;
+        QJsonObject o;
+        o["count"] = (double)h.count;
+        o["rate"] = histogramRate(i, previous);
+        o["mean"] = h.mean();
+        o["p50"] = h.percentile(0.5);
+        o["p95"] = h.percentile(0.95);
+        o["max"] = h.max();
+        histogramObjects[histograms[i].name] = o;
+    }
+    QJsonObject root;
+    root["time"] = (double)timestamp;
+    root["counters"] = counterObjects;
+    root["histograms"] = histogramObjects;
+    return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
+
+Registry *Registry::instance = new Registry();
+
+Registry *Registry::get() { return instance; }
+
+Registry::Registry() { uptime.start(); }
+
+Counter *Registry::counter(const QString &name, Counter::Unit unit) {
+    QMutexLocker locker(&mutex);
+    for (auto &c : counters)
+        if (c->name == name) return c.get();
+    counters.emplace_back(new Counter(name, unit));
+    return counters.back().get();
+}
+
+Histogram *Registry::histogram(const QString &name) {
+    QMutexLocker locker(&mutex);
+    for (auto &h : histograms)
+        if (h->name == name) return h.get();
+    histograms.emplace_back(new Histogram(name));
+    return histograms.back().get();
+}
+
+Snapshot Registry::snapshot() const {
+    QMutexLocker locker(&mutex);
+    Snapshot s;
+    s.timestamp = uptime.elapsed();
+    for (auto &c : counters) s.counters.push_back({c->name, c->unit, c->get()});
+    for (auto &h : histograms) s.histograms.push_back({h->name, h->snapshot()});
+    return s;
+}
+
+Logger::Logger(const QString &filename, int intervalMs) : file(filename) {
+    json = filename.endsWith(".json");
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+        qWarning() << "Could not open metrics log" << filename << file.errorString();
+        return;
+    }
+    previous = Registry::get()->snapshot();
+    QObject::connect(&timer, &QTimer::timeout, [this]() { write(); });
+    timer.start(intervalMs);
+}
+
+void Logger::write() {
+    Snapshot now = Registry::get()->snapshot();
+    if (json) {
+        file.write(now.toJson(previous));
+        file.write("\n");
+    } else {
+        file.write(now.toText(previous).toUtf8());
+        file.write("\n");
+    }
+    file.flush();
+    previous = std::move(now);
+}
+}
@@ -0,0 +1,143 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutex>
+#include <QString>
+#include <QTimer>
+
+#include <atomic>
+#include <inttypes.h>
+#include <list>
+#include <memory>
+#include <vector>
+
+/// Light-weight, lock free instrumentation of the acquisition and processing pipeline.
+/// Metrics are created once via the Registry and can then be updated from any thread.
+namespace Metrics {
+
+/// \brief A monotonic counter, e.g. for transferred bytes or errors.
+class Counter {
+  public:
+    /// The unit of the counted value. Used for formatting only.
+    enum class Unit { EVENTS, BYTES };
+
+    Counter(const QString &name, Unit unit) : name(name), unit(unit) {}
+    inline void add(uint64_t amount = 1) { value.fetch_add(amount, std::memory_order_relaxed); }
+    inline uint64_t get() const { return value.load(std::memory_order_relaxed); }
+
+    const QString name;
+    const Unit unit;
+
+  private:
+    std::atomic<uint64_t> value{0};
+};
+
+/// \brief A latency histogram with logarithmic buckets.
+/// Bucket i counts durations below 2^i microseconds, the last bucket collects everything above.
+class Histogram {
+  public:
+    static const unsigned BUCKETS = 24;
+
+    struct Snapshot {
+        uint64_t count = 0;
+        uint64_t sumNs = 0;
+        uint64_t maxNs = 0;
+        uint64_t buckets[BUCKETS] = {0};
+        /// \return Mean duration in milliseconds
+        double mean() const;
+        /// \return Upper bound of the bucket that contains the given fraction (0..1) of all recordings in ms.
+        double percentile(double fraction) const;
+        /// \return Maximum duration in milliseconds
+        inline double max() const { return maxNs / 1e6; }
+    };
+
+    explicit Histogram(const QString &name);
+    void record(qint64 nanoseconds);
+    Snapshot snapshot() const;
+
+    const QString name;
+
+  private:
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> sumNs{0};
+    std::atomic<uint64_t> maxNs{0};
+    std::atomic<uint64_t> buckets[BUCKETS];
+};
+
+/// \brief Measures the lifetime of this object and records it into a histogram.
+class ScopedTimer {
+  public:
+    explicit ScopedTimer(Histogram *histogram) : histogram(histogram) { timer.start(); }
+    ~ScopedTimer() { histogram->record(timer.nsecsElapsed()); }
+
+  private:
+    Histogram *histogram;
+    QElapsedTimer timer;
+};
+
+/// \brief A point in time copy of all metrics.
+/// Metrics are never removed, so the n-th entry of an older snapshot refers to the same metric.
+struct Snapshot {
+    struct CounterValue {
+        QString name;
+        Counter::Unit unit;
+        uint64_t value;
+    };
+    struct HistogramValue {
+        QString name;
+        Histogram::Snapshot value;
+    };
+    qint64 timestamp = 0; ///< Milliseconds since the registry was created
+    std::vector<CounterValue> counters;
+    std::vector<HistogramValue> histograms;
+
+    /// \return Increments per second of the given counter since the previous snapshot.
+    double counterRate(size_t index, const Snapshot &previous) const;
+    /// \return Recordings per second of the given histogram since the previous snapshot.
+    double histogramRate(size_t index, const Snapshot &previous) const;
+
+    /// \brief Human readable representation, one metric per line.
+    QString toText(const Snapshot &previous) const;
+    /// \brief Compact one-line JSON object representation.
+    QByteArray toJson(const Snapshot &previous) const;
+};
+
+/// \brief Owns all metrics of the application.
+/// Pointers returned by counter() and histogram() stay valid for the lifetime of the program.
+class Registry {
+  public:
+    static Registry *get();
+    /// \return The counter with the given name, it is created if necessary.
+    Counter *counter(const QString &name, Counter::Unit unit = Counter::Unit::EVENTS);
+    /// \return The histogram with the given name, it is created if necessary.
+    Histogram *histogram(const QString &name);
+    Snapshot snapshot() const;
+
+  private:
+    Registry();
+    static Registry *instance;
+    mutable QMutex mutex;
+    QElapsedTimer uptime;
+    std::list<std::unique_ptr<Counter>> counters;
+    std::list<std::unique_ptr<Histogram>> histograms;
+};
+
+/// \brief Periodically appends a snapshot of all metrics to a file.
+/// The file is written as JSON lines if the filename ends with ".json", as plain text otherwise.
+class Logger {
+  public:
+    Logger(const QString &filename, int intervalMs = 1000);
+    bool isOpen() const { return file.isOpen(); }
+
+  private:
+    void write();
+    QFile file;
+    QTimer timer;
+    bool json;
+    Snapshot previous;
+};
+}
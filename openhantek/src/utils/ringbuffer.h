@@ -0,0 +1,85 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <inttypes.h>
+#include <vector>
+
+/// \brief Lock free single producer ring buffer with random access for any number of readers.
+/// Every element has an absolute position, counted from the first element ever written. Readers can copy
+/// any window that is still held by the buffer, the producer never waits for readers. If a reader is too slow,
+/// the data is overwritten and `read()` reports it by returning 0.
+template <class T> class RingBuffer {
+  public:
+    explicit RingBuffer(size_t capacity = 0) : buffer(capacity) {}
+    RingBuffer(const RingBuffer &) = delete;
+
+    /// \brief Resize and empty the buffer. Not thread safe.
+    void reset(size_t capacity) {
+        buffer.assign(capacity, T());
+        reserved.store(0, std::memory_order_relaxed);
+        head.store(0, std::memory_order_release);
+    }
+
+    inline size_t capacity() const { return buffer.size(); }
+
+    /// \return The number of elements written since the last reset, which is the position of the next element
+    inline uint64_t written() const { return head.load(std::memory_order_acquire); }
+
+    /// \return The position of the oldest element that is still available
+    inline uint64_t oldest() const {
+        const uint64_t end = written();
+        return end > buffer.size() ? end - buffer.size() : 0;
+    }
+
+    /// \brief Append elements. Must only be called by the producer.
+    void write(const T *data, size_t count) {
+        if (buffer.empty()) return;
+        uint64_t position = head.load(std::memory_order_relaxed);
+        // Only the last `capacity` elements can be stored
+        if (count > buffer.size()) {
+            position += count - buffer.size();
+            data += count - buffer.size();
+            count = buffer.size();
+        }
+        // Announce the overwritten range before touching the data, see read()
+        reserved.store(position + count, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        const size_t start = (size_t)(position % buffer.size());
+        const size_t first = std::min(count, buffer.size() - start);
+        std::copy(data, data + first, buffer.begin() + start);
+        std::copy(data + first, data + count, buffer.begin());
+        head.store(position + count, std::memory_order_release);
+    }
+
+    /// \brief Copy a window of the buffer.
+    /// \param from Absolute position of the first element
+    /// \param out Receives the elements
+    /// \param count Number of elements to copy
+    /// \return The number of valid elements copied to the start of `out`. This is less than `count` if the window
+    /// reaches beyond the written data. 0 if the window start has already been overwritten.
+    size_t read(uint64_t from, T *out, size_t count) const {
+        const uint64_t end = written();
+        if (from >= end || buffer.empty()) return 0;
+        count = (size_t)std::min<uint64_t>(count, end - from);
+        if (from + buffer.size() < end) return 0;
+
+        const size_t start = (size_t)(from % buffer.size());
+        const size_t first = std::min(count, buffer.size() - start);
+        std::copy(buffer.begin() + start, buffer.begin() + start + first, out);
+        std::copy(buffer.begin(), buffer.begin() + (count - first), out + first);
+
+        // The producer may have started to overwrite the window while it was copied
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (from + buffer.size() < reserved.load(std::memory_order_relaxed)) return 0;
+        return count;
+    }
+
+  private:
+    std::vector<T> buffer;
+    std::atomic<uint64_t> head{0};     ///< Position of the next element, everything before is readable
+    std::atomic<uint64_t> reserved{0}; ///< End of the range the producer is writing or has written
+};
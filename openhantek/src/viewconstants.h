@@ -5,3 +5,5 @@
 #define DIVS_TIME 10.0f   ///< Number of horizontal screen divs
 #define DIVS_VOLTAGE 8.0f ///< Number of vertical screen divs
 #define DIVS_SUB 5       ///< Number of sub-divisions per div
+#define XY_DENSITY_WIDTH 500  ///< Horizontal cells of the XY density map, 50 per div
+#define XY_DENSITY_HEIGHT 400 ///< Vertical cells of the XY density map, 50 per div
@@ -42,6 +42,10 @@ struct DsoSettingsView {
     Dso::InterpolationMode interpolation = Dso::INTERPOLATION_LINEAR; ///< Interpolation mode for the graph
     bool screenColorImages = false;                                   ///< true exports images with screen colors
     bool zoom = false;                                                ///< true if the magnified scope is enabled
+    bool waterfall = false;                                           ///< true shows the spectrum history
+    unsigned waterfallDepth = 256;                                    ///< Number of spectrum rows of the waterfall
+    bool xyDensity = false;                                           ///< true draws the XY graphs as intensity map
+    double xyPersistence = 0.8;                                       ///< XY intensity share kept per frame, 0..0.99
 
     unsigned digitalPhosphorDraws() const {
         return digitalPhosphor ? digitalPhosphorDepth : 1;